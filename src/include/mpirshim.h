@@ -43,6 +43,20 @@ typedef enum {
     MPIR_SHIM_ATTACH_MODE
 } mpir_shim_mode_t;
 
+/**
+ * Where the held application processes stop for the debugger
+ *  - STOP_IN_INIT = Stop in PMIx_Init (Default)
+ *  - STOP_ON_EXEC = Stop at the first instruction after exec
+ *  - STOP_IN_APP  = Stop at an application-specific point
+ *  - STOP_NONE    = Do not hold the application processes
+ */
+typedef enum {
+    MPIR_SHIM_STOP_IN_INIT = 0,
+    MPIR_SHIM_STOP_ON_EXEC,
+    MPIR_SHIM_STOP_IN_APP,
+    MPIR_SHIM_STOP_NONE
+} mpir_shim_stop_point_t;
+
 /**
  * @name   MPIR_Shim_common
  * @brief  Common top-level processing for this module, used when this module is
@@ -59,4 +73,456 @@ typedef enum {
 int MPIR_Shim_common(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
                      int argc, char *argv[], const char *pmix_prefix_);
 
+/**
+ * @name   MPIR_Shim_add_job
+ * @brief  Queue an additional launcher command line to be run in the same
+ *         session as the one passed to MPIR_Shim_common. All of the jobs are
+ *         launched concurrently, share one PMIx tool connection, and are
+ *         published in one MPIR_proctable, in the order they were specified.
+ *         Must be called before MPIR_Shim_common. Not valid in attach mode.
+ * @param  argc: Number of launcher and application command line arguments
+ * @param  argv: Array of launcher and application command line arguments, terminated with NULL entry.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_add_job(int argc, char *argv[]);
+
+/**
+ * @name   MPIR_Shim_get_job_view
+ * @brief  Get the slice of MPIR_proctable that belongs to one job. Valid once
+ *         MPIR_Breakpoint has been called.
+ * @param  job_index: Index of the job. Job 0 is the one passed to
+ *         MPIR_Shim_common, followed by the MPIR_Shim_add_job jobs in order.
+ * @param  offset: Set to the index of the first MPIR_proctable entry of the job
+ * @param  size: Set to the number of MPIR_proctable entries of the job
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_get_job_view(int job_index, int *offset, int *size);
+
+/**
+ * @name   MPIR_Shim_set_stop_point
+ * @brief  Select where the application processes stop for the debugger and
+ *         which ranks are held. Ranks that are not held run freely. Applies to
+ *         every job of the session and must be called before MPIR_Shim_common.
+ *         Ignored in attach mode.
+ * @param  stop_point_: Where the held processes stop
+ * @param  ranks: Comma separated ranks and rank ranges to hold, such as
+ *         "0-15,32", or NULL to hold every rank
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_stop_point(mpir_shim_stop_point_t stop_point_, const char *ranks);
+
+/**
+ * @name   MPIR_Shim_set_tool_daemon
+ * @brief  Set the command line of a tool daemon that the launcher starts on
+ *         every node hosting application processes, once per job, before
+ *         MPIR_Breakpoint is called. The daemons are published in the
+ *         MPIR_Shim_daemon_table array. Must be called before MPIR_Shim_common.
+ * @param  argc: Number of daemon command line arguments
+ * @param  argv: Array of daemon command line arguments, terminated with NULL entry.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_tool_daemon(int argc, char *argv[]);
+
+/**
+ * @name   MPIR_Shim_set_signal_forwarding
+ * @brief  Forward the given signals, received by this process, to every
+ *         process of the application with one PMIx job control request per
+ *         job, so the launcher delivers them through its own tree. A stack
+ *         dump trigger such as SIGQUIT then reaches all of the ranks in one
+ *         step. SIGHUP, SIGINT and SIGTERM shut down the shim unless they
+ *         are listed. Must be called before MPIR_Shim_common.
+ * @param  signals: Comma separated signal names, with or without the "SIG"
+ *         prefix, or numbers, such as "USR1,USR2,QUIT"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_signal_forwarding(const char *signals);
+
+/**
+ * @name   MPIR_Shim_set_job_control_signals
+ * @brief  Pause every application process when this process receives SIGTSTP
+ *         (such as Ctrl-Z), and resume them on SIGCONT, instead of stopping
+ *         this process. The time taken is reported on stderr. Must be called
+ *         before MPIR_Shim_common.
+ * @param  enable: Non-zero to enable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_job_control_signals(int enable);
+
+/**
+ * @name   MPIR_Shim_pause_application
+ * @brief  Pause every process of the application of a job with one PMIx job
+ *         control request, sent through the launcher's tree. Returns once all
+ *         of the processes have acknowledged it. Valid once MPIR_Breakpoint
+ *         has been called, for example to take a consistent snapshot.
+ * @param  job_index: Index of the job (0 for a single job)
+ * @param  elapsed_ms_: Set to the time until the last process stopped, in
+ *         milliseconds, if not NULL
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_pause_application(int job_index, double *elapsed_ms_);
+
+/**
+ * @name   MPIR_Shim_resume_application
+ * @brief  Resume every process of the application of a job paused with
+ *         MPIR_Shim_pause_application. Returns once all of the processes have
+ *         acknowledged it.
+ * @param  job_index: Index of the job (0 for a single job)
+ * @param  elapsed_ms_: Set to the time until the last process resumed, in
+ *         milliseconds, if not NULL
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_resume_application(int job_index, double *elapsed_ms_);
+
+/**
+ * @name   MPIR_Shim_set_stdin_target
+ * @brief  Forward the standard input of this process to application
+ *         processes of the first job with PMIx_IOF_push. A regular file is
+ *         pushed in large slices from a memory mapping, and a pipe or
+ *         terminal is read in large chunks. Must be called before
+ *         MPIR_Shim_common.
+ * @param  targets: "none" (default), "all", or a rank list such as "0" or
+ *         "0-15,32"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_stdin_target(const char *targets);
+
+/**
+ * @name   MPIR_Shim_set_output_prefix
+ * @brief  Have the shim write the output of the application processes
+ *         itself, instead of the PMIx library, through a buffered pipeline
+ *         that gathers many pieces of output per write. Each line can be
+ *         prefixed with the rank it comes from ("[rank]", or "[job,rank]"
+ *         with several jobs) and the time it was received. Must be called
+ *         before MPIR_Shim_common.
+ * @param  prefix: One of "none", "rank", "time" or "rank,time"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_prefix(const char *prefix);
+
+/**
+ * @name   MPIR_Shim_set_output_dir
+ * @brief  Write the output of the application processes to files in a
+ *         directory instead of to the terminal, which enables the output
+ *         pipeline. Each rank gets its own file ("rank.R", or "job.J.rank.R"
+ *         with several jobs), or each node does ("HOST", every line prefixed
+ *         with its rank), with standard error in matching ".err" files.
+ *         The files are written by a small pool of threads
+ *         and can be compressed with gzip (".gz" suffix). Must be called
+ *         before MPIR_Shim_common.
+ * @param  dir: Directory, created if it does not exist
+ * @param  per_node: Non-zero for one file per node, zero for one per rank
+ * @param  compress: Non-zero to compress the files, if built with zlib
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_dir(const char *dir, int per_node, int compress);
+
+/**
+ * @name   MPIR_Shim_set_output_rate_limit
+ * @brief  Limit the rate of the application output, per rank and for all
+ *         ranks together, which enables the output pipeline. Output over a
+ *         limit is dropped, and with the "summarize" policy the amount
+ *         dropped from each rank is noted in its standard error at most once
+ *         a second. A total of the suppressed output is printed at the end.
+ *         Must be called before MPIR_Shim_common.
+ * @param  rank_rate: Bytes per second allowed from each rank, 0 for no limit
+ * @param  total_rate: Bytes per second allowed from all ranks, 0 for no limit
+ * @param  policy: "drop" or "summarize"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_rate_limit(double rank_rate, double total_rate,
+                                    const char *policy);
+
+/**
+ * @name   MPIR_Shim_set_output_aggregation
+ * @brief  Print lines that several ranks print identically once, prefixed
+ *         with the ranges of ranks that printed them (e.g. "[0-65535] ").
+ *         Lines are collected for a window starting with the first line, then
+ *         printed in the order first seen. This enables the output pipeline,
+ *         and cannot be combined with MPIR_Shim_set_output_dir. Must be
+ *         called before MPIR_Shim_common.
+ * @param  window_ms: Window in milliseconds, 0 to disable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_aggregation(int window_ms);
+
+/**
+ * @name   MPIR_Shim_set_release_policy
+ * @brief  Select how the held application processes are released after
+ *         MPIR_Breakpoint returns. Releasing 100k ranks at once starts a
+ *         storm of library loads and file system traffic, the staged
+ *         policies release the ranks in waves, each wave being one
+ *         notification, and report the time taken by each wave on stderr.
+ * @param  policy: One of
+ *          - "all"      Release every held rank at once (Default)
+ *          - "manual"   Do not release, the tool releases the ranks itself
+ *                       with the MPIR_Shim_release_* functions
+ *          - "ranks:N"  Release N ranks per wave
+ *          - "nodes:N"  Release the ranks of N nodes per wave
+ *          - "rate:R"   Release at most R ranks per second
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_release_policy(const char *policy);
+
+/**
+ * @name   MPIR_Shim_release_ranks
+ * @brief  Release a list of held ranks of one job with a single notification.
+ *         Valid once MPIR_Breakpoint has been called, typically with the
+ *         "manual" release policy so a tool can release ranks as it finishes
+ *         attaching to them. Fails for a process table published with the
+ *         provider API, which launched no job.
+ * @param  job_index: Index of the job the ranks belong to (0 for a single job)
+ * @param  ranks: Array of ranks to release, ranks within the job
+ * @param  num_ranks: Number of elements in ranks
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_ranks(int job_index, const int *ranks, int num_ranks);
+
+/**
+ * @name   MPIR_Shim_release_rank_ranges
+ * @brief  Release held ranks of one job, given as comma separated ranks and
+ *         rank ranges, with a single notification. Valid once MPIR_Breakpoint
+ *         has been called.
+ * @param  job_index: Index of the job the ranks belong to (0 for a single job)
+ * @param  ranges: Rank list such as "0-15,32"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_rank_ranges(int job_index, const char *ranges);
+
+/**
+ * @name   MPIR_Shim_release_host
+ * @brief  Release every held rank running on a host, with a single
+ *         notification per job. Valid once MPIR_Breakpoint has been called.
+ * @param  host_name: Host name, as listed in MPIR_proctable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_host(const char *host_name);
+
+/**
+ * @name   MPIR_Shim_proctable_reserve
+ * @brief  Provider API, for a launcher that links this library and already
+ *         knows its process map: set the number of processes in
+ *         MPIR_proctable, so the table is allocated once. Not valid together
+ *         with MPIR_Shim_common. No PMIx calls are made by the provider API.
+ * @param  size: Number of MPIR_proctable entries
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_reserve(int size);
+
+/**
+ * @name   MPIR_Shim_proctable_set
+ * @brief  Provider API: set the MPIR_proctable entry of one process. The table
+ *         grows if index is past its end. Host and executable names are
+ *         copied, with one copy of each distinct name shared by the entries.
+ * @param  index: Index of the entry, the rank of the process
+ * @param  host_name: Host the process runs on
+ * @param  executable_name: Executable of the process
+ * @param  pid: Process id of the process
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_set(int index, const char *host_name,
+                            const char *executable_name, int pid);
+
+/**
+ * @name   MPIR_Shim_proctable_set_range
+ * @brief  Provider API: set the MPIR_proctable entries of count consecutive
+ *         processes, starting at index first, in one call.
+ * @param  first: Index of the first entry
+ * @param  count: Number of entries
+ * @param  host_names: Host of each process
+ * @param  executable_names: Executable of each process
+ * @param  pids: Process id of each process
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_set_range(int first, int count,
+                                  const char * const host_names[],
+                                  const char * const executable_names[],
+                                  const int pids[]);
+
+/**
+ * @name   MPIR_Shim_proctable_publish
+ * @brief  Provider API: set MPIR_debug_state to MPIR_DEBUG_SPAWNED and call
+ *         MPIR_Breakpoint. Every entry up to MPIR_proctable_size must be set.
+ *         May be called again after adding processes, so the tool attaches to
+ *         the new ones. The table is published as a single job.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_publish(void);
+
+/**
+ * @name   MPIR_Shim_proctable_abort
+ * @brief  Provider API: set MPIR_debug_abort_string and MPIR_debug_state to
+ *         MPIR_DEBUG_ABORTING, and call MPIR_Breakpoint.
+ * @param  reason: Human readable reason for the abort, reported to the tool
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_abort(const char *reason);
+
+/**
+ * A timed phase of MPIR_Shim_common, e.g. "tool_init", "spawn" or
+ * "ready_for_debug". Times are in milliseconds from a monotonic clock,
+ * starting when MPIR_Shim_common was called. job_index is -1 for phases
+ * of the whole session.
+ */
+typedef struct MPIR_Shim_timing_t {
+    const char *phase;
+    int job_index;
+    double start_ms;
+    double elapsed_ms;
+} MPIR_Shim_timing_t;
+
+/**
+ * @name   MPIR_Shim_set_timings_file
+ * @brief  Write the phase timings of MPIR_Shim_common as JSON to a file when
+ *         it returns. Must be called before MPIR_Shim_common.
+ * @param  path: File to write, NULL to not write one
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_timings_file(const char *path);
+
+/**
+ * @name   MPIR_Shim_get_timings
+ * @brief  Get the phase timings recorded so far by MPIR_Shim_common, in the
+ *         order the phases ended. The array is valid until the next phase
+ *         ends or the next call to MPIR_Shim_common.
+ * @param  timings_: Set to the timings
+ * @param  num_timings_: Set to the number of timings
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_get_timings(const MPIR_Shim_timing_t **timings_, int *num_timings_);
+
+/**
+ * @name   MPIR_Shim_set_pmix_profile
+ * @brief  Profile the PMIx calls made by the shim: count them, time them and
+ *         record their return codes. The profile is reported at exit.
+ * @param  file: File to write the profile to as JSON, NULL to print a
+ *         summary to stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_profile(const char *file);
+
+/**
+ * @name   MPIR_Shim_write_pmix_profile
+ * @brief  Write the PMIx call profile gathered so far.
+ * @param  file: File to write the profile to as JSON, NULL to print a
+ *         summary to stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_write_pmix_profile(const char *file);
+
+/**
+ * @name   MPIR_Shim_set_trace
+ * @brief  Select the categories recorded in the binary trace. Every thread
+ *         records into its own ring without locking, and the rings are
+ *         dumped with MPIR_Shim_dump_trace or to the trace file.
+ * @param  categories: "all" (default), "none", or a comma separated list of
+ *         flow, general, event, signal and procs
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_trace(const char *categories);
+
+/**
+ * @name   MPIR_Shim_set_trace_file
+ * @brief  Dump the binary trace to a file at exit and if the process crashes
+ *         (SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT).
+ * @param  file: The file, NULL to not dump
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_trace_file(const char *file);
+
+/**
+ * @name   MPIR_Shim_dump_trace
+ * @brief  Dump the binary trace recorded so far to a file. Print it with
+ *         mpirtrace.
+ * @param  file: The file
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_dump_trace(const char *file);
+
+/**
+ * @name   MPIR_Shim_set_metrics
+ * @brief  Write the metrics of each session when it ends: phase latencies,
+ *         process table size, events handled, connection retries, forwarded
+ *         bytes and exit reason. Without a call, the MPIR_SHIM_METRICS and
+ *         MPIR_SHIM_METRICS_FORMAT environment variables set them.
+ * @param  destination: A file, "unix:PATH" for a local socket, or NULL to
+ *         not write metrics
+ * @param  format: "json" (default) to append one JSON line per session, or
+ *         "prometheus" for the Prometheus text format. A Prometheus file
+ *         holds the totals of all the sessions that wrote to it.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_metrics(const char *destination, const char *format);
+
+/**
+ * @name   MPIR_Shim_set_memory_report
+ * @brief  Report the memory used by the shim's data structures (process
+ *         table, strings, event records, output buffers and caches), their
+ *         peaks, and the resident set size of the process, at exit and on
+ *         SIGUSR2. SIGUSR2 is not used if it is forwarded to the application.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_memory_report(const char *file);
+
+/**
+ * @name   MPIR_Shim_write_memory_report
+ * @brief  Write the memory used by the shim's data structures now.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_write_memory_report(const char *file);
+
+/**
+ * @name   MPIR_Shim_set_hold_report
+ * @brief  Report, at the end of each session, how long the application
+ *         ranks took to fork and to reach the hold point after the launcher
+ *         was spawned, how long they were held and how long their release
+ *         took to be delivered, as percentiles, with the slowest nodes.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_hold_report(const char *file);
+
+/**
+ * @name   MPIR_Shim_set_journal
+ * @brief  Record every event, state transition, MPIR_proctable generation,
+ *         release and exit code of the shim in a journal file, to be read
+ *         with mpirjournal. The file is memory-mapped, so it holds every
+ *         record up to the last one even if the process is killed. Without
+ *         a call, the MPIR_SHIM_JOURNAL environment variable sets the file.
+ * @param  file: The file, replaced, NULL to stop journaling
+ * @param  num_records: Records kept, 128 bytes each, before the oldest are
+ *         overwritten, 0 for the default of 65536
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_journal(const char *file, int num_records);
+
+/**
+ * @name   MPIR_Shim_set_pmix_record
+ * @brief  Record everything the PMIx calls of the shim return, and every
+ *         event, application output and job control completion PMIx calls
+ *         it back with, with their timing, in a capture file for
+ *         MPIR_Shim_set_pmix_replay. Set before the session starts.
+ * @param  file: The capture file, replaced, NULL to stop recording
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_record(const char *file);
+
+/**
+ * @name   MPIR_Shim_set_pmix_replay
+ * @brief  Replay a capture written by MPIR_Shim_set_pmix_record instead of
+ *         calling PMIx, so the session needs no PMIx server, launcher or
+ *         application. Each call returns what the same call returned when
+ *         recorded, and events follow the calls they followed then. Set
+ *         before the session starts.
+ * @param  file: The capture file, NULL to stop replaying
+ * @param  timed: Non-zero to make the calls and the events take as long as
+ *         they did when recorded, 0 to replay as fast as possible
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_replay(const char *file, int timed);
+
 #endif /* MPIRSHIM_H */
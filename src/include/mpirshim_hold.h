@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Hold and release latency of the application ranks, used internally by the
+ * shim module. Not installed.
+ *
+ * The shim records when each rank is first seen forked and connected to its
+ * PMIx server in the process table, which is where it is held when stopped
+ * in init, and when the release notification covering it is delivered. The
+ * report gives the distributions of these latencies and the slowest nodes.
+ * All times are milliseconds since the start of the session.
+ */
+
+#ifndef MPIRSHIM_HOLD_H
+#define MPIRSHIM_HOLD_H
+
+#include <pmix_tool.h>
+
+/**
+ * @name   mpir_shim_hold_enabled
+ * @brief  Whether the hold report was requested with MPIR_Shim_set_hold_report.
+ * @return Non-zero if so
+ */
+int mpir_shim_hold_enabled(void);
+
+/**
+ * @name   mpir_shim_hold_session_start
+ * @brief  Forget the ranks of a previous session.
+ * @param  num_jobs: Number of jobs of the session
+ */
+void mpir_shim_hold_session_start(int num_jobs);
+
+/**
+ * @name   mpir_shim_hold_spawn
+ * @brief  Record when the launcher of a job was spawned.
+ * @param  job_index: Index of the job
+ * @param  now_ms: Current time
+ */
+void mpir_shim_hold_spawn(int job_index, double now_ms);
+
+/**
+ * @name   mpir_shim_hold_poll
+ * @brief  Record the interval waited before polling the process table, for
+ *         the report to show how precise the forked and held times are.
+ * @param  job_index: Index of the job
+ * @param  interval_ms: The interval
+ */
+void mpir_shim_hold_poll(int job_index, double interval_ms);
+
+/**
+ * @name   mpir_shim_hold_observe
+ * @brief  Record the state of a rank as seen in the process table.
+ * @param  job_index: Index of the job
+ * @param  rank: The rank
+ * @param  host: Node of the rank, an interned name
+ * @param  state: The state of the rank
+ * @param  now_ms: When the process table was received
+ */
+void mpir_shim_hold_observe(int job_index, pmix_rank_t rank, const char *host,
+                            pmix_proc_state_t state, double now_ms);
+
+/**
+ * @name   mpir_shim_hold_ready
+ * @brief  Record when the launcher reported a job ready for debug, the time
+ *         every rank was held by at the latest.
+ * @param  job_index: Index of the job
+ * @param  now_ms: Current time
+ */
+void mpir_shim_hold_ready(int job_index, double now_ms);
+
+/**
+ * @name   mpir_shim_hold_released
+ * @brief  Record the delivery of a release notification.
+ * @param  job_index: Index of the job
+ * @param  rank: The rank released, PMIX_RANK_WILDCARD for every rank
+ * @param  sent_ms: When the notification was sent
+ * @param  now_ms: When it was delivered
+ */
+void mpir_shim_hold_released(int job_index, pmix_rank_t rank, double sent_ms,
+                             double now_ms);
+
+/**
+ * @name   mpir_shim_hold_report
+ * @brief  Write the hold report where MPIR_Shim_set_hold_report asked, if it
+ *         was asked for.
+ */
+void mpir_shim_hold_report(void);
+
+#endif /* MPIRSHIM_HOLD_H */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Forwarding of the output of the application processes, and of stdin to
+ * them, used internally by the shim module. Not installed.
+ */
+
+#ifndef MPIRSHIM_IOF_H
+#define MPIRSHIM_IOF_H
+
+#include <pmix_tool.h>
+
+/**
+ * @name   mpir_shim_iof_enabled
+ * @brief  Check whether the output pipeline was requested. When it was not,
+ *         the PMIx library writes the forwarded output itself.
+ * @return Non-zero if enabled
+ */
+int mpir_shim_iof_enabled(void);
+
+/**
+ * @name   mpir_shim_iof_start
+ * @brief  Start the output writer. Called once connected to PMIx.
+ * @param  debug: Non-zero to print statistics when stopping
+ * @return 0 if successful, 1 if failed
+ */
+int mpir_shim_iof_start(int debug);
+
+/**
+ * @name   mpir_shim_iof_pull
+ * @brief  Ask the currently selected PMIx server to deliver the output of
+ *         the processes of a job to the pipeline, before the launcher is
+ *         released.
+ * @param  job_index: Index of the job, used in the rank prefix
+ * @param  source: Processes whose output is pulled, an empty namespace for
+ *         every process of the selected server
+ * @return 0 if successful, 1 if failed
+ */
+int mpir_shim_iof_pull(int job_index, const pmix_proc_t *source);
+
+/**
+ * @name   mpir_shim_iof_set_namespace
+ * @brief  Record the application namespace of a job once its launch
+ *         completes.
+ * @param  job_index: Index of the job
+ * @param  application_proc: Application namespace, with a wildcard rank
+ */
+void mpir_shim_iof_set_namespace(int job_index, const pmix_proc_t *application_proc);
+
+/**
+ * @name   mpir_shim_iof_hosts_ready
+ * @brief  Tell the pipeline the process table is complete. Output bound for
+ *         per-node files is held back until then.
+ */
+void mpir_shim_iof_hosts_ready(void);
+
+/**
+ * @name   mpir_shim_iof_stop
+ * @brief  Write out everything buffered and stop the writer. Safe to call
+ *         more than once, or when the pipeline was never started.
+ */
+void mpir_shim_iof_stop(void);
+
+/**
+ * @name   mpir_shim_iof_set_stdin
+ * @brief  Select the ranks stdin is forwarded to.
+ * @param  enable: Zero to not forward stdin
+ * @param  ranks: Target ranks, NULL for all ranks. Owned by the pipeline
+ *         from now on.
+ * @param  num_ranks: Number of target ranks
+ */
+void mpir_shim_iof_set_stdin(int enable, pmix_rank_t *ranks, size_t num_ranks);
+
+/**
+ * @name   mpir_shim_iof_stdin_enabled
+ * @brief  Check whether stdin forwarding was requested.
+ * @return Non-zero if enabled
+ */
+int mpir_shim_iof_stdin_enabled(void);
+
+/**
+ * @name   mpir_shim_iof_stdin_start
+ * @brief  Start forwarding stdin to an application through the currently
+ *         selected PMIx server. It is stopped by mpir_shim_iof_stop.
+ * @param  application_proc: Application namespace
+ * @return 0 if successful, 1 if failed
+ */
+int mpir_shim_iof_stdin_start(const pmix_proc_t *application_proc);
+
+/**
+ * @name   mpir_shim_rank_host
+ * @brief  Get the host of a process of an application, from the process
+ *         table. Provided by the shim module for the per-node output files.
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @return Host name, NULL if not known
+ */
+const char *mpir_shim_rank_host(int job_index, pmix_rank_t rank);
+
+#endif /* MPIRSHIM_IOF_H */
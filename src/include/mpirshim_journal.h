@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Event journal of the shim, used internally by the shim module and by the
+ * mpirjournal decoder. Not installed.
+ *
+ * The journal is a file mapped shared into the process: a header, then a
+ * ring of fixed size records, one per event, state transition, process
+ * table, release or exit code. Records are appended without locking or
+ * system calls, and since the pages belong to the file they survive the
+ * process being killed. Once the ring is full the oldest records are
+ * overwritten.
+ */
+
+#ifndef MPIRSHIM_JOURNAL_H
+#define MPIRSHIM_JOURNAL_H
+
+#include <stdint.h>
+
+/*
+ * Record types
+ */
+typedef enum {
+    // status: shim mode, value: number of jobs, text: launcher
+    MPIR_SHIM_JOURNAL_SESSION_START = 0,
+    // status: return code, text: exit reason
+    MPIR_SHIM_JOURNAL_SESSION_END,
+    // status: PMIx event, rank and text: the affected or source process
+    MPIR_SHIM_JOURNAL_EVENT,
+    // status: exit code, rank and text: the process, or the whole namespace
+    MPIR_SHIM_JOURNAL_EXIT,
+    // value: microseconds the phase took, text: the phase
+    MPIR_SHIM_JOURNAL_PHASE,
+    // value: MPIR_debug_state given to the debugger, text: abort message
+    MPIR_SHIM_JOURNAL_STATE,
+    // status: generation of MPIR_proctable, value: processes of the job,
+    // rank: offset of the job in MPIR_proctable
+    MPIR_SHIM_JOURNAL_PROCTABLE,
+    // value: processes released, rank and text: the first of them
+    MPIR_SHIM_JOURNAL_RELEASE,
+    // value: signal forwarded to the application
+    MPIR_SHIM_JOURNAL_SIGNAL,
+    MPIR_SHIM_NUM_JOURNAL
+} mpir_shim_journal_type_t;
+
+// Names of the record types, in order
+#define MPIR_SHIM_JOURNAL_NAMES {"session_start", "session_end", "event", "exit", \
+                                 "phase", "state", "proctable", "release", "signal"}
+
+/*
+ * File format, in the byte order of the journaling machine: the header,
+ * padded to MPIR_SHIM_JOURNAL_HEADER_SIZE, then num_records records.
+ * Record n is stored at index n % num_records with seq set to n + 1, last,
+ * so a record with a seq of 0 or of another index was being written.
+ */
+#define MPIR_SHIM_JOURNAL_MAGIC "MPIRJNL1"
+#define MPIR_SHIM_JOURNAL_VERSION 1
+#define MPIR_SHIM_JOURNAL_HEADER_SIZE 4096
+#define MPIR_SHIM_JOURNAL_TEXT 88
+
+typedef struct mpir_shim_journal_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t pid;
+    uint32_t record_size;
+    uint32_t num_records;
+    uint64_t monotonic_ns;  // Clock of the records when the journal was opened
+    uint64_t realtime_ns;   // Wall clock when the journal was opened
+    uint64_t head;          // Records appended so far
+} mpir_shim_journal_header_t;
+
+typedef struct mpir_shim_journal_record_t {
+    uint64_t seq;
+    uint64_t time_ns;
+    uint16_t type;
+    int16_t job;            // Index of the job, -1 for none
+    int32_t tid;
+    int32_t status;
+    uint32_t rank;
+    int64_t value;
+    char text[MPIR_SHIM_JOURNAL_TEXT];
+} mpir_shim_journal_record_t;
+
+/**
+ * @name   mpir_shim_journal_append
+ * @brief  Append a record to the journal, if there is one, from any thread.
+ * @param  type: Type of the record
+ * @param  job: Index of the job, -1 for none
+ * @param  status: Status, see the record types
+ * @param  rank: Rank, see the record types
+ * @param  value: Value, see the record types
+ * @param  text: Text, truncated to fit, may be NULL
+ */
+void mpir_shim_journal_append(mpir_shim_journal_type_t type, int job, int status,
+                              uint32_t rank, int64_t value, const char *text);
+
+/**
+ * @name   mpir_shim_journal_session_start
+ * @brief  Open the journal named by MPIR_SHIM_JOURNAL if none was set, and
+ *         record the start of a session.
+ * @param  mode: The shim mode
+ * @param  num_jobs: Number of jobs of the session
+ * @param  launcher: The launcher of the first job, may be NULL
+ */
+void mpir_shim_journal_session_start(int mode, int num_jobs, const char *launcher);
+
+/**
+ * @name   mpir_shim_journal_flush
+ * @brief  Start writing the journal back to its file, without waiting.
+ */
+void mpir_shim_journal_flush(void);
+
+#endif /* MPIRSHIM_JOURNAL_H */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Memory accounting of the shim, used internally by the shim module. Not
+ * installed.
+ *
+ * The bytes allocated for each kind of data structure are counted where the
+ * structures grow and shrink, with relaxed atomic updates, along with the
+ * peak of each. The report puts them next to the resident set size of the
+ * process and the memory limit of its cgroup.
+ */
+
+#ifndef MPIRSHIM_MEMORY_H
+#define MPIRSHIM_MEMORY_H
+
+/*
+ * Kinds of data structures accounted for
+ */
+typedef enum {
+    // MPIR process, job and daemon tables, the PMIx query results they are
+    // built from, and the per-rank lists of release requests
+    MPIR_SHIM_MEMORY_PROCTABLE = 0,
+    // Interned host and executable names, and namespaces
+    MPIR_SHIM_MEMORY_STRINGS,
+    // Signal forwarding requests, phase timings, trace rings and the PMIx
+    // capture being replayed
+    MPIR_SHIM_MEMORY_EVENTS,
+    // Output chunks, partial lines, output file buffers and the stdin buffer
+    MPIR_SHIM_MEMORY_IO_BUFFERS,
+    // Per-rank output state: rate limits, line states, aggregated lines and
+    // the output file table
+    MPIR_SHIM_MEMORY_CACHES,
+    MPIR_SHIM_NUM_MEMORY
+} mpir_shim_memory_t;
+
+/**
+ * @name   mpir_shim_memory_add
+ * @brief  Account for memory allocated or freed, from any thread.
+ * @param  kind: Kind of data structure
+ * @param  delta: Bytes allocated, negative if freed
+ */
+void mpir_shim_memory_add(mpir_shim_memory_t kind, long delta);
+
+#define MPIR_SHIM_MEMORY_ADD(kind, size) mpir_shim_memory_add(kind, (long)(size))
+#define MPIR_SHIM_MEMORY_SUB(kind, size) mpir_shim_memory_add(kind, -(long)(size))
+
+/**
+ * @name   mpir_shim_memory_report_enabled
+ * @brief  Whether a memory report was requested with MPIR_Shim_set_memory_report.
+ * @return Non-zero if so
+ */
+int mpir_shim_memory_report_enabled(void);
+
+/**
+ * @name   mpir_shim_memory_report
+ * @brief  Write the memory report where MPIR_Shim_set_memory_report asked,
+ *         if it was asked for. Used at exit and on SIGUSR2.
+ */
+void mpir_shim_memory_report(void);
+
+#endif /* MPIRSHIM_MEMORY_H */
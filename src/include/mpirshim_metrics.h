@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Session metrics of the shim, used internally by the shim module. Not
+ * installed.
+ *
+ * The counters are always kept, with relaxed atomic increments. At the end
+ * of a session they are written to the metrics sink, if one is set, along
+ * with the phase timings and the size of the process table.
+ */
+
+#ifndef MPIRSHIM_METRICS_H
+#define MPIRSHIM_METRICS_H
+
+#include "mpirshim.h"
+
+/*
+ * Counters of a session
+ */
+typedef enum {
+    MPIR_SHIM_METRIC_EVENT_DEFAULT = 0,
+    MPIR_SHIM_METRIC_EVENT_LAUNCHER_COMPLETE,
+    MPIR_SHIM_METRIC_EVENT_LAUNCHER_READY,
+    MPIR_SHIM_METRIC_EVENT_LAUNCHER_TERMINATE,
+    MPIR_SHIM_METRIC_EVENT_APPLICATION_TERMINATE,
+    MPIR_SHIM_METRIC_EVENT_PROC_FAILURE,
+    MPIR_SHIM_METRIC_CONNECT_RETRIES,
+    MPIR_SHIM_METRIC_CONNECTIONS_LOST,
+    MPIR_SHIM_METRIC_SERVER_SWITCHES,
+    MPIR_SHIM_METRIC_STDOUT_BYTES,
+    MPIR_SHIM_METRIC_STDERR_BYTES,
+    MPIR_SHIM_METRIC_SUPPRESSED_BYTES,
+    MPIR_SHIM_METRIC_STDIN_BYTES,
+    MPIR_SHIM_METRIC_SIGNALS_FORWARDED,
+    MPIR_SHIM_NUM_METRICS
+} mpir_shim_metric_t;
+
+/**
+ * @name   mpir_shim_metrics
+ * @brief  The counters, updated with MPIR_SHIM_METRIC_ADD.
+ */
+extern unsigned long mpir_shim_metrics[MPIR_SHIM_NUM_METRICS];
+
+// Add to a counter, from any thread
+#define MPIR_SHIM_METRIC_ADD(metric, n)                                 \
+    (void)__atomic_add_fetch(&mpir_shim_metrics[metric], (n), __ATOMIC_RELAXED)
+
+/**
+ * @name   mpir_shim_metrics_session_start
+ * @brief  Reset the counters at the start of a session. Takes the sink from
+ *         MPIR_SHIM_METRICS and MPIR_SHIM_METRICS_FORMAT when none was set.
+ */
+void mpir_shim_metrics_session_start(void);
+
+/**
+ * @name   mpir_shim_metrics_proctable
+ * @brief  Record the number of processes of the process table.
+ * @param  num_procs: Number of processes
+ */
+void mpir_shim_metrics_proctable(int num_procs);
+
+/**
+ * @name   mpir_shim_metrics_session_end
+ * @brief  Write the metrics of the session to the sink, if one is set. Does
+ *         nothing if the session already ended.
+ * @param  mode: proxy, non-proxy or attach
+ * @param  launcher: Name of the launcher
+ * @param  exit_reason: Why the session ended
+ * @param  status: Return code of MPIR_Shim_common
+ */
+void mpir_shim_metrics_session_end(const char *mode, const char *launcher,
+                                   const char *exit_reason, int status);
+
+#endif /* MPIRSHIM_METRICS_H */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Profiling of the PMIx calls made by the shim, used internally by the shim
+ * module. Not installed.
+ *
+ * Including this header redirects the profiled PMIx calls of the including
+ * file to thin wrappers that count them, time them and record their return
+ * codes, and that hand them to mpirshim_replay.c when the PMIx traffic is
+ * recorded or replayed. When neither is on a wrapper only tests two flags
+ * before making the call.
+ */
+
+#ifndef MPIRSHIM_PROFILE_H
+#define MPIRSHIM_PROFILE_H
+
+#include <pmix_tool.h>
+
+/**
+ * @name   mpir_shim_profile_enabled
+ * @brief  Non-zero when the PMIx calls are profiled. Read by the wrappers.
+ */
+extern int mpir_shim_profile_enabled;
+
+/*
+ * The wrappers, with the signatures of the PMIx calls they wrap.
+ */
+pmix_status_t mpir_shim_prof_PMIx_tool_init(pmix_proc_t *proc,
+                                            pmix_info_t info[], size_t ninfo);
+pmix_status_t mpir_shim_prof_PMIx_tool_finalize(void);
+pmix_status_t mpir_shim_prof_PMIx_tool_set_server(const pmix_proc_t *server,
+                                                  pmix_info_t info[], size_t ninfo);
+pmix_status_t mpir_shim_prof_PMIx_Spawn(const pmix_info_t job_info[], size_t ninfo,
+                                        const pmix_app_t apps[], size_t napps,
+                                        pmix_nspace_t nspace);
+pmix_status_t mpir_shim_prof_PMIx_Query_info(pmix_query_t queries[], size_t nqueries,
+                                             pmix_info_t **results, size_t *nresults);
+pmix_status_t mpir_shim_prof_PMIx_Notify_event(pmix_status_t status,
+                                               const pmix_proc_t *source,
+                                               pmix_data_range_t range,
+                                               const pmix_info_t info[], size_t ninfo,
+                                               pmix_op_cbfunc_t cbfunc, void *cbdata);
+pmix_status_t mpir_shim_prof_PMIx_Register_event_handler(pmix_status_t codes[],
+                                                         size_t ncodes,
+                                                         pmix_info_t info[], size_t ninfo,
+                                                         pmix_notification_fn_t evhdlr,
+                                                         pmix_hdlr_reg_cbfunc_t cbfunc,
+                                                         void *cbdata);
+pmix_status_t mpir_shim_prof_PMIx_Get(const pmix_proc_t *proc, const char key[],
+                                      const pmix_info_t info[], size_t ninfo,
+                                      pmix_value_t **val);
+pmix_status_t mpir_shim_prof_PMIx_Job_control(const pmix_proc_t targets[], size_t ntargets,
+                                              const pmix_info_t directives[], size_t ndirs,
+                                              pmix_info_t **results, size_t *nresults);
+pmix_status_t mpir_shim_prof_PMIx_Job_control_nb(const pmix_proc_t targets[],
+                                                 size_t ntargets,
+                                                 const pmix_info_t directives[],
+                                                 size_t ndirs,
+                                                 pmix_info_cbfunc_t cbfunc, void *cbdata);
+pmix_status_t mpir_shim_prof_PMIx_IOF_pull(const pmix_proc_t procs[], size_t nprocs,
+                                           const pmix_info_t directives[], size_t ndirs,
+                                           pmix_iof_channel_t channel,
+                                           pmix_iof_cbfunc_t cbfunc,
+                                           pmix_hdlr_reg_cbfunc_t regcbfunc,
+                                           void *regcbdata);
+pmix_status_t mpir_shim_prof_PMIx_IOF_push(const pmix_proc_t targets[], size_t ntargets,
+                                           pmix_byte_object_t *bo,
+                                           const pmix_info_t directives[], size_t ndirs,
+                                           pmix_op_cbfunc_t cbfunc, void *cbdata);
+
+#ifndef MPIR_SHIM_PROFILE_IMPL
+#define PMIx_tool_init mpir_shim_prof_PMIx_tool_init
+#define PMIx_tool_finalize mpir_shim_prof_PMIx_tool_finalize
+#define PMIx_tool_set_server mpir_shim_prof_PMIx_tool_set_server
+#define PMIx_Spawn mpir_shim_prof_PMIx_Spawn
+#define PMIx_Query_info mpir_shim_prof_PMIx_Query_info
+#define PMIx_Notify_event mpir_shim_prof_PMIx_Notify_event
+#define PMIx_Register_event_handler mpir_shim_prof_PMIx_Register_event_handler
+#define PMIx_Get mpir_shim_prof_PMIx_Get
+#define PMIx_Job_control mpir_shim_prof_PMIx_Job_control
+#define PMIx_Job_control_nb mpir_shim_prof_PMIx_Job_control_nb
+#define PMIx_IOF_pull mpir_shim_prof_PMIx_IOF_pull
+#define PMIx_IOF_push mpir_shim_prof_PMIx_IOF_push
+#endif /* MPIR_SHIM_PROFILE_IMPL */
+
+#endif /* MPIRSHIM_PROFILE_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Recording and replay of the PMIx traffic of the shim, used internally by
+ * the shim module. Not installed.
+ *
+ * The PMIx calls wrapped by mpirshim_profile.h go through here when
+ * recording or replaying. Recording makes the call and writes what it
+ * returned, along with every event, output and completion the shim is
+ * called back with, to a capture file. Replaying makes no PMIx call: each
+ * call returns what the same call returned when recorded, and a thread calls
+ * the shim back with the recorded events, in their recorded order.
+ */
+
+#ifndef MPIRSHIM_REPLAY_H
+#define MPIRSHIM_REPLAY_H
+
+#include <pmix_tool.h>
+
+typedef enum {
+    MPIR_SHIM_REPLAY_OFF = 0,
+    MPIR_SHIM_REPLAY_RECORD,
+    MPIR_SHIM_REPLAY_PLAY
+} mpir_shim_replay_mode_t;
+
+/**
+ * @name   mpir_shim_replay_mode
+ * @brief  Whether the PMIx calls are recorded or replayed. Read by the
+ *         wrappers.
+ */
+extern mpir_shim_replay_mode_t mpir_shim_replay_mode;
+
+/*
+ * File format, in the byte order of the recording machine: the magic and
+ * the version, then one record after another. A record is its kind, the
+ * call it belongs to, the size of its body and its body. Strings are a
+ * 32 bit length, UINT32_MAX for NULL, and the characters.
+ */
+#define MPIR_SHIM_REPLAY_MAGIC "MPIRPMIX"
+#define MPIR_SHIM_REPLAY_VERSION 1
+
+/*
+ * The replacements of the wrapped PMIx calls, with their signatures.
+ */
+pmix_status_t mpir_shim_replay_PMIx_tool_init(pmix_proc_t *proc,
+                                              pmix_info_t info[], size_t ninfo);
+pmix_status_t mpir_shim_replay_PMIx_tool_finalize(void);
+pmix_status_t mpir_shim_replay_PMIx_tool_set_server(const pmix_proc_t *server,
+                                                    pmix_info_t info[], size_t ninfo);
+pmix_status_t mpir_shim_replay_PMIx_Spawn(const pmix_info_t job_info[], size_t ninfo,
+                                          const pmix_app_t apps[], size_t napps,
+                                          pmix_nspace_t nspace);
+pmix_status_t mpir_shim_replay_PMIx_Query_info(pmix_query_t queries[], size_t nqueries,
+                                               pmix_info_t **results, size_t *nresults);
+pmix_status_t mpir_shim_replay_PMIx_Notify_event(pmix_status_t status,
+                                                 const pmix_proc_t *source,
+                                                 pmix_data_range_t range,
+                                                 const pmix_info_t info[], size_t ninfo,
+                                                 pmix_op_cbfunc_t cbfunc, void *cbdata);
+pmix_status_t mpir_shim_replay_PMIx_Register_event_handler(pmix_status_t codes[],
+                                                           size_t ncodes,
+                                                           pmix_info_t info[],
+                                                           size_t ninfo,
+                                                           pmix_notification_fn_t evhdlr,
+                                                           pmix_hdlr_reg_cbfunc_t cbfunc,
+                                                           void *cbdata);
+pmix_status_t mpir_shim_replay_PMIx_Get(const pmix_proc_t *proc, const char key[],
+                                        const pmix_info_t info[], size_t ninfo,
+                                        pmix_value_t **val);
+pmix_status_t mpir_shim_replay_PMIx_Job_control(const pmix_proc_t targets[],
+                                                size_t ntargets,
+                                                const pmix_info_t directives[],
+                                                size_t ndirs,
+                                                pmix_info_t **results, size_t *nresults);
+pmix_status_t mpir_shim_replay_PMIx_Job_control_nb(const pmix_proc_t targets[],
+                                                   size_t ntargets,
+                                                   const pmix_info_t directives[],
+                                                   size_t ndirs,
+                                                   pmix_info_cbfunc_t cbfunc, void *cbdata);
+pmix_status_t mpir_shim_replay_PMIx_IOF_pull(const pmix_proc_t procs[], size_t nprocs,
+                                             const pmix_info_t directives[], size_t ndirs,
+                                             pmix_iof_channel_t channel,
+                                             pmix_iof_cbfunc_t cbfunc,
+                                             pmix_hdlr_reg_cbfunc_t regcbfunc,
+                                             void *regcbdata);
+pmix_status_t mpir_shim_replay_PMIx_IOF_push(const pmix_proc_t targets[], size_t ntargets,
+                                             pmix_byte_object_t *bo,
+                                             const pmix_info_t directives[], size_t ndirs,
+                                             pmix_op_cbfunc_t cbfunc, void *cbdata);
+
+#endif /* MPIRSHIM_REPLAY_H */
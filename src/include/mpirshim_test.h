@@ -13,6 +13,9 @@
 #define MPIRSHIM_TEST_H
 #ifdef MPIR_SHIM_TESTCASE
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * @name   MPIR_Shim_release_application
  * @brief  Release application processes from hold in MPI_Init so they may
@@ -21,5 +24,23 @@
  */
 int MPIR_Shim_release_application(void);
 
+/**
+ * @name   MPIR_Breakpoint_hook
+ * @brief  Called by MPIR_Breakpoint when the test program defines it, in
+ *         place of a debugger.
+ */
+void MPIR_Breakpoint_hook(void);
+
+/**
+ * @name   MPIR_Shim_parse_rank_list
+ * @brief  Parse a rank list as the release, hold and stdin calls do.
+ * @param  ranks: Rank list such as "0-15,32"
+ * @param  rank_list: Set to the allocated, sorted array of distinct ranks,
+ *         freed by the caller
+ * @param  num_ranks: Set to the number of elements in rank_list
+ * @return STATUS_OK if successful, STATUS_FAIL otherwise
+ */
+int MPIR_Shim_parse_rank_list(const char *ranks, uint32_t **rank_list, size_t *num_ranks);
+
 #endif /* MPIR_SHIM_TESTCASE */
 #endif /* MPIRSHIM_TEST_H */
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Binary trace of the shim, used internally by the shim module and by the
+ * mpirtrace decoder. Not installed.
+ *
+ * Every thread records into its own ring of fixed size records without
+ * locking. A record keeps the address of its printf format and the raw
+ * arguments; the formatting is left to the decoder. The rings are dumped
+ * to a file on demand, at exit, or when the process crashes.
+ */
+
+#ifndef MPIRSHIM_TRACE_H
+#define MPIRSHIM_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Trace categories
+ */
+#define MPIR_SHIM_TRACE_FLOW    0x01 // Function entry and exit
+#define MPIR_SHIM_TRACE_GENERAL 0x02 // Messages of the former debug_print
+#define MPIR_SHIM_TRACE_EVENT   0x04 // PMIx events received
+#define MPIR_SHIM_TRACE_SIGNAL  0x08 // Signal forwarding
+#define MPIR_SHIM_TRACE_PROCS   0x10 // One message per process
+#define MPIR_SHIM_TRACE_ALL     0x1f
+
+// Names of the categories, in bit order
+#define MPIR_SHIM_TRACE_NAMES {"flow", "general", "event", "signal", "procs"}
+#define MPIR_SHIM_TRACE_NUM_CATEGORIES 5
+
+/*
+ * Categories compiled in. Tracing of the others is removed by the compiler,
+ * e.g., CPPFLAGS=-DMPIR_SHIM_TRACE_COMPILED=0x0f drops the per-process
+ * messages.
+ */
+#ifndef MPIR_SHIM_TRACE_COMPILED
+#define MPIR_SHIM_TRACE_COMPILED MPIR_SHIM_TRACE_ALL
+#endif
+
+/**
+ * @name   mpir_shim_trace_mask
+ * @brief  Categories traced at runtime.
+ */
+extern unsigned int mpir_shim_trace_mask;
+
+// Whether a category is traced
+#define MPIR_SHIM_TRACE_ON(category)                                    \
+    ((MPIR_SHIM_TRACE_COMPILED & (category)) && (mpir_shim_trace_mask & (category)))
+
+/**
+ * @name   mpir_shim_trace
+ * @brief  Record a trace message. Use through the MPIR_SHIM_TRACE macro of
+ *         the caller, which tests the category first.
+ * @param  category: One of the MPIR_SHIM_TRACE_* categories
+ * @param  echo: Non-zero to also print the message to stdout
+ * @param  format: printf format. Must be a string literal, the record keeps
+ *         only its address.
+ */
+void mpir_shim_trace(unsigned int category, int echo, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/*
+ * Argument kinds of a printf conversion, as stored in a record
+ */
+typedef enum {
+    MPIR_SHIM_TRACE_ARG_NONE = 0,  // %% or %n, nothing stored
+    MPIR_SHIM_TRACE_ARG_SIGNED,    // 8 bytes, sign extended
+    MPIR_SHIM_TRACE_ARG_UNSIGNED,  // 8 bytes
+    MPIR_SHIM_TRACE_ARG_DOUBLE,    // 8 bytes
+    MPIR_SHIM_TRACE_ARG_POINTER,   // 8 bytes
+    MPIR_SHIM_TRACE_ARG_STRING     // Length byte, then the characters
+} mpir_shim_trace_arg_t;
+
+/**
+ * @name   mpir_shim_trace_conversion
+ * @brief  Find the next conversion of a printf format.
+ * @param  format: Where to start looking
+ * @param  start_: Set to the '%' of the conversion
+ * @param  end_: Set past the conversion character
+ * @param  num_stars_: Set to the number of '*' widths and precisions, each
+ *         stored as a signed argument before the value
+ * @return The kind of the value, -1 if there are no more conversions
+ */
+int mpir_shim_trace_conversion(const char *format, const char **start_,
+                               const char **end_, int *num_stars_);
+
+/*
+ * Dump file format, in the byte order of the traced machine: a header, then
+ * entries each starting with a tag byte. A format entry comes before the
+ * first record using it.
+ */
+#define MPIR_SHIM_TRACE_MAGIC "MPIRTRC1"
+#define MPIR_SHIM_TRACE_VERSION 1
+
+// Longest string argument kept in a record
+#define MPIR_SHIM_TRACE_MAX_STRING 254
+// Length byte of a NULL string argument
+#define MPIR_SHIM_TRACE_NULL_STRING 255
+
+typedef struct mpir_shim_trace_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t pid;
+    uint64_t monotonic_ns;  // Clock of the records when dumped
+    uint64_t realtime_ns;   // Wall clock when dumped
+} mpir_shim_trace_header_t;
+
+// Format entry: uint32 id, uint32 length, the characters
+#define MPIR_SHIM_TRACE_TAG_FORMAT 'F'
+// Record entry: mpir_shim_trace_entry_t, then the payload
+#define MPIR_SHIM_TRACE_TAG_RECORD 'R'
+
+typedef struct mpir_shim_trace_entry_t {
+    uint64_t time_ns;
+    uint32_t format_id;
+    int32_t tid;
+    uint16_t category;
+    uint16_t payload_size;
+} mpir_shim_trace_entry_t;
+
+#endif /* MPIRSHIM_TRACE_H */
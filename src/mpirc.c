@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #pragma push_macro("_GNU_SOURCE")
 #undef _GNU_SOURCE
 #define _GNU_SOURCE
@@ -25,8 +26,13 @@
  */
 static error_t mpir_parse_opt(int key, char *arg, struct argp_state *state);
 static void mpir_version_hook(FILE *stream, struct argp_state *state);
+static char **split_command(const char *command, int *argc);
+static double parse_rate(const char *arg);
 
-static char args_doc[] = "[LAUNCHER] [ARGS] PROG [PROG-ARGS]";
+/* Argument separating the launcher command lines of several jobs */
+#define MPIRC_JOB_SEPARATOR ":::"
+
+static char args_doc[] = "[LAUNCHER] [ARGS] PROG [PROG-ARGS] [" MPIRC_JOB_SEPARATOR " LAUNCHER ...]";
 static char args_extra_doc[] = 
     "MPIR Shim wrapper program\n"
     "\n"
@@ -53,8 +59,103 @@ static char args_extra_doc[] =
     "By default, if LAUNCHER is named \"prun\" then a non-proxy run is performed,\n"
     "otherwise a proxy run is done.\n"
     "\n"
+    "Several jobs can be launched in one session by separating their launcher\n"
+    "command lines with \"" MPIRC_JOB_SEPARATOR "\", for example:\n"
+    "  mpirc mpirun -n 2 ./a.out " MPIRC_JOB_SEPARATOR " mpirun -n 4 ./b.out\n"
+    "The processes of all jobs are published in one MPIR_proctable.\n"
+    "\n"
+    "By default every application process is held in PMIx_Init until the\n"
+    "debugger is done with MPIR_Breakpoint. Use --stop to hold them on exec,\n"
+    "at an application-specific point, or not at all, and --hold-ranks to\n"
+    "hold only some ranks, for example \"--hold-ranks 0-15,32\".\n"
+    "\n"
+    "The held ranks are released all at once by default. --release selects\n"
+    "staged waves instead: \"ranks:N\" releases N ranks per wave, \"nodes:N\"\n"
+    "the ranks of N nodes per wave, and \"rate:R\" at most R ranks per second.\n"
+    "\"manual\" leaves them held until a debugger calls MPIR_Shim_release_*().\n"
+    "\n"
+    "With --tool-daemon the launcher also starts the given command, split on\n"
+    "blanks, on every node hosting application processes before the\n"
+    "debugger is notified, for example \"--tool-daemon 'tvdsvr -verbose'\".\n"
+    "\n"
+    "With --forward-signals the listed signals received by mpirc are delivered\n"
+    "to every application process through the launcher, for example\n"
+    "\"--forward-signals USR1,QUIT\". HUP, INT and TERM stop mpirc and the job\n"
+    "unless they are listed.\n"
+    "\n"
+    "With --job-control, SIGTSTP (Ctrl-Z) pauses every application process\n"
+    "and SIGCONT resumes them, reporting how long it took for the last one.\n"
+    "\n"
+    "With --output-prefix the application output is written by mpirc through\n"
+    "a buffered pipeline, each line prefixed with its rank (\"rank\"), the\n"
+    "time it was received (\"time\"), both (\"rank,time\") or nothing (\"none\").\n"
+    "\n"
+    "With --output-dir the application output goes to one file per rank in\n"
+    "the directory, or one per node with --output-per-node, each line tagged\n"
+    "with its rank. --output-compress writes the files gzip compressed.\n"
+    "\n"
+    "--output-rate and --output-total-rate limit the output of each rank and\n"
+    "of all ranks, in bytes per second with an optional K, M or G suffix.\n"
+    "Output over the limit is dropped, or with --output-limit-policy=summarize\n"
+    "replaced by a note of how much was dropped.\n"
+    "\n"
+    "With --output-aggregate identical lines from different ranks are printed\n"
+    "once, prefixed with the ranks that printed them (e.g., \"[0-1023] \"). The\n"
+    "optional MS is how long lines are collected, 100 ms by default.\n"
+    "\n"
+    "--stdin forwards the standard input of mpirc to rank 0 (\"0\"), a rank list\n"
+    "(e.g., \"0-3,8\"), every rank (\"all\"), or no rank (\"none\", default).\n"
+    "\n"
+    "--pmix-profile counts and times the PMIx calls made by mpirc and prints a\n"
+    "summary at exit, or writes it as JSON to FILE.\n"
+    "\n"
+    "--pmix-record saves the PMIx replies and events of mpirc to FILE, for\n"
+    "--pmix-replay(-timed) to play back without a PMIx server.\n"
+    "\n"
+    "mpirc always records a binary trace in memory, of the --trace categories\n"
+    "(flow, general, event, signal, procs). --trace-file dumps it to FILE at\n"
+    "exit or on a crash, print the dump with mpirtrace.\n"
+    "\n"
+    "--metrics writes the session metrics to DEST when it ends, a file or\n"
+    "unix:PATH for a local socket, as json (one line per session) or, with\n"
+    "--metrics-format=prometheus, the totals of all the sessions writing it.\n"
+    "Both default to MPIR_SHIM_METRICS(_FORMAT).\n"
+    "\n"
+    "--memory-report prints the memory used by mpirc at exit and on SIGUSR2,\n"
+    "and --hold-report how long the ranks took to be held and released, or\n"
+    "they write it as JSON to FILE.\n"
+    "\n"
+    "--journal records the events of mpirc in FILE, read it with mpirjournal.\n"
+    "\n"
     "OPTIONS:";
 #define ARGS_PMIX_PREFIX 0x80 // 128
+#define ARGS_STOP        0x81 // 129
+#define ARGS_HOLD_RANKS  0x82 // 130
+#define ARGS_TOOL_DAEMON 0x83 // 131
+#define ARGS_RELEASE     0x84 // 132
+#define ARGS_FORWARD_SIGNALS 0x85 // 133
+#define ARGS_JOB_CONTROL 0x86 // 134
+#define ARGS_OUTPUT_PREFIX 0x87 // 135
+#define ARGS_OUTPUT_DIR  0x88 // 136
+#define ARGS_OUTPUT_PER_NODE 0x89 // 137
+#define ARGS_OUTPUT_COMPRESS 0x8a // 138
+#define ARGS_OUTPUT_RATE 0x8b // 139
+#define ARGS_OUTPUT_TOTAL_RATE 0x8c // 140
+#define ARGS_OUTPUT_LIMIT_POLICY 0x8d // 141
+#define ARGS_OUTPUT_AGGREGATE 0x8e // 142
+#define ARGS_STDIN       0x8f // 143
+#define ARGS_TIMINGS     0x90 // 144
+#define ARGS_PMIX_PROFILE 0x91 // 145
+#define ARGS_TRACE       0x92 // 146
+#define ARGS_TRACE_FILE  0x93 // 147
+#define ARGS_METRICS     0x94 // 148
+#define ARGS_METRICS_FORMAT 0x95 // 149
+#define ARGS_MEMORY_REPORT 0x96 // 150
+#define ARGS_HOLD_REPORT 0x97 // 151
+#define ARGS_JOURNAL     0x98 // 152
+#define ARGS_PMIX_RECORD 0x99 // 153
+#define ARGS_PMIX_REPLAY 0x9a // 154
+#define ARGS_PMIX_REPLAY_TIMED 0x9b // 155
 static struct argp_option args_options[] =
     {
         {"debug",               'd', 0,     0, "Debugging output"},
@@ -63,6 +164,33 @@ static struct argp_option args_options[] =
         {"pid",                 'c', "PID", 0, "Attach Mode: PID of launcher"},
         {"attach",              'c', "PID", OPTION_ALIAS, ""},
         {"pmix-prefix",         ARGS_PMIX_PREFIX, "PATH", 0, "PMIx Library to use"},
+        {"stop",                ARGS_STOP, "POINT", 0, "Where to hold the application: init (default), exec, app, or none"},
+        {"hold-ranks",          ARGS_HOLD_RANKS, "RANKS", 0, "Hold only these ranks (e.g., 0-15,32)"},
+        {"release",             ARGS_RELEASE, "POLICY", 0, "How to release held ranks: all (default), manual (by a debugger), ranks:N, nodes:N, or rate:R"},
+        {"tool-daemon",         ARGS_TOOL_DAEMON, "CMD", 0, "Tool daemon to start on every application node"},
+        {"forward-signals",     ARGS_FORWARD_SIGNALS, "SIGNALS", 0, "Signals to forward to the application (e.g., USR1,QUIT)"},
+        {"job-control",         ARGS_JOB_CONTROL, 0, 0, "Pause the application on SIGTSTP, resume it on SIGCONT"},
+        {"output-prefix",       ARGS_OUTPUT_PREFIX, "PREFIX", 0, "Write the application output with a prefix: none, rank, time, or rank,time"},
+        {"output-dir",          ARGS_OUTPUT_DIR, "DIR", 0, "Write the application output to one file per rank in DIR"},
+        {"output-per-node",     ARGS_OUTPUT_PER_NODE, 0, 0, "With --output-dir, write one file per node instead"},
+        {"output-compress",     ARGS_OUTPUT_COMPRESS, 0, 0, "With --output-dir, compress the files with gzip"},
+        {"output-rate",         ARGS_OUTPUT_RATE, "RATE", 0, "Limit the output of each rank to RATE bytes per second"},
+        {"output-total-rate",   ARGS_OUTPUT_TOTAL_RATE, "RATE", 0, "Limit the output of all ranks to RATE bytes per second"},
+        {"output-limit-policy", ARGS_OUTPUT_LIMIT_POLICY, "POLICY", 0, "Output over the rate limit: drop (default) or summarize"},
+        {"output-aggregate",    ARGS_OUTPUT_AGGREGATE, "MS", OPTION_ARG_OPTIONAL, "Print identical lines from several ranks once"},
+        {"stdin",               ARGS_STDIN, "RANKS", 0, "Forward stdin to these ranks: 0, a rank list, all, or none"},
+        {"timings",             ARGS_TIMINGS, "FILE", 0, "Write the phase timings as JSON to FILE"},
+        {"pmix-profile",        ARGS_PMIX_PROFILE, "FILE", OPTION_ARG_OPTIONAL, "Profile the PMIx calls, writing the profile as JSON to FILE if given"},
+        {"trace",               ARGS_TRACE, "CATEGORIES", 0, "Trace categories: all (default), none, or a list (e.g., event,signal)"},
+        {"trace-file",          ARGS_TRACE_FILE, "FILE", 0, "Dump the trace to FILE at exit or on a crash"},
+        {"metrics",             ARGS_METRICS, "DEST", 0, "Write the session metrics to a file or unix:PATH"},
+        {"metrics-format",      ARGS_METRICS_FORMAT, "FORMAT", 0, "Format of the metrics: json (default) or prometheus"},
+        {"memory-report",       ARGS_MEMORY_REPORT, "FILE", OPTION_ARG_OPTIONAL, "Report the memory used at exit and on SIGUSR2, as JSON to FILE if given"},
+        {"hold-report",         ARGS_HOLD_REPORT, "FILE", OPTION_ARG_OPTIONAL, "Report the hold and release latency of the ranks, as JSON to FILE if given"},
+        {"journal",             ARGS_JOURNAL, "FILE", 0, "Record the events of the session in FILE, for mpirjournal"},
+        {"pmix-record",         ARGS_PMIX_RECORD, "FILE", 0, "Record the PMIx replies and events of the session in FILE"},
+        {"pmix-replay",         ARGS_PMIX_REPLAY, "FILE", 0, "Replay the PMIx replies and events recorded in FILE, as fast as possible"},
+        {"pmix-replay-timed",   ARGS_PMIX_REPLAY_TIMED, "FILE", 0, "Replay the PMIx replies and events recorded in FILE, as they were timed"},
         {0}
     };
 static struct argp argp = { args_options, mpir_parse_opt, args_doc, args_extra_doc};
@@ -74,6 +202,19 @@ struct mpir_args_t {
     int num_run_args;
     char **run_args;
     char *pmix_prefix;
+    int set_stop_point;
+    mpir_shim_stop_point_t stop_point;
+    char *hold_ranks;
+    int num_daemon_args;
+    char **daemon_args;
+    char *output_dir;
+    int output_per_node;
+    int output_compress;
+    double output_rate;
+    double output_total_rate;
+    char *output_limit_policy;
+    char *metrics;
+    char *metrics_format;
 };
 typedef struct mpir_args_t mpir_args_t;
 
@@ -90,6 +231,7 @@ static error_t mpir_parse_opt(int key, char *arg, struct argp_state *state)
     mpir_args_t *mpir_args = state->input;
     char *endp = NULL;
     size_t len = 0;
+    unsigned long window;
 
     switch(key)
         {
@@ -140,6 +282,146 @@ static error_t mpir_parse_opt(int key, char *arg, struct argp_state *state)
             endp = NULL;
             mpir_args->pmix_prefix = arg;
             break;
+        case ARGS_STOP:
+            if (0 == strcmp(arg, "init")) {
+                mpir_args->stop_point = MPIR_SHIM_STOP_IN_INIT;
+            }
+            else if (0 == strcmp(arg, "exec")) {
+                mpir_args->stop_point = MPIR_SHIM_STOP_ON_EXEC;
+            }
+            else if (0 == strcmp(arg, "app")) {
+                mpir_args->stop_point = MPIR_SHIM_STOP_IN_APP;
+            }
+            else if (0 == strcmp(arg, "none")) {
+                mpir_args->stop_point = MPIR_SHIM_STOP_NONE;
+            }
+            else {
+                fprintf(stderr, "Error: Invalid --stop point '%s'.\n", arg);
+                exit(1);
+            }
+            mpir_args->set_stop_point = 1;
+            break;
+        case ARGS_HOLD_RANKS:
+            mpir_args->hold_ranks = arg;
+            mpir_args->set_stop_point = 1;
+            break;
+        case ARGS_RELEASE:
+            if (0 != MPIR_Shim_set_release_policy(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_FORWARD_SIGNALS:
+            if (0 != MPIR_Shim_set_signal_forwarding(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_JOB_CONTROL:
+            (void)MPIR_Shim_set_job_control_signals(1);
+            break;
+        case ARGS_OUTPUT_PREFIX:
+            if (0 != MPIR_Shim_set_output_prefix(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_OUTPUT_DIR:
+            mpir_args->output_dir = arg;
+            break;
+        case ARGS_OUTPUT_PER_NODE:
+            mpir_args->output_per_node = 1;
+            break;
+        case ARGS_OUTPUT_COMPRESS:
+            mpir_args->output_compress = 1;
+            break;
+        case ARGS_OUTPUT_RATE:
+            mpir_args->output_rate = parse_rate(arg);
+            break;
+        case ARGS_OUTPUT_TOTAL_RATE:
+            mpir_args->output_total_rate = parse_rate(arg);
+            break;
+        case ARGS_OUTPUT_LIMIT_POLICY:
+            mpir_args->output_limit_policy = arg;
+            break;
+        case ARGS_OUTPUT_AGGREGATE:
+            window = 100;
+            if (NULL != arg) {
+                window = strtoul(arg, &endp, 10);
+                if (endp == arg || '\0' != *endp || 0 == window || INT_MAX < window) {
+                    fprintf(stderr, "Error: Invalid aggregation window '%s'.\n", arg);
+                    exit(1);
+                }
+            }
+            if (0 != MPIR_Shim_set_output_aggregation((int)window)) {
+                exit(1);
+            }
+            break;
+        case ARGS_TIMINGS:
+            if (0 != MPIR_Shim_set_timings_file(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_PMIX_PROFILE:
+            if (0 != MPIR_Shim_set_pmix_profile(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_MEMORY_REPORT:
+            if (0 != MPIR_Shim_set_memory_report(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_HOLD_REPORT:
+            if (0 != MPIR_Shim_set_hold_report(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_JOURNAL:
+            if (0 != MPIR_Shim_set_journal(arg, 0)) {
+                exit(1);
+            }
+            break;
+        case ARGS_PMIX_RECORD:
+            if (0 != MPIR_Shim_set_pmix_record(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_PMIX_REPLAY:
+        case ARGS_PMIX_REPLAY_TIMED:
+            if (0 != MPIR_Shim_set_pmix_replay(arg, ARGS_PMIX_REPLAY_TIMED == key)) {
+                exit(1);
+            }
+            break;
+        case ARGS_METRICS:
+            mpir_args->metrics = arg;
+            break;
+        case ARGS_METRICS_FORMAT:
+            mpir_args->metrics_format = arg;
+            break;
+        case ARGS_TRACE:
+            if (0 != MPIR_Shim_set_trace(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_TRACE_FILE:
+            if (0 != MPIR_Shim_set_trace_file(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_STDIN:
+            if (0 != MPIR_Shim_set_stdin_target(arg)) {
+                exit(1);
+            }
+            break;
+        case ARGS_TOOL_DAEMON:
+            if (NULL != mpir_args->daemon_args) {
+                fprintf(stderr, "Error: Multiple --tool-daemon options provided.\n");
+                exit(1);
+            }
+            mpir_args->daemon_args = split_command(arg, &mpir_args->num_daemon_args);
+            if (0 == mpir_args->num_daemon_args) {
+                fprintf(stderr, "Error: Empty --tool-daemon command.\n");
+                exit(1);
+            }
+            break;
         case ARGP_KEY_ARG:
             // Skip to 'ARGP_KEY_ARGS' to consume the rest of the string
             return ARGP_ERR_UNKNOWN;
@@ -161,6 +443,65 @@ static error_t mpir_parse_opt(int key, char *arg, struct argp_state *state)
     return 0;
 }
 
+/**
+ * @name  split_command
+ * @brief Split a command string on blanks into a NULL terminated argv array
+ * @param command: The command string
+ * @param argc: Set to the number of arguments
+ * @return The argv array
+ */
+static char **split_command(const char *command, int *argc)
+{
+    char *copy, *token, *saveptr = NULL;
+    char **argv;
+    int n = 0;
+
+    copy = strdup(command);
+    argv = (char **)malloc(sizeof(char *) * (strlen(command) / 2 + 2));
+    if (NULL == copy || NULL == argv) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    for (token = strtok_r(copy, " \t", &saveptr); NULL != token;
+         token = strtok_r(NULL, " \t", &saveptr)) {
+        argv[n++] = token;
+    }
+    argv[n] = NULL;
+    *argc = n;
+    return argv;
+}
+
+/**
+ * @name  parse_rate
+ * @brief Parse a rate in bytes per second, with an optional K, M or G suffix
+ * @param arg: The rate string
+ * @return The rate; exits if it is not valid
+ */
+static double parse_rate(const char *arg)
+{
+    char *endp = NULL;
+    double rate;
+
+    rate = strtod(arg, &endp);
+    switch (*endp) {
+        case 'G': case 'g':
+            rate *= 1024;
+            // Fall through
+        case 'M': case 'm':
+            rate *= 1024;
+            // Fall through
+        case 'K': case 'k':
+            rate *= 1024;
+            endp++;
+            break;
+    }
+    if (endp == arg || '\0' != *endp || 0 >= rate) {
+        fprintf(stderr, "Error: Invalid rate '%s'.\n", arg);
+        exit(1);
+    }
+    return rate;
+}
+
 /**
  * @name  mpir_version_hook
  * @brief Display version information when requested
@@ -208,7 +549,7 @@ static void mpir_version_hook(FILE *stream, struct argp_state *state)
 /***********************************************************************/
 int main(int argc, char *argv[])
 {
-    int rc;
+    int rc, i, start, num_args;
     mpir_args_t mpir_args;
 
     /*
@@ -220,6 +561,19 @@ int main(int argc, char *argv[])
     mpir_args.num_run_args = 0;
     mpir_args.run_args = NULL;
     mpir_args.pmix_prefix = NULL;
+    mpir_args.set_stop_point = 0;
+    mpir_args.stop_point = MPIR_SHIM_STOP_IN_INIT;
+    mpir_args.hold_ranks = NULL;
+    mpir_args.num_daemon_args = 0;
+    mpir_args.daemon_args = NULL;
+    mpir_args.output_dir = NULL;
+    mpir_args.output_per_node = 0;
+    mpir_args.output_compress = 0;
+    mpir_args.output_rate = 0;
+    mpir_args.output_total_rate = 0;
+    mpir_args.output_limit_policy = NULL;
+    mpir_args.metrics = NULL;
+    mpir_args.metrics_format = NULL;
 
     argp_program_version_hook= mpir_version_hook;
     argp_program_bug_address = "the OpenPMIx mailing list or GitHub.\nhttps://openpmix.github.io";
@@ -229,6 +583,74 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    if (mpir_args.set_stop_point &&
+        0 != MPIR_Shim_set_stop_point(mpir_args.stop_point, mpir_args.hold_ranks)) {
+        exit(1);
+    }
+
+    if (NULL != mpir_args.daemon_args &&
+        0 != MPIR_Shim_set_tool_daemon(mpir_args.num_daemon_args, mpir_args.daemon_args)) {
+        exit(1);
+    }
+
+    if (NULL == mpir_args.output_dir &&
+        (mpir_args.output_per_node || mpir_args.output_compress)) {
+        fprintf(stderr, "Error: --output-per-node and --output-compress require --output-dir.\n");
+        exit(1);
+    }
+    if (NULL != mpir_args.output_dir &&
+        0 != MPIR_Shim_set_output_dir(mpir_args.output_dir, mpir_args.output_per_node,
+                                      mpir_args.output_compress)) {
+        exit(1);
+    }
+
+    if ((0 != mpir_args.output_rate || 0 != mpir_args.output_total_rate ||
+         NULL != mpir_args.output_limit_policy) &&
+        0 != MPIR_Shim_set_output_rate_limit(mpir_args.output_rate,
+                                             mpir_args.output_total_rate,
+                                             mpir_args.output_limit_policy)) {
+        exit(1);
+    }
+
+    if (NULL == mpir_args.metrics && NULL != mpir_args.metrics_format) {
+        fprintf(stderr, "Error: --metrics-format requires --metrics.\n");
+        exit(1);
+    }
+    if (NULL != mpir_args.metrics &&
+        0 != MPIR_Shim_set_metrics(mpir_args.metrics, mpir_args.metrics_format)) {
+        exit(1);
+    }
+
+    /*
+     * Split off any additional jobs. The separator arguments are replaced
+     * with NULL so each command line is NULL terminated.
+     */
+    num_args = mpir_args.num_run_args;
+    start = 0;
+    for (i = 0; i <= num_args; i++) {
+        if (i < num_args && 0 != strcmp(mpir_args.run_args[i], MPIRC_JOB_SEPARATOR)) {
+            continue;
+        }
+        if (i == num_args && 0 == start) {
+            break;
+        }
+        if (i == start) {
+            fprintf(stderr, "Error: Empty job command line next to \"%s\".\n",
+                    MPIRC_JOB_SEPARATOR);
+            exit(1);
+        }
+        if (i < num_args) {
+            mpir_args.run_args[i] = NULL;
+        }
+        if (0 == start) {
+            mpir_args.num_run_args = i;
+        }
+        else if (0 != MPIR_Shim_add_job(i - start, &mpir_args.run_args[start])) {
+            exit(1);
+        }
+        start = i + 1;
+    }
+
     /*
      * Call the main driver
      */
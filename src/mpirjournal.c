@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * mpirjournal: print the event journals of the MPIR shim as text, oldest
+ * record first.
+ */
+#include "mpirshim.h"
+#include "mpirshim_config.h"
+#include "mpirshim_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <argp.h>
+
+#include <pmix_tool.h>
+
+/* Use argp to parse the command line
+ *   https://www.gnu.org/software/libc/manual/html_node/Argp.html
+ */
+static error_t journal_parse_opt(int key, char *arg, struct argp_state *state);
+
+static char args_doc[] = "FILE...";
+static char args_extra_doc[] =
+    "Print MPIR shim event journals\n"
+    "\n"
+    "FILE:\n"
+    "  A journal written with mpirc --journal, MPIR_SHIM_JOURNAL or\n"
+    "  MPIR_Shim_set_journal(), on a machine of the same byte order. The\n"
+    "  journal can be read while it is written.\n"
+    "\n"
+    "Each line shows the wall clock time of the record, its sequence number,\n"
+    "the thread id, the type, the job and what happened.\n"
+    "\n"
+    "OPTIONS:";
+static struct argp_option args_options[] =
+    {
+        {"types", 't', "TYPES", 0, "Print only these record types (e.g., event,exit)"},
+        {0}
+    };
+static struct argp argp = { args_options, journal_parse_opt, args_doc, args_extra_doc};
+
+static const char *type_names[] = MPIR_SHIM_JOURNAL_NAMES;
+// Record types printed, all by default
+static unsigned int type_mask = ~0U;
+
+static int decode_file(const char *path);
+static int compare_records(const void *a, const void *b);
+static const char *rank_string(uint32_t rank, char *buffer, size_t size);
+static void print_record(const mpir_shim_journal_record_t *record);
+
+int main(int argc, char **argv)
+{
+    int first_file;
+    int rc = 0;
+
+    // The files are left unparsed, from first_file on
+    if (0 != argp_parse(&argp, argc, argv, 0, &first_file, NULL)) {
+        return 1;
+    }
+    if (first_file >= argc) {
+        argp_help(&argp, stderr, ARGP_HELP_USAGE, argv[0]);
+        return 1;
+    }
+    for (; first_file < argc; first_file++) {
+        if (0 != decode_file(argv[first_file])) {
+            rc = 1;
+        }
+    }
+    return rc;
+}
+
+/**
+ * @name   journal_parse_opt
+ * @brief  Parse one command line option.
+ */
+static error_t journal_parse_opt(int key, char *arg, struct argp_state *state)
+{
+    const char *name;
+    size_t length;
+    int i;
+
+    switch (key) {
+        case 't':
+            type_mask = 0;
+            for (name = arg; ; name += length + 1) {
+                length = strcspn(name, ",");
+                for (i = 0; i < MPIR_SHIM_NUM_JOURNAL; i++) {
+                    if (strlen(type_names[i]) == length &&
+                        0 == strncmp(name, type_names[i], length)) {
+                        type_mask |= 1U << i;
+                        break;
+                    }
+                }
+                if (MPIR_SHIM_NUM_JOURNAL == i) {
+                    argp_error(state, "Invalid record type '%.*s'.", (int)length, name);
+                }
+                if ('\0' == name[length]) {
+                    break;
+                }
+            }
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/**
+ * @name   decode_file
+ * @brief  Print one journal.
+ * @param  path: The journal
+ * @return 0 if successful, 1 if failed
+ */
+int decode_file(const char *path)
+{
+    mpir_shim_journal_header_t header;
+    mpir_shim_journal_record_t *records = NULL, *record;
+    FILE *stream;
+    size_t num_records = 0, i;
+    uint64_t head, first, torn;
+    time_t seconds;
+    struct tm tm;
+    char when[32];
+    uint64_t wall_ns;
+    int rc = 1;
+
+    stream = fopen(path, "rb");
+    if (NULL == stream) {
+        perror(path);
+        return 1;
+    }
+    if (1 != fread(&header, sizeof(header), 1, stream) ||
+        0 != memcmp(header.magic, MPIR_SHIM_JOURNAL_MAGIC, sizeof(header.magic))) {
+        fprintf(stderr, "%s: not an MPIR shim journal\n", path);
+        goto done;
+    }
+    if (MPIR_SHIM_JOURNAL_VERSION != header.version ||
+        sizeof(mpir_shim_journal_record_t) != header.record_size) {
+        fprintf(stderr, "%s: not an MPIR shim journal of version %d\n", path,
+                MPIR_SHIM_JOURNAL_VERSION);
+        goto done;
+    }
+
+    records = malloc((size_t)header.num_records * sizeof(mpir_shim_journal_record_t));
+    if (NULL == records ||
+        0 != fseek(stream, MPIR_SHIM_JOURNAL_HEADER_SIZE, SEEK_SET)) {
+        fprintf(stderr, "%s: out of memory or truncated\n", path);
+        goto done;
+    }
+    num_records = fread(records, sizeof(mpir_shim_journal_record_t),
+                        header.num_records, stream);
+    if (num_records < header.num_records) {
+        fprintf(stderr, "%s: truncated after %lu records\n", path,
+                (unsigned long)num_records);
+    }
+
+    /*
+     * Keep the records that are complete and in their place. The others
+     * were being written, or were overwritten while the journal was read.
+     */
+    head = header.head;
+    first = (head > header.num_records) ? head - header.num_records : 0;
+    for (i = 0, record = records; i < num_records; i++) {
+        if (0 == records[i].seq || records[i].seq > head ||
+            (records[i].seq - 1) % header.num_records != i ||
+            records[i].type >= MPIR_SHIM_NUM_JOURNAL) {
+            continue;
+        }
+        *record++ = records[i];
+    }
+    torn = (head - first) - (uint64_t)(record - records);
+    num_records = record - records;
+    qsort(records, num_records, sizeof(mpir_shim_journal_record_t), compare_records);
+
+    seconds = (time_t)(header.realtime_ns / 1000000000ULL);
+    localtime_r(&seconds, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("# %s: pid %u, opened %s, %llu records appended, %lu kept",
+           path, header.pid, when, (unsigned long long)head, (unsigned long)num_records);
+    if (0 < first) {
+        printf(", %llu overwritten", (unsigned long long)first);
+    }
+    if (0 < torn) {
+        printf(", %llu incomplete", (unsigned long long)torn);
+    }
+    printf("\n");
+
+    for (i = 0; i < num_records; i++) {
+        if (!(type_mask & (1U << records[i].type))) {
+            continue;
+        }
+
+        // Records use the monotonic clock, convert to the wall clock
+        wall_ns = header.realtime_ns + (records[i].time_ns - header.monotonic_ns);
+        seconds = (time_t)(wall_ns / 1000000000ULL);
+        localtime_r(&seconds, &tm);
+        strftime(when, sizeof(when), "%H:%M:%S", &tm);
+        printf("%s.%06lu %8llu %7d %-13s ", when,
+               (unsigned long)(wall_ns % 1000000000ULL / 1000),
+               (unsigned long long)records[i].seq, records[i].tid,
+               type_names[records[i].type]);
+        if (0 <= records[i].job) {
+            printf("job %-3d ", records[i].job);
+        }
+        else {
+            printf("%-8s", "");
+        }
+        print_record(&records[i]);
+        printf("\n");
+    }
+    rc = 0;
+
+done:
+    fclose(stream);
+    free(records);
+    return rc;
+}
+
+/**
+ * @name   compare_records
+ * @brief  Order records by sequence number.
+ */
+int compare_records(const void *a, const void *b)
+{
+    const mpir_shim_journal_record_t *record_a = a;
+    const mpir_shim_journal_record_t *record_b = b;
+
+    return (record_a->seq < record_b->seq) ? -1 : (record_a->seq > record_b->seq);
+}
+
+/**
+ * @name   rank_string
+ * @brief  Format a PMIx rank.
+ * @param  rank: The rank
+ * @param  buffer: Where to format it
+ * @param  size: Size of buffer
+ * @return buffer
+ */
+const char *rank_string(uint32_t rank, char *buffer, size_t size)
+{
+    if (PMIX_RANK_WILDCARD == rank) {
+        snprintf(buffer, size, "*");
+    }
+    else if (PMIX_RANK_VALID < rank) {
+        snprintf(buffer, size, "-");
+    }
+    else {
+        snprintf(buffer, size, "%u", rank);
+    }
+    return buffer;
+}
+
+/**
+ * @name   print_record
+ * @brief  Print what a record says happened.
+ * @param  record: The record
+ */
+void print_record(const mpir_shim_journal_record_t *record)
+{
+    static const char *modes[] = {"dynamic", "proxy", "non-proxy", "attach"};
+    static const char *states[] = {"MPIR_NULL", "MPIR_DEBUG_SPAWNED",
+                                   "MPIR_DEBUG_ABORTING"};
+    char rank[16];
+    char text[MPIR_SHIM_JOURNAL_TEXT];
+
+    // A record may have been cut while it was written
+    memcpy(text, record->text, sizeof(text));
+    text[sizeof(text) - 1] = '\0';
+
+    switch (record->type) {
+        case MPIR_SHIM_JOURNAL_SESSION_START:
+            printf("%s mode, %lld jobs, launcher '%s'",
+                   (0 <= record->status && 4 > record->status) ? modes[record->status] : "?",
+                   (long long)record->value, text);
+            break;
+        case MPIR_SHIM_JOURNAL_SESSION_END:
+            printf("status %d, %s", record->status, text);
+            break;
+        case MPIR_SHIM_JOURNAL_EVENT:
+            printf("%s, %s:%s", PMIx_Error_string(record->status), text,
+                   rank_string(record->rank, rank, sizeof(rank)));
+            break;
+        case MPIR_SHIM_JOURNAL_EXIT:
+            printf("exit code %d, %s:%s", record->status, text,
+                   rank_string(record->rank, rank, sizeof(rank)));
+            break;
+        case MPIR_SHIM_JOURNAL_PHASE:
+            printf("%s took %.3f ms", text, record->value / 1e3);
+            break;
+        case MPIR_SHIM_JOURNAL_STATE:
+            printf("%s", (0 <= record->value && 3 > record->value) ?
+                   states[record->value] : "?");
+            if ('\0' != text[0]) {
+                printf(", %s", text);
+            }
+            break;
+        case MPIR_SHIM_JOURNAL_PROCTABLE:
+            printf("generation %d, %lld processes at %u, %s", record->status,
+                   (long long)record->value, record->rank, text);
+            break;
+        case MPIR_SHIM_JOURNAL_RELEASE:
+            printf("%lld processes from %s:%s", (long long)record->value, text,
+                   rank_string(record->rank, rank, sizeof(rank)));
+            break;
+        case MPIR_SHIM_JOURNAL_SIGNAL:
+            printf("signal %lld (%s) forwarded", (long long)record->value,
+                   strsignal((int)record->value));
+            break;
+        default:
+            break;
+    }
+}
@@ -35,15 +35,25 @@
 
 #include "mpirshim_config.h"
 #include "mpirshim.h"
+#include "mpirshim_iof.h"
+#include "mpirshim_profile.h"
+#include "mpirshim_trace.h"
+#include "mpirshim_metrics.h"
+#include "mpirshim_memory.h"
+#include "mpirshim_hold.h"
+#include "mpirshim_journal.h"
 
 #include <pthread.h>
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <pmix_tool.h>
@@ -52,22 +62,40 @@
 /**********************************************************************/
 /* Print a fatal error message along with the PMIx status (if it's not
    PMIX_SUCCESS), finalize the tool, and exit. */
-static void pmix_fatal_error(pmix_status_t rc, const char *format, ...);
+static int pmix_fatal_error(pmix_status_t rc, const char *format, ...);
+#ifdef MPIR_SHIM_PRELOAD
+static void preload_disable_mpir(void);
+#endif
+
 
+// CLI option: Debugging (-d)
+static char debug_active;
 
 /**********************************************************************/
-/* Internal "debug printf" function. */
-static void debug_print(char *format, ...);
+/* Trace a message to the binary trace, and print it with debugging on.
+   The arguments are only evaluated when the message is used. */
+#define MPIR_SHIM_TRACE(category, ...)                                  \
+    do {                                                                \
+        if (MPIR_SHIM_TRACE_ON(category) || debug_active) {             \
+            mpir_shim_trace(category, debug_active, __VA_ARGS__);       \
+        }                                                               \
+    } while (0)
+
+/* Internal "debug printf", a message of the general category. */
+#define debug_print(...) MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_GENERAL, __VA_ARGS__)
 
 /**********************************************************************/
-/* Funtion entry and exit tracing */
+/* Funtion entry and exit tracing. The empty string closing the arguments
+   is consumed by the final %s. */
 #define MPIR_SHIM_DEBUG_ENTER(...) { MPIR_SHIM_DEBUG_ENTER_(__VA_ARGS__, ""); }
 #define MPIR_SHIM_DEBUG_ENTER_(format, ...)                             \
-    debug_print(">>> ENTER (%s): " format "\n", __func__, ##__VA_ARGS__);
+    MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_FLOW,                               \
+                    ">>> ENTER (%s): " format "%s\n", __func__, ##__VA_ARGS__);
 
 #define MPIR_SHIM_DEBUG_EXIT(...) { MPIR_SHIM_DEBUG_EXIT_(__VA_ARGS__, ""); }
 #define MPIR_SHIM_DEBUG_EXIT_(format, ...)                             \
-    debug_print("<<< EXIT  (%s): " format "\n", __func__, ##__VA_ARGS__);
+    MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_FLOW,                               \
+                    "<<< EXIT  (%s): " format "%s\n", __func__, ##__VA_ARGS__);
 
 
 /**********************************************************************
@@ -221,7 +249,8 @@ void MPIR_Breakpoint(void)
 #ifdef MPIR_SHIM_TESTCASE
 #pragma weak MPIR_Breakpoint_hook
     void MPIR_Breakpoint_hook(void);
-    debug_print("MPI_Breakpoint_hook=%p\n", MPIR_Breakpoint_hook);
+    debug_print("MPI_Breakpoint_hook is %s\n",
+                (NULL != MPIR_Breakpoint_hook) ? "set" : "not set");
     if (NULL != MPIR_Breakpoint_hook) {
         MPIR_Breakpoint_hook();
     }
@@ -251,9 +280,50 @@ void MPIR_Breakpoint(void)
 /*******************************************************************************
 *                           End of MPIR declarations                           *
 *******************************************************************************/
+
+/*
+ * MPIR_Shim_jobtable is an extension to the MPIR interface, it is not part of
+ * the MPIR document. When several jobs are launched in one session the
+ * MPIR_proctable holds the processes of all of them, one job after the other.
+ * Each MPIR_SHIM_JOBDESC describes the slice of MPIR_proctable belonging to
+ * one job so a tool that knows about this extension can present per-job
+ * views. Tools that only know MPIR see one combined job.
+ */
+typedef struct MPIR_SHIM_JOBDESC {
+  char *launcher_namespace;
+  char *application_namespace;
+  int proctable_offset;
+  int proctable_size;
+  char *daemon_namespace;
+  int daemon_table_offset;
+  int daemon_table_size;
+} MPIR_SHIM_JOBDESC;
+
+MPIR_SHIM_JOBDESC *MPIR_Shim_jobtable = 0;
+int MPIR_Shim_jobtable_size = 0;
+
+/*
+ * MPIR_Shim_daemon_table is an extension to the MPIR interface, it is not
+ * part of the MPIR document. When a tool daemon command is given (see
+ * MPIR_Shim_set_tool_daemon) the launcher starts one daemon on every node
+ * hosting application processes before MPIR_Breakpoint is called. Each entry
+ * describes one daemon, using the same layout as MPIR_proctable, so a tool
+ * can match daemons to MPIR_proctable entries by host_name. The entries of
+ * each job are described by the daemon_table fields of MPIR_Shim_jobtable.
+ */
+MPIR_PROCDESC *MPIR_Shim_daemon_table = 0;
+int MPIR_Shim_daemon_table_size = 0;
+
 #define STATUS_OK 0
 #define STATUS_FAIL 1
 
+// Shortest interval between process table queries for the hold report
+#define HOLD_POLL_MS 100
+
+// Most ranks a rank list may name. The job size is not known when the list
+// is parsed, this refuses a typo such as "0-4000000000" before allocating.
+#define MAX_RANK_LIST 16777216
+
 typedef struct MPIR_Shim_Condition {
     char *name;
     pthread_mutex_t mutex;
@@ -261,25 +331,97 @@ typedef struct MPIR_Shim_Condition {
     int flag;
 } MPIR_Shim_Condition;
 
+/*
+ * State kept for each launcher command line run in this session. A session
+ * normally has one job, but several launches can share a single tool
+ * connection and MPIR_proctable (see MPIR_Shim_add_job).
+ */
+typedef struct MPIR_Shim_Job {
+    int index;
+    int num_run_args;
+    char **run_args;
+    char launcher_namespace[PMIX_MAX_NSLEN + 1];
+    pmix_proc_t launcher_proc;
+    pmix_proc_t application_proc;
+    int app_terminated;
+    int app_exit_code;
+    int launcher_terminated;
+    int launcher_exit_code;
+    // Slice of MPIR_proctable holding this job's processes
+    int proctable_offset;
+    int proctable_size;
+    // Tool daemons co-launched with the application
+    char daemon_namespace[PMIX_MAX_NSLEN + 1];
+    int daemon_table_offset;
+    int daemon_table_size;
+    // Callback ids
+    size_t launch_complete_cb_id;
+    size_t launch_ready_cb_id;
+    size_t launcher_terminate_cb_id;
+    size_t app_terminate_cb_id;
+    size_t proc_failure_cb_id;
+    // Synchronization controls
+    MPIR_Shim_Condition launch_complete_cond;
+    MPIR_Shim_Condition ready_for_debug_cond;
+    MPIR_Shim_Condition launch_term_cond;
+} MPIR_Shim_Job;
+
+// A failed application process, as reported to the tool
+typedef struct proc_failure_t {
+    int pending;
+    int job_index;
+    pmix_rank_t rank;
+    pmix_status_t status;
+    int exit_code;
+    int have_exit_code;
+} proc_failure_t;
+
 // Initialize/Finalize this tool
 static int initialize_as_tool(void);
 static int finalize_as_tool(void);
+static void finalize_session_tool(void);
 
 // Connect this tool to a server
-static int connect_to_server(void);
+static int connect_to_server(MPIR_Shim_Job *job);
+static int select_job_server(MPIR_Shim_Job *job);
+static int lock_job_server(MPIR_Shim_Job *job);
+static void unlock_job_server(void);
+
+// Query the process table of a namespace of a job
+static int query_job_proctable(MPIR_Shim_Job *job, const char *nspace,
+                               int quiet, pmix_info_t **query_data,
+                               size_t *query_size);
+
+// Co-launch tool daemons with the application
+static int spawn_tool_daemons(MPIR_Shim_Job *job);
+static int pmix_daemon_table_to_mpir(void);
 
 // Access MPIR Proctable
 static int pmix_proc_table_to_mpir(void);
+static void free_proctable_queries(pmix_info_t **query_data, size_t *query_size);
 
 // PMIx Spawn of launcher which will then spawn the application
-static int spawn_launcher_and_application(void);
+static int spawn_launcher_and_application(MPIR_Shim_Job *job);
 
 // Register various event handlers
 static int register_default_event_handler(void);
-static int register_launcher_complete_handler(void);
-static int register_launcher_ready_handler(void);
-static int register_launcher_terminate_handler(void);
-static int register_application_terminate_handler(void);
+
+// Phase timings of MPIR_Shim_common
+static int run_session(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
+                       int argc, char *argv[], const char *pmix_prefix_);
+static double timing_now(void);
+static void record_timing(const char *phase, int job_index, double start_ms);
+static int write_timings(int status);
+static void write_json_string(FILE *file, const char *string);
+static const char *session_mode_name(void);
+static const char *session_exit_reason(int status);
+static int job_exit_code(MPIR_Shim_Job *job);
+static void end_session_metrics(const char *exit_reason, int status);
+static int register_launcher_complete_handler(MPIR_Shim_Job *job);
+static int register_launcher_ready_handler(MPIR_Shim_Job *job);
+static int register_launcher_terminate_handler(MPIR_Shim_Job *job);
+static int register_application_terminate_handler(MPIR_Shim_Job *job);
+static int register_proc_failure_handler(MPIR_Shim_Job *job);
 
 // Handlers for the various events
 static void registration_complete_handler(pmix_status_t status,
@@ -313,6 +455,14 @@ static void application_terminate_handler(size_t handler_id, pmix_status_t statu
                                           pmix_info_t results[], size_t nresults,
                                           pmix_event_notification_cbfunc_fn_t cbfunc,
                                           void *cbdata);
+static void proc_failure_handler(size_t handler_id, pmix_status_t status,
+                                 const pmix_proc_t *source,
+                                 pmix_info_t info[], size_t ninfo,
+                                 pmix_info_t results[], size_t nresults,
+                                 pmix_event_notification_cbfunc_fn_t cbfunc,
+                                 void *cbdata);
+static void report_proc_failure(const proc_failure_t *failure);
+static void publish_proc_table(void);
 
 // atexit handler to make sure we cleanup
 static void exit_handler(void);
@@ -322,19 +472,69 @@ static void signal_handler(int signum);
 
 // Utility functions
 static void wait_for_condition(MPIR_Shim_Condition *wait_cond);
+static int wait_for_condition_timeout(MPIR_Shim_Condition *wait_cond,
+                                      double timeout_ms);
+static void wait_for_ready_for_debug(MPIR_Shim_Job *job);
+static void observe_held_ranks(MPIR_Shim_Job *job);
 static void post_condition(MPIR_Shim_Condition *wait_cond);
 static void release_conditions(void);
+static void release_job_conditions(MPIR_Shim_Job *job);
+static void free_jobs(void);
 static int setup_signal_handlers(void);
+static void add_forward_signal(int signum);
+static void stop_signal_forwarding(void);
+static void forward_signal_handler(int signum);
+static void *forward_signal_thread(void *arg);
+static int forward_signal(int signum);
+static int control_application(MPIR_Shim_Job *job, const char *directive,
+                               double *elapsed);
+static void control_all_applications(const char *directive);
+static void forward_signal_complete(pmix_status_t status, pmix_info_t *info,
+                                    size_t ninfo, void *cbdata,
+                                    pmix_release_cbfunc_t release_fn,
+                                    void *release_cbdata);
+static MPIR_Shim_Job *find_nspace_job(const char *nspace);
+static void journal_event(pmix_status_t status, const pmix_proc_t *source,
+                          pmix_info_t info[], size_t ninfo);
+static void journal_debug_state(void);
+static MPIR_Shim_Job *find_event_job(const pmix_proc_t *source,
+                                     pmix_info_t info[], size_t ninfo);
 
 // Command line options
 static int process_options(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_, int arg, char *argv[]);
 
+// Setup the per-job state for this session
+static int setup_jobs(int argc, char *argv[]);
+
+// Stop point and held ranks for the application
+static int parse_rank_list(const char *ranks, pmix_rank_t **rank_list, size_t *num_ranks);
+static int compare_ranks(const void *a, const void *b);
+static int add_stop_directive(void *directive_list);
+
 // Query the launcher/application namespace
-static int query_launcher_namespace(void);
-static int query_application_namespace(void);
+static int query_launcher_namespace(MPIR_Shim_Job *job);
+static int query_application_namespace(MPIR_Shim_Job *job);
 
 // Release all processes in the specified namespace
 static int release_procs_in_namespace(char *namespace, pmix_rank_t rank);
+static int release_procs(pmix_proc_t *procs, size_t num_procs);
+
+// Release the held application processes of a job following the release policy
+static int release_application(MPIR_Shim_Job *job);
+static int release_application_waves(MPIR_Shim_Job *job);
+static int compare_release_rank(const void *a, const void *b);
+static int release_job_ranks(MPIR_Shim_Job *job, const pmix_rank_t *ranks, size_t num_ranks);
+static double elapsed_ms(const struct timespec *start, const struct timespec *end);
+
+// Share one copy of each host and executable name between table entries
+static const char *intern_string(const char *str);
+static void free_interned_strings(void);
+static size_t namespace_size(const char *name);
+
+// Proctable pushed directly by the host process (MPIR_Shim_proctable_*)
+static int provider_api_allowed(void);
+static int grow_provider_table(int size);
+static int publish_provider_table(int debug_state);
 
 // Environment
 extern char **environ;
@@ -343,61 +543,140 @@ extern char **environ;
 static int const_true = 1;
 
 // Command line arguments after the mpir args
-static int num_run_args;
-static char **run_args;
 static char *pmix_prefix = NULL;
 static char *tool_binary_name;
 
+// Jobs in this session. The first job comes from the MPIR_Shim_common
+// arguments, any others were queued with MPIR_Shim_add_job.
+static MPIR_Shim_Job *shim_jobs = NULL;
+static int num_shim_jobs = 0;
+static int num_added_jobs = 0;
+static int *added_job_argc = NULL;
+static char ***added_job_argv = NULL;
+// Job whose launcher is the current primary server (proxy mode)
+static MPIR_Shim_Job *server_job = NULL;
+// Held from selecting the server of a job until the requests to it are
+// made, so the signal forwarding thread cannot switch the primary server
+// under the main thread, or the other way around
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Phase timings of the current MPIR_Shim_common call, and where to write them
+static MPIR_Shim_timing_t *timings = NULL;
+static int num_timings = 0;
+static int timings_capacity = 0;
+static struct timespec timings_origin;
+static struct timespec timings_wall_origin;
+static char *timings_file = NULL;
+
 // General state flags
 static int pmix_initialized = 0;
 static int session_count = 0;
-static int app_terminated;
-static int app_exit_code = PMIX_SUCCESS;
+// Set once every launcher in the session has terminated
 static int launcher_terminated;
-static int launcher_exit_code = PMIX_SUCCESS;
+static int num_launchers_terminated = 0;
+// Number of times MPIR_proctable was published, for the journal
+static int proctable_generation = 0;
 
 // Callback ids
 static size_t callback_reg_id;
 static pmix_status_t callback_reg_status;
 static size_t default_cb_id = -1;
-static size_t launch_complete_cb_id = -1;
-static size_t launch_ready_cb_id = -1;
-static size_t launcher_terminate_cb_id = -1;
-static size_t app_terminate_cb_id = -1;
 
 // CLI option: Connect to PID (-c)
 static pid_t connect_pid;
-// CLI option: Debugging (-d)
-static char debug_active;
 // CLI option: Use proxy (e.g., prterun) (-p)
 static mpir_shim_mode_t mpir_mode = MPIR_SHIM_DYNAMIC_PROXY_MODE;
 
+// Where the application processes stop, and which ranks (all if none listed)
+static mpir_shim_stop_point_t stop_point = MPIR_SHIM_STOP_IN_INIT;
+static pmix_rank_t *hold_ranks = NULL;
+static size_t num_hold_ranks = 0;
+
+// How the held application processes are released
+typedef enum {
+    RELEASE_ALL = 0,   // Every held rank at once
+    RELEASE_RANKS,     // Waves of release_count ranks
+    RELEASE_NODES,     // Waves of the ranks on release_count nodes
+    RELEASE_RATE,      // At most release_count ranks per second
+    RELEASE_MANUAL     // Left to the tool, see MPIR_Shim_release_ranks
+} release_policy_t;
+static release_policy_t release_policy = RELEASE_ALL;
+static int release_count = 0;
+
+// Rank of a job and the host it runs on, used to order the ranks by node
+typedef struct release_rank_t {
+    const char *host_name;
+    pmix_rank_t rank;
+} release_rank_t;
+
+// Tool daemon command line, one daemon per application node if set
+static int num_daemon_args = 0;
+static char **daemon_args = NULL;
+
+// Interned host and executable names, an open addressing hash set whose
+// capacity is a power of two. Owns every name in the MPIR tables.
+static char **interned_strings = NULL;
+static size_t interned_capacity = 0;
+static size_t interned_count = 0;
+
+// Number of MPIR_proctable entries allocated by the provider API. Taken
+// before server_lock when both are held.
+static int provider_capacity = 0;
+static int provider_exit_registered = 0;
+static pthread_mutex_t provider_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Signals relayed to the application instead of shutting down the shim.
+// The handlers write the signal number to forward_pipe, a thread reads it
+// and makes the PMIx call, or shuts down, neither of which is allowed in a
+// signal handler.
+static sigset_t forward_signal_set;
+static int num_forward_signals = 0;
+static int forward_pipe[2] = {-1, -1};
+// Started once, by the first session, and joined by stop_signal_forwarding.
+// It reads the job table under server_lock.
+static pthread_t forward_thread;
+// Pause the application on SIGTSTP and resume it on SIGCONT
+static int job_control_signals = 0;
+// Write the memory report on SIGUSR2, unless SIGUSR2 is forwarded
+static int memory_report_signal = 0;
+
+// A signal being forwarded to the application of one job
+typedef struct forward_request_t {
+    pmix_proc_t target;
+    pmix_info_t *directives;
+    int signum;
+} forward_request_t;
+
 // PMIx names for various agents
 static pmix_proc_t tool_proc;
-static pmix_proc_t launcher_proc;
-static pmix_proc_t application_proc;
-static char launcher_namespace[PMIX_MAX_NSLEN + 1];
 
 // Synchronization controls
-static MPIR_Shim_Condition launch_complete_cond = {"launch_complete",
-       PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 1};
-static MPIR_Shim_Condition ready_for_debug_cond = {"ready-for-debug",
-       PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 1};
-static MPIR_Shim_Condition launch_term_cond = {"launch-terminated",
-       PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 1};
 static MPIR_Shim_Condition registration_cond = {"callback-registration",
        PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 1};
-static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+// Set once the first process failure has been reported to the tool.
+// proc_failure_lock also guards MPIR_proctable and MPIR_Shim_jobtable
+// against the failure handler: it only reads them once proctable_published
+// is set, and a failure that arrives before is kept in pending_proc_failure.
+static int proc_failure_reported = 0;
+static int proctable_published = 0;
+// Set by pmix_fatal_error in the preload library, MPIR_Breakpoint is then
+// no longer called
+static int mpir_disabled = 0;
+static proc_failure_t pending_proc_failure;
+static pthread_mutex_t proc_failure_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 /**
  * @name   pmix_fatal_error
- * @brief  Print a fatal error message along with the PMIx status, and exit
+ * @brief  Print a fatal error message along with the PMIx status, and exit.
+ *         The preload library must not exit the launcher it runs in, so it
+ *         turns off the MPIR support and returns instead.
  * @param  rc: PMIx status
  * @param  format: printf-style format string for message. Additional parameters
  *           follow as needed.
+ * @return STATUS_FAIL, in the preload library only
  */
-static void pmix_fatal_error(pmix_status_t rc, const char *format, ...)
+static int pmix_fatal_error(pmix_status_t rc, const char *format, ...)
 {
     va_list arg_list;
 
@@ -414,32 +693,15 @@ static void pmix_fatal_error(pmix_status_t rc, const char *format, ...)
 
     fprintf(stderr, "\n");
 
+#ifdef MPIR_SHIM_PRELOAD
+    preload_disable_mpir();
+    return STATUS_FAIL;
+#else
+    end_session_metrics("fatal_error", 1);
     finalize_as_tool();
 
     exit(1);
-}
-
-/**
- * @name   debug_print
- * @brief  Print a debug message to stdout.
- * @param  format: printf-style format string for message. Additional parameters
- *           follow as needed.
- */
-void debug_print(char *format, ...)
-{
-    va_list args;
-
-    if (1 == debug_active) {
-        pthread_mutex_lock(&print_lock);
-
-        va_start(args, format);
-        printf("DEBUG: ");
-        vprintf(format, args);
-        va_end(args);
-        fflush(stdout);
-
-        pthread_mutex_unlock(&print_lock);
-    }
+#endif
 }
 
 /**
@@ -470,6 +732,19 @@ int finalize_as_tool(void)
     return STATUS_OK;
 }
 
+/**
+ * @name   finalize_session_tool
+ * @brief  Finalize the PMIx environment at the end of a session. server_lock
+ *         is held so the signal forwarding thread is not in a PMIx call, and
+ *         sees the shim is no longer connected once it takes the lock.
+ */
+void finalize_session_tool(void)
+{
+    pthread_mutex_lock(&server_lock);
+    (void) finalize_as_tool();
+    pthread_mutex_unlock(&server_lock);
+}
+
 /**
  * @name   initialize_as_tool
  * @brief  Initialize the PMIx environment for this module.
@@ -572,7 +847,7 @@ int initialize_as_tool(void)
 
     if (MPIR_SHIM_ATTACH_MODE == mpir_mode) {
         // Access launcher information
-        query_launcher_namespace();
+        query_launcher_namespace(&shim_jobs[0]);
     }
 
     pmix_initialized += 1;
@@ -620,16 +895,126 @@ int process_options(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_, int arg
         connect_pid = pid_;
         mpir_mode = MPIR_SHIM_ATTACH_MODE;
     }
+    else {
+        mpir_mode = mpir_mode_;
+    }
 
     debug_active = (bool)debug_;
 
-    num_run_args = argc;
-    run_args     = argv;
-
     MPIR_SHIM_DEBUG_EXIT("");
     return STATUS_OK;
 }
 
+/**
+ * @name   setup_jobs
+ * @brief  Build the job table for this session from the MPIR_Shim_common
+ *         arguments and any jobs queued with MPIR_Shim_add_job.
+ * @param  argc: Number of launcher and application command line arguments
+ * @param  argv: Array of launcher and application command line arguments
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int setup_jobs(int argc, char *argv[])
+{
+    MPIR_Shim_Job *job;
+    int i;
+
+    MPIR_SHIM_DEBUG_ENTER("%d added jobs", num_added_jobs);
+
+    if ((MPIR_SHIM_ATTACH_MODE == mpir_mode) && (0 < num_added_jobs)) {
+        fprintf(stderr, "Multiple jobs can not be used in attach mode.\n");
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    // The table of an earlier session that ended without being finalized
+    if (NULL != shim_jobs) {
+        finalize_session_tool();
+        free_jobs();
+    }
+
+    pthread_mutex_lock(&server_lock);
+    num_shim_jobs = 1 + num_added_jobs;
+    shim_jobs = calloc(num_shim_jobs, sizeof(MPIR_Shim_Job));
+    if (NULL == shim_jobs) {
+        num_shim_jobs = 0;
+        pthread_mutex_unlock(&server_lock);
+        fprintf(stderr, "Unable to allocate the job table.\n");
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    for (i = 0; i < num_shim_jobs; i++) {
+        job = &shim_jobs[i];
+        job->index = i;
+        if (0 == i) {
+            job->num_run_args = argc;
+            job->run_args = argv;
+        }
+        else {
+            job->num_run_args = added_job_argc[i - 1];
+            job->run_args = added_job_argv[i - 1];
+        }
+        PMIX_LOAD_NSPACE(job->launcher_namespace, NULL);
+        PMIX_LOAD_NSPACE(job->launcher_proc.nspace, NULL);
+        job->launcher_proc.rank = PMIX_RANK_WILDCARD;
+        PMIX_LOAD_NSPACE(job->application_proc.nspace, NULL);
+        job->application_proc.rank = PMIX_RANK_WILDCARD;
+        job->app_exit_code = PMIX_SUCCESS;
+        job->launcher_exit_code = PMIX_SUCCESS;
+        job->launch_complete_cb_id = -1;
+        job->launch_ready_cb_id = -1;
+        job->launcher_terminate_cb_id = -1;
+        job->app_terminate_cb_id = -1;
+        job->proc_failure_cb_id = -1;
+
+        job->launch_complete_cond.name = "launch_complete";
+        job->ready_for_debug_cond.name = "ready-for-debug";
+        job->launch_term_cond.name = "launch-terminated";
+        pthread_mutex_init(&job->launch_complete_cond.mutex, NULL);
+        pthread_mutex_init(&job->ready_for_debug_cond.mutex, NULL);
+        pthread_mutex_init(&job->launch_term_cond.mutex, NULL);
+        pthread_cond_init(&job->launch_complete_cond.condition, NULL);
+        pthread_cond_init(&job->ready_for_debug_cond.condition, NULL);
+        pthread_cond_init(&job->launch_term_cond.condition, NULL);
+        job->launch_complete_cond.flag = 1;
+        job->ready_for_debug_cond.flag = 1;
+        job->launch_term_cond.flag = 1;
+    }
+    pthread_mutex_unlock(&server_lock);
+
+    MPIR_SHIM_DEBUG_EXIT("%d jobs", num_shim_jobs);
+    return STATUS_OK;
+}
+
+/**
+ * @name   free_jobs
+ * @brief  Free the job table of the session, with the synchronization
+ *         controls of its jobs. Only called once PMIx is finalized, so no
+ *         event handler can still refer to a job.
+ */
+void free_jobs(void)
+{
+    MPIR_Shim_Job *job;
+    int i;
+
+    // The signal forwarding thread reads the table under server_lock
+    pthread_mutex_lock(&server_lock);
+    for (i = 0; i < num_shim_jobs; i++) {
+        job = &shim_jobs[i];
+        pthread_mutex_destroy(&job->launch_complete_cond.mutex);
+        pthread_mutex_destroy(&job->ready_for_debug_cond.mutex);
+        pthread_mutex_destroy(&job->launch_term_cond.mutex);
+        pthread_cond_destroy(&job->launch_complete_cond.condition);
+        pthread_cond_destroy(&job->ready_for_debug_cond.condition);
+        pthread_cond_destroy(&job->launch_term_cond.condition);
+    }
+    num_shim_jobs = 0;
+    free(shim_jobs);
+    shim_jobs = NULL;
+    server_job = NULL;
+    pthread_mutex_unlock(&server_lock);
+}
+
 /**
  * @name   exit_handler
  * @brief  atexit function to clean up resources obtained by this module.
@@ -640,39 +1025,73 @@ void exit_handler(void)
 
     MPIR_SHIM_DEBUG_ENTER("");
 
+    // No signal is forwarded while the session is torn down
+    stop_signal_forwarding();
+
+    // Report the memory while the tables are still allocated
+    mpir_shim_memory_report();
+
+    // Write out any buffered application output while still connected
+    mpir_shim_iof_stop();
+
     // PMIx_tool_finalize must be called to make sure the launcher exits
     finalize_as_tool();
+    if (0 == pmix_initialized) {
+        free_jobs();
+    }
 
-    if (NULL != MPIR_proctable) {
-        for (i = 0; i < MPIR_proctable_size; i++) {
-            free( MPIR_proctable[i].host_name );
-            free( MPIR_proctable[i].executable_name );
+    // The failure handler no longer reads the tables once unpublished
+    pthread_mutex_lock(&proc_failure_lock);
+    proctable_published = 0;
+    pthread_mutex_unlock(&proc_failure_lock);
+
+    // The host and executable names are interned, not owned by the entries
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE,
+                         (0 < provider_capacity ? provider_capacity : MPIR_proctable_size) *
+                         sizeof(MPIR_PROCDESC));
+    free(MPIR_proctable);
+
+    if (NULL != MPIR_Shim_jobtable) {
+        for (i = 0; i < MPIR_Shim_jobtable_size; i++) {
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_STRINGS,
+                                 namespace_size(MPIR_Shim_jobtable[i].launcher_namespace) +
+                                 namespace_size(MPIR_Shim_jobtable[i].application_namespace) +
+                                 namespace_size(MPIR_Shim_jobtable[i].daemon_namespace));
+            free( MPIR_Shim_jobtable[i].launcher_namespace );
+            free( MPIR_Shim_jobtable[i].application_namespace );
+            free( MPIR_Shim_jobtable[i].daemon_namespace );
         }
-        free(MPIR_proctable);
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE,
+                             MPIR_Shim_jobtable_size * sizeof(MPIR_SHIM_JOBDESC));
+        free(MPIR_Shim_jobtable);
     }
 
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE,
+                         MPIR_Shim_daemon_table_size * sizeof(MPIR_PROCDESC));
+    free(MPIR_Shim_daemon_table);
+    free_interned_strings();
+
     MPIR_SHIM_DEBUG_EXIT("");
 }
 
 /**
  * @name   signal_handler
- * @brief  Handle selected signals by calling exit to perform orderly shutdown,
- *         including running atexit handler functions.
+ * @brief  Handle selected signals by passing them to the forwarding thread,
+ *         which calls exit to perform orderly shutdown, including running
+ *         atexit handler functions. Only async-signal-safe calls are allowed
+ *         here.
+ * @param  signum: The signal received
  */
 void signal_handler(int signum)
 {
-    MPIR_SHIM_DEBUG_ENTER("Signum: %d", signum);
-
-    finalize_as_tool();
-
-    // exit_handler will do further cleanup
-    exit(1);
+    forward_signal_handler(signum);
 }
 
 /**
  * @name   setup_signal_handlers
  * @brief  Register signal handlers for signals we want to trap in order to
- *         perform an orderly shutdown on receipt of those signals.
+ *         perform an orderly shutdown on receipt of those signals, and for the
+ *         signals forwarded to the application.
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
 int setup_signal_handlers(void)
@@ -680,15 +1099,75 @@ int setup_signal_handlers(void)
     struct sigaction signal_parms;
     int signals[] = {SIGHUP, SIGINT, SIGTERM};
     size_t i;
+    int signum;
 
     MPIR_SHIM_DEBUG_ENTER("");
 
+    // Pause and resume requests go through the forwarding thread too
+    if (job_control_signals) {
+        add_forward_signal(SIGTSTP);
+        add_forward_signal(SIGCONT);
+    }
+    if (mpir_shim_memory_report_enabled() && !memory_report_signal) {
+        if (1 == sigismember(&forward_signal_set, SIGUSR2)) {
+            debug_print("SIGUSR2 is forwarded, the memory report is only written at exit\n");
+        }
+        else {
+            add_forward_signal(SIGUSR2);
+            memory_report_signal = 1;
+        }
+    }
+
+    // The pipe and the thread are kept for later sessions
+    if (-1 == forward_pipe[0]) {
+        if (0 != pipe(forward_pipe)) {
+            fprintf(stderr, "An error occured setting up signal forwarding: %s.\n",
+                    strerror(errno));
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+        if (-1 == fcntl(forward_pipe[1], F_SETFL, O_NONBLOCK) ||
+            0 != pthread_create(&forward_thread, NULL, forward_signal_thread, NULL)) {
+            fprintf(stderr, "An error occured setting up signal forwarding: %s.\n",
+                    strerror(errno));
+            close(forward_pipe[0]);
+            close(forward_pipe[1]);
+            forward_pipe[0] = -1;
+            forward_pipe[1] = -1;
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+    }
+
+    if (0 < num_forward_signals) {
+        signal_parms.sa_handler = forward_signal_handler;
+        signal_parms.sa_flags = SA_RESTART;
+        sigemptyset(&signal_parms.sa_mask);
+        signal_parms.sa_restorer = NULL;
+
+        for (signum = 1; signum < NSIG; signum++) {
+            if (1 != sigismember(&forward_signal_set, signum)) {
+                continue;
+            }
+            if (-1 == sigaction(signum, &signal_parms, NULL)) {
+                fprintf(stderr, "An error occured setting a signal handler: %s.\n",
+                        strerror(errno));
+                MPIR_SHIM_DEBUG_EXIT("");
+                return STATUS_FAIL;
+            }
+        }
+    }
+
     signal_parms.sa_handler = signal_handler;
     signal_parms.sa_flags = SA_RESTART;
     sigemptyset(&signal_parms.sa_mask);
     signal_parms.sa_restorer = NULL;
 
     for (i = 0; i < (sizeof(signals) / sizeof(int)); i++) {
+        // A forwarded signal no longer shuts down the shim
+        if (0 < num_forward_signals && 1 == sigismember(&forward_signal_set, signals[i])) {
+            continue;
+        }
         if (-1 == sigaction(signals[i], &signal_parms, NULL)) {
             fprintf(stderr, "An error occured setting a signal handler: %s.\n",
                     strerror(errno));
@@ -702,109 +1181,652 @@ int setup_signal_handlers(void)
 }
 
 /**
- * @name   release_conditions
- * @brief  Post all condition variables so any threads waiting for them to
- *         be posted are not blocked and preventing this module's termination.
+ * @name   add_forward_signal
+ * @brief  Add a signal to the set forwarded to the application, unless it is
+ *         already in it.
+ * @param  signum: The signal to forward
  */
-void release_conditions()
+void add_forward_signal(int signum)
 {
-    MPIR_SHIM_DEBUG_ENTER("");
+    if (1 != sigismember(&forward_signal_set, signum)) {
+        sigaddset(&forward_signal_set, signum);
+        num_forward_signals++;
+    }
+}
 
-    if (1 == registration_cond.flag) {
-        pthread_cond_broadcast(&registration_cond.condition);
-        registration_cond.flag = 0;
+/**
+ * @name   stop_signal_forwarding
+ * @brief  Restore the default action of the shutdown signals, ignore the
+ *         forwarded signals and stop the forwarding thread. Closing
+ *         the write end of the pipe ends the thread once it has forwarded the
+ *         signals already received.
+ */
+void stop_signal_forwarding(void)
+{
+    struct sigaction signal_parms;
+    int signals[] = {SIGHUP, SIGINT, SIGTERM};
+    size_t i;
+    int signum;
+
+    if (-1 == forward_pipe[1]) {
+        return;
     }
-    if (1 == ready_for_debug_cond.flag) {
-        pthread_cond_broadcast(&ready_for_debug_cond.condition);
-        ready_for_debug_cond.flag = 0;
+
+    // The handlers must not write to the pipe once it is closed
+    signal_parms.sa_handler = SIG_DFL;
+    signal_parms.sa_flags = 0;
+    sigemptyset(&signal_parms.sa_mask);
+    signal_parms.sa_restorer = NULL;
+    for (i = 0; i < (sizeof(signals) / sizeof(int)); i++) {
+        (void) sigaction(signals[i], &signal_parms, NULL);
     }
-    if (1 == launch_complete_cond.flag) {
-        pthread_cond_broadcast(&launch_complete_cond.condition);
-        launch_complete_cond.flag = 0;
+    signal_parms.sa_handler = SIG_IGN;
+    for (signum = 1; signum < NSIG; signum++) {
+        if (1 == sigismember(&forward_signal_set, signum)) {
+            (void) sigaction(signum, &signal_parms, NULL);
+        }
     }
-    if (1 == launch_term_cond.flag) {
-        pthread_cond_broadcast(&launch_term_cond.condition);
-        launch_term_cond.flag = 0;
+
+    close(forward_pipe[1]);
+    forward_pipe[1] = -1;
+    // exit may be called from the thread itself, it then ends on its own
+    if (!pthread_equal(pthread_self(), forward_thread)) {
+        pthread_join(forward_thread, NULL);
     }
+    close(forward_pipe[0]);
+    forward_pipe[0] = -1;
+}
 
-    MPIR_SHIM_DEBUG_EXIT("");
+/**
+ * @name   forward_signal_handler
+ * @brief  Handle a signal selected for forwarding by passing it to the
+ *         forwarding thread. Only async-signal-safe calls are allowed here.
+ * @param  signum: The signal received
+ */
+void forward_signal_handler(int signum)
+{
+    unsigned char signal_byte = (unsigned char)signum;
+    int saved_errno = errno;
+    ssize_t rc;
+
+    // If the pipe is full the signal is dropped, as a pending signal would be
+    rc = write(forward_pipe[1], &signal_byte, 1);
+    (void)rc;
+    errno = saved_errno;
 }
 
 /**
- * @name   post_condition
- * @brief  Post a condition variable so any threads waiting for that condition
- *         can resume execution.
- * @param  wait_cond: The condition variable to post
+ * @name   forward_signal_thread
+ * @brief  Forward each signal received by forward_signal_handler to the
+ *         application processes, and shut down on the signals received by
+ *         signal_handler.
+ * @param  arg: Unused
+ * @return NULL
  */
-void post_condition(MPIR_Shim_Condition *wait_cond)
+void *forward_signal_thread(void *arg)
 {
-    MPIR_SHIM_DEBUG_ENTER("Condition '%s'", wait_cond->name);
+    unsigned char signal_byte;
+    ssize_t n;
+
+    (void)arg;
+    for (;;) {
+        n = read(forward_pipe[0], &signal_byte, 1);
+        if (1 == n && job_control_signals && SIGTSTP == signal_byte) {
+            control_all_applications(PMIX_JOB_CTRL_PAUSE);
+        }
+        else if (1 == n && job_control_signals && SIGCONT == signal_byte) {
+            control_all_applications(PMIX_JOB_CTRL_RESUME);
+        }
+        else if (1 == n && memory_report_signal && SIGUSR2 == signal_byte) {
+            mpir_shim_memory_report();
+        }
+        else if (1 == n && 1 != sigismember(&forward_signal_set, signal_byte)) {
+            debug_print("Shutting down on signal %d\n", signal_byte);
+            end_session_metrics("signal", 1);
+            finalize_as_tool();
 
-    pthread_mutex_lock(&(wait_cond->mutex));
-    pthread_cond_broadcast(&(wait_cond->condition));
-    wait_cond->flag = 0;
-    pthread_mutex_unlock(&(wait_cond->mutex));
+            // exit_handler will do further cleanup
+            exit(1);
+        }
+        else if (1 == n) {
+            (void)forward_signal(signal_byte);
+        }
+        else if (0 == n || EINTR != errno) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @name   forward_signal
+ * @brief  Ask the launcher of each job to deliver a signal to every process
+ *         of its application. One PMIx job control request per job covers
+ *         all of the ranks, the launcher fans it out through its own tree.
+ * @param  signum: The signal to forward
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int forward_signal(int signum)
+{
+    forward_request_t *request;
+    MPIR_Shim_Job *job;
+    pmix_status_t rc;
+    int i, status = STATUS_OK;
+
+    MPIR_SHIM_DEBUG_ENTER("Signum: %d", signum);
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_SIGNAL, -1, 0, 0, signum, NULL);
+
+    // The main thread frees the job table and finalizes under server_lock
+    pthread_mutex_lock(&server_lock);
+    if (0 == pmix_initialized) {
+        pthread_mutex_unlock(&server_lock);
+        MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_SIGNAL,
+                        "Not connected to PMIx, dropping signal %d\n", signum);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    for (i = 0; i < num_shim_jobs; i++) {
+        job = &shim_jobs[i];
+        if ('\0' == job->application_proc.nspace[0]) {
+            MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_SIGNAL,
+                            "Job %d has no application yet, dropping signal %d\n",
+                            i, signum);
+            continue;
+        }
+        request = calloc(1, sizeof(forward_request_t));
+        if (NULL == request) {
+            fprintf(stderr, "Unable to allocate signal forwarding request.\n");
+            status = STATUS_FAIL;
+            continue;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS, sizeof(forward_request_t));
+        request->signum = signum;
+        PMIX_PROC_LOAD(&request->target, job->application_proc.nspace,
+                         PMIX_RANK_WILDCARD);
+        PMIX_INFO_CREATE(request->directives, 1);
+        PMIX_INFO_LOAD(&request->directives[0], PMIX_JOB_CTRL_SIGNAL, &signum,
+                       PMIX_INT);
+
+        MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_SIGNAL,
+                        "Forwarding signal %d to '%s'\n", signum,
+                        request->target.nspace);
+        MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_SIGNALS_FORWARDED, 1);
+        if (STATUS_OK == select_job_server(job)) {
+            rc = PMIx_Job_control_nb(&request->target, 1, request->directives, 1,
+                                     forward_signal_complete, request);
+        }
+        else {
+            rc = PMIX_ERR_UNREACH;
+        }
+        if (PMIX_SUCCESS != rc) {
+            fprintf(stderr, "An error occurred forwarding signal %d to '%s': %s.\n",
+                    signum, request->target.nspace, PMIx_Error_string(rc));
+            PMIX_INFO_FREE(request->directives, 1);
+            free(request);
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_EVENTS, sizeof(forward_request_t));
+            status = STATUS_FAIL;
+        }
+    }
+    pthread_mutex_unlock(&server_lock);
 
     MPIR_SHIM_DEBUG_EXIT("");
+    return status;
 }
 
 /**
- * @name   wait_for_condition
- * @brief  Suspend a thread until the specified condition is posted.
- * @param  wait_cond: The condition to wait for completion
+ * @name   control_application
+ * @brief  Pause or resume every process of the application of a job with one
+ *         PMIx job control request. The launcher delivers it through its own
+ *         tree and replies once all of the processes have acknowledged it.
+ *         Called with server_lock held.
+ * @param  job: The job whose application is paused or resumed
+ * @param  directive: PMIX_JOB_CTRL_PAUSE or PMIX_JOB_CTRL_RESUME
+ * @param  elapsed: Set to the time until the last process acknowledged, in
+ *         milliseconds, if not NULL
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-void wait_for_condition(MPIR_Shim_Condition *wait_cond) 
+int control_application(MPIR_Shim_Job *job, const char *directive,
+                        double *elapsed)
 {
-    MPIR_SHIM_DEBUG_ENTER("Condition '%s'", wait_cond->name);
+    struct timespec start, end;
+    pmix_info_t directive_info;
+    pmix_status_t rc;
+    bool flag = true;
 
-    pthread_mutex_lock(&(wait_cond->mutex));
+    MPIR_SHIM_DEBUG_ENTER("Job %d: %s", job->index, directive);
 
-    while ((1 == wait_cond->flag) && (0 == launcher_terminated)) {
-        debug_print("Wait for condition %s to be posted\n", wait_cond->name);
-        pthread_cond_wait(&(wait_cond->condition), &(wait_cond->mutex));
+    if (0 == pmix_initialized || '\0' == job->application_proc.nspace[0]) {
+        fprintf(stderr, "Job %d has no running application.\n", job->index);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    if (STATUS_OK != select_job_server(job)) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
     }
 
-    MPIR_SHIM_DEBUG_EXIT("Condition '%s'", wait_cond->name);
+    PMIX_INFO_LOAD(&directive_info, directive, &flag, PMIX_BOOL);
 
-    // Reset condition flag in preparation for next wait on this condition.
-    wait_cond->flag = 1;
-    pthread_mutex_unlock(&(wait_cond->mutex));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rc = PMIx_Job_control(&job->application_proc, 1, &directive_info, 1,
+                          NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    PMIX_INFO_DESTRUCT(&directive_info);
+
+    if (PMIX_SUCCESS != rc && PMIX_OPERATION_SUCCEEDED != rc) {
+        fprintf(stderr, "An error occurred sending %s to '%s': %s.\n",
+                directive, job->application_proc.nspace, PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    if (NULL != elapsed) {
+        *elapsed = elapsed_ms(&start, &end);
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
 }
 
 /**
- * @name   registration_complete_handler
- * @brief  Handle notification that a callback has been registered.
- * @param  status: Event id for callback
- * @param  handler_ref: Callback id, used to de-register the handler
- * @param  cbdata: Data passed to this callback
+ * @name   control_all_applications
+ * @brief  Pause or resume the applications of all of the jobs, reporting the
+ *         time taken by each on stderr.
+ * @param  directive: PMIX_JOB_CTRL_PAUSE or PMIX_JOB_CTRL_RESUME
  */
-void registration_complete_handler(pmix_status_t status, size_t handler_ref, 
-                                   void *cbdata)
+void control_all_applications(const char *directive)
 {
-    MPIR_SHIM_DEBUG_ENTER("Status '%s'", PMIx_Error_string(status));
+    double elapsed;
+    int i;
 
-    // PMIx callbacks do not provide a way to pass information back to the
-    // code that invoked the callback. Therefore the registration callback
-    // uses two global variables, callback_reg_status and callback_reg_id to
-    // hold the needed information. The code which registered the callback
-    // reads these variables. This requires that a callback registration
-    // must complete before a subsequent callback can be registered in order 
-    // to avoid clobbering variables.
-    callback_reg_status = status;
-    callback_reg_id = handler_ref;
+    // The main thread frees the job table and finalizes under server_lock
+    pthread_mutex_lock(&server_lock);
+    for (i = 0; i < num_shim_jobs; i++) {
+        if (0 == pmix_initialized ||
+            '\0' == shim_jobs[i].application_proc.nspace[0]) {
+            continue;
+        }
+        if (STATUS_OK == control_application(&shim_jobs[i], directive, &elapsed)) {
+            fprintf(stderr, "Job %d %s in %.3f ms\n", i,
+                    (0 == strcmp(directive, PMIX_JOB_CTRL_PAUSE) ? "paused" : "resumed"),
+                    elapsed);
+        }
+    }
+    pthread_mutex_unlock(&server_lock);
+}
 
-    post_condition(&registration_cond);
+/**
+ * @name   forward_signal_complete
+ * @brief  Completion callback for a forwarded signal.
+ * @param  status: Outcome of the job control request
+ * @param  info: Unused
+ * @param  ninfo: Unused
+ * @param  cbdata: The forward_request_t of the request
+ * @param  release_fn: Function to release the info array
+ * @param  release_cbdata: Data for release_fn
+ */
+void forward_signal_complete(pmix_status_t status, pmix_info_t *info,
+                             size_t ninfo, void *cbdata,
+                             pmix_release_cbfunc_t release_fn,
+                             void *release_cbdata)
+{
+    forward_request_t *request = (forward_request_t *)cbdata;
+
+    (void)info;
+    (void)ninfo;
+    if (PMIX_SUCCESS != status && PMIX_OPERATION_SUCCEEDED != status) {
+        fprintf(stderr, "Forwarding signal %d to '%s' failed: %s.\n",
+                request->signum, request->target.nspace,
+                PMIx_Error_string(status));
+    }
+    else {
+        MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_SIGNAL,
+                        "Signal %d delivered to '%s'\n", request->signum,
+                        request->target.nspace);
+    }
 
-    MPIR_SHIM_DEBUG_EXIT("String '%s'", (NULL == cbdata ? "null" : (char*)cbdata) );
+    PMIX_INFO_FREE(request->directives, 1);
+    free(request);
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_EVENTS, sizeof(forward_request_t));
+    if (NULL != release_fn) {
+        release_fn(release_cbdata);
+    }
 }
 
 /**
- * @name   default_event_handler
- * @brief  Default callback for notifications received by this module but not
- *         handled by another callback.
- * @param  handler_id: Callback id for this callback
- * @param: status: The event this handler was invoked for
- * @param  source: The source for the notification
+ * @name   release_conditions
+ * @brief  Post all condition variables so any threads waiting for them to
+ *         be posted are not blocked and preventing this module's termination.
+ */
+void release_conditions()
+{
+    int i;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    if (1 == registration_cond.flag) {
+        pthread_cond_broadcast(&registration_cond.condition);
+        registration_cond.flag = 0;
+    }
+    for (i = 0; i < num_shim_jobs; i++) {
+        release_job_conditions(&shim_jobs[i]);
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("");
+}
+
+/**
+ * @name   release_job_conditions
+ * @brief  Post the condition variables for one job so the main thread is not
+ *         blocked waiting for a job that will not make further progress.
+ * @param  job: The job whose conditions are released
+ */
+void release_job_conditions(MPIR_Shim_Job *job)
+{
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
+
+    if (1 == job->ready_for_debug_cond.flag) {
+        pthread_cond_broadcast(&job->ready_for_debug_cond.condition);
+        job->ready_for_debug_cond.flag = 0;
+    }
+    if (1 == job->launch_complete_cond.flag) {
+        pthread_cond_broadcast(&job->launch_complete_cond.condition);
+        job->launch_complete_cond.flag = 0;
+    }
+    if (1 == job->launch_term_cond.flag) {
+        pthread_cond_broadcast(&job->launch_term_cond.condition);
+        job->launch_term_cond.flag = 0;
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("");
+}
+
+/**
+ * @name   find_event_job
+ * @brief  Find the job an event notification is about. The affected process
+ *         and the source namespace are matched against the job table first.
+ *         A handler is not always registered with a filter that restricts it
+ *         to its own job, so the PMIX_EVENT_RETURN_OBJECT of the handler is
+ *         only used when neither namespace identifies the job.
+ * @param  source: The source for the notification
+ * @param  info: Array of pmix_info_t objects passed to the callback
+ * @param  ninfo: Number of elements in info array
+ * @return The job, or NULL if the event does not belong to any job
+ */
+MPIR_Shim_Job *find_event_job(const pmix_proc_t *source,
+                              pmix_info_t info[], size_t ninfo)
+{
+    MPIR_Shim_Job *job;
+    size_t n;
+
+    for (n = 0; n < ninfo; n++) {
+        if (PMIX_CHECK_KEY(&info[n], PMIX_EVENT_AFFECTED_PROC) &&
+            PMIX_PROC == info[n].value.type) {
+            job = find_nspace_job(info[n].value.data.proc->nspace);
+            if (NULL != job) {
+                return job;
+            }
+        }
+    }
+
+    if (NULL != source) {
+        job = find_nspace_job(source->nspace);
+        if (NULL != job) {
+            return job;
+        }
+    }
+
+    for (n = 0; n < ninfo; n++) {
+        if (PMIX_CHECK_KEY(&info[n], PMIX_EVENT_RETURN_OBJECT) &&
+            PMIX_POINTER == info[n].value.type &&
+            NULL != info[n].value.data.ptr) {
+            return (MPIR_Shim_Job *)info[n].value.data.ptr;
+        }
+    }
+
+    // A single job session owns every event
+    if (1 == num_shim_jobs) {
+        return &shim_jobs[0];
+    }
+    return NULL;
+}
+
+/**
+ * @name   journal_event
+ * @brief  Record a PMIx event in the journal, and the exit code it carries.
+ * @param  status: The event
+ * @param  source: The source for the notification
+ * @param  info: Array of pmix_info_t objects passed to the callback
+ * @param  ninfo: Number of elements in info array
+ */
+void journal_event(pmix_status_t status, const pmix_proc_t *source,
+                   pmix_info_t info[], size_t ninfo)
+{
+    const pmix_proc_t *proc = source;
+    MPIR_Shim_Job *job;
+    int exit_code = 0, have_exit_code = 0;
+    size_t n;
+
+    for (n = 0; n < ninfo; n++) {
+        if (PMIX_CHECK_KEY(&info[n], PMIX_EVENT_AFFECTED_PROC) &&
+            PMIX_PROC == info[n].value.type) {
+            proc = info[n].value.data.proc;
+        }
+        else if (PMIX_CHECK_KEY(&info[n], PMIX_EXIT_CODE)) {
+            exit_code = info[n].value.data.integer;
+            have_exit_code = 1;
+        }
+        else if (PMIX_CHECK_KEY(&info[n], PMIX_JOB_TERM_STATUS)) {
+            exit_code = info[n].value.data.status;
+            have_exit_code = 1;
+        }
+    }
+
+    job = find_event_job(source, info, ninfo);
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_EVENT, (NULL == job) ? -1 : job->index,
+                             status, (NULL == proc) ? PMIX_RANK_UNDEF : proc->rank, 0,
+                             (NULL == proc) ? NULL : proc->nspace);
+    if (have_exit_code) {
+        mpir_shim_journal_append(MPIR_SHIM_JOURNAL_EXIT, (NULL == job) ? -1 : job->index,
+                                 exit_code, (NULL == proc) ? PMIX_RANK_UNDEF : proc->rank,
+                                 0, (NULL == proc) ? NULL : proc->nspace);
+    }
+}
+
+/**
+ * @name   journal_debug_state
+ * @brief  Record in the journal the state given to the debugger, before
+ *         calling MPIR_Breakpoint.
+ */
+void journal_debug_state(void)
+{
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_STATE, -1, 0, 0, MPIR_debug_state,
+                             MPIR_debug_abort_string);
+}
+
+/**
+ * @name   find_nspace_job
+ * @brief  Find the job whose launcher or application has namespace nspace
+ * @param  nspace: Namespace to look up
+ * @return The job, or NULL if no job owns the namespace
+ */
+MPIR_Shim_Job *find_nspace_job(const char *nspace)
+{
+    int i;
+
+    // Note: PMIX_CHECK_NSPACE treats an empty namespace as a wildcard, so
+    // compare explicitly since a job's namespaces may not be known yet.
+    if (NULL == nspace || '\0' == nspace[0]) {
+        return NULL;
+    }
+    for (i = 0; i < num_shim_jobs; i++) {
+        if (0 == strncmp(nspace, shim_jobs[i].launcher_proc.nspace,
+                         PMIX_MAX_NSLEN) ||
+            0 == strncmp(nspace, shim_jobs[i].application_proc.nspace,
+                         PMIX_MAX_NSLEN)) {
+            return &shim_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @name   post_condition
+ * @brief  Post a condition variable so any threads waiting for that condition
+ *         can resume execution.
+ * @param  wait_cond: The condition variable to post
+ */
+void post_condition(MPIR_Shim_Condition *wait_cond)
+{
+    MPIR_SHIM_DEBUG_ENTER("Condition '%s'", wait_cond->name);
+
+    pthread_mutex_lock(&(wait_cond->mutex));
+    pthread_cond_broadcast(&(wait_cond->condition));
+    wait_cond->flag = 0;
+    pthread_mutex_unlock(&(wait_cond->mutex));
+
+    MPIR_SHIM_DEBUG_EXIT("");
+}
+
+/**
+ * @name   wait_for_condition
+ * @brief  Suspend a thread until the specified condition is posted.
+ * @param  wait_cond: The condition to wait for completion
+ */
+void wait_for_condition(MPIR_Shim_Condition *wait_cond) 
+{
+    MPIR_SHIM_DEBUG_ENTER("Condition '%s'", wait_cond->name);
+
+    pthread_mutex_lock(&(wait_cond->mutex));
+
+    while ((1 == wait_cond->flag) && (0 == launcher_terminated)) {
+        debug_print("Wait for condition %s to be posted\n", wait_cond->name);
+        pthread_cond_wait(&(wait_cond->condition), &(wait_cond->mutex));
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("Condition '%s'", wait_cond->name);
+
+    // Reset condition flag in preparation for next wait on this condition.
+    wait_cond->flag = 1;
+    pthread_mutex_unlock(&(wait_cond->mutex));
+}
+
+/**
+ * @name   wait_for_condition_timeout
+ * @brief  Suspend a thread until the specified condition is posted, or for
+ *         at most a given time.
+ * @param  wait_cond: The condition to wait for completion
+ * @param  timeout_ms: The longest time to wait
+ * @return 1 if the condition was posted or the launcher terminated, 0 if the
+ *         time ran out
+ */
+int wait_for_condition_timeout(MPIR_Shim_Condition *wait_cond, double timeout_ms)
+{
+    struct timespec deadline;
+    long timeout_ns = (long)(timeout_ms * 1e6);
+    int posted;
+
+    MPIR_SHIM_DEBUG_ENTER("Condition '%s'", wait_cond->name);
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ns / 1000000000L;
+    deadline.tv_nsec += timeout_ns % 1000000000L;
+    if (1000000000L <= deadline.tv_nsec) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&(wait_cond->mutex));
+
+    while ((1 == wait_cond->flag) && (0 == launcher_terminated)) {
+        if (ETIMEDOUT == pthread_cond_timedwait(&(wait_cond->condition),
+                                                &(wait_cond->mutex), &deadline)) {
+            break;
+        }
+    }
+    posted = (0 == wait_cond->flag) || (0 != launcher_terminated);
+
+    MPIR_SHIM_DEBUG_EXIT("Condition '%s', posted %d", wait_cond->name, posted);
+
+    // Reset condition flag in preparation for next wait on this condition.
+    if (posted) {
+        wait_cond->flag = 1;
+    }
+    pthread_mutex_unlock(&(wait_cond->mutex));
+    return posted;
+}
+
+/**
+ * @name   wait_for_ready_for_debug
+ * @brief  Wait for a launcher to become ready for debug. For the hold report,
+ *         poll the process table of the application meanwhile, once it is
+ *         launched, to see when each rank reaches the hold point.
+ * @param  job: The job to wait for
+ */
+void wait_for_ready_for_debug(MPIR_Shim_Job *job)
+{
+    double interval_ms = HOLD_POLL_MS, start, elapsed;
+    int launched;
+
+    if (!mpir_shim_hold_enabled()) {
+        wait_for_condition(&job->ready_for_debug_cond);
+        return;
+    }
+
+    while (!wait_for_condition_timeout(&job->ready_for_debug_cond, interval_ms)) {
+        pthread_mutex_lock(&job->launch_complete_cond.mutex);
+        launched = (0 == job->launch_complete_cond.flag);
+        pthread_mutex_unlock(&job->launch_complete_cond.mutex);
+        if (!launched) {
+            continue;
+        }
+        mpir_shim_hold_poll(job->index, interval_ms);
+        start = timing_now();
+        observe_held_ranks(job);
+        // Keep the queries from loading the launcher of a large job
+        elapsed = timing_now() - start;
+        if (4 * elapsed > interval_ms) {
+            interval_ms = 4 * elapsed;
+        }
+    }
+    mpir_shim_hold_ready(job->index, timing_now());
+}
+
+/**
+ * @name   registration_complete_handler
+ * @brief  Handle notification that a callback has been registered.
+ * @param  status: Event id for callback
+ * @param  handler_ref: Callback id, used to de-register the handler
+ * @param  cbdata: Data passed to this callback
+ */
+void registration_complete_handler(pmix_status_t status, size_t handler_ref, 
+                                   void *cbdata)
+{
+    MPIR_SHIM_DEBUG_ENTER("Status '%s'", PMIx_Error_string(status));
+
+    // PMIx callbacks do not provide a way to pass information back to the
+    // code that invoked the callback. Therefore the registration callback
+    // uses two global variables, callback_reg_status and callback_reg_id to
+    // hold the needed information. The code which registered the callback
+    // reads these variables. This requires that a callback registration
+    // must complete before a subsequent callback can be registered in order 
+    // to avoid clobbering variables.
+    callback_reg_status = status;
+    callback_reg_id = handler_ref;
+
+    post_condition(&registration_cond);
+
+    MPIR_SHIM_DEBUG_EXIT("String '%s'", (NULL == cbdata ? "null" : (char*)cbdata) );
+}
+
+/**
+ * @name   default_event_handler
+ * @brief  Default callback for notifications received by this module but not
+ *         handled by another callback.
+ * @param  handler_id: Callback id for this callback
+ * @param: status: The event this handler was invoked for
+ * @param  source: The source for the notification
  * @param  info: Array of pmix_info_t objects passed to this callback by sender
  * @param  ninfo: Number of elements in ninfo array
  * @param  results: Array of pmix_info_t objects from previous handlers in chain
@@ -822,8 +1844,11 @@ void default_event_handler(size_t handler_id, pmix_status_t status,
                           PMIx_Error_string(status),
                           source ? source->nspace : "null",
                           source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_DEFAULT, 1);
+    journal_event(status, source, info, ninfo);
 
     if (PMIX_ERR_LOST_CONNECTION_TO_SERVER == status) {
+        MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_CONNECTIONS_LOST, 1);
         fprintf(stderr, "Connection to application being debugged was lost. (sessions %d)\n", session_count);
         // In non-proxy mode there can be 2 sessions since the code originally
         // connects to the server in PMIx_tool_init then again in 
@@ -876,12 +1901,17 @@ void launcher_complete_handler(size_t handler_id, pmix_status_t status,
                                void *cbdata)
 {
     char application_namespace[PMIX_MAX_NSLEN + 1];
+    MPIR_Shim_Job *job;
     int i;
 
     MPIR_SHIM_DEBUG_ENTER("Event '%s', nspace '%s', rank '%ld'",
                           PMIx_Error_string(status),
                           source ? source->nspace : "null",
                           source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_LAUNCHER_COMPLETE, 1);
+    journal_event(status, source, info, ninfo);
+
+    job = find_event_job(source, info, ninfo);
 
     /*
      * Search for the namespace of the application.
@@ -902,12 +1932,19 @@ void launcher_complete_handler(size_t handler_id, pmix_status_t status,
      */
     if ('\0' == application_namespace[0]) {
         fprintf(stderr, "No application namespace found in notification.\n");
-        pmix_fatal_error(PMIX_ERROR, "Launched application namespace wasn't returned in callback");
+        (void) pmix_fatal_error(PMIX_ERROR, "Launched application namespace wasn't returned in callback");
+    }
+    else if (NULL == job) {
+        (void) pmix_fatal_error(PMIX_ERROR, "Launch complete notification for unknown job '%s'",
+                                application_namespace);
+    }
+    else {
+        PMIX_PROC_LOAD(&job->application_proc, application_namespace, PMIX_RANK_WILDCARD);
+        debug_print("Job %d application namespace is '%s'\n", job->index,
+                    job->application_proc.nspace);
+        mpir_shim_iof_set_namespace(job->index, &job->application_proc);
+        post_condition(&job->launch_complete_cond);
     }
-
-    PMIX_PROC_LOAD(&application_proc, application_namespace, PMIX_RANK_WILDCARD);
-    debug_print("Application namespace is '%s'\n", application_proc.nspace);
-    post_condition(&launch_complete_cond);
 
     /*
      * Tell the event handler state machine that we are the last step
@@ -943,13 +1980,20 @@ void launcher_ready_handler(size_t handler_id, pmix_status_t status,
                             pmix_event_notification_cbfunc_fn_t cbfunc,
                             void *cbdata)
 {
+    MPIR_Shim_Job *job;
+
     MPIR_SHIM_DEBUG_ENTER("Event '%s', nspace '%s', rank '%ld'",
                           PMIx_Error_string(status),
                           source ? source->nspace : "null",
                           source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_LAUNCHER_READY, 1);
+    journal_event(status, source, info, ninfo);
 
     callback_reg_status = status;
-    post_condition(&ready_for_debug_cond);
+    job = find_event_job(source, info, ninfo);
+    if (NULL != job) {
+        post_condition(&job->ready_for_debug_cond);
+    }
 
     /*
      * Tell the event handler state machine that we are the last step.
@@ -986,57 +2030,178 @@ void application_terminate_handler(size_t handler_id, pmix_status_t status,
 {
     size_t n;
     pmix_proc_t *affected_proc = NULL;
+    MPIR_Shim_Job *job;
 
     MPIR_SHIM_DEBUG_ENTER("Event '%s', nspace '%s', rank '%ld'",
                           PMIx_Error_string(status),
                           source ? source->nspace : "null",
                           source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_APPLICATION_TERMINATE, 1);
+    journal_event(status, source, info, ninfo);
+
+    job = find_event_job(source, info, ninfo);
+    if (NULL == job) {
+        if (NULL != cbfunc) {
+            cbfunc(PMIX_EVENT_ACTION_COMPLETE, NULL, 0, NULL, NULL, cbdata);
+        }
+        MPIR_SHIM_DEBUG_EXIT("Unknown job");
+        return;
+    }
 
     /*
      * Extract the error code
      */
     for( n = 0; n < ninfo; ++n ) {
         if( PMIX_CHECK_KEY(&info[n], PMIX_EXIT_CODE) ) {
-            app_exit_code = info[n].value.data.integer;
-            if( app_exit_code != 0  ) {
+            job->app_exit_code = info[n].value.data.integer;
+            if( job->app_exit_code != 0  ) {
                 MPIR_debug_state = MPIR_DEBUG_ABORTING;
                 if( NULL == MPIR_debug_abort_string ) {
                     asprintf(&MPIR_debug_abort_string,
-                             "The application exited with return code %d", app_exit_code);
+                             "The application exited with return code %d", job->app_exit_code);
                 }
             }
         }
         else if( PMIX_CHECK_KEY(&info[n], PMIX_JOB_TERM_STATUS) ) {
-            app_exit_code = info[n].value.data.status;
-            if( app_exit_code != 0  ) {
+            job->app_exit_code = info[n].value.data.status;
+            if( job->app_exit_code != 0  ) {
                 MPIR_debug_state = MPIR_DEBUG_ABORTING;
                 if( NULL == MPIR_debug_abort_string ) {
                     asprintf(&MPIR_debug_abort_string,
-                             "The application exited with return code %d", app_exit_code);
+                             "The application exited with return code %d", job->app_exit_code);
                 }
             }
         }
         else if( PMIX_CHECK_KEY(&info[n], PMIX_EVENT_AFFECTED_PROC) ) {
             affected_proc = info[n].value.data.proc;
-            debug_print("Notified job terminated, affected '%s'.%d\n",
-                        (NULL == affected_proc ? "NULL" : affected_proc->nspace),
-                        (NULL == affected_proc ? -1 : (int)affected_proc->rank));
+            MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                            "Notified job terminated, affected '%s'.%d\n",
+                            (NULL == affected_proc ? "NULL" : affected_proc->nspace),
+                            (NULL == affected_proc ? -1 : (int)affected_proc->rank));
         }
     }
 
-    debug_print("Notified job terminated, affected '%s', exit status %d\n",
-                (NULL == affected_proc ? "NULL" : affected_proc->nspace),
-                app_exit_code);
+    MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                    "Notified job terminated, affected '%s', exit status %d\n",
+                    (NULL == affected_proc ? "NULL" : affected_proc->nspace),
+                    job->app_exit_code);
 
     // Mark launcher terminated so any subsequent condition waits are assumed
     // satisfied and so this module will not hang on those conditions.
-    app_terminated = 1;
-    launcher_terminated = 2;
-    post_condition(&launch_term_cond);
+    job->app_terminated = 1;
+    if (0 == job->launcher_terminated) {
+        job->launcher_terminated = 2;
+        if (++num_launchers_terminated == num_shim_jobs) {
+            launcher_terminated = 2;
+        }
+    }
+    post_condition(&job->launch_term_cond);
 
     // Main thread could be waiting for any of these conditions to post ready.
     // Post them here so main thread is not hung after launcher terminates.
-    release_conditions();
+    release_job_conditions(job);
+
+    /*
+     * Tell the event handler state machine that we are the last step.
+     */
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_EVENT_ACTION_COMPLETE, NULL, 0, NULL, NULL, cbdata);
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("");
+}
+
+/**
+ * @name   proc_failure_handler
+ * @brief  Callback to handle notification that an application process has
+ *         aborted, is aborting, or exited with a non-zero code.
+ * @param  handler_id: Callback id for this callback
+ * @param: status: The event this handler was invoked for
+ * @param  source: The source for the notification
+ * @param  info: Array of pmix_info_t objects passed to this callback by sender
+ * @param  ninfo: Number of elements in ninfo array
+ * @param  results: Array of pmix_info_t objects from previous handlers in chain
+ * @param  nresults: Number of elements in results array
+ * @param  cbfunc: Function to be called to propagate notification
+ * @param  cbdata: Data passed to this callback
+ *
+ * The first failure is reported to the tool right away, with
+ * MPIR_DEBUG_ABORTING, while the surviving processes are still running and
+ * can be inspected. Later failures are only traced.
+ */
+void proc_failure_handler(size_t handler_id, pmix_status_t status,
+                          const pmix_proc_t *source,
+                          pmix_info_t info[], size_t ninfo,
+                          pmix_info_t results[], size_t nresults,
+                          pmix_event_notification_cbfunc_fn_t cbfunc,
+                          void *cbdata)
+{
+    size_t n;
+    pmix_proc_t *affected_proc = NULL;
+    MPIR_Shim_Job *job;
+    proc_failure_t failure;
+    int exit_code = 0, have_exit_code = 0, report = 0;
+
+    MPIR_SHIM_DEBUG_ENTER("Event '%s', nspace '%s', rank '%ld'",
+                          PMIx_Error_string(status),
+                          source ? source->nspace : "null",
+                          source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_PROC_FAILURE, 1);
+    journal_event(status, source, info, ninfo);
+
+    job = find_event_job(source, info, ninfo);
+
+    for( n = 0; n < ninfo; ++n ) {
+        if( PMIX_CHECK_KEY(&info[n], PMIX_EXIT_CODE) ) {
+            exit_code = info[n].value.data.integer;
+            have_exit_code = 1;
+        }
+        else if( PMIX_CHECK_KEY(&info[n], PMIX_EVENT_AFFECTED_PROC) ) {
+            affected_proc = info[n].value.data.proc;
+        }
+    }
+
+    /*
+     * A process exiting normally is not a failure. Neither is a special rank,
+     * nor a process of another namespace, such as the launcher, since the
+     * handler is registered before the application namespace is known.
+     */
+    if (NULL == job || NULL == affected_proc ||
+        PMIX_RANK_VALID <= affected_proc->rank ||
+        0 != strncmp(affected_proc->nspace, job->application_proc.nspace,
+                     PMIX_MAX_NSLEN) ||
+        (PMIX_EVENT_PROC_TERMINATED == status && 0 == exit_code)) {
+        if (NULL != cbfunc) {
+            cbfunc(PMIX_EVENT_ACTION_COMPLETE, NULL, 0, NULL, NULL, cbdata);
+        }
+        MPIR_SHIM_DEBUG_EXIT("Not a failure");
+        return;
+    }
+
+    MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                    "Rank %u of '%s' failed: %s, exit code %d\n",
+                    affected_proc->rank, affected_proc->nspace,
+                    PMIx_Error_string(status), exit_code);
+
+    /*
+     * Only report once, and only once the tool has the process table. The
+     * first failure before that is kept and reported when it is published.
+     */
+    failure.pending = 1;
+    failure.job_index = job->index;
+    failure.rank = affected_proc->rank;
+    failure.status = status;
+    failure.exit_code = exit_code;
+    failure.have_exit_code = have_exit_code;
+    pthread_mutex_lock(&proc_failure_lock);
+    if (0 == proc_failure_reported && proctable_published) {
+        report_proc_failure(&failure);
+        report = 1;
+    }
+    else if (0 == proc_failure_reported && 0 == pending_proc_failure.pending) {
+        pending_proc_failure = failure;
+    }
+    pthread_mutex_unlock(&proc_failure_lock);
 
     /*
      * Tell the event handler state machine that we are the last step.
@@ -1045,6 +2210,13 @@ void application_terminate_handler(size_t handler_id, pmix_status_t status,
         cbfunc(PMIX_EVENT_ACTION_COMPLETE, NULL, 0, NULL, NULL, cbdata);
     }
 
+    if (report) {
+        MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                        "Reporting first failure: %s\n", MPIR_debug_abort_string);
+        journal_debug_state();
+        MPIR_Breakpoint();
+    }
+
     MPIR_SHIM_DEBUG_EXIT("");
 }
 
@@ -1073,31 +2245,43 @@ void launcher_terminate_handler(size_t handler_id, pmix_status_t status,
 {
     size_t n;
     pmix_proc_t *affected_proc = NULL;
+    MPIR_Shim_Job *job;
 
     MPIR_SHIM_DEBUG_ENTER("Event '%s', nspace '%s', rank '%ld'",
                           PMIx_Error_string(status),
                           source ? source->nspace : "null",
                           source ? source->rank : -1L);
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_EVENT_LAUNCHER_TERMINATE, 1);
+    journal_event(status, source, info, ninfo);
+
+    job = find_event_job(source, info, ninfo);
+    if (NULL == job) {
+        if (NULL != cbfunc) {
+            cbfunc(PMIX_EVENT_ACTION_COMPLETE, NULL, 0, NULL, NULL, cbdata);
+        }
+        MPIR_SHIM_DEBUG_EXIT("Unknown job");
+        return;
+    }
 
     /*
      * Extract the error code
      */
     for( n = 0; n < ninfo; ++n ) {
         if( PMIX_CHECK_KEY(&info[n], PMIX_EXIT_CODE) ) {
-            launcher_exit_code = info[n].value.data.integer;
-            if( launcher_exit_code != 0 ) {
+            job->launcher_exit_code = info[n].value.data.integer;
+            if( job->launcher_exit_code != 0 ) {
                 MPIR_debug_state = MPIR_DEBUG_ABORTING;
                 if( NULL == MPIR_debug_abort_string ) {
-                    asprintf(&MPIR_debug_abort_string, "The launcher exited with return code %d", launcher_exit_code);
+                    asprintf(&MPIR_debug_abort_string, "The launcher exited with return code %d", job->launcher_exit_code);
                 }
             }
         }
         else if( PMIX_CHECK_KEY(&info[n], PMIX_JOB_TERM_STATUS) ) {
-            launcher_exit_code = info[n].value.data.status;
-            if( launcher_exit_code != 0 ) {
+            job->launcher_exit_code = info[n].value.data.status;
+            if( job->launcher_exit_code != 0 ) {
                 MPIR_debug_state = MPIR_DEBUG_ABORTING;
                 if( NULL == MPIR_debug_abort_string ) {
-                    asprintf(&MPIR_debug_abort_string, "The launcher exited with return code %d", launcher_exit_code);
+                    asprintf(&MPIR_debug_abort_string, "The launcher exited with return code %d", job->launcher_exit_code);
                 }
             }
         }
@@ -1106,18 +2290,25 @@ void launcher_terminate_handler(size_t handler_id, pmix_status_t status,
         }
     }
 
-    debug_print("Notified job terminated, affected '%s', exit status %d\n",
-                (NULL == affected_proc ? "NULL" : affected_proc->nspace),
-                launcher_exit_code);
+    MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                    "Notified job terminated, affected '%s', exit status %d\n",
+                    (NULL == affected_proc ? "NULL" : affected_proc->nspace),
+                    job->launcher_exit_code);
 
     // Mark launcher terminated so any subsequent condition waits are assumed
     // satisfied and so this module will not hang on those conditions.
-    launcher_terminated = 1;
-    post_condition(&launch_term_cond);
+    if (1 != job->launcher_terminated) {
+        if (0 == job->launcher_terminated &&
+            ++num_launchers_terminated == num_shim_jobs) {
+            launcher_terminated = 1;
+        }
+        job->launcher_terminated = 1;
+    }
+    post_condition(&job->launch_term_cond);
 
     // Main thread could be waiting for any of these conditions to post ready.
     // Post them here so main thread is not hung after launcher terminates.
-    release_conditions();
+    release_job_conditions(job);
 
     /*
      * Tell the event handler state machine that we are the last step.
@@ -1162,9 +2353,10 @@ int register_default_event_handler(void)
 /**
  * @name   register_launcher_complete_handler
  * @brief  Register callback to handle launch complete notifications
+ * @param  job: The job whose launch complete notification is handled
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int register_launcher_complete_handler(void)
+int register_launcher_complete_handler(MPIR_Shim_Job *job)
 {
     pmix_info_t *infos = NULL;
     void *attr_list;
@@ -1178,7 +2370,7 @@ int register_launcher_complete_handler(void)
 
     PMIX_INFO_LIST_START(attr_list);
     /* Set object to be returned when registered callback is called */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)&registration_cond, PMIX_POINTER);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)job, PMIX_POINTER);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_RETURN_OBJECT) failed: %s",
                 PMIx_Error_string(rc));
@@ -1220,7 +2412,7 @@ int register_launcher_complete_handler(void)
         return STATUS_FAIL;
     }
 
-    launch_complete_cb_id = callback_reg_id;
+    job->launch_complete_cb_id = callback_reg_id;
 
     MPIR_SHIM_DEBUG_EXIT("");
     return STATUS_OK;
@@ -1229,9 +2421,10 @@ int register_launcher_complete_handler(void)
 /**
  * @name   register_launcher_ready_handler
  * @brief  Register callback to handle launcher ready notifications.
+ * @param  job: The job whose launcher ready notification is handled
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int register_launcher_ready_handler(void)
+int register_launcher_ready_handler(MPIR_Shim_Job *job)
 {
     void *attr_list;
     pmix_info_t *infos = NULL;
@@ -1245,7 +2438,7 @@ int register_launcher_ready_handler(void)
 
     PMIX_INFO_LIST_START(attr_list);
     /* Set object to be returned when this registered callback is called */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)&registration_cond, PMIX_POINTER);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)job, PMIX_POINTER);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_RETURN_OBJECT) failed: %s",
                 PMIx_Error_string(rc));
@@ -1261,7 +2454,7 @@ int register_launcher_ready_handler(void)
         return STATUS_FAIL;
     }
     /* Handle this event only when sent by the launcher process */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &launcher_proc, PMIX_PROC);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &job->launcher_proc, PMIX_PROC);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_AFFECTED_PROC) failed: %s",
                 PMIx_Error_string(rc));
@@ -1295,7 +2488,7 @@ int register_launcher_ready_handler(void)
         return STATUS_FAIL;
     }
 
-    launch_ready_cb_id = callback_reg_id;
+    job->launch_ready_cb_id = callback_reg_id;
 
     MPIR_SHIM_DEBUG_EXIT("");
     return STATUS_OK;
@@ -1304,9 +2497,10 @@ int register_launcher_ready_handler(void)
 /**
  * @name   register_launcher_terminate_handler
  * @brief  Register callback to handle launcher terminated notifications.
+ * @param  job: The job whose launcher termination is handled
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int register_launcher_terminate_handler(void)
+int register_launcher_terminate_handler(MPIR_Shim_Job *job)
 {
     void *attr_list;
     pmix_info_t *infos = NULL;
@@ -1320,7 +2514,7 @@ int register_launcher_terminate_handler(void)
 
     PMIX_INFO_LIST_START(attr_list);
     /* Set object to be returned when this registered callback is called */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)&registration_cond, PMIX_POINTER);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)job, PMIX_POINTER);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_RETURN_OBJECT) failed: %s",
                 PMIx_Error_string(rc));
@@ -1336,7 +2530,7 @@ int register_launcher_terminate_handler(void)
         return STATUS_FAIL;
     }
     /* Only accept termination events from the launcher process */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &launcher_proc, PMIX_PROC);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &job->launcher_proc, PMIX_PROC);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_AFFECTED_PROC) failed: %s",
                 PMIx_Error_string(rc));
@@ -1370,7 +2564,7 @@ int register_launcher_terminate_handler(void)
         return STATUS_FAIL;
     }
 
-    launcher_terminate_cb_id = callback_reg_id;
+    job->launcher_terminate_cb_id = callback_reg_id;
 
     MPIR_SHIM_DEBUG_EXIT("");
     return STATUS_OK;
@@ -1379,9 +2573,10 @@ int register_launcher_terminate_handler(void)
 /**
  * @name   register_application_terminate_handler
  * @brief  Register callback to handle application terminated notifications.
+ * @param  job: The job whose application termination is handled
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int register_application_terminate_handler(void)
+int register_application_terminate_handler(MPIR_Shim_Job *job)
 {
     void *attr_list;
     pmix_info_t *infos = NULL;
@@ -1395,7 +2590,7 @@ int register_application_terminate_handler(void)
 
     PMIX_INFO_LIST_START(attr_list);
     /* Set object to be returned when this registered callback is called */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)&registration_cond, PMIX_POINTER);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)job, PMIX_POINTER);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_RETURN_OBJECT) failed: %s",
                 PMIx_Error_string(rc));
@@ -1403,7 +2598,7 @@ int register_application_terminate_handler(void)
         return STATUS_FAIL;
     }
     /* Accept termination events only from application process */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &application_proc, PMIX_PROC);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_AFFECTED_PROC, &job->application_proc, PMIX_PROC);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_AFFECTED_PROC) failed: %s",
                 PMIx_Error_string(rc));
@@ -1444,21 +2639,297 @@ int register_application_terminate_handler(void)
         return STATUS_FAIL;
     }
 
-    app_terminate_cb_id = callback_reg_id;
+    job->app_terminate_cb_id = callback_reg_id;
 
     MPIR_SHIM_DEBUG_EXIT("");
     return STATUS_OK;
 }
 
+/**
+ * @name   report_proc_failure
+ * @brief  Set MPIR_debug_state and MPIR_debug_abort_string for the first
+ *         process failure, naming the node of the process from the published
+ *         process table. Called with proc_failure_lock held, once the table
+ *         is published. The caller calls MPIR_Breakpoint.
+ * @param  failure: The failure
+ */
+void report_proc_failure(const proc_failure_t *failure)
+{
+    const char *host_name = NULL;
+    char exit_code_text[32] = "";
+    int offset;
+
+    proc_failure_reported = 1;
+    if (NULL != MPIR_Shim_jobtable && failure->job_index < MPIR_Shim_jobtable_size &&
+        failure->rank < (pmix_rank_t)MPIR_Shim_jobtable[failure->job_index].proctable_size) {
+        offset = MPIR_Shim_jobtable[failure->job_index].proctable_offset;
+        host_name = MPIR_proctable[offset + failure->rank].host_name;
+    }
+    if (NULL == MPIR_debug_abort_string) {
+        if (failure->have_exit_code) {
+            snprintf(exit_code_text, sizeof(exit_code_text),
+                     " with code %d", failure->exit_code);
+        }
+        asprintf(&MPIR_debug_abort_string, "Rank %u of job %d %s%s%s%s",
+                 failure->rank, failure->job_index,
+                 (PMIX_ERR_PROC_ABORTING == failure->status ? "is aborting" :
+                  (PMIX_ERR_PROC_ABORTED == failure->status ? "aborted" : "exited")),
+                 exit_code_text,
+                 (NULL != host_name ? " on " : ""),
+                 (NULL != host_name ? host_name : ""));
+    }
+    MPIR_debug_state = MPIR_DEBUG_ABORTING;
+}
+
+/**
+ * @name   publish_proc_table
+ * @brief  Let the process failure handler read MPIR_proctable, once the tool
+ *         was given it, and report a failure that arrived before.
+ */
+void publish_proc_table(void)
+{
+    int report = 0;
+
+    pthread_mutex_lock(&proc_failure_lock);
+    proctable_published = 1;
+    if (0 == proc_failure_reported && pending_proc_failure.pending) {
+        report_proc_failure(&pending_proc_failure);
+        pending_proc_failure.pending = 0;
+        report = 1;
+    }
+    pthread_mutex_unlock(&proc_failure_lock);
+
+    if (report) {
+        MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_EVENT,
+                        "Reporting failure before the process table: %s\n",
+                        MPIR_debug_abort_string);
+        journal_debug_state();
+        MPIR_Breakpoint();
+    }
+}
+
+/**
+ * @name   register_proc_failure_handler
+ * @brief  Register callback to handle the failure of individual application
+ *         processes. It is registered before the launcher is released, so
+ *         no failure is missed, when the application namespace is not known
+ *         yet: the handler tells the application processes apart itself.
+ * @param  job: The job whose application processes are watched
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int register_proc_failure_handler(MPIR_Shim_Job *job)
+{
+    void *attr_list;
+    pmix_info_t *infos = NULL;
+    pmix_status_t events[] = {PMIX_ERR_PROC_ABORTED, PMIX_ERR_PROC_ABORTING,
+                              PMIX_EVENT_PROC_TERMINATED};
+    pmix_status_t rc;
+    size_t num_infos;
+    pmix_data_array_t attr_array;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    PMIX_INFO_LIST_START(attr_list);
+    /* Set object to be returned when this registered callback is called */
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_RETURN_OBJECT, (void *)job, PMIX_POINTER);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_RETURN_OBJECT) failed: %s",
+                PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    /* Set string identifying this callback */
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_HDLR_NAME, "PROCESS-FAILURE", PMIX_STRING);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_HDLR_NAME) failed: %s",
+                PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_CONVERT(rc, attr_list, &attr_array);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_CONVERT failed: %s",
+                PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_RELEASE(attr_list);
+    infos = attr_array.array;
+    num_infos = attr_array.size;
+
+    PMIx_Register_event_handler(events, sizeof(events) / sizeof(events[0]),
+                                infos, num_infos,
+                                proc_failure_handler,
+                                registration_complete_handler,
+                                "proc-failure-callback");
+    wait_for_condition(&registration_cond);
+    PMIX_DATA_ARRAY_DESTRUCT(&attr_array);
+    if (PMIX_SUCCESS != callback_reg_status) {
+        fprintf(stderr,
+             "An error occurred registering process failure callback %s.\n",
+             PMIx_Error_string(callback_reg_status));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    job->proc_failure_cb_id = callback_reg_id;
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   parse_rank_list
+ * @brief  Parse a comma separated list of ranks and rank ranges, such as
+ *         "0-15,32", into a sorted array of distinct ranks. The ranges may
+ *         overlap, but together name at most MAX_RANK_LIST ranks.
+ * @param  ranks: The rank list to parse
+ * @param  rank_list: Set to the allocated array of ranks, freed by the caller
+ * @param  num_ranks: Set to the number of elements in rank_list
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int parse_rank_list(const char *ranks, pmix_rank_t **rank_list, size_t *num_ranks)
+{
+    pmix_rank_t *list = NULL, *new_list;
+    size_t count = 0, size = 0, i, j;
+    unsigned long first, last, rank;
+    const char *p = ranks;
+    char *endp;
+    int valid = 0;
+
+    while (isdigit((unsigned char)*p)) {
+        first = strtoul(p, &endp, 10);
+        last = first;
+        if ('-' == *endp) {
+            p = endp + 1;
+            if (!isdigit((unsigned char)*p)) {
+                break;
+            }
+            last = strtoul(p, &endp, 10);
+        }
+        if (last < first || PMIX_RANK_VALID < last ||
+            (',' != *endp && '\0' != *endp)) {
+            break;
+        }
+        if (MAX_RANK_LIST - count <= last - first) {
+            fprintf(stderr, "Rank list '%s' names more than %d ranks.\n", ranks,
+                    MAX_RANK_LIST);
+            free(list);
+            return STATUS_FAIL;
+        }
+        for (rank = first; rank <= last; rank++) {
+            if (count == size) {
+                size = (0 == size) ? 16 : 2 * size;
+                new_list = realloc(list, size * sizeof(pmix_rank_t));
+                if (NULL == new_list) {
+                    fprintf(stderr, "Unable to allocate the rank list.\n");
+                    free(list);
+                    return STATUS_FAIL;
+                }
+                list = new_list;
+            }
+            list[count++] = (pmix_rank_t)rank;
+        }
+        if ('\0' == *endp) {
+            valid = 1;
+            break;
+        }
+        p = endp + 1;
+    }
+
+    if (!valid) {
+        fprintf(stderr, "Invalid rank list '%s'.\n", ranks);
+        free(list);
+        return STATUS_FAIL;
+    }
+
+    // Each rank is released or held once, however often it is named
+    qsort(list, count, sizeof(pmix_rank_t), compare_ranks);
+    for (i = 0, j = 0; i < count; i++) {
+        if (0 == j || list[j - 1] != list[i]) {
+            list[j++] = list[i];
+        }
+    }
+
+    *rank_list = list;
+    *num_ranks = j;
+    return STATUS_OK;
+}
+
+/**
+ * @name   compare_ranks
+ * @brief  qsort comparison ordering ranks
+ * @param  a: First pmix_rank_t
+ * @param  b: Second pmix_rank_t
+ * @return Negative, zero or positive as a is before, equal to or after b
+ */
+int compare_ranks(const void *a, const void *b)
+{
+    pmix_rank_t rank_a = *(const pmix_rank_t *)a;
+    pmix_rank_t rank_b = *(const pmix_rank_t *)b;
+
+    return (rank_a > rank_b) - (rank_a < rank_b);
+}
+
+/**
+ * @name   add_stop_directive
+ * @brief  Add the launch directive telling the held application processes
+ *         where to stop. Nothing is added if the processes are not held.
+ * @param  directive_list: The launch directive list to add to
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int add_stop_directive(void *directive_list)
+{
+    pmix_data_array_t rank_array;
+    pmix_status_t rc;
+    const char *key;
+
+    switch (stop_point) {
+    case MPIR_SHIM_STOP_NONE:
+        return STATUS_OK;
+    case MPIR_SHIM_STOP_ON_EXEC:
+        key = PMIX_DEBUG_STOP_ON_EXEC;
+        break;
+    case MPIR_SHIM_STOP_IN_APP:
+        key = PMIX_DEBUG_STOP_IN_APP;
+        break;
+    case MPIR_SHIM_STOP_IN_INIT:
+    default:
+        key = PMIX_DEBUG_STOP_IN_INIT;
+        break;
+    }
+
+    if (0 == num_hold_ranks) {
+        PMIX_INFO_LIST_ADD(rc, directive_list, key, NULL, PMIX_BOOL);
+    }
+    else if (1 == num_hold_ranks) {
+        PMIX_INFO_LIST_ADD(rc, directive_list, key, &hold_ranks[0], PMIX_PROC_RANK);
+    }
+    else {
+        rank_array.type = PMIX_PROC_RANK;
+        rank_array.size = num_hold_ranks;
+        rank_array.array = hold_ranks;
+        PMIX_INFO_LIST_ADD(rc, directive_list, key, &rank_array, PMIX_DATA_ARRAY);
+    }
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(%s) failed: %s", key,
+                PMIx_Error_string(rc));
+        return STATUS_FAIL;
+    }
+    debug_print("Stop directive %s for %s\n", key,
+                (0 == num_hold_ranks) ? "all ranks" : "selected ranks");
+    return STATUS_OK;
+}
+
 /**
  * @name   spawn_launcher_and_application
  * @brief  Set up command line and environment variable then spawn the launcher
  *         which will in turn spawn the application tasks.
+ * @param  job: The job to spawn
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int spawn_launcher_and_application(void)
+int spawn_launcher_and_application(MPIR_Shim_Job *job)
 {
-//    char launcher_namespace[PMIX_MAX_NSLEN + 1];
     pmix_info_t *attrs = NULL;
     int i;
     pmix_status_t rc;
@@ -1469,11 +2940,11 @@ int spawn_launcher_and_application(void)
     pmix_data_array_t attr_array, directive_array;
     void *attr_list, *directive_list;
 
-    MPIR_SHIM_DEBUG_ENTER("");
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
 
-    PMIX_LOAD_NSPACE(launcher_namespace, NULL);
-    PMIX_LOAD_NSPACE(launcher_proc.nspace, NULL);
-    launcher_proc.rank = PMIX_RANK_WILDCARD;
+    PMIX_LOAD_NSPACE(job->launcher_namespace, NULL);
+    PMIX_LOAD_NSPACE(job->launcher_proc.nspace, NULL);
+    job->launcher_proc.rank = PMIX_RANK_WILDCARD;
 
     /*
      * Setup the launcher's application parameters.
@@ -1481,11 +2952,11 @@ int spawn_launcher_and_application(void)
     PMIX_APP_CONSTRUCT(&app_context);
 
     /* Setup the executable */
-    app_context.cmd = strdup(run_args[0]);
+    app_context.cmd = strdup(job->run_args[0]);
 
     /* The argv to pass to the application */
-    for (i = 0; i < num_run_args; i++) {
-        PMIX_ARGV_APPEND(rc, app_context.argv, run_args[i]);
+    for (i = 0; i < job->num_run_args; i++) {
+        PMIX_ARGV_APPEND(rc, app_context.argv, job->run_args[i]);
         if( PMIX_SUCCESS != rc ) {
             fprintf(stderr, "PMIX_ARGV_APPEND() failed %d\n", rc);
             MPIR_SHIM_DEBUG_EXIT("");
@@ -1548,20 +3019,21 @@ int spawn_launcher_and_application(void)
 
     /* Build directives to be set to launcher process */
     PMIX_INFO_LIST_START(directive_list);
-    /* Tell application processes to block in PMIx_Init */
-    PMIX_INFO_LIST_ADD(rc, directive_list, PMIX_DEBUG_STOP_IN_INIT, NULL, PMIX_BOOL);
-    if (rc != PMIX_SUCCESS) {
-        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_DEBUG_STOP_IN_INIT) failed: %s",
-                PMIx_Error_string(rc));
+    /* Tell the held application processes where to block */
+    if (STATUS_OK != add_stop_directive(directive_list)) {
         MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
-    PMIX_INFO_LIST_CONVERT(rc, directive_list, &directive_array);
-    if (rc != PMIX_SUCCESS) {
-        fprintf(stderr, "PMIX_INFO_LIST_CONVERT failed: %s",
-                PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
-        return STATUS_FAIL;
+    /* The directive list is empty when nothing is held */
+    PMIX_DATA_ARRAY_CONSTRUCT(&directive_array, 0, PMIX_INFO);
+    if (MPIR_SHIM_STOP_NONE != stop_point) {
+        PMIX_INFO_LIST_CONVERT(rc, directive_list, &directive_array);
+        if (rc != PMIX_SUCCESS) {
+            fprintf(stderr, "PMIX_INFO_LIST_CONVERT failed: %s",
+                    PMIx_Error_string(rc));
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
     }
     PMIX_INFO_LIST_RELEASE(directive_list);
     PMIX_INFO_LIST_START(attr_list);
@@ -1605,13 +3077,15 @@ int spawn_launcher_and_application(void)
         return STATUS_FAIL;
     }
     /* Add launcher directives to launch attributes list */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_LAUNCH_DIRECTIVES, &directive_array,
-                       PMIX_DATA_ARRAY);
-    if (rc != PMIX_SUCCESS) {
-        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_LAUNCH_DIRECTIVES) failed: %s",
-                PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
-        return STATUS_FAIL;
+    if (0 < directive_array.size) {
+        PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_LAUNCH_DIRECTIVES, &directive_array,
+                           PMIX_DATA_ARRAY);
+        if (rc != PMIX_SUCCESS) {
+            fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_LAUNCH_DIRECTIVES) failed: %s",
+                    PMIx_Error_string(rc));
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
     }
     PMIX_INFO_LIST_CONVERT(rc, attr_list, &attr_array);
     if (rc != PMIX_SUCCESS) {
@@ -1631,10 +3105,10 @@ int spawn_launcher_and_application(void)
      * fork/exec'd.
      */
     debug_print("Calling PMIx_Spawn for %s\n", app_context.cmd);
-    rc = PMIx_Spawn(attrs, num_attrs, &app_context, 1, launcher_namespace);
+    rc = PMIx_Spawn(attrs, num_attrs, &app_context, 1, job->launcher_namespace);
     PMIX_APP_DESTRUCT(&app_context);
     debug_print("PMIx_Spawn status %s launcher_namespace: %s\n",
-                PMIx_Error_string(rc), launcher_namespace);
+                PMIx_Error_string(rc), job->launcher_namespace);
     PMIX_DATA_ARRAY_DESTRUCT(&attr_array);
     PMIX_DATA_ARRAY_DESTRUCT(&directive_array);
 
@@ -1648,7 +3122,7 @@ int spawn_launcher_and_application(void)
 
     // Proxy case fills this in during connect_to_server()
     if (MPIR_SHIM_NONPROXY_MODE == mpir_mode) {
-        PMIX_PROC_LOAD(&launcher_proc, launcher_namespace, 0);
+        PMIX_PROC_LOAD(&job->launcher_proc, job->launcher_namespace, 0);
     }
 
     MPIR_SHIM_DEBUG_EXIT("");
@@ -1658,9 +3132,10 @@ int spawn_launcher_and_application(void)
 /**
  * @name   connect_to_server
  * @brief  Connect to the PMIx server for this session
+ * @param  job: The job whose launcher is the server
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int connect_to_server(void)
+int connect_to_server(MPIR_Shim_Job *job)
 {
     void *attr_list;
     pmix_info_t *attrs;
@@ -1670,9 +3145,9 @@ int connect_to_server(void)
     int timeout_elapsed = 0, sleep_rc;
     pmix_data_array_t attr_array;
 
-    MPIR_SHIM_DEBUG_ENTER("");
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
 
-    PMIX_LOAD_PROCID(&launcher_proc, launcher_namespace, PMIX_RANK_WILDCARD);
+    PMIX_LOAD_PROCID(&job->launcher_proc, job->launcher_namespace, PMIX_RANK_WILDCARD);
     /*
      * Attributes for connecting to the server.
      */
@@ -1704,10 +3179,11 @@ int connect_to_server(void)
     num_attrs = attr_array.size;
 
     while (timeout_elapsed < connect_timeout) {
-        rc = PMIx_tool_set_server(&launcher_proc, attrs, num_attrs);
+        rc = PMIx_tool_set_server(&job->launcher_proc, attrs, num_attrs);
         if (rc == PMIX_SUCCESS) {
             break;
         }
+        MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_CONNECT_RETRIES, 1);
         do {
             sleep_rc = sleep(1); // returns non-zero if interrupted
         } while(0 != sleep_rc);
@@ -1724,12 +3200,76 @@ int connect_to_server(void)
     }
 
     session_count = session_count + 1;
+    server_job = job;
 
     MPIR_SHIM_DEBUG_EXIT("Connected to launcher nspace '%s' rank %d",
-                         launcher_proc.nspace, launcher_proc.rank);
+                         job->launcher_proc.nspace, job->launcher_proc.rank);
+    return STATUS_OK;
+}
+
+/**
+ * @name   select_job_server
+ * @brief  Make the launcher of the specified job the primary server for
+ *         subsequent requests. In proxy mode each launcher is its own PMIx
+ *         server, so requests about a job must be sent to its launcher. In
+ *         other modes all jobs share a single server. Called with
+ *         server_lock held, see lock_job_server.
+ * @param  job: The job whose launcher becomes the primary server
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int select_job_server(MPIR_Shim_Job *job)
+{
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_PROXY_MODE != mpir_mode || server_job == job) {
+        return STATUS_OK;
+    }
+
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
+
+    rc = PMIx_tool_set_server(&job->launcher_proc, NULL, 0);
+    if (PMIX_SUCCESS != rc) {
+        fprintf(stderr, "An error occurred selecting PMIx server '%s': %s.\n",
+                job->launcher_proc.nspace, PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    server_job = job;
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_SERVER_SWITCHES, 1);
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   lock_job_server
+ * @brief  Take server_lock and make the launcher of a job the primary server,
+ *         until unlock_job_server. The requests about the job are made in
+ *         between.
+ * @param  job: The job whose launcher becomes the primary server
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL with server_lock
+ *         released
+ */
+int lock_job_server(MPIR_Shim_Job *job)
+{
+    pthread_mutex_lock(&server_lock);
+    if (STATUS_OK != select_job_server(job)) {
+        pthread_mutex_unlock(&server_lock);
+        return STATUS_FAIL;
+    }
     return STATUS_OK;
 }
 
+/**
+ * @name   unlock_job_server
+ * @brief  Let another thread select a server, once the requests to the one
+ *         selected by lock_job_server are made.
+ */
+void unlock_job_server(void)
+{
+    pthread_mutex_unlock(&server_lock);
+}
+
 /**
  * @name   release_procs_in_namespace
  * @brief  Notify processes in the specified namespace that they are to resume
@@ -1740,24 +3280,53 @@ int connect_to_server(void)
  */
 int release_procs_in_namespace(char *namespace, pmix_rank_t rank)
 {
-    void *attr_list;
-    pmix_info_t *attrs;
-    size_t num_attrs;
-    pmix_status_t rc;
     pmix_proc_t target_procs;
-    pmix_data_array_t attr_array;
+    int status;
 
     MPIR_SHIM_DEBUG_ENTER("Namespace '%s', rank %d", namespace, rank);
 
     PMIX_PROC_LOAD(&target_procs, namespace, rank);
+    status = release_procs(&target_procs, 1);
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return status;
+}
+
+/**
+ * @name   release_procs
+ * @brief  Notify a set of processes that they are to resume execution, using
+ *         a single custom range notification.
+ * @param  procs: Array of processes to be notified
+ * @param  num_procs: Number of elements in procs
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int release_procs(pmix_proc_t *procs, size_t num_procs)
+{
+    void *attr_list;
+    pmix_info_t *attrs;
+    size_t num_attrs;
+    pmix_status_t rc;
+    pmix_data_array_t attr_array, proc_array;
+    MPIR_Shim_Job *job = NULL;
+    double sent_ms, now_ms;
+    int64_t released;
+    size_t i;
 
     PMIX_INFO_LIST_START(attr_list);
-    /* Send the process release request to only the specified namespace */
-    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_CUSTOM_RANGE, &target_procs, PMIX_PROC);
+    /* Send the process release request to only the specified processes */
+    if (1 == num_procs) {
+        PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_CUSTOM_RANGE, &procs[0], PMIX_PROC);
+    }
+    else {
+        proc_array.type = PMIX_PROC;
+        proc_array.size = num_procs;
+        proc_array.array = procs;
+        PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_EVENT_CUSTOM_RANGE, &proc_array,
+                           PMIX_DATA_ARRAY);
+    }
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_CUSTOM_RANGE) failed: %s",
                 PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
     /* Don't send request to default event handlers */
@@ -1765,14 +3334,12 @@ int release_procs_in_namespace(char *namespace, pmix_rank_t rank)
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_EVENT_NON_DEFAULT) failed: %s",
                 PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
     PMIX_INFO_LIST_CONVERT(rc, attr_list, &attr_array);
     if (rc != PMIX_SUCCESS) {
         fprintf(stderr, "PMIX_INFO_LIST_CONVERT failed: %s",
                 PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
     PMIX_INFO_LIST_RELEASE(attr_list);
@@ -1780,6 +3347,7 @@ int release_procs_in_namespace(char *namespace, pmix_rank_t rank)
     attrs = attr_array.array;
     num_attrs = attr_array.size;
 
+    sent_ms = timing_now();
     rc = PMIx_Notify_event(PMIX_ERR_DEBUGGER_RELEASE,
                            NULL, PMIX_RANGE_CUSTOM,
                            attrs, num_attrs,
@@ -1788,92 +3356,372 @@ int release_procs_in_namespace(char *namespace, pmix_rank_t rank)
     if ((PMIX_SUCCESS != rc) && (PMIX_OPERATION_SUCCEEDED != rc)) {
         fprintf(stderr, "An error occurred resuming launcher process: %s.\n",
                 PMIx_Error_string(rc));
-        MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
 
-    MPIR_SHIM_DEBUG_EXIT("");
+    /*
+     * PMIx does not acknowledge the resumption of each process, so the
+     * processes count as released once the notification is delivered.
+     * Releasing a launcher releases no application rank.
+     */
+    job = find_nspace_job(procs[0].nspace);
+    released = (int64_t)num_procs;
+    // A wildcard releases every rank of the application
+    if (1 == num_procs && PMIX_RANK_WILDCARD == procs[0].rank && NULL != job &&
+        0 == strncmp(procs[0].nspace, job->application_proc.nspace, PMIX_MAX_NSLEN)) {
+        released = job->proctable_size;
+    }
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_RELEASE, (NULL == job) ? -1 : job->index,
+                             0, procs[0].rank, released, procs[0].nspace);
+
+    if (mpir_shim_hold_enabled()) {
+        now_ms = timing_now();
+        for (i = 0; i < num_procs; i++) {
+            if (NULL == job || 0 != strncmp(procs[i].nspace,
+                                            job->application_proc.nspace,
+                                            PMIX_MAX_NSLEN)) {
+                job = find_nspace_job(procs[i].nspace);
+            }
+            if (NULL != job && 0 == strncmp(procs[i].nspace,
+                                            job->application_proc.nspace,
+                                            PMIX_MAX_NSLEN)) {
+                mpir_shim_hold_released(job->index, procs[i].rank, sent_ms, now_ms);
+            }
+        }
+    }
+
     return STATUS_OK;
 }
 
 /**
- * @name   query_launcher_namespace
- * @brief  Access the server namespace/rank and save it in launcher_proc
+ * @name   release_application
+ * @brief  Release the held application processes of a job, all at once or in
+ *         waves depending on the release policy.
+ * @param  job: The job to release
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int query_launcher_namespace(void)
+int release_application(MPIR_Shim_Job *job)
 {
-    char launcher_namespace[PMIX_MAX_NSLEN + 1];
-    pmix_value_t *val = NULL;
-    int rc;
-
-    MPIR_SHIM_DEBUG_ENTER("");
+    int status;
 
-    // Access Launcher information
-    // https://github.com/openpmix/openpmix/issues/1801#issuecomment-648365247
-    rc = PMIx_Get(&tool_proc, PMIX_SERVER_NSPACE, NULL, 0, &val);
-    if( PMIX_SUCCESS == rc && NULL != val && val->type == PMIX_STRING ) {
-        PMIX_LOAD_NSPACE(launcher_namespace, val->data.string);
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
 
-        rc = PMIx_Get(&tool_proc, PMIX_SERVER_RANK, NULL, 0, &val);
-        if( PMIX_SUCCESS == rc && NULL != val && val->type == PMIX_PROC_RANK ) {
-            PMIX_PROC_LOAD(&launcher_proc, launcher_namespace, val->data.rank);
-        }
-        else {
-            pmix_fatal_error(rc, "Failed in PMIx_Get(PMIX_SERVER_RANK)\n");
+    // A manual release of the whole application releases everything at once
+    if (RELEASE_ALL == release_policy || RELEASE_MANUAL == release_policy) {
+        if (STATUS_OK != lock_job_server(job)) {
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
         }
+        status = release_procs_in_namespace(job->application_proc.nspace,
+                                            PMIX_RANK_WILDCARD);
+        unlock_job_server();
     }
     else {
-        pmix_fatal_error(rc, "Failed in PMIx_Get(PMIX_SERVER_NSPACE)\n");
-    }
-
-    if (0 == strlen(launcher_proc.nspace)) {
-        pmix_fatal_error(rc, "Failed to access the launcher's namespace\n");
+        status = release_application_waves(job);
     }
 
-    MPIR_SHIM_DEBUG_EXIT("Connected to launcher nspace '%s' rank %d",
-                         launcher_proc.nspace, launcher_proc.rank);
-    return STATUS_OK;
+    MPIR_SHIM_DEBUG_EXIT("");
+    return status;
 }
 
 /**
- * @name   query_application_namespace
- * @brief  Set application_proc to the name of the application namespace
+ * @name   release_job_ranks
+ * @brief  Release a set of ranks of a job with one custom range notification
+ * @param  job: The job the ranks belong to
+ * @param  ranks: Array of ranks to release
+ * @param  num_ranks: Number of elements in ranks
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int query_application_namespace(void)
+int release_job_ranks(MPIR_Shim_Job *job, const pmix_rank_t *ranks, size_t num_ranks)
 {
-    void *qual_list;
-    pmix_info_t *namespace_query_data = NULL;
-    size_t namespace_query_size;
-    pmix_status_t rc;
-    pmix_query_t namespace_query;
-    pmix_data_array_t qual_array;
+    pmix_proc_t *procs;
+    size_t i;
+    int status;
 
-    MPIR_SHIM_DEBUG_ENTER("");
+    MPIR_SHIM_DEBUG_ENTER("Job %d, %lu ranks", job->index, (unsigned long)num_ranks);
 
-    PMIX_QUERY_CONSTRUCT(&namespace_query);
-    PMIX_ARGV_APPEND(rc, namespace_query.keys, PMIX_QUERY_NAMESPACES);
-    if (PMIX_SUCCESS != rc) {
-        fprintf(stderr, "An error occurred creating namespace query.");
-        PMIX_QUERY_DESTRUCT(&namespace_query);
+    if ('\0' == job->application_proc.nspace[0]) {
+        fprintf(stderr, "Job %d has no application processes to release.\n", job->index);
         MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
+    for (i = 0; i < num_ranks; i++) {
+        if ((int)ranks[i] >= job->proctable_size) {
+            fprintf(stderr, "Rank %u is not a rank of job %d.\n", ranks[i], job->index);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+    }
+    if (0 == num_ranks) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_OK;
+    }
 
-    PMIX_INFO_LIST_START(qual_list);
-    /* Set the namespace and rank to query */
-    PMIX_INFO_LIST_ADD(rc, qual_list, PMIX_NSPACE, launcher_proc.nspace, PMIX_STRING);
-    if (rc != PMIX_SUCCESS) {
-        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_NSPACE) failed: %s",
-                PMIx_Error_string(rc));
+    procs = calloc(num_ranks, sizeof(pmix_proc_t));
+    if (NULL == procs) {
+        fprintf(stderr, "Unable to allocate the processes to release.\n");
         MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
-    PMIX_INFO_LIST_ADD(rc, qual_list, PMIX_RANK, &launcher_proc.rank,  PMIX_INT32);
-    if (rc != PMIX_SUCCESS) {
-        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_RANK) failed: %s",
-                PMIx_Error_string(rc));
+    for (i = 0; i < num_ranks; i++) {
+        PMIX_PROC_LOAD(&procs[i], job->application_proc.nspace, ranks[i]);
+    }
+
+    status = lock_job_server(job);
+    if (STATUS_OK == status) {
+        status = release_procs(procs, num_ranks);
+        unlock_job_server();
+    }
+    free(procs);
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return status;
+}
+
+/**
+ * @name   compare_release_rank
+ * @brief  qsort comparison ordering ranks by host name, then by rank
+ */
+int compare_release_rank(const void *a, const void *b)
+{
+    const release_rank_t *ra = (const release_rank_t *)a;
+    const release_rank_t *rb = (const release_rank_t *)b;
+    int cmp;
+
+    cmp = strcmp(ra->host_name, rb->host_name);
+    if (0 != cmp) {
+        return cmp;
+    }
+    return (ra->rank < rb->rank) ? -1 : (ra->rank > rb->rank);
+}
+
+/**
+ * @name   elapsed_ms
+ * @brief  Milliseconds elapsed between two time stamps
+ */
+double elapsed_ms(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000.0 +
+           (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/**
+ * @name   release_application_waves
+ * @brief  Release the held application processes of a job in waves so they
+ *         do not all start loading libraries and touching the file system at
+ *         the same time. Each wave is one custom range notification. The
+ *         totals are reported on stderr, each wave in the debug output.
+ * @param  job: The job to release, with its MPIR_proctable slice built
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int release_application_waves(MPIR_Shim_Job *job)
+{
+    release_rank_t *ranks;
+    pmix_proc_t *procs;
+    struct timespec start, wave_start, wave_end, next;
+    const char *host_name;
+    double interval_ms = 0.0, delay_ms;
+    size_t num_ranks, wave_size, i, n, lists_size;
+    int num_waves, num_nodes, status;
+
+    /*
+     * Release the held ranks, or every rank of the job if all are held.
+     */
+    ranks = calloc(job->proctable_size + 1, sizeof(release_rank_t));
+    procs = calloc(job->proctable_size + 1, sizeof(pmix_proc_t));
+    if (NULL == ranks || NULL == procs) {
+        fprintf(stderr, "Unable to allocate the release waves.\n");
+        free(ranks);
+        free(procs);
+        return STATUS_FAIL;
+    }
+    lists_size = (job->proctable_size + 1) * (sizeof(release_rank_t) + sizeof(pmix_proc_t));
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE, lists_size);
+    num_ranks = 0;
+    if (0 < num_hold_ranks) {
+        for (i = 0; i < num_hold_ranks; i++) {
+            if ((int)hold_ranks[i] < job->proctable_size) {
+                ranks[num_ranks++].rank = hold_ranks[i];
+            }
+        }
+    }
+    else {
+        for (i = 0; i < (size_t)job->proctable_size; i++) {
+            ranks[num_ranks++].rank = (pmix_rank_t)i;
+        }
+    }
+    for (i = 0; i < num_ranks; i++) {
+        host_name = MPIR_proctable[job->proctable_offset + ranks[i].rank].host_name;
+        ranks[i].host_name = (NULL != host_name) ? host_name : "";
+    }
+
+    wave_size = release_count;
+    if (RELEASE_NODES == release_policy) {
+        qsort(ranks, num_ranks, sizeof(release_rank_t), compare_release_rank);
+    }
+    else if (RELEASE_RATE == release_policy) {
+        // Ten waves per second, or one rank per wave at low rates
+        wave_size = (10 <= release_count) ? release_count / 10 : 1;
+        interval_ms = wave_size * 1000.0 / release_count;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    num_waves = 0;
+    for (i = 0; i < num_ranks; i += n) {
+        /*
+         * Fill the wave: wave_size ranks, or every rank of wave_size nodes.
+         */
+        n = 0;
+        num_nodes = 0;
+        while (i + n < num_ranks) {
+            if (RELEASE_NODES == release_policy) {
+                if (0 == n || 0 != strcmp(ranks[i + n].host_name,
+                                          ranks[i + n - 1].host_name)) {
+                    if (num_nodes == release_count) {
+                        break;
+                    }
+                    num_nodes++;
+                }
+            }
+            else if (n == wave_size) {
+                break;
+            }
+            PMIX_PROC_LOAD(&procs[n], job->application_proc.nspace, ranks[i + n].rank);
+            n++;
+        }
+
+        /*
+         * Pace the waves when releasing at a fixed rate.
+         */
+        if (RELEASE_RATE == release_policy && 0 < num_waves) {
+            clock_gettime(CLOCK_MONOTONIC, &wave_start);
+            delay_ms = num_waves * interval_ms - elapsed_ms(&start, &wave_start);
+            if (0.0 < delay_ms) {
+                next.tv_sec = (time_t)(delay_ms / 1000.0);
+                next.tv_nsec = (long)((delay_ms - next.tv_sec * 1000.0) * 1000000.0);
+                nanosleep(&next, NULL);
+            }
+        }
+
+        // The server is selected for each wave, not across the pacing
+        clock_gettime(CLOCK_MONOTONIC, &wave_start);
+        if (STATUS_OK != lock_job_server(job)) {
+            free(ranks);
+            free(procs);
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE, lists_size);
+            return STATUS_FAIL;
+        }
+        status = release_procs(procs, n);
+        unlock_job_server();
+        if (STATUS_OK != status) {
+            free(ranks);
+            free(procs);
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE, lists_size);
+            return STATUS_FAIL;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &wave_end);
+        num_waves++;
+
+        // PMIx_Notify_event does not wait for delivery, so this only times the notify
+        debug_print("Job %d release wave %d: %lu ranks (first rank %u), notify %.3f ms,"
+                    " %.3f ms since first wave\n", job->index, num_waves,
+                    (unsigned long)n, procs[0].rank, elapsed_ms(&wave_start, &wave_end),
+                    elapsed_ms(&start, &wave_end));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wave_end);
+    fprintf(stderr, "Job %d released %lu ranks in %d waves in %.3f ms\n", job->index,
+            (unsigned long)num_ranks, num_waves, elapsed_ms(&start, &wave_end));
+
+    free(ranks);
+    free(procs);
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE, lists_size);
+    return STATUS_OK;
+}
+
+/**
+ * @name   query_launcher_namespace
+ * @brief  Access the server namespace/rank and save it in the job's launcher_proc
+ * @param  job: The job to update
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int query_launcher_namespace(MPIR_Shim_Job *job)
+{
+    char launcher_namespace[PMIX_MAX_NSLEN + 1];
+    pmix_value_t *val = NULL;
+    int rc;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    // Access Launcher information
+    // https://github.com/openpmix/openpmix/issues/1801#issuecomment-648365247
+    rc = PMIx_Get(&tool_proc, PMIX_SERVER_NSPACE, NULL, 0, &val);
+    if( PMIX_SUCCESS == rc && NULL != val && val->type == PMIX_STRING ) {
+        PMIX_LOAD_NSPACE(launcher_namespace, val->data.string);
+
+        rc = PMIx_Get(&tool_proc, PMIX_SERVER_RANK, NULL, 0, &val);
+        if( PMIX_SUCCESS == rc && NULL != val && val->type == PMIX_PROC_RANK ) {
+            PMIX_PROC_LOAD(&job->launcher_proc, launcher_namespace, val->data.rank);
+        }
+        else {
+            MPIR_SHIM_DEBUG_EXIT("");
+            return pmix_fatal_error(rc, "Failed in PMIx_Get(PMIX_SERVER_RANK)\n");
+        }
+    }
+    else {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return pmix_fatal_error(rc, "Failed in PMIx_Get(PMIX_SERVER_NSPACE)\n");
+    }
+
+    if (0 == strlen(job->launcher_proc.nspace)) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return pmix_fatal_error(rc, "Failed to access the launcher's namespace\n");
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("Connected to launcher nspace '%s' rank %d",
+                         job->launcher_proc.nspace, job->launcher_proc.rank);
+    return STATUS_OK;
+}
+
+/**
+ * @name   query_application_namespace
+ * @brief  Set the job's application_proc to the name of the application namespace
+ * @param  job: The job to update
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int query_application_namespace(MPIR_Shim_Job *job)
+{
+    void *qual_list;
+    pmix_info_t *namespace_query_data = NULL;
+    size_t namespace_query_size;
+    pmix_status_t rc;
+    pmix_query_t namespace_query;
+    pmix_data_array_t qual_array;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    PMIX_QUERY_CONSTRUCT(&namespace_query);
+    PMIX_ARGV_APPEND(rc, namespace_query.keys, PMIX_QUERY_NAMESPACES);
+    if (PMIX_SUCCESS != rc) {
+        fprintf(stderr, "An error occurred creating namespace query.");
+        PMIX_QUERY_DESTRUCT(&namespace_query);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    PMIX_INFO_LIST_START(qual_list);
+    /* Set the namespace and rank to query */
+    PMIX_INFO_LIST_ADD(rc, qual_list, PMIX_NSPACE, job->launcher_proc.nspace, PMIX_STRING);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_NSPACE) failed: %s",
+                PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_ADD(rc, qual_list, PMIX_RANK, &job->launcher_proc.rank,  PMIX_INT32);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_RANK) failed: %s",
+                PMIx_Error_string(rc));
         MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
@@ -1907,8 +3755,8 @@ int query_application_namespace(void)
         return STATUS_FAIL;
     }
 
-    PMIX_PROC_LOAD(&application_proc, namespace_query_data->value.data.string, PMIX_RANK_WILDCARD);
-    debug_print("Application namespace is '%s'\n", application_proc.nspace);
+    PMIX_PROC_LOAD(&job->application_proc, namespace_query_data->value.data.string, PMIX_RANK_WILDCARD);
+    debug_print("Application namespace is '%s'\n", job->application_proc.nspace);
 
     if (NULL != namespace_query_data) {
         free(namespace_query_data);
@@ -1919,26 +3767,30 @@ int query_application_namespace(void)
 }
 
 /**
- * @name   pmix_proc_table_to_mpir
- * @brief  Request the process mapping data from PMIX, build the MPIR_proctable
- *         array, and call MPIR_Breakpoint to notify the tool that the process
- *         map info is available.
+ * @name   query_job_proctable
+ * @brief  Request the process mapping data for one namespace of a job from PMIX.
+ * @param  job: The job to query
+ * @param  nspace: The namespace of the job to query
+ * @param  quiet: If non-zero, fail silently on a failed query or an incomplete
+ *           response instead of reporting it, as a poll that skips the sample
+ * @param  query_data: Set to the query response, released by the caller with
+ *           PMIX_INFO_FREE
+ * @param  query_size: Set to the number of elements in query_data
  * @return STATUS_OK if successful, otherwise STATUS_FAIL
  */
-int pmix_proc_table_to_mpir(void)
+int query_job_proctable(MPIR_Shim_Job *job, const char *nspace, int quiet,
+                        pmix_info_t **query_data, size_t *query_size)
 {
     pmix_info_t *proctable_query_data = NULL;
     size_t proctable_query_size;
-    pmix_data_array_t *response_array;
-    pmix_proc_info_t *proc_info;
     pmix_status_t rc;
-    int i, n, rank;
+    int n, status = STATUS_OK;
     pmix_query_t proctable_query;
 
-    MPIR_SHIM_DEBUG_ENTER("");
+    MPIR_SHIM_DEBUG_ENTER("Job %d, nspace '%s'", job->index, nspace);
 
     /*
-     * Query PMIx for the process table for the application namespace.
+     * Query PMIx for the process table for the namespace.
      */
     PMIX_QUERY_CONSTRUCT(&proctable_query);
     PMIX_ARGV_APPEND(rc, proctable_query.keys, PMIX_QUERY_PROC_TABLE);
@@ -1953,305 +3805,2065 @@ int pmix_proc_table_to_mpir(void)
     PMIX_INFO_CREATE(proctable_query.qualifiers, proctable_query.nqual);
     n = 0;
     PMIX_INFO_LOAD(&proctable_query.qualifiers[n], PMIX_NSPACE,
-                   application_proc.nspace, PMIX_STRING);
+                   nspace, PMIX_STRING);
     n++;
 
+    if (STATUS_OK != lock_job_server(job)) {
+        PMIX_QUERY_DESTRUCT(&proctable_query);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
     rc = PMIx_Query_info(&proctable_query, 1, &proctable_query_data,
                          &proctable_query_size);
+    unlock_job_server();
     PMIX_QUERY_DESTRUCT(&proctable_query);
     if (PMIX_SUCCESS != rc) {
-        fprintf(stderr, "An error occurred querying the proctable: %s.\n",
-                PMIx_Error_string(rc));
+        if (0 == quiet) {
+            fprintf(stderr, "An error occurred querying the proctable: %s.\n",
+                    PMIx_Error_string(rc));
+        }
+        if (NULL != proctable_query_data) {
+            PMIX_INFO_FREE(proctable_query_data, proctable_query_size);
+        }
         MPIR_SHIM_DEBUG_EXIT("");
         return STATUS_FAIL;
     }
 
     /*
      * Check the query data status, info/ninfo, and data type (which
-     * should be a data array).
+     * should be a data array). A quiet query skips an incomplete response,
+     * which the launcher may return while it is still mapping the job.
      */
+    if (0 != quiet &&
+        (NULL == proctable_query_data || 0 >= proctable_query_size ||
+         PMIX_DATA_ARRAY != proctable_query_data[0].value.type ||
+         NULL == proctable_query_data[0].value.data.darray ||
+         NULL == proctable_query_data[0].value.data.darray->array ||
+         PMIX_PROC_INFO != proctable_query_data[0].value.data.darray->type)) {
+        debug_print("Skipping incomplete proctable of job %d\n", job->index);
+        if (NULL != proctable_query_data) {
+            PMIX_INFO_FREE(proctable_query_data, proctable_query_size);
+        }
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
     if (NULL == proctable_query_data || 0 >= proctable_query_size) {
-        pmix_fatal_error(rc, "PMIx proc table info/ninfo is 0");
+        status = pmix_fatal_error(rc, "PMIx proc table info/ninfo is 0");
     }
-    if (PMIX_DATA_ARRAY != proctable_query_data[0].value.type) {
-        pmix_fatal_error(rc, "PMIx proc table has incorrect data type: %s (%d)",
-                         PMIx_Data_type_string (proctable_query_data[0].value.type),
-                         (int) proctable_query_data[0].value.type);
+    else if (PMIX_DATA_ARRAY != proctable_query_data[0].value.type) {
+        status = pmix_fatal_error(rc, "PMIx proc table has incorrect data type: %s (%d)",
+                                  PMIx_Data_type_string (proctable_query_data[0].value.type),
+                                  (int) proctable_query_data[0].value.type);
     }
-    if (NULL == proctable_query_data[0].value.data.darray->array) {
-        pmix_fatal_error(rc, "PMIx proc table data array is null");
+    else if (NULL == proctable_query_data[0].value.data.darray ||
+             NULL == proctable_query_data[0].value.data.darray->array) {
+        status = pmix_fatal_error(rc, "PMIx proc table data array is null");
     }
-    if (PMIX_PROC_INFO != proctable_query_data[0].value.data.darray->type) {
-        pmix_fatal_error(rc, "PMIx proc table data array has incorrect type: %s (%d)",
-                         PMIx_Data_type_string (proctable_query_data[0].value.data.darray->type),
-                         (int) proctable_query_data[0].value.data.darray->type);
+    else if (PMIX_PROC_INFO != proctable_query_data[0].value.data.darray->type) {
+        status = pmix_fatal_error(rc, "PMIx proc table data array has incorrect type: %s (%d)",
+                                  PMIx_Data_type_string (proctable_query_data[0].value.data.darray->type),
+                                  (int) proctable_query_data[0].value.data.darray->type);
+    }
+    if (STATUS_OK != status) {
+        if (NULL != proctable_query_data) {
+            PMIX_INFO_FREE(proctable_query_data, proctable_query_size);
+        }
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
     }
 
-    /*
-     * The data array consists of a struct:
-     *     size_t size;
-     *     void* array;
-     *
-     * In this case, the array is composed of pmix_proc_info_t structs:
-     *     pmix_proc_t proc;   // contains the nspace,rank of this proc
-     *     char* hostname;
-     *     char* executable_name;
-     *     pid_t pid;
-     *     int exit_code;
-     *     pmix_proc_state_t state;
-     */
-    debug_print("Proctable query returns %d elements of type %s\n",
-               proctable_query_size,
+    debug_print("Proctable query returns %lu elements of type %s\n",
+                (unsigned long)proctable_query_size,
                PMIx_Data_type_string(proctable_query_data->value.type));
-    response_array =
-        (pmix_data_array_t *) proctable_query_data->value.data.darray;
-    proc_info = response_array->array;
 
-    debug_print("Received PMIx proc table for %lu procs:\n", response_array->size);
+    *query_data = proctable_query_data;
+    *query_size = proctable_query_size;
 
-    MPIR_proctable_size = response_array->size;
-    MPIR_proctable = malloc(MPIR_proctable_size * sizeof(MPIR_PROCDESC));
-    for (i = 0; i < MPIR_proctable_size; i++) {
-        rank = proc_info[i].proc.rank;
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   observe_held_ranks
+ * @brief  Query the process table of a launched application and pass the
+ *         state of each rank to the hold report. A failed query or an
+ *         incomplete table skips this sample without reporting an error.
+ * @param  job: The job to query
+ */
+void observe_held_ranks(MPIR_Shim_Job *job)
+{
+    pmix_info_t *query_data = NULL;
+    size_t query_size = 0, i;
+    pmix_data_array_t *response_array;
+    pmix_proc_info_t *proc_info;
+    double now_ms;
 
-        MPIR_proctable[rank].pid = proc_info[i].pid;
-        MPIR_proctable[rank].host_name = strdup(proc_info[i].hostname);
-        MPIR_proctable[rank].executable_name = strdup(proc_info[i].executable_name);
+    MPIR_SHIM_DEBUG_ENTER("Job %d", job->index);
 
-        debug_print("Task %d host=%s exec=%s pid=%d state='%s'\n", i, 
-                    proc_info[i].hostname, proc_info[i].executable_name,
-                    proc_info[i].pid,
-                    PMIx_Proc_state_string(proc_info[i].state));
+    if (STATUS_OK != query_job_proctable(job, job->application_proc.nspace, 1,
+                                         &query_data, &query_size)) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return;
     }
-    MPIR_debug_state = MPIR_DEBUG_SPAWNED;
-
-    if (NULL != proctable_query_data) {
-        PMIX_INFO_FREE(proctable_query_data, proctable_query_size);
+    now_ms = timing_now();
+    response_array = query_data[0].value.data.darray;
+    proc_info = response_array->array;
+    for (i = 0; i < response_array->size; i++) {
+        mpir_shim_hold_observe(job->index, proc_info[i].proc.rank,
+                               intern_string(proc_info[i].hostname),
+                               proc_info[i].state, now_ms);
     }
-
-    /*
-     * Notify the debugger.
-     */
-    MPIR_Breakpoint();
+    PMIX_INFO_FREE(query_data, query_size);
 
     MPIR_SHIM_DEBUG_EXIT("");
-    return PMIX_SUCCESS;
 }
 
 /**
- * @name   MPIR_Shim_common
- * @brief  Common top-level processing for this module, used when this module is
- *         invoked as a shim module between the tool and the launcher, and when
- *         this module is used as a shared library when used in a MPIR testcase.
- * @param  mpir_mode_: Force this into proxy mode or non-proxy mode (Default: dynamic)
- * @param  pid_: Connect to this PID in an attach mode (Default: disabled = 0)
- * @param  debug_: Enable debugging output and tracing (Default: Disabled)
- * @param  argc: Number of launcher and application command line arguments
- * @param  argv: Array of launcher and application command line arguments, terminated with NULL entry.
- * @param  pmix_prefix_: Value to set PMIX_PREFIX info key when call tool init. NULL if skip.
- * @return 0 if successful, 1 if failed
+ * @name   intern_string
+ * @brief  Get the shared copy of a host or executable name, adding it to the
+ *         interned names if it is not there yet. Large jobs run many
+ *         processes of the same executable on each host, so the MPIR tables
+ *         hold one copy of each distinct name instead of one per entry.
+ *         The copies are freed by exit_handler.
+ * @param  str: Name to intern, may be NULL
+ * @return The interned copy of str, NULL if str is NULL
  */
-int MPIR_Shim_common(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
-                     int argc, char *argv[], const char *pmix_prefix_)
+const char *intern_string(const char *str)
 {
-    MPIR_SHIM_DEBUG_ENTER("");
-
-    tool_binary_name = strdup("mpir");
-
-    PMIX_LOAD_NSPACE(launcher_proc.nspace, NULL);
-    launcher_proc.rank = PMIX_RANK_WILDCARD;
+    char **new_strings;
+    size_t new_capacity, hash, i, j;
+    const char *c;
 
-    PMIX_LOAD_NSPACE(application_proc.nspace, NULL);
-    application_proc.rank = PMIX_RANK_WILDCARD;
-
-
-    /*
-     * Process options provided
-     */
-    if (STATUS_FAIL == process_options(mpir_mode_, pid_, debug_, argc, argv)) {
-        return STATUS_FAIL;
-    }
-    if (NULL != pmix_prefix_) {
-        pmix_prefix = (char *) pmix_prefix_;
+    if (NULL == str) {
+        return NULL;
     }
-    debug_print("Launcher '%s', performing a %s\n", tool_binary_name,
-                (MPIR_SHIM_PROXY_MODE == mpir_mode ? "proxy run" : 
-                 (MPIR_SHIM_NONPROXY_MODE == mpir_mode ? "non-proxy run" :
-                  (MPIR_SHIM_ATTACH_MODE == mpir_mode ? "attach run" : "(unknown"))));
 
     /*
-     * Setup signal handlers.
+     * Keep the load factor under one half so probe sequences stay short.
      */
-    if (STATUS_FAIL == setup_signal_handlers()) {
-        return STATUS_FAIL;
+    if (interned_capacity <= 2 * (interned_count + 1)) {
+        new_capacity = (0 == interned_capacity) ? 256 : 2 * interned_capacity;
+        new_strings = calloc(new_capacity, sizeof(char *));
+        if (NULL == new_strings) {
+            (void) pmix_fatal_error(PMIX_ERR_NOMEM, "Unable to allocate interned names");
+            return NULL;
+        }
+        for (i = 0; i < interned_capacity; i++) {
+            if (NULL == interned_strings[i]) {
+                continue;
+            }
+            hash = 2166136261u;
+            for (c = interned_strings[i]; '\0' != *c; c++) {
+                hash = (hash ^ (unsigned char)*c) * 16777619u;
+            }
+            for (j = hash & (new_capacity - 1); NULL != new_strings[j];
+                 j = (j + 1) & (new_capacity - 1)) {
+            }
+            new_strings[j] = interned_strings[i];
+        }
+        free(interned_strings);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_STRINGS,
+                             (new_capacity - interned_capacity) * sizeof(char *));
+        interned_strings = new_strings;
+        interned_capacity = new_capacity;
     }
 
-    /*
-     * Setup an atexit handler to make sure we cleanup
-     */
-    if (0 != atexit(exit_handler)) {
-        fprintf(stderr, "An error occurred setting an exit handler.\n");
-        return STATUS_FAIL;
+    hash = 2166136261u;
+    for (c = str; '\0' != *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    for (i = hash & (interned_capacity - 1); NULL != interned_strings[i];
+         i = (i + 1) & (interned_capacity - 1)) {
+        if (0 == strcmp(interned_strings[i], str)) {
+            return interned_strings[i];
+        }
     }
 
-    /*
-     * Initialize ourselves as a PMIx tool.
-     */
-    if (STATUS_FAIL == initialize_as_tool()) {
-        return STATUS_FAIL;
+    interned_strings[i] = strdup(str);
+    if (NULL == interned_strings[i]) {
+        (void) pmix_fatal_error(PMIX_ERR_NOMEM, "Unable to allocate interned names");
+        return NULL;
     }
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_STRINGS, strlen(str) + 1);
+    interned_count++;
+    return interned_strings[i];
+}
 
-    /*
-     * Register the default event handler.
-     */
-    if( STATUS_OK != register_default_event_handler() ) {
-        return STATUS_FAIL;
+/**
+ * @name   free_interned_strings
+ * @brief  Free every interned name. The MPIR tables must not be used after.
+ */
+void free_interned_strings(void)
+{
+    size_t i;
+
+    for (i = 0; i < interned_capacity; i++) {
+        if (NULL != interned_strings[i]) {
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_STRINGS, strlen(interned_strings[i]) + 1);
+            free(interned_strings[i]);
+        }
     }
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_STRINGS, interned_capacity * sizeof(char *));
+    free(interned_strings);
+    interned_strings = NULL;
+    interned_capacity = 0;
+    interned_count = 0;
+}
+
+/**
+ * @name   namespace_size
+ * @brief  Bytes allocated for a namespace copy of MPIR_Shim_jobtable.
+ * @param  name: The copy, may be NULL
+ * @return Its size
+ */
+size_t namespace_size(const char *name)
+{
+    return (NULL != name) ? strlen(name) + 1 : 0;
+}
+
+/**
+ * @name   mpir_shim_rank_host
+ * @brief  Get the host of a process of an application, from the process
+ *         table.
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @return Host name, NULL if not known
+ */
+const char *mpir_shim_rank_host(int job_index, pmix_rank_t rank)
+{
+    MPIR_Shim_Job *job;
+
+    if (NULL == MPIR_proctable || 0 > job_index || num_shim_jobs <= job_index) {
+        return NULL;
+    }
+    job = &shim_jobs[job_index];
+    if ((pmix_rank_t)job->proctable_size <= rank) {
+        return NULL;
+    }
+    return MPIR_proctable[job->proctable_offset + rank].host_name;
+}
+
+/**
+ * @name   pmix_proc_table_to_mpir
+ * @brief  Request the process mapping data from PMIX, build the MPIR_proctable
+ *         array, and call MPIR_Breakpoint to notify the tool that the process
+ *         map info is available.
+ *
+ * When there are several jobs in the session the tables of all of the jobs
+ * are gathered first, then combined into a single MPIR_proctable with one
+ * MPIR_Shim_jobtable entry per job, and MPIR_Breakpoint is called once.
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int pmix_proc_table_to_mpir(void)
+{
+    pmix_info_t **proctable_query_data;
+    size_t *proctable_query_size;
+    pmix_data_array_t *response_array;
+    pmix_proc_info_t *proc_info;
+    MPIR_Shim_Job *job;
+    MPIR_PROCDESC *procdesc;
+    double start;
+    int i, j, rank, total_size;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    proctable_query_data = calloc(num_shim_jobs, sizeof(pmix_info_t *));
+    proctable_query_size = calloc(num_shim_jobs, sizeof(size_t));
+    if (NULL == proctable_query_data || NULL == proctable_query_size) {
+        fprintf(stderr, "Unable to allocate proctable query data.\n");
+        free(proctable_query_data);
+        free(proctable_query_size);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    /*
+     * Query the table of each job. A job whose launcher has already
+     * terminated contributes no processes.
+     */
+    total_size = 0;
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+        job->proctable_offset = total_size;
+        job->proctable_size = 0;
+        if ('\0' == job->application_proc.nspace[0]) {
+            debug_print("Job %d has no application namespace, skipping\n", j);
+            continue;
+        }
+        start = timing_now();
+        if (STATUS_OK != query_job_proctable(job, job->application_proc.nspace, 0,
+                                             &proctable_query_data[j],
+                                             &proctable_query_size[j])) {
+            free_proctable_queries(proctable_query_data, proctable_query_size);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+        record_timing("proctable_query", j, start);
+        response_array = proctable_query_data[j][0].value.data.darray;
+        job->proctable_size = (int)response_array->size;
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE,
+                             response_array->size * sizeof(pmix_proc_info_t));
+        total_size += job->proctable_size;
+    }
+
+    start = timing_now();
+    pthread_mutex_lock(&proc_failure_lock);
+    proctable_published = 0;
+    pthread_mutex_unlock(&proc_failure_lock);
+    MPIR_proctable_size = total_size;
+    mpir_shim_metrics_proctable(total_size);
+    MPIR_proctable = calloc(MPIR_proctable_size, sizeof(MPIR_PROCDESC));
+    MPIR_Shim_jobtable_size = num_shim_jobs;
+    MPIR_Shim_jobtable = calloc(MPIR_Shim_jobtable_size, sizeof(MPIR_SHIM_JOBDESC));
+    if (NULL == MPIR_Shim_jobtable || (0 < total_size && NULL == MPIR_proctable)) {
+        (void) pmix_fatal_error(PMIX_ERR_NOMEM, "Unable to allocate MPIR_proctable");
+        free_proctable_queries(proctable_query_data, proctable_query_size);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE,
+                         MPIR_proctable_size * sizeof(MPIR_PROCDESC) +
+                         MPIR_Shim_jobtable_size * sizeof(MPIR_SHIM_JOBDESC));
+
+    /*
+     * The data array consists of a struct:
+     *     size_t size;
+     *     void* array;
+     *
+     * In this case, the array is composed of pmix_proc_info_t structs:
+     *     pmix_proc_t proc;   // contains the nspace,rank of this proc
+     *     char* hostname;
+     *     char* executable_name;
+     *     pid_t pid;
+     *     int exit_code;
+     *     pmix_proc_state_t state;
+     */
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+
+        MPIR_Shim_jobtable[j].launcher_namespace = strdup(job->launcher_proc.nspace);
+        MPIR_Shim_jobtable[j].application_namespace = strdup(job->application_proc.nspace);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_STRINGS,
+                             namespace_size(MPIR_Shim_jobtable[j].launcher_namespace) +
+                             namespace_size(MPIR_Shim_jobtable[j].application_namespace));
+        MPIR_Shim_jobtable[j].proctable_offset = job->proctable_offset;
+        MPIR_Shim_jobtable[j].proctable_size = job->proctable_size;
+        mpir_shim_journal_append(MPIR_SHIM_JOURNAL_PROCTABLE, j, proctable_generation,
+                                 job->proctable_offset, job->proctable_size,
+                                 job->application_proc.nspace);
+
+        if (NULL == proctable_query_data[j]) {
+            continue;
+        }
+
+        response_array = proctable_query_data[j][0].value.data.darray;
+        proc_info = response_array->array;
+
+        debug_print("Received PMIx proc table for %lu procs in job %d:\n",
+                    response_array->size, j);
+
+        for (i = 0; i < job->proctable_size; i++) {
+            rank = proc_info[i].proc.rank;
+            if (0 > rank || job->proctable_size <= rank) {
+                (void) pmix_fatal_error(PMIX_ERR_BAD_PARAM,
+                                        "PMIx proc table rank %d out of range for job '%s'",
+                                        rank, job->application_proc.nspace);
+                continue;
+            }
+
+            procdesc = &MPIR_proctable[job->proctable_offset + rank];
+            procdesc->pid = proc_info[i].pid;
+            procdesc->host_name = (char *)intern_string(proc_info[i].hostname);
+            procdesc->executable_name = (char *)intern_string(proc_info[i].executable_name);
+            mpir_shim_hold_observe(j, rank, procdesc->host_name, proc_info[i].state,
+                                   start);
+
+            MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_PROCS,
+                            "Job %d task %d host=%s exec=%s pid=%d state='%s'\n", j, rank,
+                            proc_info[i].hostname, proc_info[i].executable_name,
+                            proc_info[i].pid,
+                            PMIx_Proc_state_string(proc_info[i].state));
+        }
+
+        PMIX_INFO_FREE(proctable_query_data[j], proctable_query_size[j]);
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE,
+                             job->proctable_size * sizeof(pmix_proc_info_t));
+    }
+    free(proctable_query_data);
+    free(proctable_query_size);
+    proctable_generation++;
+    record_timing("proctable_build", -1, start);
+
+    /*
+     * Start the tool daemons, if requested, so they are running and published
+     * when the debugger is notified.
+     */
+    if (NULL != daemon_args) {
+        start = timing_now();
+        if (STATUS_OK != pmix_daemon_table_to_mpir()) {
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+        record_timing("tool_daemons", -1, start);
+    }
+
+    // The tables are incomplete after a fatal error in the preload library
+    if (mpir_disabled) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    MPIR_debug_state = MPIR_DEBUG_SPAWNED;
+
+    /*
+     * Notify the debugger.
+     */
+    start = timing_now();
+    journal_debug_state();
+    MPIR_Breakpoint();
+    record_timing("breakpoint", -1, start);
+
+    /*
+     * Only now may a process failure be reported, naming its node.
+     */
+    publish_proc_table();
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return PMIX_SUCCESS;
+}
+
+/**
+ * @name   free_proctable_queries
+ * @brief  Free the process table query responses of the jobs, and the arrays
+ *         holding them.
+ * @param  query_data: The response of each job, NULL for a job not queried
+ * @param  query_size: The number of elements in each response
+ */
+void free_proctable_queries(pmix_info_t **query_data, size_t *query_size)
+{
+    int j;
+
+    for (j = 0; j < num_shim_jobs; j++) {
+        if (NULL != query_data[j]) {
+            PMIX_INFO_FREE(query_data[j], query_size[j]);
+        }
+    }
+    free(query_data);
+    free(query_size);
+}
+
+/**
+ * @name   spawn_tool_daemons
+ * @brief  Ask the launcher of a job to start one tool daemon on every node
+ *         hosting processes of the application.
+ * @param  job: The job whose application is the debug target
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int spawn_tool_daemons(MPIR_Shim_Job *job)
+{
+    pmix_info_t *attrs = NULL;
+    int i;
+    pmix_status_t rc;
+    size_t num_attrs;
+    pmix_app_t app_context;
+    char cwd[_POSIX_PATH_MAX + 1];
+    pmix_data_array_t attr_array;
+    void *attr_list;
+    uint16_t daemons_per_node = 1;
+
+    MPIR_SHIM_DEBUG_ENTER("Job %d, target '%s'", job->index,
+                          job->application_proc.nspace);
+
+    PMIX_LOAD_NSPACE(job->daemon_namespace, NULL);
+
+    PMIX_APP_CONSTRUCT(&app_context);
+    app_context.cmd = strdup(daemon_args[0]);
+    for (i = 0; i < num_daemon_args; i++) {
+        PMIX_ARGV_APPEND(rc, app_context.argv, daemon_args[i]);
+        if (PMIX_SUCCESS != rc) {
+            fprintf(stderr, "PMIX_ARGV_APPEND() failed %d\n", rc);
+            PMIX_APP_DESTRUCT(&app_context);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+    }
+    if (NULL == getcwd(cwd, sizeof(cwd) - 1)) {
+        app_context.cwd = strdup("");
+    }
+    else {
+        app_context.cwd = strdup(cwd);
+    }
+
+    /*
+     * The launcher places the daemons itself, one per node of the target
+     * namespace, so maxprocs is left unset.
+     */
+    PMIX_INFO_LIST_START(attr_list);
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_DEBUGGER_DAEMONS, &const_true, PMIX_BOOL);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_DEBUGGER_DAEMONS) failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_DEBUG_TARGET, &job->application_proc,
+                       PMIX_PROC);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_DEBUG_TARGET) failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_DEBUG_DAEMONS_PER_NODE, &daemons_per_node,
+                       PMIX_UINT16);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_DEBUG_DAEMONS_PER_NODE) failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    /* Forward daemon stdout and stderr to this process */
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_FWD_STDOUT, &const_true, PMIX_BOOL);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_FWD_STDOUT) failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_ADD(rc, attr_list, PMIX_FWD_STDERR, &const_true, PMIX_BOOL);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_ADD(PMIX_FWD_STDERR) failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    PMIX_INFO_LIST_CONVERT(rc, attr_list, &attr_array);
+    if (rc != PMIX_SUCCESS) {
+        fprintf(stderr, "PMIX_INFO_LIST_CONVERT failed: %s",
+                PMIx_Error_string(rc));
+        PMIX_APP_DESTRUCT(&app_context);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    attrs = attr_array.array;
+    num_attrs = attr_array.size;
+    PMIX_INFO_LIST_RELEASE(attr_list);
+
+    debug_print("Calling PMIx_Spawn for tool daemon %s\n", app_context.cmd);
+    if (STATUS_OK != lock_job_server(job)) {
+        PMIX_APP_DESTRUCT(&app_context);
+        PMIX_DATA_ARRAY_DESTRUCT(&attr_array);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    rc = PMIx_Spawn(attrs, num_attrs, &app_context, 1, job->daemon_namespace);
+    unlock_job_server();
+    PMIX_APP_DESTRUCT(&app_context);
+    PMIX_DATA_ARRAY_DESTRUCT(&attr_array);
+    debug_print("PMIx_Spawn status %s daemon_namespace: %s\n",
+                PMIx_Error_string(rc), job->daemon_namespace);
+
+    if ((PMIX_SUCCESS != rc) && (PMIX_OPERATION_SUCCEEDED != rc)) {
+        fprintf(stderr, "An error occurred launching the tool daemons: %s.\n",
+                PMIx_Error_string(rc));
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   pmix_daemon_table_to_mpir
+ * @brief  Start the tool daemons of every job and build the
+ *         MPIR_Shim_daemon_table array from their PMIx process tables.
+ *         Called once MPIR_proctable and MPIR_Shim_jobtable are built.
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int pmix_daemon_table_to_mpir(void)
+{
+    pmix_info_t **daemon_query_data;
+    size_t *daemon_query_size;
+    pmix_data_array_t *response_array;
+    pmix_proc_info_t *proc_info;
+    MPIR_Shim_Job *job;
+    MPIR_PROCDESC *procdesc;
+    int i, j, rank, total_size;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    daemon_query_data = calloc(num_shim_jobs, sizeof(pmix_info_t *));
+    daemon_query_size = calloc(num_shim_jobs, sizeof(size_t));
+    if (NULL == daemon_query_data || NULL == daemon_query_size) {
+        fprintf(stderr, "Unable to allocate daemon table query data.\n");
+        free(daemon_query_data);
+        free(daemon_query_size);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    /*
+     * Launch all of the daemons before querying any of them.
+     */
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+        PMIX_LOAD_NSPACE(job->daemon_namespace, NULL);
+        if ('\0' == job->application_proc.nspace[0]) {
+            continue;
+        }
+        if (STATUS_OK != spawn_tool_daemons(job)) {
+            free(daemon_query_data);
+            free(daemon_query_size);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+    }
+
+    total_size = 0;
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+        job->daemon_table_offset = total_size;
+        job->daemon_table_size = 0;
+        if ('\0' == job->daemon_namespace[0]) {
+            continue;
+        }
+        if (STATUS_OK != query_job_proctable(job, job->daemon_namespace, 0,
+                                             &daemon_query_data[j],
+                                             &daemon_query_size[j])) {
+            for (i = 0; i < j; i++) {
+                if (NULL != daemon_query_data[i]) {
+                    PMIX_INFO_FREE(daemon_query_data[i], daemon_query_size[i]);
+                }
+            }
+            free(daemon_query_data);
+            free(daemon_query_size);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return STATUS_FAIL;
+        }
+        response_array = daemon_query_data[j][0].value.data.darray;
+        job->daemon_table_size = (int)response_array->size;
+        total_size += job->daemon_table_size;
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE,
+                             response_array->size * sizeof(pmix_proc_info_t));
+    }
+
+    MPIR_Shim_daemon_table_size = total_size;
+    MPIR_Shim_daemon_table = calloc(MPIR_Shim_daemon_table_size, sizeof(MPIR_PROCDESC));
+    if (0 < total_size && NULL == MPIR_Shim_daemon_table) {
+        (void) pmix_fatal_error(PMIX_ERR_NOMEM, "Unable to allocate MPIR_Shim_daemon_table");
+        free_proctable_queries(daemon_query_data, daemon_query_size);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE,
+                         MPIR_Shim_daemon_table_size * sizeof(MPIR_PROCDESC));
+
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+
+        MPIR_Shim_jobtable[j].daemon_namespace = strdup(job->daemon_namespace);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_STRINGS,
+                             namespace_size(MPIR_Shim_jobtable[j].daemon_namespace));
+        MPIR_Shim_jobtable[j].daemon_table_offset = job->daemon_table_offset;
+        MPIR_Shim_jobtable[j].daemon_table_size = job->daemon_table_size;
+
+        if (NULL == daemon_query_data[j]) {
+            continue;
+        }
+
+        response_array = daemon_query_data[j][0].value.data.darray;
+        proc_info = response_array->array;
+
+        debug_print("Received PMIx proc table for %lu tool daemons in job %d:\n",
+                    response_array->size, j);
+
+        for (i = 0; i < job->daemon_table_size; i++) {
+            rank = proc_info[i].proc.rank;
+            if (0 > rank || job->daemon_table_size <= rank) {
+                (void) pmix_fatal_error(PMIX_ERR_BAD_PARAM,
+                                        "PMIx proc table rank %d out of range for daemons '%s'",
+                                        rank, job->daemon_namespace);
+                continue;
+            }
+
+            procdesc = &MPIR_Shim_daemon_table[job->daemon_table_offset + rank];
+            procdesc->pid = proc_info[i].pid;
+            procdesc->host_name = (char *)intern_string(proc_info[i].hostname);
+            procdesc->executable_name = (char *)intern_string(proc_info[i].executable_name);
+
+            MPIR_SHIM_TRACE(MPIR_SHIM_TRACE_PROCS,
+                            "Daemon %d host=%s exec=%s pid=%d\n", rank,
+                            proc_info[i].hostname, proc_info[i].executable_name,
+                            proc_info[i].pid);
+        }
+
+        PMIX_INFO_FREE(daemon_query_data[j], daemon_query_size[j]);
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_PROCTABLE,
+                             job->daemon_table_size * sizeof(pmix_proc_info_t));
+    }
+    free(daemon_query_data);
+    free(daemon_query_size);
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   provider_api_allowed
+ * @brief  Check that MPIR_Shim_common has not set up any job, since the
+ *         provider API and MPIR_Shim_common would both own MPIR_proctable.
+ *         Called with provider_lock held.
+ * @return STATUS_OK if the provider API may be used, otherwise STATUS_FAIL
+ */
+int provider_api_allowed(void)
+{
+    int in_use;
+
+    pthread_mutex_lock(&server_lock);
+    in_use = (NULL != shim_jobs);
+    pthread_mutex_unlock(&server_lock);
+
+    if (in_use) {
+        fprintf(stderr, "The proctable provider API cannot be used with MPIR_Shim_common.\n");
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   grow_provider_table
+ * @brief  Make room for at least size entries in MPIR_proctable for the
+ *         provider API, growing it geometrically so entries pushed one at a
+ *         time are not copied on every call. New entries are zeroed.
+ *         Called with provider_lock held.
+ * @param  size: Number of entries needed
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int grow_provider_table(int size)
+{
+    MPIR_PROCDESC *new_table;
+    int new_capacity;
+
+    if (STATUS_OK != provider_api_allowed()) {
+        return STATUS_FAIL;
+    }
+
+    if (0 == provider_exit_registered) {
+        if (0 != atexit(exit_handler)) {
+            fprintf(stderr, "An error occurred setting an exit handler.\n");
+            return STATUS_FAIL;
+        }
+        provider_exit_registered = 1;
+    }
+
+    if (size <= provider_capacity) {
+        return STATUS_OK;
+    }
+
+    new_capacity = (0 == provider_capacity) ? size : provider_capacity;
+    while (new_capacity < size) {
+        new_capacity = (INT_MAX / 2 < new_capacity) ? size : 2 * new_capacity;
+    }
+
+    new_table = realloc(MPIR_proctable, new_capacity * sizeof(MPIR_PROCDESC));
+    if (NULL == new_table) {
+        fprintf(stderr, "Unable to allocate MPIR_proctable for %d entries.\n",
+                new_capacity);
+        return STATUS_FAIL;
+    }
+    memset(&new_table[provider_capacity], 0,
+           (new_capacity - provider_capacity) * sizeof(MPIR_PROCDESC));
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE,
+                         (new_capacity - provider_capacity) * sizeof(MPIR_PROCDESC));
+    MPIR_proctable = new_table;
+    provider_capacity = new_capacity;
+
+    return STATUS_OK;
+}
+
+/**
+ * @name   publish_provider_table
+ * @brief  Describe the pushed MPIR_proctable as a single job in
+ *         MPIR_Shim_jobtable, set MPIR_debug_state and call MPIR_Breakpoint.
+ * @param  debug_state: MPIR_DEBUG_SPAWNED or MPIR_DEBUG_ABORTING
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int publish_provider_table(int debug_state)
+{
+    int i;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    pthread_mutex_lock(&provider_lock);
+
+    if (STATUS_OK != provider_api_allowed()) {
+        pthread_mutex_unlock(&provider_lock);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return STATUS_FAIL;
+    }
+
+    if (MPIR_DEBUG_SPAWNED == debug_state) {
+        for (i = 0; i < MPIR_proctable_size; i++) {
+            if (NULL == MPIR_proctable[i].host_name) {
+                fprintf(stderr, "MPIR_proctable entry %d has not been set.\n", i);
+                pthread_mutex_unlock(&provider_lock);
+                MPIR_SHIM_DEBUG_EXIT("");
+                return STATUS_FAIL;
+            }
+        }
+    }
+
+    if (NULL == MPIR_Shim_jobtable) {
+        MPIR_Shim_jobtable = calloc(1, sizeof(MPIR_SHIM_JOBDESC));
+        if (NULL == MPIR_Shim_jobtable) {
+            pthread_mutex_unlock(&provider_lock);
+            MPIR_SHIM_DEBUG_EXIT("");
+            return pmix_fatal_error(PMIX_ERR_NOMEM, "Unable to allocate MPIR_Shim_jobtable");
+        }
+        MPIR_Shim_jobtable[0].launcher_namespace = strdup("");
+        MPIR_Shim_jobtable[0].application_namespace = strdup("");
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_PROCTABLE, sizeof(MPIR_SHIM_JOBDESC));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_STRINGS, 2);
+        MPIR_Shim_jobtable_size = 1;
+    }
+    MPIR_Shim_jobtable[0].proctable_offset = 0;
+    MPIR_Shim_jobtable[0].proctable_size = MPIR_proctable_size;
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_PROCTABLE, 0, proctable_generation++, 0,
+                             MPIR_proctable_size, NULL);
+
+    debug_print("Publishing %d pushed MPIR_proctable entries, %lu distinct names\n",
+                MPIR_proctable_size, interned_count);
+
+    MPIR_debug_state = debug_state;
+
+    pthread_mutex_unlock(&provider_lock);
+
+    /*
+     * Notify the debugger.
+     */
+    journal_debug_state();
+    MPIR_Breakpoint();
+
+    MPIR_SHIM_DEBUG_EXIT("");
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_common
+ * @brief  Common top-level processing for this module, used when this module is
+ *         invoked as a shim module between the tool and the launcher, and when
+ *         this module is used as a shared library when used in a MPIR testcase.
+ * @param  mpir_mode_: Force this into proxy mode or non-proxy mode (Default: dynamic)
+ * @param  pid_: Connect to this PID in an attach mode (Default: disabled = 0)
+ * @param  debug_: Enable debugging output and tracing (Default: Disabled)
+ * @param  argc: Number of launcher and application command line arguments
+ * @param  argv: Array of launcher and application command line arguments, terminated with NULL entry.
+ * @param  pmix_prefix_: Value to set PMIX_PREFIX info key when call tool init. NULL if skip.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_common(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
+                     int argc, char *argv[], const char *pmix_prefix_)
+{
+    int rc;
+
+    num_timings = 0;
+    clock_gettime(CLOCK_MONOTONIC, &timings_origin);
+    clock_gettime(CLOCK_REALTIME, &timings_wall_origin);
+    mpir_shim_metrics_session_start();
+
+    rc = run_session(mpir_mode_, pid_, debug_, argc, argv, pmix_prefix_);
+
+    record_timing("total", -1, 0);
+    if (NULL != timings_file) {
+        (void)write_timings(rc);
+    }
+    mpir_shim_hold_report();
+    end_session_metrics(session_exit_reason(rc), rc);
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_SESSION_END, -1, rc, 0, 0,
+                             session_exit_reason(rc));
+    mpir_shim_journal_flush();
+
+    // Once finalized, a later session builds its own table
+    if (0 == pmix_initialized) {
+        free_jobs();
+    }
+    return rc;
+}
+
+/**
+ * @name   run_session
+ * @brief  The body of MPIR_Shim_common, recording the time of each phase.
+ * @param  mpir_mode_: See MPIR_Shim_common
+ * @param  pid_: See MPIR_Shim_common
+ * @param  debug_: See MPIR_Shim_common
+ * @param  argc: See MPIR_Shim_common
+ * @param  argv: See MPIR_Shim_common
+ * @param  pmix_prefix_: See MPIR_Shim_common
+ * @return 0 if successful, 1 if failed, or the launcher exit code
+ */
+int run_session(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
+                int argc, char *argv[], const char *pmix_prefix_)
+{
+    MPIR_Shim_Job *job;
+    pmix_proc_t iof_source;
+    double start;
+    int i, rc, exit_code;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    tool_binary_name = strdup("mpir");
+
+    /*
+     * Process options provided
+     */
+    if (STATUS_FAIL == process_options(mpir_mode_, pid_, debug_, argc, argv)) {
+        return STATUS_FAIL;
+    }
+    if (NULL != pmix_prefix_) {
+        pmix_prefix = (char *) pmix_prefix_;
+    }
+    debug_print("Launcher '%s', performing a %s\n", tool_binary_name,
+                (MPIR_SHIM_PROXY_MODE == mpir_mode ? "proxy run" : 
+                 (MPIR_SHIM_NONPROXY_MODE == mpir_mode ? "non-proxy run" :
+                  (MPIR_SHIM_ATTACH_MODE == mpir_mode ? "attach run" : "(unknown"))));
+
+    /*
+     * Setup the job table
+     */
+    if (STATUS_FAIL == setup_jobs(argc, argv)) {
+        return STATUS_FAIL;
+    }
+    mpir_shim_journal_session_start(mpir_mode, num_shim_jobs,
+                                    (0 < argc) ? argv[0] : NULL);
+
+    /*
+     * Setup signal handlers.
+     */
+    if (STATUS_FAIL == setup_signal_handlers()) {
+        return STATUS_FAIL;
+    }
+
+    /*
+     * Setup an atexit handler to make sure we cleanup
+     */
+    if (0 != atexit(exit_handler)) {
+        fprintf(stderr, "An error occurred setting an exit handler.\n");
+        return STATUS_FAIL;
+    }
+
+    /*
+     * Initialize ourselves as a PMIx tool.
+     */
+    start = timing_now();
+    if (STATUS_FAIL == initialize_as_tool()) {
+        return STATUS_FAIL;
+    }
+    record_timing("tool_init", -1, start);
+
+    /*
+     * Register the default event handler.
+     */
+    start = timing_now();
+    if( STATUS_OK != register_default_event_handler() ) {
+        return STATUS_FAIL;
+    }
+    record_timing("register_default_handler", -1, start);
+
+    /*
+     * Start writing the application output, if the shim handles it.
+     */
+    if (STATUS_OK != mpir_shim_iof_start(debug_active)) {
+        return STATUS_FAIL;
+    }
+
+    /*
+     * If we are using the rendezvous mechanism for connecting to the PMIx server
+     */
+    if (MPIR_SHIM_ATTACH_MODE != mpir_mode) {
+        /*
+         * Spawn the launcher processes with the application arguments.
+         * All of the launchers are started before waiting on any of them so
+         * the jobs start up concurrently.
+         */
+        mpir_shim_hold_session_start(num_shim_jobs);
+        for (i = 0; i < num_shim_jobs; i++) {
+            start = timing_now();
+            mpir_shim_hold_spawn(i, start);
+            if (STATUS_FAIL == spawn_launcher_and_application(&shim_jobs[i])) {
+                return STATUS_FAIL;
+            }
+            record_timing("spawn", i, start);
+        }
+
+        for (i = 0; i < num_shim_jobs; i++) {
+            job = &shim_jobs[i];
+
+            /*
+             * Connect to the server. It stays the primary server until the
+             * launcher is released.
+             */
+            pthread_mutex_lock(&server_lock);
+            if (MPIR_SHIM_PROXY_MODE == mpir_mode) {
+                start = timing_now();
+                if (STATUS_FAIL == connect_to_server(job)) {
+                    unlock_job_server();
+                    return STATUS_FAIL;
+                }
+                record_timing("connect", i, start);
+            }
+
+            /*
+             * Register for the "launcher has terminated" event.
+             * In a 'proxy' (prun) scenario this will tell us when everything is done
+             */
+            start = timing_now();
+            if (STATUS_FAIL == register_launcher_terminate_handler(job) ) {
+                unlock_job_server();
+                return STATUS_FAIL;
+            }
+            record_timing("register_launcher_terminate_handler", i, start);
+
+            // There's apparently a restriction, noted in the mpir-shim git log
+            // entry dated 3/29/20 that states the launch complete and launch
+            // terminate callbacks can't be registered until after this code
+            // connects to the server.
+            /*
+             * Register for the "launcher is ready for debug" event.
+             */
+            start = timing_now();
+            if (STATUS_FAIL == register_launcher_ready_handler(job) ) {
+                unlock_job_server();
+                return STATUS_FAIL;
+            }
+            record_timing("register_launcher_ready_handler", i, start);
+
+            /*
+             * Register for the "launcher has completed launching" event,
+             * before the launcher is released so the event cannot be missed.
+             */
+            start = timing_now();
+            if (STATUS_FAIL == register_launcher_complete_handler(job) ) {
+                unlock_job_server();
+                return STATUS_FAIL;
+            }
+            record_timing("register_launcher_complete_handler", i, start);
+
+            /*
+             * Register for the failure of individual application processes,
+             * so the tool hears about the first one while the others still
+             * run. A process may fail before the job is ready for debug, so
+             * this is done before the launcher is released too.
+             */
+            start = timing_now();
+            if (STATUS_FAIL == register_proc_failure_handler(job)) {
+                unlock_job_server();
+                return STATUS_FAIL;
+            }
+            record_timing("register_proc_failure_handler", i, start);
+
+            /*
+             * Take over the output of the application, if requested. The
+             * application namespace is not known yet, so the output of every
+             * process of the server is pulled. The jobs share the server
+             * outside of proxy mode, so it is pulled once then.
+             */
+            if (mpir_shim_iof_enabled() &&
+                (MPIR_SHIM_PROXY_MODE == mpir_mode || 0 == i)) {
+                start = timing_now();
+                PMIX_LOAD_PROCID(&iof_source, NULL, PMIX_RANK_WILDCARD);
+                if (STATUS_OK != mpir_shim_iof_pull(i, &iof_source)) {
+                    unlock_job_server();
+                    return STATUS_FAIL;
+                }
+                record_timing("iof_pull", i, start);
+            }
+
+            start = timing_now();
+            rc = release_procs_in_namespace(job->launcher_proc.nspace, 0);
+            unlock_job_server();
+            if (STATUS_FAIL == rc) {
+                return STATUS_FAIL;
+            }
+            record_timing("release_launcher", i, start);
+        }
+
+        /*
+         * Wait here for the launchers to declare themselves ready for debug.
+         * Nothing is held when there is no stop point, so only wait for the
+         * launch to complete.
+         */
+        for (i = 0; i < num_shim_jobs; i++) {
+            start = timing_now();
+            if (MPIR_SHIM_STOP_NONE == stop_point) {
+                debug_print("Waiting for launcher %d to complete the launch\n", i);
+                wait_for_condition(&shim_jobs[i].launch_complete_cond);
+                debug_print("Launcher %d completed the launch\n", i);
+                record_timing("launch_complete", i, start);
+                continue;
+            }
+            debug_print("Waiting for launcher %d to become ready for debug\n", i);
+            wait_for_ready_for_debug(&shim_jobs[i]);
+            debug_print("Launcher %d is ready for debug\n", i);
+            record_timing("ready_for_debug", i, start);
+        }
+
+        // At this point we have the application info in each job's
+        // 'application_proc'
+
+        /*
+         * Forward our stdin to the first application, if requested.
+         */
+        if (mpir_shim_iof_stdin_enabled() &&
+            '\0' != shim_jobs[0].application_proc.nspace[0]) {
+            if (STATUS_OK != lock_job_server(&shim_jobs[0])) {
+                return STATUS_FAIL;
+            }
+            rc = mpir_shim_iof_stdin_start(&shim_jobs[0].application_proc);
+            unlock_job_server();
+            if (STATUS_OK != rc) {
+                return STATUS_FAIL;
+            }
+        }
+
+        /*
+         * Extract the proctable and fill in the MPIR information.  If there
+         * is a debugger controlling us and it knows about MPIR, it will
+         * probably attach to the application processes.
+         */
+        if (STATUS_FAIL == pmix_proc_table_to_mpir()) {
+            return STATUS_FAIL;
+        }
+        mpir_shim_iof_hosts_ready();
+
+        for (i = 0; i < num_shim_jobs; i++) {
+            job = &shim_jobs[i];
+            if ('\0' == job->application_proc.nspace[0]) {
+                continue;
+            }
+
+            /*
+             * Register for the "application has terminated" event.
+             * In a 'proxy' (prterun) scenario this will tell us when the job is
+             * done and avoid a race between the prterun shutting down and this
+             * processes receiving the event.
+             */
+            if (MPIR_SHIM_PROXY_MODE == mpir_mode) {
+                start = timing_now();
+                if (STATUS_FAIL == lock_job_server(job)) {
+                    return STATUS_FAIL;
+                }
+                rc = register_application_terminate_handler(job);
+                unlock_job_server();
+                if (STATUS_FAIL == rc) {
+                    return STATUS_FAIL;
+                }
+                record_timing("register_application_terminate_handler", i, start);
+            }
+
+#ifndef MPIR_SHIM_TESTCASE
+            /*
+             * Also release the application processes and allow them to run.
+             * - If we are building this for the shim testcases then we skip this
+             *   and let them do it in their own time.
+             */
+            if (MPIR_SHIM_STOP_NONE == stop_point ||
+                RELEASE_MANUAL == release_policy) {
+                continue;
+            }
+            start = timing_now();
+            if (STATUS_FAIL == release_application(job)) {
+                return STATUS_FAIL;
+            }
+            record_timing("release", i, start);
+#endif
+        }
+
+        /*
+         * Wait for the launchers to terminate.
+         */
+        exit_code = PMIX_SUCCESS;
+        for (i = 0; i < num_shim_jobs; i++) {
+            start = timing_now();
+            debug_print("Waiting for launcher %d to terminate\n", i);
+            wait_for_condition(&shim_jobs[i].launch_term_cond);
+            debug_print("Launcher %d terminated\n", i);
+            record_timing("terminate", i, start);
+            if (PMIX_SUCCESS == exit_code) {
+                exit_code = job_exit_code(&shim_jobs[i]);
+            }
+        }
+
+        /*
+         * Write out the remaining application output.
+         */
+        start = timing_now();
+        mpir_shim_iof_stop();
+        record_timing("output_drain", -1, start);
+
+        /*
+         * Finalize as a PMIx tool.
+         */
+        debug_print("Finalizing as a PMIx tool\n");
+        start = timing_now();
+        finalize_session_tool();
+        record_timing("tool_finalize", -1, start);
+
+        /*
+         * If a job returned an exit code, pass the first one along,
+         * otherwise exit with 0.
+         */
+        debug_print("Exiting with status %d\n", exit_code);
+        return exit_code;
+    }
+    /*
+     * If we are connecting to a running PID
+     */
+    else {
+        /*
+         * Already connected to the launcher during initialize_as_tool()
+         */
 
-    /*
-     * If we are using the rendezvous mechanism for connecting to the PMIx server
-     */
-    if (MPIR_SHIM_ATTACH_MODE != mpir_mode) {
         /*
-         * Spawn the launcher process with the application arguments
+         * Access the application's namespace
          */
-        if (STATUS_FAIL == spawn_launcher_and_application()) {
+        start = timing_now();
+        if (STATUS_FAIL == query_application_namespace(&shim_jobs[0])) {
             return STATUS_FAIL;
         }
+        record_timing("namespace_query", 0, start);
 
         /*
-         * Connect to the server.
+         * Extract the proctable and fill in the MPIR information.  If there
+         * is a debugger controlling us and it knows about MPIR, it will
+         * probably attach to the application processes.
          */
-        if (MPIR_SHIM_PROXY_MODE == mpir_mode) {
-            if (STATUS_FAIL == connect_to_server()) {
-                return STATUS_FAIL;
+        if (STATUS_FAIL == pmix_proc_table_to_mpir()) {
+            return STATUS_FAIL;
+        }
+
+        /*
+         * Finalize as a PMIx tool.
+         */
+        debug_print("Finalizing as a PMIx tool\n");
+        start = timing_now();
+        finalize_session_tool();
+        record_timing("tool_finalize", -1, start);
+
+        return 0;
+    }
+}
+
+/**
+ * @name   MPIR_Shim_set_timings_file
+ * @brief  Write the phase timings of MPIR_Shim_common as JSON to a file.
+ * @param  path: File to write, NULL to not write one
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_timings_file(const char *path)
+{
+    char *copy = NULL;
+
+    if (NULL != path && NULL == (copy = strdup(path))) {
+        fprintf(stderr, "Unable to allocate the timings file name.\n");
+        return STATUS_FAIL;
+    }
+    free(timings_file);
+    timings_file = copy;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_get_timings
+ * @brief  Get the phase timings recorded so far by MPIR_Shim_common.
+ * @param  timings_: Set to the timings
+ * @param  num_timings_: Set to the number of timings
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_get_timings(const MPIR_Shim_timing_t **timings_, int *num_timings_)
+{
+    if (NULL == timings_ || NULL == num_timings_) {
+        return STATUS_FAIL;
+    }
+    *timings_ = timings;
+    *num_timings_ = num_timings;
+    return STATUS_OK;
+}
+
+/**
+ * @name   timing_now
+ * @brief  Get the time since MPIR_Shim_common was called.
+ * @return Milliseconds
+ */
+double timing_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - timings_origin.tv_sec) * 1e3 +
+           (now.tv_nsec - timings_origin.tv_nsec) / 1e6;
+}
+
+/**
+ * @name   record_timing
+ * @brief  Record a phase that ends now. Phases are only recorded by the
+ *         thread running MPIR_Shim_common.
+ * @param  phase: Name of the phase, a string constant
+ * @param  job_index: Index of the job, -1 for the whole session
+ * @param  start_ms: When the phase started, from timing_now
+ */
+void record_timing(const char *phase, int job_index, double start_ms)
+{
+    MPIR_Shim_timing_t *new_timings;
+    int capacity;
+
+    if (num_timings == timings_capacity) {
+        capacity = (0 == timings_capacity) ? 64 : 2 * timings_capacity;
+        new_timings = realloc(timings, capacity * sizeof(MPIR_Shim_timing_t));
+        if (NULL == new_timings) {
+            return;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS,
+                             (capacity - timings_capacity) * sizeof(MPIR_Shim_timing_t));
+        timings = new_timings;
+        timings_capacity = capacity;
+    }
+    timings[num_timings].phase = phase;
+    timings[num_timings].job_index = job_index;
+    timings[num_timings].start_ms = start_ms;
+    timings[num_timings].elapsed_ms = timing_now() - start_ms;
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_PHASE, job_index, 0, 0,
+                             (int64_t)(timings[num_timings].elapsed_ms * 1e3), phase);
+    num_timings++;
+}
+
+/**
+ * @name   write_timings
+ * @brief  Write the phase timings to the timings file as JSON.
+ * @param  status: Return code of MPIR_Shim_common
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int write_timings(int status)
+{
+    FILE *file;
+    int i;
+
+    file = fopen(timings_file, "w");
+    if (NULL == file) {
+        fprintf(stderr, "Unable to open the timings file '%s': %s.\n",
+                timings_file, strerror(errno));
+        return STATUS_FAIL;
+    }
+
+    fprintf(file, "{\n  \"version\": 1,\n  \"pmix_version\": ");
+    write_json_string(file, PMIx_Get_version());
+    fprintf(file, ",\n  \"mode\": \"%s\",\n", session_mode_name());
+    fprintf(file, "  \"launcher\": ");
+    write_json_string(file, (NULL != shim_jobs && 0 < shim_jobs[0].num_run_args) ?
+                            shim_jobs[0].run_args[0] : "");
+    fprintf(file, ",\n  \"num_jobs\": %d,\n  \"num_procs\": %d,\n",
+            num_shim_jobs, MPIR_proctable_size);
+    fprintf(file, "  \"start_time\": %ld.%06ld,\n  \"status\": %d,\n",
+            (long)timings_wall_origin.tv_sec, timings_wall_origin.tv_nsec / 1000, status);
+    fprintf(file, "  \"phases\": [");
+    for (i = 0; i < num_timings; i++) {
+        fprintf(file, "%s\n    {\"phase\": \"%s\", \"job\": %d, "
+                "\"start_ms\": %.3f, \"elapsed_ms\": %.3f}",
+                (0 == i) ? "" : ",", timings[i].phase, timings[i].job_index,
+                timings[i].start_ms, timings[i].elapsed_ms);
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    if (0 != fclose(file)) {
+        fprintf(stderr, "Unable to write the timings file '%s': %s.\n",
+                timings_file, strerror(errno));
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   write_json_string
+ * @brief  Write a string as a quoted JSON string.
+ * @param  file: File to write to
+ * @param  string: The string
+ */
+void write_json_string(FILE *file, const char *string)
+{
+    const unsigned char *c;
+
+    fputc('"', file);
+    for (c = (const unsigned char *)string; '\0' != *c; c++) {
+        if ('"' == *c || '\\' == *c) {
+            fprintf(file, "\\%c", *c);
+        }
+        else if (0x20 > *c) {
+            fprintf(file, "\\u%04x", *c);
+        }
+        else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/**
+ * @name   session_mode_name
+ * @brief  Get the name of the mode of the session.
+ * @return proxy, non-proxy, attach, or unknown before it is decided
+ */
+const char *session_mode_name(void)
+{
+    switch (mpir_mode) {
+        case MPIR_SHIM_PROXY_MODE:
+            return "proxy";
+        case MPIR_SHIM_NONPROXY_MODE:
+            return "non-proxy";
+        case MPIR_SHIM_ATTACH_MODE:
+            return "attach";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @name   job_exit_code
+ * @brief  Get the exit code of a terminated job. In proxy mode the session
+ *         ends when the application terminates, which may be before its
+ *         launcher reports an exit code. The application's exit code is used
+ *         then, so that an aborted application does not end the session
+ *         with 0.
+ * @param  job: The job
+ * @return The exit code of the launcher if it reported one, otherwise that of
+ *         the application
+ */
+int job_exit_code(MPIR_Shim_Job *job)
+{
+    int exit_code;
+
+    // The handlers set the exit codes before posting launch_term_cond
+    pthread_mutex_lock(&job->launch_term_cond.mutex);
+    if (1 == job->launcher_terminated) {
+        exit_code = job->launcher_exit_code;
+    }
+    else {
+        exit_code = job->app_exit_code;
+    }
+    pthread_mutex_unlock(&job->launch_term_cond.mutex);
+    return exit_code;
+}
+
+/**
+ * @name   session_exit_reason
+ * @brief  Get why a session that returned ended.
+ * @param  status: Return code of run_session
+ * @return proc_failure, application_exit, launcher_exit, error or success
+ */
+const char *session_exit_reason(int status)
+{
+    int i;
+
+    if (proc_failure_reported) {
+        return "proc_failure";
+    }
+    for (i = 0; i < num_shim_jobs; i++) {
+        if (PMIX_SUCCESS != shim_jobs[i].app_exit_code) {
+            return "application_exit";
+        }
+    }
+    for (i = 0; i < num_shim_jobs; i++) {
+        if (PMIX_SUCCESS != shim_jobs[i].launcher_exit_code) {
+            return "launcher_exit";
+        }
+    }
+    return (0 != status) ? "error" : "success";
+}
+
+/**
+ * @name   end_session_metrics
+ * @brief  Write the metrics of the session, if it is not already done.
+ * @param  exit_reason: Why the session ended
+ * @param  status: Exit status of the session
+ */
+void end_session_metrics(const char *exit_reason, int status)
+{
+    mpir_shim_metrics_session_end(session_mode_name(),
+                                  (NULL != shim_jobs && 0 < shim_jobs[0].num_run_args) ?
+                                  shim_jobs[0].run_args[0] : "",
+                                  exit_reason, status);
+}
+
+/**
+ * @name   MPIR_Shim_add_job
+ * @brief  Queue an additional launcher command line to run in the same session
+ *         as the one passed to MPIR_Shim_common.
+ * @param  argc: Number of launcher and application command line arguments
+ * @param  argv: Array of launcher and application command line arguments, terminated with NULL entry.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_add_job(int argc, char *argv[])
+{
+    int *new_argc;
+    char ***new_argv;
+
+    if (0 >= argc || NULL == argv || NULL == argv[0]) {
+        fprintf(stderr, "No launcher command line specified for additional job.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL != shim_jobs) {
+        fprintf(stderr, "Jobs must be added before calling MPIR_Shim_common.\n");
+        return STATUS_FAIL;
+    }
+
+    new_argc = realloc(added_job_argc, (num_added_jobs + 1) * sizeof(int));
+    if (NULL == new_argc) {
+        return STATUS_FAIL;
+    }
+    added_job_argc = new_argc;
+    new_argv = realloc(added_job_argv, (num_added_jobs + 1) * sizeof(char **));
+    if (NULL == new_argv) {
+        return STATUS_FAIL;
+    }
+    added_job_argv = new_argv;
+
+    added_job_argc[num_added_jobs] = argc;
+    added_job_argv[num_added_jobs] = argv;
+    num_added_jobs++;
+
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_get_job_view
+ * @brief  Get the slice of MPIR_proctable that belongs to one job.
+ * @param  job_index: Index of the job, in the order the jobs were specified
+ * @param  offset: Set to the index of the first MPIR_proctable entry of the job
+ * @param  size: Set to the number of MPIR_proctable entries of the job
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_get_job_view(int job_index, int *offset, int *size)
+{
+    if (NULL == offset || NULL == size || 0 > job_index || MPIR_Shim_jobtable_size <= job_index) {
+        return STATUS_FAIL;
+    }
+
+    *offset = MPIR_Shim_jobtable[job_index].proctable_offset;
+    *size = MPIR_Shim_jobtable[job_index].proctable_size;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_release_ranks
+ * @brief  Release a list of held ranks of one job.
+ * @param  job_index: Index of the job the ranks belong to
+ * @param  ranks: Array of ranks to release
+ * @param  num_ranks: Number of elements in ranks
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_ranks(int job_index, const int *ranks, int num_ranks)
+{
+    pmix_rank_t *rank_list;
+    int i, status;
+
+    // The jobs launched by MPIR_Shim_common, not those of the provider API
+    if (NULL == shim_jobs || 0 > job_index || num_shim_jobs <= job_index ||
+        0 > num_ranks) {
+        fprintf(stderr, "Invalid job %d to release.\n", job_index);
+        return STATUS_FAIL;
+    }
+    rank_list = calloc(num_ranks + 1, sizeof(pmix_rank_t));
+    if (NULL == rank_list) {
+        fprintf(stderr, "Unable to allocate the rank list.\n");
+        return STATUS_FAIL;
+    }
+    for (i = 0; i < num_ranks; i++) {
+        if (0 > ranks[i]) {
+            fprintf(stderr, "Invalid rank %d to release.\n", ranks[i]);
+            free(rank_list);
+            return STATUS_FAIL;
+        }
+        rank_list[i] = (pmix_rank_t)ranks[i];
+    }
+
+    status = release_job_ranks(&shim_jobs[job_index], rank_list, num_ranks);
+    free(rank_list);
+    return status;
+}
+
+/**
+ * @name   MPIR_Shim_release_rank_ranges
+ * @brief  Release held ranks of one job given as ranks and rank ranges.
+ * @param  job_index: Index of the job the ranks belong to
+ * @param  ranges: Rank list such as "0-15,32"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_rank_ranges(int job_index, const char *ranges)
+{
+    pmix_rank_t *rank_list = NULL;
+    size_t num_ranks = 0;
+    int status;
+
+    if (NULL == shim_jobs || 0 > job_index || num_shim_jobs <= job_index) {
+        fprintf(stderr, "Invalid job %d to release.\n", job_index);
+        return STATUS_FAIL;
+    }
+    if (STATUS_OK != parse_rank_list(ranges, &rank_list, &num_ranks)) {
+        return STATUS_FAIL;
+    }
+
+    status = release_job_ranks(&shim_jobs[job_index], rank_list, num_ranks);
+    free(rank_list);
+    return status;
+}
+
+/**
+ * @name   MPIR_Shim_release_host
+ * @brief  Release every held rank running on a host, in all jobs.
+ * @param  host_name: Host name, as listed in MPIR_proctable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_release_host(const char *host_name)
+{
+    pmix_rank_t *rank_list;
+    MPIR_Shim_Job *job;
+    size_t num_ranks;
+    int i, j, found = 0;
+
+    if (NULL == MPIR_proctable || NULL == host_name) {
+        fprintf(stderr, "No process table to release host from.\n");
+        return STATUS_FAIL;
+    }
+    rank_list = calloc(MPIR_proctable_size + 1, sizeof(pmix_rank_t));
+    if (NULL == rank_list) {
+        fprintf(stderr, "Unable to allocate the rank list.\n");
+        return STATUS_FAIL;
+    }
+
+    // One notification per job, each job has its own namespace
+    for (j = 0; j < num_shim_jobs; j++) {
+        job = &shim_jobs[j];
+        num_ranks = 0;
+        for (i = 0; i < job->proctable_size; i++) {
+            if (NULL != MPIR_proctable[job->proctable_offset + i].host_name &&
+                0 == strcmp(host_name,
+                            MPIR_proctable[job->proctable_offset + i].host_name)) {
+                rank_list[num_ranks++] = (pmix_rank_t)i;
+            }
+        }
+        if (0 == num_ranks) {
+            continue;
+        }
+        found = 1;
+        if (STATUS_OK != release_job_ranks(job, rank_list, num_ranks)) {
+            free(rank_list);
+            return STATUS_FAIL;
+        }
+    }
+    free(rank_list);
+
+    if (!found) {
+        fprintf(stderr, "No processes on host '%s'.\n", host_name);
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_release_policy
+ * @brief  Select how the held application processes are released.
+ * @param  policy: "all", "manual", "ranks:N", "nodes:N" or "rate:R"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_release_policy(const char *policy)
+{
+    release_policy_t new_policy;
+    const char *value = NULL;
+    char *endp;
+    long count = 0;
+
+    if (0 == strcmp(policy, "all")) {
+        new_policy = RELEASE_ALL;
+    }
+    else if (0 == strcmp(policy, "manual")) {
+        new_policy = RELEASE_MANUAL;
+    }
+    else if (0 == strncmp(policy, "ranks:", strlen("ranks:"))) {
+        new_policy = RELEASE_RANKS;
+        value = policy + strlen("ranks:");
+    }
+    else if (0 == strncmp(policy, "nodes:", strlen("nodes:"))) {
+        new_policy = RELEASE_NODES;
+        value = policy + strlen("nodes:");
+    }
+    else if (0 == strncmp(policy, "rate:", strlen("rate:"))) {
+        new_policy = RELEASE_RATE;
+        value = policy + strlen("rate:");
+    }
+    else {
+        fprintf(stderr, "Invalid release policy '%s'.\n", policy);
+        return STATUS_FAIL;
+    }
+
+    if (NULL != value) {
+        count = strtol(value, &endp, 10);
+        if ('\0' == *value || '\0' != *endp || 0 >= count || INT_MAX < count) {
+            fprintf(stderr, "Invalid release policy count in '%s'.\n", policy);
+            return STATUS_FAIL;
+        }
+    }
+
+    release_policy = new_policy;
+    release_count = (int)count;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_pause_application
+ * @brief  Pause every process of the application of a job.
+ * @param  job_index: Index of the job (0 for a single job)
+ * @param  elapsed_ms_: Set to the time taken, in milliseconds, if not NULL
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_pause_application(int job_index, double *elapsed_ms_)
+{
+    int rc;
+
+    pthread_mutex_lock(&server_lock);
+    if (0 > job_index || num_shim_jobs <= job_index) {
+        pthread_mutex_unlock(&server_lock);
+        fprintf(stderr, "Invalid job index %d.\n", job_index);
+        return STATUS_FAIL;
+    }
+    rc = control_application(&shim_jobs[job_index], PMIX_JOB_CTRL_PAUSE,
+                             elapsed_ms_);
+    pthread_mutex_unlock(&server_lock);
+    return rc;
+}
+
+/**
+ * @name   MPIR_Shim_resume_application
+ * @brief  Resume every process of the application of a job.
+ * @param  job_index: Index of the job (0 for a single job)
+ * @param  elapsed_ms_: Set to the time taken, in milliseconds, if not NULL
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_resume_application(int job_index, double *elapsed_ms_)
+{
+    int rc;
+
+    pthread_mutex_lock(&server_lock);
+    if (0 > job_index || num_shim_jobs <= job_index) {
+        pthread_mutex_unlock(&server_lock);
+        fprintf(stderr, "Invalid job index %d.\n", job_index);
+        return STATUS_FAIL;
+    }
+    rc = control_application(&shim_jobs[job_index], PMIX_JOB_CTRL_RESUME,
+                             elapsed_ms_);
+    pthread_mutex_unlock(&server_lock);
+    return rc;
+}
+
+/**
+ * @name   MPIR_Shim_set_job_control_signals
+ * @brief  Pause the application on SIGTSTP and resume it on SIGCONT.
+ * @param  enable: Non-zero to enable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_job_control_signals(int enable)
+{
+    job_control_signals = (0 != enable);
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_signal_forwarding
+ * @brief  Select the signals forwarded to the application processes.
+ * @param  signals: Comma separated signal names or numbers
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_signal_forwarding(const char *signals)
+{
+    static const struct {
+        const char *name;
+        int signum;
+    } signal_names[] = {
+        {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT},
+        {"ABRT", SIGABRT}, {"USR1", SIGUSR1}, {"USR2", SIGUSR2},
+        {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CONT", SIGCONT},
+        {"TSTP", SIGTSTP}, {"TTIN", SIGTTIN}, {"TTOU", SIGTTOU},
+        {"URG", SIGURG}, {"WINCH", SIGWINCH}
+    };
+    char *list, *token, *saveptr, *end;
+    sigset_t new_set;
+    int count = 0, signum;
+    long value;
+    size_t i;
+
+    if (NULL == signals) {
+        fprintf(stderr, "No signals specified for forwarding.\n");
+        return STATUS_FAIL;
+    }
+    list = strdup(signals);
+    if (NULL == list) {
+        return STATUS_FAIL;
+    }
+
+    sigemptyset(&new_set);
+    for (token = strtok_r(list, ",", &saveptr); NULL != token;
+         token = strtok_r(NULL, ",", &saveptr)) {
+        signum = 0;
+        if (isdigit((unsigned char)token[0])) {
+            errno = 0;
+            value = strtol(token, &end, 10);
+            if (0 == errno && '\0' == *end && 0 < value && NSIG > value) {
+                signum = (int)value;
+            }
+        }
+        else {
+            if (0 == strncmp(token, "SIG", 3)) {
+                token += 3;
+            }
+            for (i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+                if (0 == strcmp(token, signal_names[i].name)) {
+                    signum = signal_names[i].signum;
+                    break;
+                }
             }
         }
-
-        /*
-         * Register for the "launcher has terminated" event.
-         * In a 'proxy' (prun) scenario this will tell us when everything is done
-         */
-        if (STATUS_FAIL == register_launcher_terminate_handler() ) {
+        // SIGKILL and SIGSTOP cannot be caught, the others stop the shim itself
+        if (0 == signum || SIGKILL == signum || SIGSTOP == signum ||
+            SIGSEGV == signum || SIGBUS == signum || SIGILL == signum ||
+            SIGFPE == signum || SIGPIPE == signum || SIGCHLD == signum) {
+            fprintf(stderr, "Invalid signal to forward '%s'.\n", token);
+            free(list);
             return STATUS_FAIL;
         }
+        sigaddset(&new_set, signum);
+        count++;
+    }
+    free(list);
 
-        // There's apparently a restriction, noted in the mpir-shim git log
-        // entry dated 3/29/20 that states the launch complete and launch
-        // terminate callbacks can't be registered until after this code
-        // connects to the server.
-        /*
-         * Register for the "launcher is ready for debug" event.
-         */
-        if (STATUS_FAIL == register_launcher_ready_handler() ) {
-            return STATUS_FAIL;
-        }
+    if (0 == count) {
+        fprintf(stderr, "No signals specified for forwarding.\n");
+        return STATUS_FAIL;
+    }
+    forward_signal_set = new_set;
+    num_forward_signals = count;
+    return STATUS_OK;
+}
 
-        if (STATUS_FAIL == release_procs_in_namespace(launcher_proc.nspace, 0)) {
-            return STATUS_FAIL;
-        }
-        /*
-         * Register for the "launcher has completed launching" event.
-         */
-        if (STATUS_FAIL == register_launcher_complete_handler() ) {
-            return STATUS_FAIL;
-        }
-        /*
-         * Wait here for the launcher to declare itself ready for debug.
-         */
-        debug_print("Waiting for launcher to become ready for debug\n");
-        wait_for_condition(&ready_for_debug_cond);
-        debug_print("Launcher is ready for debug\n");
+/**
+ * @name   MPIR_Shim_set_tool_daemon
+ * @brief  Set the command line of a tool daemon to start on every node
+ *         hosting application processes.
+ * @param  argc: Number of daemon command line arguments
+ * @param  argv: Array of daemon command line arguments, terminated with NULL entry.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_tool_daemon(int argc, char *argv[])
+{
+    if (0 >= argc || NULL == argv || NULL == argv[0]) {
+        fprintf(stderr, "No tool daemon command line specified.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL != shim_jobs) {
+        fprintf(stderr, "The tool daemon must be set before calling MPIR_Shim_common.\n");
+        return STATUS_FAIL;
+    }
 
-        // At this point we have the application info in 'application_proc'
+    num_daemon_args = argc;
+    daemon_args = argv;
+    return STATUS_OK;
+}
 
-        /*
-         * Extract the proctable and fill in the MPIR information.  If there
-         * is a debugger controlling us and it knows about MPIR, it will
-         * probably attach to the application processes.
-         */
-        if (STATUS_FAIL == pmix_proc_table_to_mpir()) {
-            return STATUS_FAIL;
-        }
+/**
+ * @name   MPIR_Shim_set_stop_point
+ * @brief  Select where the application processes stop for the debugger and
+ *         which ranks are held.
+ * @param  stop_point_: Where the held processes stop
+ * @param  ranks: Rank list such as "0-15,32", or NULL to hold every rank
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_stop_point(mpir_shim_stop_point_t stop_point_, const char *ranks)
+{
+    pmix_rank_t *rank_list = NULL;
+    size_t num_ranks = 0;
 
-        /*
-         * Register for the "application has terminated" event.
-         * In a 'proxy' (prterun) scenario this will tell us when the job is
-         * done and avoid a race between the prterun shutting down and this
-         * processes receiving the event.
-         */
-        if (MPIR_SHIM_PROXY_MODE == mpir_mode) {
-            if (STATUS_FAIL == register_application_terminate_handler() ) {
-                return STATUS_FAIL;
-            }
-        }
+    if (NULL != shim_jobs) {
+        fprintf(stderr, "The stop point must be set before calling MPIR_Shim_common.\n");
+        return STATUS_FAIL;
+    }
+    if (MPIR_SHIM_STOP_NONE == stop_point_ && NULL != ranks) {
+        fprintf(stderr, "Ranks can not be held without a stop point.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL != ranks &&
+        STATUS_OK != parse_rank_list(ranks, &rank_list, &num_ranks)) {
+        return STATUS_FAIL;
+    }
 
-#ifndef MPIR_SHIM_TESTCASE
-        /*
-         * Also release the application processes and allow them to run.
-         * - If we are building this for the shim testcases then we skip this
-         *   and let them do it in their own time.
-         */
-        if (STATUS_FAIL == release_procs_in_namespace(application_proc.nspace,
-                                                      PMIX_RANK_WILDCARD)) {
-            return STATUS_FAIL;
-        }
-#endif
+    free(hold_ranks);
+    hold_ranks = rank_list;
+    num_hold_ranks = num_ranks;
+    stop_point = stop_point_;
+    return STATUS_OK;
+}
 
-        /*
-         * Wait for the launcher to terminate.
-         */
-        debug_print("Waiting for launcher to terminate\n");
-        wait_for_condition(&launch_term_cond);
-        debug_print("Launcher terminated\n");
+/**
+ * @name   MPIR_Shim_set_stdin_target
+ * @brief  Select the application processes the standard input of this
+ *         process is forwarded to.
+ * @param  targets: "none", "all", or a rank list such as "0" or "0-15,32"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_stdin_target(const char *targets)
+{
+    pmix_rank_t *rank_list = NULL;
+    size_t num_ranks = 0;
 
-        /*
-         * Finalize as a PMIx tool.
-         */
-        debug_print("Finalizing as a PMIx tool\n");
-        (void) finalize_as_tool();
+    if (NULL != shim_jobs) {
+        fprintf(stderr, "The stdin target must be set before calling MPIR_Shim_common.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL == targets || 0 == strcmp(targets, "none")) {
+        mpir_shim_iof_set_stdin(0, NULL, 0);
+        return STATUS_OK;
+    }
+    if (0 == strcmp(targets, "all")) {
+        mpir_shim_iof_set_stdin(1, NULL, 0);
+        return STATUS_OK;
+    }
+    if (STATUS_OK != parse_rank_list(targets, &rank_list, &num_ranks)) {
+        return STATUS_FAIL;
+    }
+    mpir_shim_iof_set_stdin(1, rank_list, num_ranks);
+    return STATUS_OK;
+}
 
-        /*
-         * If the launcher returned an exit code, pass it along,
-         * otherwise exit with 0.
-         */
-        debug_print("Exiting with status %d\n", launcher_exit_code);
-        return launcher_exit_code;
+/**
+ * @name   MPIR_Shim_proctable_reserve
+ * @brief  Set the number of processes published by the provider API.
+ * @param  size: Number of MPIR_proctable entries
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_reserve(int size)
+{
+    int rc;
+
+    if (0 > size) {
+        fprintf(stderr, "Invalid MPIR_proctable size %d.\n", size);
+        return STATUS_FAIL;
     }
-    /*
-     * If we are connecting to a running PID
-     */
-    else {
-        /*
-         * Already connected to the launcher during initialize_as_tool()
-         */
 
-        /*
-         * Access the application's namespace
-         */
-        if (STATUS_FAIL == query_application_namespace()) {
-            return STATUS_FAIL;
-        }
+    pthread_mutex_lock(&provider_lock);
+    rc = grow_provider_table(size);
+    if (STATUS_OK == rc && MPIR_proctable_size < size) {
+        MPIR_proctable_size = size;
+    }
+    pthread_mutex_unlock(&provider_lock);
+    return rc;
+}
 
-        /*
-         * Extract the proctable and fill in the MPIR information.  If there
-         * is a debugger controlling us and it knows about MPIR, it will
-         * probably attach to the application processes.
-         */
-        if (STATUS_FAIL == pmix_proc_table_to_mpir()) {
+/**
+ * @name   MPIR_Shim_proctable_set
+ * @brief  Set one MPIR_proctable entry, growing the table if needed.
+ * @param  index: Index of the entry, the rank of the process
+ * @param  host_name: Host the process runs on
+ * @param  executable_name: Executable of the process
+ * @param  pid: Process id of the process
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_set(int index, const char *host_name,
+                            const char *executable_name, int pid)
+{
+    return MPIR_Shim_proctable_set_range(index, 1, &host_name,
+                                         &executable_name, &pid);
+}
+
+/**
+ * @name   MPIR_Shim_proctable_set_range
+ * @brief  Set consecutive MPIR_proctable entries, growing the table if needed.
+ * @param  first: Index of the first entry
+ * @param  count: Number of entries
+ * @param  host_names: Host of each process
+ * @param  executable_names: Executable of each process
+ * @param  pids: Process id of each process
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_set_range(int first, int count,
+                                  const char * const host_names[],
+                                  const char * const executable_names[],
+                                  const int pids[])
+{
+    MPIR_PROCDESC *procdesc;
+    int i;
+
+    if (0 > first || 0 > count || INT_MAX - first < count) {
+        fprintf(stderr, "Invalid MPIR_proctable range %d+%d.\n", first, count);
+        return STATUS_FAIL;
+    }
+    if (0 < count && (NULL == host_names || NULL == executable_names || NULL == pids)) {
+        fprintf(stderr, "No MPIR_proctable entries specified.\n");
+        return STATUS_FAIL;
+    }
+    for (i = 0; i < count; i++) {
+        if (NULL == host_names[i] || NULL == executable_names[i]) {
+            fprintf(stderr, "MPIR_proctable entry %d has no host or executable name.\n",
+                    first + i);
             return STATUS_FAIL;
         }
+    }
 
-        /*
-         * Finalize as a PMIx tool.
-         */
-        debug_print("Finalizing as a PMIx tool\n");
-        (void) finalize_as_tool();
-
-        return 0;
+    pthread_mutex_lock(&provider_lock);
+    if (STATUS_OK != grow_provider_table(first + count)) {
+        pthread_mutex_unlock(&provider_lock);
+        return STATUS_FAIL;
+    }
+    for (i = 0; i < count; i++) {
+        procdesc = &MPIR_proctable[first + i];
+        procdesc->host_name = (char *)intern_string(host_names[i]);
+        procdesc->executable_name = (char *)intern_string(executable_names[i]);
+        procdesc->pid = pids[i];
     }
+    if (MPIR_proctable_size < first + count) {
+        MPIR_proctable_size = first + count;
+    }
+    pthread_mutex_unlock(&provider_lock);
+
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_proctable_publish
+ * @brief  Notify the tool that the pushed MPIR_proctable is complete.
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_publish(void)
+{
+    return publish_provider_table(MPIR_DEBUG_SPAWNED);
 }
 
+/**
+ * @name   MPIR_Shim_proctable_abort
+ * @brief  Notify the tool that the job has aborted.
+ * @param  reason: Human readable reason, reported to the tool
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_proctable_abort(const char *reason)
+{
+    pthread_mutex_lock(&provider_lock);
+    if (NULL == MPIR_debug_abort_string) {
+        MPIR_debug_abort_string = strdup(NULL != reason ? reason : "The job aborted");
+    }
+    pthread_mutex_unlock(&provider_lock);
+
+    return publish_provider_table(MPIR_DEBUG_ABORTING);
+}
 
 /*
  * Functions specific to the testing version of this library (not shipped)
@@ -2268,7 +5880,302 @@ int MPIR_Shim_common(mpir_shim_mode_t mpir_mode_, pid_t pid_, int debug_,
  */
 int MPIR_Shim_release_application(void)
 {
+    int i;
+
+    MPIR_SHIM_DEBUG_ENTER("");
+
+    for (i = 0; i < num_shim_jobs; i++) {
+        if ('\0' == shim_jobs[i].application_proc.nspace[0]) {
+            continue;
+        }
+        if (STATUS_OK != release_application(&shim_jobs[i])) {
+            return STATUS_FAIL;
+        }
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_parse_rank_list
+ * @brief  Parse a rank list as the release, hold and stdin calls do.
+ * @param  ranks: Rank list such as "0-15,32"
+ * @param  rank_list: Set to the allocated, sorted array of distinct ranks,
+ *         freed by the caller
+ * @param  num_ranks: Set to the number of elements in rank_list
+ * @return STATUS_OK if successful, STATUS_FAIL otherwise
+ */
+int MPIR_Shim_parse_rank_list(const char *ranks, uint32_t **rank_list, size_t *num_ranks)
+{
+    return parse_rank_list(ranks, rank_list, num_ranks);
+}
+#endif
+
+/*
+ * Functions specific to the preloadable version of this library. When it is
+ * injected into a launcher (mpirun, prterun) with LD_PRELOAD, the MPIR symbols
+ * are defined in the launcher process itself and filled in from inside the
+ * launcher, without mpirc, a rendezvous or a second PMIx tool connection.
+ *
+ * The launcher's own PMIx_server_init and PMIx_Notify_event calls are
+ * interposed. Once the server is up a thread waits for the launcher to
+ * announce the application (PMIX_LAUNCH_COMPLETE, or PMIX_READY_FOR_DEBUG
+ * when the processes are held), queries the process table from the
+ * launcher's server, and calls MPIR_Breakpoint.
+ *
+ * It is configured through the environment:
+ *  - MPIR_SHIM_DEBUG=1        Debugging output
+ *  - MPIR_SHIM_STOP=POINT     The stop point the launcher was itself asked to
+ *                             hold the processes at (init, exec, app or none).
+ *                             It is not passed to the launcher, it only tells
+ *                             the shim to wait for the processes to be ready
+ *                             for debug and to release them after
+ *                             MPIR_Breakpoint. Default: none
+ *  - MPIR_SHIM_RELEASE=POLICY Release policy, see MPIR_Shim_set_release_policy
+ *  - MPIR_SHIM_TRACE=CATS     Trace categories, see MPIR_Shim_set_trace
+ *  - MPIR_SHIM_TRACE_FILE=FILE Dump the trace to FILE at exit or on a crash
+ */
+#ifdef MPIR_SHIM_PRELOAD
+#include <dlfcn.h>
+#include <pmix_server.h>
+
+// The interposed calls below are the real symbols, not profiling wrappers
+#undef PMIx_Notify_event
+
+typedef pmix_status_t (*server_init_fn_t)(pmix_server_module_t *module,
+                                          pmix_info_t info[], size_t ninfo);
+typedef pmix_status_t (*notify_event_fn_t)(pmix_status_t status,
+                                           const pmix_proc_t *source,
+                                           pmix_data_range_t range,
+                                           const pmix_info_t info[], size_t ninfo,
+                                           pmix_op_cbfunc_t cbfunc, void *cbdata);
+
+static void preload_start(void);
+static void preload_launch_event(pmix_status_t status, const pmix_proc_t *source,
+                                 const pmix_info_t info[], size_t ninfo);
+static void *preload_thread_main(void *arg);
+
+static notify_event_fn_t real_notify_event = NULL;
+static int preload_active = 0;
+static int preload_held = 0;
+static char preload_nspace[PMIX_MAX_NSLEN + 1];
+static MPIR_Shim_Condition preload_launch_cond = {"preload-launch",
+                    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 1};
+
+/**
+ * @name   PMIx_server_init
+ * @brief  Interposed launcher call. Starts the MPIR support once the
+ *         launcher's PMIx server is initialized.
+ */
+pmix_status_t PMIx_server_init(pmix_server_module_t *module,
+                               pmix_info_t info[], size_t ninfo)
+{
+    server_init_fn_t real_server_init;
+    pmix_status_t rc;
+
+    // POSIX form of converting the dlsym result to a function pointer
+    *(void **)(&real_server_init) = dlsym(RTLD_NEXT, "PMIx_server_init");
+    if (NULL == real_server_init) {
+        fprintf(stderr, "MPIR shim: PMIx_server_init not found: %s\n", dlerror());
+        return PMIX_ERR_NOT_FOUND;
+    }
+
+    rc = real_server_init(module, info, ninfo);
+    if (PMIX_SUCCESS == rc) {
+        preload_start();
+    }
+    return rc;
+}
+
+/**
+ * @name   PMIx_Notify_event
+ * @brief  Interposed launcher call. Watches for the launcher announcing the
+ *         application, then passes the notification on unchanged.
+ */
+pmix_status_t PMIx_Notify_event(pmix_status_t status,
+                                const pmix_proc_t *source,
+                                pmix_data_range_t range,
+                                const pmix_info_t info[], size_t ninfo,
+                                pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    if (NULL == real_notify_event) {
+        *(void **)(&real_notify_event) = dlsym(RTLD_NEXT, "PMIx_Notify_event");
+        if (NULL == real_notify_event) {
+            fprintf(stderr, "MPIR shim: PMIx_Notify_event not found: %s\n", dlerror());
+            return PMIX_ERR_NOT_FOUND;
+        }
+    }
+
+    if (preload_active &&
+        ((PMIX_LAUNCH_COMPLETE == status && !preload_held) ||
+         (PMIX_READY_FOR_DEBUG == status && preload_held))) {
+        preload_launch_event(status, source, info, ninfo);
+    }
+
+    return real_notify_event(status, source, range, info, ninfo, cbfunc, cbdata);
+}
+
+/**
+ * @name   preload_start
+ * @brief  Read the settings from the environment and start the thread that
+ *         publishes MPIR_proctable.
+ */
+void preload_start(void)
+{
+    pthread_t thread;
+    char *value;
+
+    if (preload_active) {
+        return;
+    }
+
+    value = getenv("MPIR_SHIM_DEBUG");
+    debug_active = (NULL != value && 0 != strcmp(value, "0"));
+    value = getenv("MPIR_SHIM_TRACE");
+    if (NULL != value) {
+        (void)MPIR_Shim_set_trace(value);
+    }
+    value = getenv("MPIR_SHIM_TRACE_FILE");
+    if (NULL != value) {
+        (void)MPIR_Shim_set_trace_file(value);
+    }
+    value = getenv("MPIR_SHIM_JOURNAL");
+    if (NULL != value && '\0' != *value) {
+        (void)MPIR_Shim_set_journal(value, 0);
+    }
+
     MPIR_SHIM_DEBUG_ENTER("");
-    return release_procs_in_namespace(application_proc.nspace, PMIX_RANK_WILDCARD);
+
+    value = getenv("MPIR_SHIM_STOP");
+    if (NULL == value || 0 == strcmp(value, "none")) {
+        preload_held = 0;
+    }
+    else if (0 == strcmp(value, "init") || 0 == strcmp(value, "exec") ||
+             0 == strcmp(value, "app")) {
+        preload_held = 1;
+    }
+    else {
+        fprintf(stderr, "MPIR shim: invalid MPIR_SHIM_STOP '%s', expected init, exec,"
+                " app or none.\n", value);
+        MPIR_SHIM_DEBUG_EXIT("");
+        return;
+    }
+    value = getenv("MPIR_SHIM_RELEASE");
+    if (NULL != value && STATUS_OK != MPIR_Shim_set_release_policy(value)) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return;
+    }
+
+    // The launcher process itself is the one job of this session
+    if (STATUS_OK != setup_jobs(0, NULL)) {
+        MPIR_SHIM_DEBUG_EXIT("");
+        return;
+    }
+
+    if (0 != pthread_create(&thread, NULL, preload_thread_main, NULL)) {
+        fprintf(stderr, "MPIR shim: unable to start the MPIR thread.\n");
+        MPIR_SHIM_DEBUG_EXIT("");
+        return;
+    }
+    pthread_detach(thread);
+    preload_active = 1;
+
+    MPIR_SHIM_DEBUG_EXIT("Waiting for %s", preload_held ? "ready for debug" : "launch complete");
+}
+
+/**
+ * @name   preload_launch_event
+ * @brief  Record the namespace of the launched application and wake up the
+ *         MPIR thread. Only the first application launched is published.
+ * @param  status: The event being notified
+ * @param  source: The source for the notification
+ * @param  info: Array of pmix_info_t objects passed with the notification
+ * @param  ninfo: Number of elements in info array
+ */
+void preload_launch_event(pmix_status_t status, const pmix_proc_t *source,
+                          const pmix_info_t info[], size_t ninfo)
+{
+    char nspace[PMIX_MAX_NSLEN + 1];
+    size_t n;
+
+    MPIR_SHIM_DEBUG_ENTER("Event '%s'", PMIx_Error_string(status));
+
+    nspace[0] = '\0';
+    for (n = 0; n < ninfo; n++) {
+        if (PMIX_CHECK_KEY(&info[n], PMIX_NSPACE) && PMIX_STRING == info[n].value.type) {
+            PMIX_LOAD_NSPACE(nspace, info[n].value.data.string);
+        }
+    }
+    for (n = 0; '\0' == nspace[0] && n < ninfo; n++) {
+        if (PMIX_CHECK_KEY(&info[n], PMIX_EVENT_AFFECTED_PROC) &&
+            PMIX_PROC == info[n].value.type) {
+            PMIX_LOAD_NSPACE(nspace, info[n].value.data.proc->nspace);
+        }
+    }
+    if ('\0' == nspace[0] && NULL != source) {
+        PMIX_LOAD_NSPACE(nspace, source->nspace);
+    }
+
+    pthread_mutex_lock(&preload_launch_cond.mutex);
+    if (1 == preload_launch_cond.flag && '\0' != nspace[0]) {
+        PMIX_LOAD_NSPACE(preload_nspace, nspace);
+        preload_launch_cond.flag = 0;
+        pthread_cond_broadcast(&preload_launch_cond.condition);
+    }
+    pthread_mutex_unlock(&preload_launch_cond.mutex);
+
+    MPIR_SHIM_DEBUG_EXIT("Application namespace '%s'", nspace);
+}
+
+/**
+ * @name   preload_thread_main
+ * @brief  Wait for the application, publish its process table, notify the
+ *         debugger and release the held processes. Runs outside of the
+ *         launcher's own threads so the PMIx calls do not block them.
+ * @param  arg: Unused
+ * @return NULL
+ */
+void *preload_thread_main(void *arg)
+{
+    MPIR_Shim_Job *job = &shim_jobs[0];
+
+    (void)arg;
+
+    wait_for_condition(&preload_launch_cond);
+
+    PMIX_PROC_LOAD(&job->application_proc, preload_nspace, PMIX_RANK_WILDCARD);
+    debug_print("Publishing MPIR_proctable for '%s'\n", preload_nspace);
+
+    if (STATUS_OK != pmix_proc_table_to_mpir()) {
+        fprintf(stderr, "MPIR shim: unable to build MPIR_proctable for '%s'.\n",
+                preload_nspace);
+        return NULL;
+    }
+
+    if (preload_held && RELEASE_MANUAL != release_policy) {
+        if (STATUS_OK != release_application(job)) {
+            fprintf(stderr, "MPIR shim: unable to release '%s'.\n", preload_nspace);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @name   preload_disable_mpir
+ * @brief  Turn off the MPIR support after a fatal error, leaving the launcher
+ *         running. The tables are emptied, so a debugger that attaches finds
+ *         no processes, and MPIR_Breakpoint is no longer called.
+ */
+void preload_disable_mpir(void)
+{
+    fprintf(stderr, "MPIR shim: MPIR support is disabled, the launcher continues.\n");
+
+    pthread_mutex_lock(&proc_failure_lock);
+    mpir_disabled = 1;
+    proctable_published = 0;
+    MPIR_proctable_size = 0;
+    MPIR_Shim_jobtable_size = 0;
+    MPIR_Shim_daemon_table_size = 0;
+    MPIR_debug_state = MPIR_NULL;
+    pthread_mutex_unlock(&proc_failure_lock);
 }
 #endif
@@ -0,0 +1,745 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_hold.c
+ * @brief  Hold and release latency of the application ranks.
+ *
+ * While waiting for a job to be ready for debug, the shim polls its process
+ * table and passes the state of every rank here (see mpirshim_hold.h). A
+ * rank is forked when first seen running, and held when first seen
+ * connected to its PMIx server, or at the latest when the launcher reports
+ * the job ready for debug. It is released when the release notification
+ * covering it is delivered. The report shows the distribution of each
+ * latency, the interval between polls, which bounds how precise the forked
+ * and held times are, and the nodes whose ranks were the slowest to reach the hold
+ * point, since every rank of a large launch waits for them.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_hold.h"
+#include "mpirshim_memory.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// Number of slowest nodes reported
+#define HOLD_NUM_NODES 10
+
+// Times of a rank, -1 until known
+typedef struct hold_rank_t {
+    const char *host;
+    double forked_ms;
+    double held_ms;
+    double released_ms;
+} hold_rank_t;
+
+typedef struct hold_job_t {
+    hold_rank_t *ranks;
+    pmix_rank_t num_ranks;
+    pmix_rank_t capacity;
+    double spawn_ms;
+    double ready_ms;
+    // When the first and the last release notifications were sent
+    double release_ms;
+    double last_release_ms;
+    // Number of release notifications delivered
+    int releases;
+    // Number of process tables seen
+    int polls;
+    double last_poll_ms;
+    // Shortest and longest interval between polls, -1 until polled
+    double poll_min_ms;
+    double poll_max_ms;
+} hold_job_t;
+
+// Distribution of a latency
+typedef struct hold_stats_t {
+    size_t count;
+    double min, p50, p90, p99, max;
+} hold_stats_t;
+
+// A node, and its ranks
+typedef struct hold_node_t {
+    const char *host;
+    size_t num_ranks;
+    double reach_p50;
+    double reach_max;
+    double release_max;
+} hold_node_t;
+
+static int hold_on = 0;
+// Where the report goes, stderr if NULL
+static char *hold_file = NULL;
+static hold_job_t *hold_jobs = NULL;
+static int hold_num_jobs = 0;
+static pthread_mutex_t hold_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static hold_rank_t *hold_rank(int job_index, pmix_rank_t rank);
+static double hold_reach(const hold_job_t *job, const hold_rank_t *rank);
+static void hold_stats(double *values, size_t count, hold_stats_t *stats);
+static double hold_percentile(const double *sorted, size_t count, double fraction);
+static int hold_compare_doubles(const void *a, const void *b);
+static int hold_compare_hosts(const void *a, const void *b);
+static int hold_compare_nodes(const void *a, const void *b);
+static size_t hold_nodes(const hold_job_t *job, hold_node_t *nodes);
+static void hold_print_stats(FILE *stream, const char *name, const hold_stats_t *stats);
+static void hold_json_stats(FILE *stream, const char *name, const hold_stats_t *stats);
+
+/**
+ * @name   MPIR_Shim_set_hold_report
+ * @brief  Report how long the application ranks took to reach the hold
+ *         point, how long they were held and how long their release took,
+ *         at the end of each session.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_hold_report(const char *file)
+{
+    char *copy = NULL;
+
+    if (NULL != file && NULL == (copy = strdup(file))) {
+        fprintf(stderr, "Unable to allocate the hold report file name.\n");
+        return STATUS_FAIL;
+    }
+    free(hold_file);
+    hold_file = copy;
+    hold_on = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_hold_enabled
+ * @brief  Whether the hold report was requested.
+ * @return Non-zero if so
+ */
+int mpir_shim_hold_enabled(void)
+{
+    return hold_on;
+}
+
+/**
+ * @name   mpir_shim_hold_session_start
+ * @brief  Forget the ranks of a previous session.
+ * @param  num_jobs: Number of jobs of the session
+ */
+void mpir_shim_hold_session_start(int num_jobs)
+{
+    hold_job_t *jobs;
+    int i;
+
+    if (!hold_on) {
+        return;
+    }
+
+    jobs = calloc(num_jobs, sizeof(hold_job_t));
+    if (NULL == jobs) {
+        fprintf(stderr, "Unable to allocate the hold report, not reporting.\n");
+    }
+    for (i = 0; NULL != jobs && i < num_jobs; i++) {
+        jobs[i].spawn_ms = -1;
+        jobs[i].ready_ms = -1;
+        jobs[i].release_ms = -1;
+        jobs[i].last_release_ms = -1;
+        jobs[i].last_poll_ms = -1;
+        jobs[i].poll_min_ms = -1;
+        jobs[i].poll_max_ms = -1;
+    }
+
+    pthread_mutex_lock(&hold_lock);
+    for (i = 0; i < hold_num_jobs; i++) {
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_EVENTS,
+                             hold_jobs[i].capacity * sizeof(hold_rank_t));
+        free(hold_jobs[i].ranks);
+    }
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_EVENTS, hold_num_jobs * sizeof(hold_job_t));
+    free(hold_jobs);
+    hold_jobs = jobs;
+    hold_num_jobs = (NULL != jobs) ? num_jobs : 0;
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS, hold_num_jobs * sizeof(hold_job_t));
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_spawn
+ * @brief  Record when the launcher of a job was spawned.
+ * @param  job_index: Index of the job
+ * @param  now_ms: Current time
+ */
+void mpir_shim_hold_spawn(int job_index, double now_ms)
+{
+    pthread_mutex_lock(&hold_lock);
+    if (0 <= job_index && job_index < hold_num_jobs) {
+        hold_jobs[job_index].spawn_ms = now_ms;
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_poll
+ * @brief  Record the interval waited before polling the process table.
+ * @param  job_index: Index of the job
+ * @param  interval_ms: The interval
+ */
+void mpir_shim_hold_poll(int job_index, double interval_ms)
+{
+    hold_job_t *job;
+
+    pthread_mutex_lock(&hold_lock);
+    if (0 <= job_index && job_index < hold_num_jobs) {
+        job = &hold_jobs[job_index];
+        if (0 > job->poll_min_ms || interval_ms < job->poll_min_ms) {
+            job->poll_min_ms = interval_ms;
+        }
+        if (interval_ms > job->poll_max_ms) {
+            job->poll_max_ms = interval_ms;
+        }
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_observe
+ * @brief  Record the state of a rank as seen in the process table.
+ * @param  job_index: Index of the job
+ * @param  rank: The rank
+ * @param  host: Node of the rank, an interned name
+ * @param  state: The state of the rank
+ * @param  now_ms: When the process table was received
+ */
+void mpir_shim_hold_observe(int job_index, pmix_rank_t rank, const char *host,
+                            pmix_proc_state_t state, double now_ms)
+{
+    hold_rank_t *entry;
+
+    pthread_mutex_lock(&hold_lock);
+    entry = hold_rank(job_index, rank);
+    if (NULL != entry) {
+        if (hold_jobs[job_index].last_poll_ms != now_ms) {
+            hold_jobs[job_index].last_poll_ms = now_ms;
+            hold_jobs[job_index].polls++;
+        }
+        if (NULL != host) {
+            entry->host = host;
+        }
+        // A rank that already terminated was running before
+        if (PMIX_PROC_STATE_RUNNING <= state && 0 > entry->forked_ms) {
+            entry->forked_ms = now_ms;
+        }
+        if (PMIX_PROC_STATE_CONNECTED <= state && 0 > entry->held_ms) {
+            entry->held_ms = now_ms;
+        }
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_ready
+ * @brief  Record when the launcher reported a job ready for debug.
+ * @param  job_index: Index of the job
+ * @param  now_ms: Current time
+ */
+void mpir_shim_hold_ready(int job_index, double now_ms)
+{
+    pthread_mutex_lock(&hold_lock);
+    if (0 <= job_index && job_index < hold_num_jobs) {
+        hold_jobs[job_index].ready_ms = now_ms;
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_released
+ * @brief  Record the delivery of a release notification.
+ * @param  job_index: Index of the job
+ * @param  rank: The rank released, PMIX_RANK_WILDCARD for every rank
+ * @param  sent_ms: When the notification was sent
+ * @param  now_ms: When it was delivered
+ */
+void mpir_shim_hold_released(int job_index, pmix_rank_t rank, double sent_ms,
+                             double now_ms)
+{
+    hold_job_t *job;
+    hold_rank_t *entry;
+    pmix_rank_t r;
+
+    pthread_mutex_lock(&hold_lock);
+    if (0 > job_index || job_index >= hold_num_jobs) {
+        pthread_mutex_unlock(&hold_lock);
+        return;
+    }
+    job = &hold_jobs[job_index];
+    if (0 > job->release_ms || sent_ms < job->release_ms) {
+        job->release_ms = sent_ms;
+    }
+    // Each rank of a notification is recorded with the same sent time
+    if (sent_ms != job->last_release_ms) {
+        job->last_release_ms = sent_ms;
+        job->releases++;
+    }
+    if (PMIX_RANK_WILDCARD == rank) {
+        for (r = 0; r < job->num_ranks; r++) {
+            if (0 > job->ranks[r].released_ms) {
+                job->ranks[r].released_ms = now_ms;
+            }
+        }
+    }
+    else if (NULL != (entry = hold_rank(job_index, rank)) && 0 > entry->released_ms) {
+        entry->released_ms = now_ms;
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+/**
+ * @name   mpir_shim_hold_report
+ * @brief  Write the hold report where it was asked for, if it was.
+ */
+void mpir_shim_hold_report(void)
+{
+    FILE *stream;
+    hold_job_t *job;
+    hold_node_t *nodes;
+    hold_stats_t forked, reach, held, release;
+    double *values[4];
+    size_t counts[4], num_nodes, estimated, i;
+    double all_held, all_released, reach_ms;
+    pmix_rank_t r;
+    int j, k;
+
+    if (!hold_on) {
+        return;
+    }
+    if (NULL == hold_file) {
+        stream = stderr;
+    }
+    else if (NULL == (stream = fopen(hold_file, "w"))) {
+        fprintf(stderr, "Unable to open the hold report file '%s': %s.\n",
+                hold_file, strerror(errno));
+        return;
+    }
+
+    pthread_mutex_lock(&hold_lock);
+    if (NULL != hold_file) {
+        fprintf(stream, "{\n  \"jobs\": [");
+    }
+    for (j = 0; j < hold_num_jobs; j++) {
+        job = &hold_jobs[j];
+        for (k = 0; k < 4; k++) {
+            values[k] = malloc((job->num_ranks + 1) * sizeof(double));
+            counts[k] = 0;
+        }
+        nodes = malloc((job->num_ranks + 1) * sizeof(hold_node_t));
+        if (NULL == values[0] || NULL == values[1] || NULL == values[2] ||
+            NULL == values[3] || NULL == nodes) {
+            fprintf(stderr, "Unable to allocate the hold report of job %d.\n", j);
+            for (k = 0; k < 4; k++) {
+                free(values[k]);
+            }
+            free(nodes);
+            continue;
+        }
+
+        /*
+         * The latencies of each rank: from the spawn of the launcher until
+         * forked and until held, how long held, and from the first release
+         * notification sent until the one covering the rank was delivered.
+         */
+        estimated = 0;
+        all_held = -1;
+        all_released = -1;
+        for (r = 0; r < job->num_ranks; r++) {
+            hold_rank_t *rank = &job->ranks[r];
+            reach_ms = hold_reach(job, rank);
+            if (0 <= rank->forked_ms && 0 <= job->spawn_ms) {
+                // A rank held before it was first seen running was forked
+                // by then
+                values[0][counts[0]++] = (0 <= reach_ms &&
+                                          rank->forked_ms - job->spawn_ms > reach_ms) ?
+                                         reach_ms : rank->forked_ms - job->spawn_ms;
+            }
+            if (0 <= reach_ms) {
+                values[1][counts[1]++] = reach_ms;
+                if (reach_ms > all_held) {
+                    all_held = reach_ms;
+                }
+                if (0 > rank->held_ms) {
+                    estimated++;
+                }
+            }
+            if (0 <= rank->released_ms && 0 <= reach_ms) {
+                values[2][counts[2]++] = rank->released_ms - job->spawn_ms - reach_ms;
+            }
+            if (0 <= rank->released_ms && 0 <= job->release_ms) {
+                values[3][counts[3]++] = rank->released_ms - job->release_ms;
+                if (rank->released_ms - job->release_ms > all_released) {
+                    all_released = rank->released_ms - job->release_ms;
+                }
+            }
+        }
+        hold_stats(values[0], counts[0], &forked);
+        hold_stats(values[1], counts[1], &reach);
+        hold_stats(values[2], counts[2], &held);
+        hold_stats(values[3], counts[3], &release);
+        num_nodes = hold_nodes(job, nodes);
+
+        /*
+         * A single notification releases every rank at once, so its
+         * delivery is one latency rather than a distribution.
+         */
+        if (NULL == hold_file) {
+            fprintf(stream, "Job %d hold and release latency (%lu ranks, %d process "
+                    "tables seen", j, (unsigned long)job->num_ranks, job->polls);
+            if (job->poll_max_ms > job->poll_min_ms) {
+                fprintf(stream, " every %.0f to %.0f ms", job->poll_min_ms,
+                        job->poll_max_ms);
+            }
+            else if (0 <= job->poll_min_ms) {
+                fprintf(stream, " every %.0f ms", job->poll_min_ms);
+            }
+            fprintf(stream, ", times in ms):\n");
+            fprintf(stream, "%-18s %8s %10s %10s %10s %10s %10s\n", "", "ranks",
+                    "min", "p50", "p90", "p99", "max");
+            hold_print_stats(stream, "spawn to forked", &forked);
+            hold_print_stats(stream, "spawn to held", &reach);
+            hold_print_stats(stream, "held", &held);
+            if (1 < job->releases) {
+                hold_print_stats(stream, "release delivered", &release);
+            }
+            if (0 < estimated) {
+                fprintf(stream, "%lu ranks were not seen connected before the job was "
+                        "ready for debug, and are counted as held then.\n",
+                        (unsigned long)estimated);
+            }
+            if (0 <= all_held) {
+                fprintf(stream, "Every rank was held %.3f ms after the spawn", all_held);
+                if (1 == job->releases && 0 <= all_released) {
+                    fprintf(stream, ", and released by one notification delivered "
+                            "%.3f ms after it was sent", all_released);
+                }
+                else if (0 <= all_released) {
+                    fprintf(stream, ", and released by %d notifications %.3f ms "
+                            "after the first one", job->releases, all_released);
+                }
+                fprintf(stream, ".\n");
+            }
+            else if (1 == job->releases && 0 <= all_released) {
+                fprintf(stream, "The release notification was delivered %.3f ms after "
+                        "it was sent.\n", all_released);
+            }
+            if (0 < num_nodes) {
+                fprintf(stream, "Slowest nodes to reach the hold point:\n");
+                fprintf(stream, "  %-30s %8s %12s %12s %12s\n", "node", "ranks",
+                        "held p50", "held max", "release max");
+                for (i = 0; i < num_nodes && i < HOLD_NUM_NODES; i++) {
+                    fprintf(stream, "  %-30s %8lu %12.3f %12.3f ", nodes[i].host,
+                            (unsigned long)nodes[i].num_ranks, nodes[i].reach_p50,
+                            nodes[i].reach_max);
+                    if (0 <= nodes[i].release_max) {
+                        fprintf(stream, "%12.3f\n", nodes[i].release_max);
+                    }
+                    else {
+                        fprintf(stream, "%12s\n", "-");
+                    }
+                }
+            }
+        }
+        else {
+            fprintf(stream, "%s\n    {\"job\": %d, \"ranks\": %lu, \"polls\": %d, ",
+                    (0 == j) ? "" : ",", j, (unsigned long)job->num_ranks, job->polls);
+            if (0 <= job->poll_min_ms) {
+                fprintf(stream, "\"poll_interval_ms\": %.3f, \"max_poll_interval_ms\": "
+                        "%.3f, ", job->poll_min_ms, job->poll_max_ms);
+            }
+            else {
+                fprintf(stream, "\"poll_interval_ms\": null, \"max_poll_interval_ms\": "
+                        "null, ");
+            }
+            fprintf(stream, "\"estimated_held\": %lu, \"releases\": %d,\n",
+                    (unsigned long)estimated, job->releases);
+            hold_json_stats(stream, "spawn_to_forked_ms", &forked);
+            hold_json_stats(stream, "spawn_to_held_ms", &reach);
+            hold_json_stats(stream, "held_ms", &held);
+            if (1 == job->releases && 0 < release.count) {
+                fprintf(stream, "     \"release_delivered_ms\": %.3f,\n", release.max);
+            }
+            else {
+                hold_json_stats(stream, "release_delivered_ms", &release);
+            }
+            fprintf(stream, "     \"slowest_nodes\": [");
+            for (i = 0; i < num_nodes && i < HOLD_NUM_NODES; i++) {
+                fprintf(stream, "%s{\"host\": \"%s\", \"ranks\": %lu, "
+                        "\"held_p50_ms\": %.3f, \"held_max_ms\": %.3f, "
+                        "\"release_max_ms\": ", (0 == i) ? "" : ", ", nodes[i].host,
+                        (unsigned long)nodes[i].num_ranks, nodes[i].reach_p50,
+                        nodes[i].reach_max);
+                if (0 <= nodes[i].release_max) {
+                    fprintf(stream, "%.3f}", nodes[i].release_max);
+                }
+                else {
+                    fprintf(stream, "null}");
+                }
+            }
+            fprintf(stream, "]}");
+        }
+
+        for (k = 0; k < 4; k++) {
+            free(values[k]);
+        }
+        free(nodes);
+    }
+    pthread_mutex_unlock(&hold_lock);
+
+    if (NULL == hold_file) {
+        return;
+    }
+    fprintf(stream, "\n  ]\n}\n");
+    if (0 != fclose(stream)) {
+        fprintf(stderr, "Unable to write the hold report file '%s': %s.\n",
+                hold_file, strerror(errno));
+    }
+}
+
+/**
+ * @name   hold_rank
+ * @brief  Get the times of a rank, growing the table as needed. Called with
+ *         hold_lock held.
+ * @param  job_index: Index of the job
+ * @param  rank: The rank
+ * @return The times, NULL for an unknown job or rank, or if out of memory
+ */
+hold_rank_t *hold_rank(int job_index, pmix_rank_t rank)
+{
+    hold_job_t *job;
+    hold_rank_t *ranks;
+    pmix_rank_t capacity, r;
+
+    if (0 > job_index || job_index >= hold_num_jobs || PMIX_RANK_VALID < rank) {
+        return NULL;
+    }
+
+    job = &hold_jobs[job_index];
+    if (job->capacity <= rank) {
+        capacity = (0 == job->capacity) ? 64 : job->capacity;
+        while (capacity <= rank) {
+            capacity *= 2;
+        }
+        ranks = realloc(job->ranks, capacity * sizeof(hold_rank_t));
+        if (NULL == ranks) {
+            return NULL;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS,
+                             (capacity - job->capacity) * sizeof(hold_rank_t));
+        for (r = job->capacity; r < capacity; r++) {
+            ranks[r].host = NULL;
+            ranks[r].forked_ms = -1;
+            ranks[r].held_ms = -1;
+            ranks[r].released_ms = -1;
+        }
+        job->ranks = ranks;
+        job->capacity = capacity;
+    }
+    if (job->num_ranks <= rank) {
+        job->num_ranks = rank + 1;
+    }
+    return &job->ranks[rank];
+}
+
+/**
+ * @name   hold_reach
+ * @brief  How long a rank took from the spawn of its launcher until held.
+ * @param  job: The job of the rank
+ * @param  rank: The rank
+ * @return Milliseconds, -1 if not known
+ */
+double hold_reach(const hold_job_t *job, const hold_rank_t *rank)
+{
+    double held_ms = rank->held_ms;
+
+    // Every rank is held once the job is ready for debug
+    if (0 <= job->ready_ms && (0 > held_ms || held_ms > job->ready_ms)) {
+        held_ms = job->ready_ms;
+    }
+    if (0 > held_ms || 0 > job->spawn_ms) {
+        return -1;
+    }
+    return held_ms - job->spawn_ms;
+}
+
+/**
+ * @name   hold_stats
+ * @brief  Compute the distribution of a latency.
+ * @param  values: The latencies, sorted on return
+ * @param  count: Number of latencies
+ * @param  stats: Set to the distribution
+ */
+void hold_stats(double *values, size_t count, hold_stats_t *stats)
+{
+    memset(stats, 0, sizeof(hold_stats_t));
+    stats->count = count;
+    if (0 == count) {
+        return;
+    }
+    qsort(values, count, sizeof(double), hold_compare_doubles);
+    stats->min = values[0];
+    stats->p50 = hold_percentile(values, count, 0.50);
+    stats->p90 = hold_percentile(values, count, 0.90);
+    stats->p99 = hold_percentile(values, count, 0.99);
+    stats->max = values[count - 1];
+}
+
+/**
+ * @name   hold_percentile
+ * @brief  Nearest rank percentile of sorted values.
+ * @param  sorted: The values, sorted
+ * @param  count: Number of values, not 0
+ * @param  fraction: The percentile, between 0 and 1
+ * @return The percentile
+ */
+double hold_percentile(const double *sorted, size_t count, double fraction)
+{
+    size_t index = (size_t)(fraction * count);
+
+    if (index < fraction * count) {
+        index++;
+    }
+    return sorted[(0 < index) ? index - 1 : 0];
+}
+
+/**
+ * @name   hold_compare_doubles
+ * @brief  qsort comparison of doubles
+ */
+int hold_compare_doubles(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da < db) ? -1 : (da > db);
+}
+
+/**
+ * @name   hold_compare_hosts
+ * @brief  qsort comparison of nodes by name, the ranks of a node being
+ *         gathered first as nodes of their own
+ */
+int hold_compare_hosts(const void *a, const void *b)
+{
+    return strcmp(((const hold_node_t *)a)->host, ((const hold_node_t *)b)->host);
+}
+
+/**
+ * @name   hold_compare_nodes
+ * @brief  qsort comparison ordering the slowest node to reach the hold point
+ *         first
+ */
+int hold_compare_nodes(const void *a, const void *b)
+{
+    const hold_node_t *na = (const hold_node_t *)a;
+    const hold_node_t *nb = (const hold_node_t *)b;
+
+    if (na->reach_max != nb->reach_max) {
+        return (na->reach_max > nb->reach_max) ? -1 : 1;
+    }
+    return strcmp(na->host, nb->host);
+}
+
+/**
+ * @name   hold_nodes
+ * @brief  Gather the ranks of a job by node, slowest node first.
+ * @param  job: The job
+ * @param  nodes: Room for one node per rank, set to the nodes
+ * @return Number of nodes
+ */
+size_t hold_nodes(const hold_job_t *job, hold_node_t *nodes)
+{
+    double *reach;
+    size_t num_entries = 0, num_nodes = 0, first, i;
+    pmix_rank_t r;
+
+    // One entry per rank first, then merged by node
+    for (r = 0; r < job->num_ranks; r++) {
+        if (NULL == job->ranks[r].host || 0 > hold_reach(job, &job->ranks[r])) {
+            continue;
+        }
+        nodes[num_entries].host = job->ranks[r].host;
+        nodes[num_entries].num_ranks = 1;
+        nodes[num_entries].reach_max = hold_reach(job, &job->ranks[r]);
+        nodes[num_entries].release_max =
+            (0 <= job->ranks[r].released_ms && 0 <= job->release_ms) ?
+            job->ranks[r].released_ms - job->release_ms : -1;
+        num_entries++;
+    }
+    if (0 == num_entries) {
+        return 0;
+    }
+    reach = malloc(num_entries * sizeof(double));
+    if (NULL == reach) {
+        return 0;
+    }
+    qsort(nodes, num_entries, sizeof(hold_node_t), hold_compare_hosts);
+
+    for (first = 0; first < num_entries; first = i) {
+        nodes[num_nodes] = nodes[first];
+        reach[0] = nodes[first].reach_max;
+        for (i = first + 1; i < num_entries &&
+             0 == strcmp(nodes[i].host, nodes[first].host); i++) {
+            reach[i - first] = nodes[i].reach_max;
+            if (nodes[i].reach_max > nodes[num_nodes].reach_max) {
+                nodes[num_nodes].reach_max = nodes[i].reach_max;
+            }
+            if (nodes[i].release_max > nodes[num_nodes].release_max) {
+                nodes[num_nodes].release_max = nodes[i].release_max;
+            }
+        }
+        nodes[num_nodes].num_ranks = i - first;
+        qsort(reach, i - first, sizeof(double), hold_compare_doubles);
+        nodes[num_nodes].reach_p50 = hold_percentile(reach, i - first, 0.50);
+        num_nodes++;
+    }
+    free(reach);
+
+    qsort(nodes, num_nodes, sizeof(hold_node_t), hold_compare_nodes);
+    return num_nodes;
+}
+
+/**
+ * @name   hold_print_stats
+ * @brief  Print a line of the distribution table, if there are values.
+ */
+void hold_print_stats(FILE *stream, const char *name, const hold_stats_t *stats)
+{
+    if (0 == stats->count) {
+        return;
+    }
+    fprintf(stream, "%-18s %8lu %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+            (unsigned long)stats->count, stats->min, stats->p50, stats->p90,
+            stats->p99, stats->max);
+}
+
+/**
+ * @name   hold_json_stats
+ * @brief  Write a distribution as a JSON member, null if there are no values.
+ */
+void hold_json_stats(FILE *stream, const char *name, const hold_stats_t *stats)
+{
+    if (0 == stats->count) {
+        fprintf(stream, "     \"%s\": null,\n", name);
+        return;
+    }
+    fprintf(stream, "     \"%s\": {\"ranks\": %lu, \"min\": %.3f, \"p50\": %.3f, "
+            "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n", name,
+            (unsigned long)stats->count, stats->min, stats->p50, stats->p90,
+            stats->p99, stats->max);
+}
@@ -0,0 +1,2570 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_iof.c
+ * @brief  Output pipeline for the standard output and error of the
+ *         application processes.
+ *
+ * The output is pulled from the launcher with PMIx_IOF_pull. The PMIx
+ * callback only appends each piece of output to a large per-channel buffer,
+ * made of chunks, and wakes the writer thread. The writer takes all of the
+ * pending chunks at once and writes them with writev, gathering many pieces
+ * of output per system call. Rank and timestamp prefixes are separate
+ * iovecs, so the output itself is never copied again to insert them.
+ *
+ * With an output directory the writer hands each set of chunks to a small
+ * pool of file writer threads instead. Every file writer scans the chunks
+ * and writes the records of the files it owns, so the chunks are shared, not
+ * copied, and neither the PMIx callback nor the writer waits on the disk.
+ *
+ * Output can be rate limited per rank and in total with token buckets,
+ * checked in the PMIx callback before anything is copied. Suppressed output
+ * is dropped, or summarized by a note in the rank's standard error.
+ *
+ * In aggregation mode the writer collects complete lines for a short window
+ * in a hash table, and prints each distinct line once, prefixed with the
+ * ranges of ranks that printed it.
+ *
+ * Stdin is forwarded by a reader thread with PMIx_IOF_push. A regular file
+ * is mapped and pushed in large slices straight from the mapping; a pipe or
+ * terminal is read in large chunks, as much as is available at once.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_iof.h"
+#include "mpirshim_memory.h"
+#include "mpirshim_profile.h"
+#include "mpirshim_metrics.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef MPIRSHIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// Size of the buffer chunks. Larger pieces of output get a chunk of their own.
+#define IOF_CHUNK_SIZE (1024 * 1024)
+// Number of empty chunks kept for reuse
+#define IOF_MAX_FREE_CHUNKS 8
+// Maximum number of iovecs passed to one writev
+#define IOF_MAX_IOVECS 1024
+// Room for one formatted prefix
+#define IOF_PREFIX_SIZE 64
+// Number of file writer threads
+#define IOF_NUM_FILE_WRITERS 4
+// Maximum number of files kept open by each file writer
+#define IOF_MAX_OPEN_FILES 256
+// Buffer size of each open file
+#define IOF_FILE_BUFFER_SIZE (64 * 1024)
+// What happens to output over the rate limit
+#define IOF_LIMIT_DROP      0
+#define IOF_LIMIT_SUMMARIZE 1
+// Seconds of output at the limited rate allowed in one burst
+#define IOF_LIMIT_BURST 1.0
+// Minimum seconds between two notes about the output suppressed from a rank
+#define IOF_LIMIT_REPORT_INTERVAL 1.0
+// Longest rank range text, "4294967295-4294967295,"
+#define IOF_RANGE_SIZE 22
+// Largest piece of stdin pushed at once
+#define IOF_STDIN_CHUNK_SIZE (1024 * 1024)
+
+// Prefix bits
+#define IOF_PREFIX_RANK 0x1
+#define IOF_PREFIX_TIME 0x2
+
+// One piece of output, as received from PMIx. Stored in a chunk, followed
+// by the output itself, padded to a multiple of the header alignment.
+typedef struct iof_record_t {
+    size_t size;
+    struct timespec time;
+    pmix_rank_t rank;
+    int job_index;
+} iof_record_t;
+
+#define IOF_RECORD_SPACE(size) \
+    (sizeof(iof_record_t) + (((size) + sizeof(iof_record_t) - 1) / \
+                             sizeof(iof_record_t)) * sizeof(iof_record_t))
+
+// A buffer chunk holding consecutive records
+typedef struct iof_chunk_t {
+    struct iof_chunk_t *next;
+    size_t used;
+    size_t capacity;
+    iof_record_t data[];
+} iof_chunk_t;
+
+// Whether the last output of each rank of a job ended in the middle of a
+// line, so the next one does not get a prefix. Each thread writing output
+// has its own.
+typedef struct iof_line_state_t {
+    unsigned char *mid_line;
+    size_t size;
+} iof_line_state_t;
+
+typedef struct iof_lines_t {
+    iof_line_state_t *states;
+    int num_states;
+} iof_lines_t;
+
+// An output channel of the application processes
+typedef struct iof_channel_t {
+    const char *name;
+    int fd;
+    // Chunks waiting for the writer, filled by the PMIx callback
+    iof_chunk_t *head;
+    iof_chunk_t *tail;
+    size_t pending_bytes;
+    // Writer state
+    iof_lines_t lines;
+} iof_channel_t;
+
+#define IOF_NUM_CHANNELS 2
+
+// The chunks of all channels taken by the writer at once, shared by the
+// file writers. Freed by the last file writer done with it.
+typedef struct iof_batch_t {
+    iof_chunk_t *chunks[IOF_NUM_CHANNELS];
+    int refs;
+} iof_batch_t;
+
+// An entry in the queue of a file writer
+typedef struct iof_batch_ref_t {
+    struct iof_batch_ref_t *next;
+    iof_batch_t *batch;
+} iof_batch_ref_t;
+
+// An output file, one per rank or per node
+typedef struct iof_file_t {
+    char *name;
+    unsigned long last_use;
+#ifdef MPIRSHIM_HAVE_ZLIB
+    gzFile gz;
+#endif
+    FILE *file;
+} iof_file_t;
+
+// A file writer thread and the files it owns
+typedef struct iof_file_writer_t {
+    int index;
+    pthread_t thread;
+    pthread_cond_t cond;
+    iof_batch_ref_t *head;
+    iof_batch_ref_t *tail;
+    // Open addressing hash set of files, by name
+    iof_file_t **files;
+    size_t files_capacity;
+    size_t num_files;
+    int num_open;
+    unsigned long use_count;
+    // Statistics
+    unsigned long bytes;
+    unsigned long opens;
+    iof_lines_t lines[IOF_NUM_CHANNELS];
+} iof_file_writer_t;
+
+// Token bucket limiting an output rate. The tokens are bytes, and may go
+// negative so output larger than a burst is let through once.
+typedef struct iof_bucket_t {
+    double tokens;
+    double last;
+} iof_bucket_t;
+
+// Rate limit state of a rank
+typedef struct iof_rank_limit_t {
+    iof_bucket_t bucket;
+    // Bytes suppressed in total, and since the last note
+    unsigned long suppressed;
+    unsigned long unreported;
+    double last_report;
+} iof_rank_limit_t;
+
+// A distinct line seen in the aggregation window, and the ranks that
+// printed it
+typedef struct iof_agg_line_t {
+    struct iof_agg_line_t *next;
+    size_t hash;
+    int channel;
+    int job_index;
+    struct timespec time;
+    pmix_rank_t *ranks;
+    size_t num_ranks;
+    size_t ranks_capacity;
+    int ranks_sorted;
+    size_t size;
+    char text[];
+} iof_agg_line_t;
+
+// The start of a line of a rank, waiting for the rest of it
+typedef struct iof_agg_partial_t {
+    char *text;
+    size_t size;
+    size_t capacity;
+    struct timespec time;
+} iof_agg_partial_t;
+
+// Partial lines of the ranks of a job on a channel
+typedef struct iof_agg_job_t {
+    iof_agg_partial_t *partials;
+    pmix_rank_t num_partials;
+} iof_agg_job_t;
+
+// A job whose output is pulled. The application namespace is empty until
+// the launch completes, its output is told apart by handler_id until then.
+typedef struct iof_job_t {
+    pmix_proc_t application_proc;
+    size_t handler_id;
+    int pulled;
+    // Rate limit state, by rank
+    iof_rank_limit_t *limits;
+    pmix_rank_t num_limits;
+} iof_job_t;
+
+static int iof_enabled = 0;
+static int iof_prefix = 0;
+static int iof_debug = 0;
+
+// Rate limits in bytes per second, 0 when not limited
+static double iof_rank_rate = 0;
+static double iof_total_rate = 0;
+static int iof_limit_policy = IOF_LIMIT_DROP;
+static iof_bucket_t iof_total_bucket = {0, -1};
+static unsigned long iof_suppressed_bytes = 0;
+static unsigned long iof_suppressed_records = 0;
+
+// Aggregation window in milliseconds, 0 when not aggregating. The lines
+// and partial lines are only used by the writer thread.
+static int iof_aggregate_ms = 0;
+static iof_agg_line_t **iof_agg_table = NULL;
+static size_t iof_agg_capacity = 0;
+static size_t iof_agg_count = 0;
+static iof_agg_line_t *iof_agg_head = NULL;
+static iof_agg_line_t *iof_agg_tail = NULL;
+static struct timespec iof_agg_deadline;
+static iof_agg_job_t *iof_agg_jobs[IOF_NUM_CHANNELS];
+static int iof_agg_num_jobs[IOF_NUM_CHANNELS];
+static unsigned long iof_agg_lines_in = 0;
+static unsigned long iof_agg_lines_out = 0;
+
+// Stdin forwarding. The targets are set before the reader thread starts.
+static int iof_stdin_enabled = 0;
+static pmix_rank_t *iof_stdin_ranks = NULL;
+static size_t iof_stdin_num_ranks = 0;
+static pmix_proc_t *iof_stdin_targets = NULL;
+static size_t iof_stdin_num_targets = 0;
+static pthread_t iof_stdin_reader;
+static int iof_stdin_running = 0;
+static int iof_stdin_wake[2] = {-1, -1};
+static unsigned long iof_stdin_bytes = 0;
+static unsigned long iof_stdin_pushes = 0;
+
+// Output files, when an output directory is set
+static char *iof_output_dir = NULL;
+static int iof_output_per_node = 0;
+static int iof_output_compress = 0;
+
+static iof_channel_t iof_channels[IOF_NUM_CHANNELS] = {
+    {"stdout", STDOUT_FILENO, NULL, NULL, 0, {NULL, 0}},
+    {"stderr", STDERR_FILENO, NULL, NULL, 0, {NULL, 0}}
+};
+
+static iof_job_t *iof_jobs = NULL;
+static int iof_num_jobs = 0;
+
+static iof_chunk_t *iof_free_chunks = NULL;
+static int iof_num_free_chunks = 0;
+
+// Writer thread state, protected by iof_lock
+static pthread_mutex_t iof_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t iof_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t iof_writer;
+// Set until the writer thread is done, output is written right away then
+static int iof_running = 0;
+static int iof_stopping = 0;
+// Whether mpir_shim_rank_host can be used
+static int iof_hosts_ready = 0;
+
+// File writer threads, their queues protected by iof_file_lock
+static iof_file_writer_t iof_file_writers[IOF_NUM_FILE_WRITERS];
+static pthread_mutex_t iof_file_lock = PTHREAD_MUTEX_INITIALIZER;
+static int iof_file_writers_running = 0;
+static int iof_file_writers_stopping = 0;
+
+// Statistics, reported in debug mode
+static unsigned long iof_records = 0;
+static unsigned long iof_bytes = 0;
+static unsigned long iof_writev_calls = 0;
+
+static void iof_output_handler(size_t iofhdlr, pmix_iof_channel_t channel,
+                               pmix_proc_t *source, pmix_byte_object_t *payload,
+                               pmix_info_t info[], size_t ninfo);
+static int iof_append(iof_channel_t *ch, int job_index, pmix_rank_t rank,
+                      const void *data, size_t size);
+static int iof_grow_jobs(int job_index);
+static int iof_find_job(const pmix_proc_t *source, size_t iofhdlr);
+static int iof_limit_accept(int job_index, pmix_rank_t rank, size_t size);
+static iof_rank_limit_t *iof_rank_limit(int job_index, pmix_rank_t rank);
+static int iof_bucket_take(iof_bucket_t *bucket, double rate, size_t size, double now);
+static void iof_report_suppressed(int job_index, pmix_rank_t rank,
+                                  iof_rank_limit_t *limit, double now);
+static double iof_now(void);
+static iof_chunk_t *iof_get_chunk(size_t space);
+static void *iof_writer_main(void *arg);
+static void iof_free_chunks_list(iof_chunk_t *chunks);
+static void iof_write_chunks(iof_channel_t *ch, iof_chunk_t *chunks);
+static unsigned char *iof_line_state(iof_lines_t *lines, int job_index,
+                                     pmix_rank_t rank);
+static void iof_free_lines(iof_lines_t *lines);
+static int iof_format_prefix(char *prefix, const iof_record_t *record, int flags);
+static void iof_writev(iof_channel_t *ch, struct iovec *iov, int iovcnt);
+static void iof_agg_chunks(int channel, iof_chunk_t *chunks);
+static iof_agg_partial_t *iof_agg_partial(int channel, int job_index, pmix_rank_t rank);
+static void iof_agg_add(int channel, int job_index, pmix_rank_t rank,
+                        const struct timespec *time, const char *text, size_t size);
+static void iof_agg_flush(int force);
+static char *iof_agg_format_prefix(iof_agg_line_t *line);
+static int iof_compare_ranks(const void *a, const void *b);
+static void iof_agg_free(void);
+static void *iof_stdin_main(void *arg);
+static int iof_stdin_push(const void *data, size_t size);
+static void iof_stdin_close(void);
+static void iof_stdin_stop(void);
+static int iof_start_file_writers(void);
+static void iof_stop_file_writers(void);
+static void iof_queue_batch(iof_chunk_t *chunks[]);
+static void *iof_file_writer_main(void *arg);
+static void iof_file_write_batch(iof_file_writer_t *writer, iof_batch_t *batch);
+static iof_file_t *iof_file_get(iof_file_writer_t *writer, const char *name);
+static int iof_file_open(iof_file_writer_t *writer, iof_file_t *file);
+static void iof_file_close(iof_file_t *file);
+static void iof_file_write(iof_file_t *file, const void *data, size_t size);
+static void iof_file_flush_all(iof_file_writer_t *writer);
+
+/**
+ * @name   MPIR_Shim_set_output_prefix
+ * @brief  Select the prefix written before each line of application output,
+ *         which enables the output pipeline.
+ * @param  prefix: "none", "rank", "time" or "rank,time"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_prefix(const char *prefix)
+{
+    if (NULL == prefix) {
+        return STATUS_FAIL;
+    }
+    if (0 == strcmp(prefix, "none")) {
+        iof_prefix = 0;
+    }
+    else if (0 == strcmp(prefix, "rank")) {
+        iof_prefix = IOF_PREFIX_RANK;
+    }
+    else if (0 == strcmp(prefix, "time")) {
+        iof_prefix = IOF_PREFIX_TIME;
+    }
+    else if (0 == strcmp(prefix, "rank,time") || 0 == strcmp(prefix, "time,rank")) {
+        iof_prefix = IOF_PREFIX_RANK | IOF_PREFIX_TIME;
+    }
+    else {
+        fprintf(stderr, "Invalid output prefix '%s'.\n", prefix);
+        return STATUS_FAIL;
+    }
+    iof_enabled = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_output_dir
+ * @brief  Write the application output to files in a directory, which
+ *         enables the output pipeline.
+ * @param  dir: Directory, created if it does not exist
+ * @param  per_node: Non-zero for one file per node with rank-tagged lines,
+ *         otherwise one file per rank
+ * @param  compress: Non-zero to compress the files with gzip
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_dir(const char *dir, int per_node, int compress)
+{
+    if (NULL == dir || '\0' == dir[0]) {
+        fprintf(stderr, "No output directory specified.\n");
+        return STATUS_FAIL;
+    }
+#ifndef MPIRSHIM_HAVE_ZLIB
+    if (compress) {
+        fprintf(stderr, "Output compression is not available, zlib was not found.\n");
+        return STATUS_FAIL;
+    }
+#endif
+
+    free(iof_output_dir);
+    iof_output_dir = strdup(dir);
+    if (NULL == iof_output_dir) {
+        return STATUS_FAIL;
+    }
+    iof_output_per_node = (0 != per_node);
+    iof_output_compress = (0 != compress);
+    iof_enabled = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_output_rate_limit
+ * @brief  Limit the rate of the application output, which enables the
+ *         output pipeline.
+ * @param  rank_rate: Bytes per second allowed from each rank, 0 for no limit
+ * @param  total_rate: Bytes per second allowed from all ranks together, 0 for
+ *         no limit
+ * @param  policy: "drop" or "summarize"
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_rate_limit(double rank_rate, double total_rate,
+                                    const char *policy)
+{
+    if (0 > rank_rate || 0 > total_rate) {
+        fprintf(stderr, "Invalid output rate limit.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL == policy || 0 == strcmp(policy, "drop")) {
+        iof_limit_policy = IOF_LIMIT_DROP;
+    }
+    else if (0 == strcmp(policy, "summarize")) {
+        iof_limit_policy = IOF_LIMIT_SUMMARIZE;
+    }
+    else {
+        fprintf(stderr, "Invalid output rate limit policy '%s'.\n", policy);
+        return STATUS_FAIL;
+    }
+
+    iof_rank_rate = rank_rate;
+    iof_total_rate = total_rate;
+    iof_enabled = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_output_aggregation
+ * @brief  Print identical lines from different ranks once, with the ranges
+ *         of ranks that printed them, which enables the output pipeline.
+ * @param  window_ms: Milliseconds lines are collected before being printed,
+ *         0 to disable
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_output_aggregation(int window_ms)
+{
+    if (0 > window_ms) {
+        fprintf(stderr, "Invalid output aggregation window %d.\n", window_ms);
+        return STATUS_FAIL;
+    }
+    iof_aggregate_ms = window_ms;
+    if (0 < window_ms) {
+        iof_enabled = 1;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_iof_enabled
+ * @brief  Check whether the output pipeline was requested.
+ * @return Non-zero if enabled
+ */
+int mpir_shim_iof_enabled(void)
+{
+    return iof_enabled;
+}
+
+/**
+ * @name   mpir_shim_iof_start
+ * @brief  Start the output writer thread.
+ * @param  debug: Non-zero to print statistics when stopping
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int mpir_shim_iof_start(int debug)
+{
+    int rc;
+
+    iof_debug = debug;
+    if (!iof_enabled || iof_running) {
+        return STATUS_OK;
+    }
+
+    if (NULL != iof_output_dir) {
+        if (0 < iof_aggregate_ms) {
+            fprintf(stderr, "Output aggregation cannot be used with an output directory.\n");
+            return STATUS_FAIL;
+        }
+        if (0 != mkdir(iof_output_dir, 0755) && EEXIST != errno) {
+            fprintf(stderr, "Unable to create output directory '%s': %s.\n",
+                    iof_output_dir, strerror(errno));
+            return STATUS_FAIL;
+        }
+        if (STATUS_OK != iof_start_file_writers()) {
+            return STATUS_FAIL;
+        }
+    }
+
+    rc = pthread_create(&iof_writer, NULL, iof_writer_main, NULL);
+    if (0 != rc) {
+        fprintf(stderr, "Unable to start the output writer: %s.\n", strerror(rc));
+        iof_stop_file_writers();
+        return STATUS_FAIL;
+    }
+    pthread_mutex_lock(&iof_lock);
+    iof_running = 1;
+    pthread_mutex_unlock(&iof_lock);
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_iof_pull
+ * @brief  Register for the output of the processes of a job. Called before
+ *         the launcher is released, so no output is missed.
+ * @param  job_index: Index of the job, used in the rank prefix
+ * @param  source: Processes whose output is pulled, an empty namespace for
+ *         every process of the selected server
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int mpir_shim_iof_pull(int job_index, const pmix_proc_t *source)
+{
+    pmix_status_t rc;
+
+    if (!iof_enabled) {
+        return STATUS_OK;
+    }
+
+    pthread_mutex_lock(&iof_lock);
+    rc = iof_grow_jobs(job_index);
+    pthread_mutex_unlock(&iof_lock);
+    if (STATUS_OK != rc) {
+        return STATUS_FAIL;
+    }
+
+    /*
+     * Without a registration callback the call is blocking, and returns the
+     * handler id when it succeeds.
+     */
+    rc = PMIx_IOF_pull(source, 1, NULL, 0,
+                       PMIX_FWD_STDOUT_CHANNEL | PMIX_FWD_STDERR_CHANNEL |
+                       PMIX_FWD_STDDIAG_CHANNEL,
+                       iof_output_handler, NULL, NULL);
+    if (0 > rc) {
+        fprintf(stderr, "An error occurred pulling the output of job %d: %s.\n",
+                job_index, PMIx_Error_string(rc));
+        return STATUS_FAIL;
+    }
+
+    // The table may be moved by iof_grow_jobs in another thread
+    pthread_mutex_lock(&iof_lock);
+    iof_jobs[job_index].handler_id = (size_t)rc;
+    iof_jobs[job_index].pulled = 1;
+    pthread_mutex_unlock(&iof_lock);
+
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_iof_set_namespace
+ * @brief  Record the application namespace of a job once the launch
+ *         completes, so its output is prefixed with the job index.
+ * @param  job_index: Index of the job
+ * @param  application_proc: Application namespace, with a wildcard rank
+ */
+void mpir_shim_iof_set_namespace(int job_index, const pmix_proc_t *application_proc)
+{
+    if (!iof_enabled) {
+        return;
+    }
+
+    pthread_mutex_lock(&iof_lock);
+    if (STATUS_OK == iof_grow_jobs(job_index)) {
+        PMIX_PROC_LOAD(&iof_jobs[job_index].application_proc,
+                       application_proc->nspace, PMIX_RANK_WILDCARD);
+    }
+    pthread_mutex_unlock(&iof_lock);
+}
+
+/**
+ * @name   iof_grow_jobs
+ * @brief  Make room for a job in the output job table. Called with iof_lock
+ *         held.
+ * @param  job_index: Index of the job
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int iof_grow_jobs(int job_index)
+{
+    iof_job_t *new_jobs;
+
+    if (iof_num_jobs > job_index) {
+        return STATUS_OK;
+    }
+
+    new_jobs = realloc(iof_jobs, (job_index + 1) * sizeof(iof_job_t));
+    if (NULL == new_jobs) {
+        fprintf(stderr, "Unable to allocate output job table.\n");
+        return STATUS_FAIL;
+    }
+    memset(&new_jobs[iof_num_jobs], 0,
+           (job_index + 1 - iof_num_jobs) * sizeof(iof_job_t));
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                         (job_index + 1 - iof_num_jobs) * sizeof(iof_job_t));
+    iof_jobs = new_jobs;
+    iof_num_jobs = job_index + 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_iof_hosts_ready
+ * @brief  Tell the pipeline the process table is complete. Output bound for
+ *         per-node files is held back until then.
+ */
+void mpir_shim_iof_hosts_ready(void)
+{
+    pthread_mutex_lock(&iof_lock);
+    iof_hosts_ready = 1;
+    pthread_cond_signal(&iof_cond);
+    pthread_mutex_unlock(&iof_lock);
+}
+
+/**
+ * @name   mpir_shim_iof_stop
+ * @brief  Write out everything buffered and stop the writer thread.
+ */
+void mpir_shim_iof_stop(void)
+{
+    pmix_rank_t r;
+    int i, j;
+
+    iof_stdin_stop();
+
+    pthread_mutex_lock(&iof_lock);
+    if (!iof_running) {
+        pthread_mutex_unlock(&iof_lock);
+        return;
+    }
+    if (IOF_LIMIT_SUMMARIZE == iof_limit_policy) {
+        for (j = 0; j < iof_num_jobs; j++) {
+            for (r = 0; r < iof_jobs[j].num_limits; r++) {
+                if (0 != iof_jobs[j].limits[r].unreported) {
+                    iof_report_suppressed(j, r, &iof_jobs[j].limits[r], iof_now());
+                }
+            }
+        }
+    }
+    iof_stopping = 1;
+    pthread_cond_signal(&iof_cond);
+    pthread_mutex_unlock(&iof_lock);
+    pthread_join(iof_writer, NULL);
+    pthread_mutex_lock(&iof_lock);
+    iof_stopping = 0;
+    pthread_mutex_unlock(&iof_lock);
+    iof_stop_file_writers();
+
+    if (iof_debug) {
+        fprintf(stderr, "Output pipeline: %lu records, %lu bytes, %lu writev calls\n",
+                iof_records, iof_bytes, iof_writev_calls);
+        if (0 < iof_aggregate_ms) {
+            fprintf(stderr, "Output aggregation: %lu lines printed as %lu\n",
+                    iof_agg_lines_in, iof_agg_lines_out);
+        }
+        if (NULL != iof_output_dir) {
+            unsigned long bytes = 0, opens = 0;
+            for (i = 0; i < IOF_NUM_FILE_WRITERS; i++) {
+                bytes += iof_file_writers[i].bytes;
+                opens += iof_file_writers[i].opens;
+            }
+            fprintf(stderr, "Output files: %lu bytes, %lu file opens in '%s'\n",
+                    bytes, opens, iof_output_dir);
+        }
+    }
+
+    if (0 != iof_suppressed_bytes) {
+        fprintf(stderr, "%lu bytes of application output in %lu pieces were "
+                "suppressed by the rate limit.\n",
+                iof_suppressed_bytes, iof_suppressed_records);
+    }
+
+    for (i = 0; i < iof_num_jobs; i++) {
+        if (iof_debug && 0 != iof_suppressed_bytes) {
+            for (r = 0; r < iof_jobs[i].num_limits; r++) {
+                if (0 != iof_jobs[i].limits[r].suppressed) {
+                    fprintf(stderr, "Output rate limit: job %d rank %u: %lu bytes suppressed\n",
+                            i, r, iof_jobs[i].limits[r].suppressed);
+                }
+            }
+        }
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                             iof_jobs[i].num_limits * sizeof(iof_rank_limit_t));
+        free(iof_jobs[i].limits);
+        iof_jobs[i].limits = NULL;
+        iof_jobs[i].num_limits = 0;
+        // A later session pulls again
+        PMIX_LOAD_NSPACE(iof_jobs[i].application_proc.nspace, NULL);
+        iof_jobs[i].pulled = 0;
+    }
+
+    for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+        iof_free_lines(&iof_channels[i].lines);
+    }
+    iof_agg_free();
+    while (NULL != iof_free_chunks) {
+        iof_chunk_t *chunk = iof_free_chunks;
+        iof_free_chunks = chunk->next;
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS,
+                             sizeof(iof_chunk_t) + chunk->capacity);
+        free(chunk);
+    }
+    iof_num_free_chunks = 0;
+}
+
+/**
+ * @name   iof_output_handler
+ * @brief  PMIx callback receiving the output of an application process.
+ *         Runs in the PMIx progress thread, so it only buffers the output.
+ * @param  iofhdlr: Handler id returned by PMIx_IOF_pull
+ * @param  channel: Channel the output was written to
+ * @param  source: Process that wrote the output
+ * @param  payload: The output
+ * @param  info: Unused
+ * @param  ninfo: Unused
+ */
+void iof_output_handler(size_t iofhdlr, pmix_iof_channel_t channel,
+                        pmix_proc_t *source, pmix_byte_object_t *payload,
+                        pmix_info_t info[], size_t ninfo)
+{
+    iof_channel_t *ch;
+    pmix_rank_t rank;
+    int job_index;
+
+    (void)info;
+    (void)ninfo;
+
+    if (NULL == payload || NULL == payload->bytes || 0 == payload->size) {
+        return;
+    }
+
+    ch = (PMIX_FWD_STDOUT_CHANNEL & channel) ? &iof_channels[0] : &iof_channels[1];
+    MPIR_SHIM_METRIC_ADD((PMIX_FWD_STDOUT_CHANNEL & channel) ? MPIR_SHIM_METRIC_STDOUT_BYTES
+                                                            : MPIR_SHIM_METRIC_STDERR_BYTES,
+                         payload->size);
+
+    /*
+     * Output arriving after the writer stopped is written right away.
+     */
+    pthread_mutex_lock(&iof_lock);
+    if (!iof_running) {
+        pthread_mutex_unlock(&iof_lock);
+        iof_writev(ch, &(struct iovec){payload->bytes, payload->size}, 1);
+        return;
+    }
+    rank = (NULL != source) ? source->rank : PMIX_RANK_UNDEF;
+    job_index = iof_find_job(source, iofhdlr);
+    if ((0 == iof_rank_rate && 0 == iof_total_rate) ||
+        iof_limit_accept(job_index, rank, payload->size)) {
+        (void)iof_append(ch, job_index, rank, payload->bytes, payload->size);
+    }
+    pthread_mutex_unlock(&iof_lock);
+}
+
+/**
+ * @name   iof_append
+ * @brief  Append a record to the chunks of a channel and wake up the writer
+ *         if it was idle. Called with iof_lock held.
+ * @param  ch: Channel
+ * @param  job_index: Index of the job of the process that wrote the output
+ * @param  rank: Rank of that process
+ * @param  data: The output
+ * @param  size: Number of bytes
+ * @return STATUS_OK if successful, STATUS_FAIL if out of memory
+ */
+int iof_append(iof_channel_t *ch, int job_index, pmix_rank_t rank,
+               const void *data, size_t size)
+{
+    iof_chunk_t *chunk;
+    iof_record_t *record;
+    size_t space;
+    int was_idle;
+
+    space = IOF_RECORD_SPACE(size);
+
+    chunk = ch->tail;
+    if (NULL == chunk || chunk->capacity - chunk->used < space) {
+        chunk = iof_get_chunk(space);
+        if (NULL == chunk) {
+            return STATUS_FAIL;
+        }
+        if (NULL == ch->tail) {
+            ch->head = chunk;
+        }
+        else {
+            ch->tail->next = chunk;
+        }
+        ch->tail = chunk;
+    }
+
+    record = (iof_record_t *)((char *)chunk->data + chunk->used);
+    record->size = size;
+    record->rank = rank;
+    record->job_index = job_index;
+    if (iof_prefix & IOF_PREFIX_TIME) {
+        clock_gettime(CLOCK_REALTIME, &record->time);
+    }
+    memcpy(record + 1, data, size);
+    chunk->used += space;
+
+    was_idle = (0 == iof_channels[0].pending_bytes &&
+                0 == iof_channels[1].pending_bytes);
+    ch->pending_bytes += size;
+    iof_records++;
+    if (was_idle) {
+        pthread_cond_signal(&iof_cond);
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   iof_find_job
+ * @brief  Find the job an output record comes from, by its namespace, or by
+ *         the handler it was delivered to before the namespace is known.
+ *         Called with iof_lock held.
+ * @param  source: Process that wrote the output, may be NULL
+ * @param  iofhdlr: Handler id the output was delivered to
+ * @return Index of the job, 0 if not found
+ */
+int iof_find_job(const pmix_proc_t *source, size_t iofhdlr)
+{
+    int i;
+
+    if (NULL != source && '\0' != source->nspace[0]) {
+        for (i = 0; i < iof_num_jobs; i++) {
+            if (0 == strncmp(iof_jobs[i].application_proc.nspace, source->nspace,
+                             PMIX_MAX_NSLEN)) {
+                return i;
+            }
+        }
+    }
+    for (i = 0; i < iof_num_jobs; i++) {
+        if (iof_jobs[i].pulled && iof_jobs[i].handler_id == iofhdlr) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @name   iof_limit_accept
+ * @brief  Check output against the rate limits, and account for it. Output
+ *         over a limit is counted as suppressed, and with the summarize
+ *         policy noted in the rank's standard error at most once per
+ *         IOF_LIMIT_REPORT_INTERVAL. Called with iof_lock held.
+ * @param  job_index: Index of the job of the process that wrote the output
+ * @param  rank: Rank of that process
+ * @param  size: Number of bytes
+ * @return Non-zero if the output is within the limits
+ */
+int iof_limit_accept(int job_index, pmix_rank_t rank, size_t size)
+{
+    iof_rank_limit_t *limit;
+    double now;
+    int accept;
+
+    now = iof_now();
+    limit = iof_rank_limit(job_index, rank);
+
+    /*
+     * The per-rank limit is checked first, so a rank over its own limit
+     * does not use up the tokens the other ranks share.
+     */
+    accept = (NULL == limit || 0 == iof_rank_rate ||
+              iof_bucket_take(&limit->bucket, iof_rank_rate, 0, now));
+    accept = accept && (0 == iof_total_rate ||
+                        iof_bucket_take(&iof_total_bucket, iof_total_rate, size, now));
+    if (accept) {
+        if (NULL != limit && 0 != iof_rank_rate) {
+            limit->bucket.tokens -= size;
+        }
+        if (NULL != limit && 0 != limit->unreported) {
+            iof_report_suppressed(job_index, rank, limit, now);
+        }
+        return 1;
+    }
+
+    iof_suppressed_bytes += size;
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_SUPPRESSED_BYTES, size);
+    iof_suppressed_records++;
+    if (NULL != limit) {
+        limit->suppressed += size;
+        if (IOF_LIMIT_SUMMARIZE == iof_limit_policy) {
+            limit->unreported += size;
+            if (IOF_LIMIT_REPORT_INTERVAL <= now - limit->last_report) {
+                iof_report_suppressed(job_index, rank, limit, now);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @name   iof_rank_limit
+ * @brief  Get the rate limit state of a rank, growing the job's table as
+ *         needed. Called with iof_lock held.
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @return The state, NULL for an unknown rank or if out of memory
+ */
+iof_rank_limit_t *iof_rank_limit(int job_index, pmix_rank_t rank)
+{
+    iof_job_t *job;
+    iof_rank_limit_t *limits;
+    pmix_rank_t num_limits;
+
+    if (job_index >= iof_num_jobs || PMIX_RANK_VALID < rank) {
+        return NULL;
+    }
+
+    job = &iof_jobs[job_index];
+    if (job->num_limits <= rank) {
+        num_limits = (0 == job->num_limits) ? 64 : job->num_limits;
+        while (num_limits <= rank) {
+            num_limits *= 2;
+        }
+        limits = realloc(job->limits, num_limits * sizeof(iof_rank_limit_t));
+        if (NULL == limits) {
+            return NULL;
+        }
+        memset(&limits[job->num_limits], 0,
+               (num_limits - job->num_limits) * sizeof(iof_rank_limit_t));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (num_limits - job->num_limits) * sizeof(iof_rank_limit_t));
+        for (; job->num_limits < num_limits; job->num_limits++) {
+            limits[job->num_limits].bucket.last = -1;
+        }
+        job->limits = limits;
+    }
+    return &job->limits[rank];
+}
+
+/**
+ * @name   iof_bucket_take
+ * @brief  Refill a token bucket for the time elapsed, and take tokens from it
+ *         if it is not empty.
+ * @param  bucket: The bucket
+ * @param  rate: Tokens added per second
+ * @param  size: Tokens to take
+ * @param  now: Current time, from iof_now
+ * @return Non-zero if the bucket was not empty
+ */
+int iof_bucket_take(iof_bucket_t *bucket, double rate, size_t size, double now)
+{
+    if (0 > bucket->last) {
+        bucket->tokens = rate * IOF_LIMIT_BURST;
+    }
+    else {
+        bucket->tokens += (now - bucket->last) * rate;
+        if (bucket->tokens > rate * IOF_LIMIT_BURST) {
+            bucket->tokens = rate * IOF_LIMIT_BURST;
+        }
+    }
+    bucket->last = now;
+
+    if (0 >= bucket->tokens) {
+        return 0;
+    }
+    bucket->tokens -= size;
+    return 1;
+}
+
+/**
+ * @name   iof_report_suppressed
+ * @brief  Note the output suppressed from a rank since the last note, in
+ *         the rank's standard error. Called with iof_lock held.
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @param  limit: Rate limit state of the rank
+ * @param  now: Current time, from iof_now
+ */
+void iof_report_suppressed(int job_index, pmix_rank_t rank,
+                           iof_rank_limit_t *limit, double now)
+{
+    char note[128];
+    int len;
+
+    len = snprintf(note, sizeof(note),
+                   "[%lu bytes of output suppressed by the rate limit]\n",
+                   limit->unreported);
+    (void)iof_append(&iof_channels[1], job_index, rank, note, len);
+    limit->unreported = 0;
+    limit->last_report = now;
+}
+
+/**
+ * @name   iof_now
+ * @brief  Get a monotonic time for the rate limits.
+ * @return Seconds
+ */
+double iof_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @name   iof_get_chunk
+ * @brief  Get an empty chunk with room for at least space bytes, reusing a
+ *         free chunk when possible. Called with iof_lock held.
+ * @param  space: Bytes needed
+ * @return The chunk, NULL if out of memory
+ */
+iof_chunk_t *iof_get_chunk(size_t space)
+{
+    iof_chunk_t *chunk;
+    size_t capacity;
+
+    if (space <= IOF_CHUNK_SIZE && NULL != iof_free_chunks) {
+        chunk = iof_free_chunks;
+        iof_free_chunks = chunk->next;
+        iof_num_free_chunks--;
+    }
+    else {
+        capacity = (space > IOF_CHUNK_SIZE) ? space : IOF_CHUNK_SIZE;
+        chunk = malloc(sizeof(iof_chunk_t) + capacity);
+        if (NULL == chunk) {
+            fprintf(stderr, "Unable to allocate output buffer, output lost.\n");
+            return NULL;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS, sizeof(iof_chunk_t) + capacity);
+        chunk->capacity = capacity;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    return chunk;
+}
+
+/**
+ * @name   iof_writer_main
+ * @brief  Writer thread: take the pending chunks of every channel and write
+ *         them out, until stopped and drained.
+ * @param  arg: Unused
+ * @return NULL
+ */
+void *iof_writer_main(void *arg)
+{
+    iof_chunk_t *chunks[IOF_NUM_CHANNELS];
+    int i, pending;
+
+    (void)arg;
+
+    pthread_mutex_lock(&iof_lock);
+    for (;;) {
+        pending = 0;
+        for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+            pending |= (0 != iof_channels[i].pending_bytes);
+        }
+        if (!pending) {
+            if (iof_stopping) {
+                // Output arriving from now on is written by the handler
+                iof_running = 0;
+                break;
+            }
+            // Wait for more output, or the end of the aggregation window
+            if (NULL != iof_agg_head) {
+                if (ETIMEDOUT == pthread_cond_timedwait(&iof_cond, &iof_lock,
+                                                        &iof_agg_deadline)) {
+                    pthread_mutex_unlock(&iof_lock);
+                    iof_agg_flush(0);
+                    pthread_mutex_lock(&iof_lock);
+                }
+            }
+            else {
+                pthread_cond_wait(&iof_cond, &iof_lock);
+            }
+            continue;
+        }
+        // The node of each rank is not known before the process table
+        if (iof_output_per_node && !iof_hosts_ready && !iof_stopping) {
+            pthread_cond_wait(&iof_cond, &iof_lock);
+            continue;
+        }
+
+        for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+            chunks[i] = iof_channels[i].head;
+            iof_channels[i].head = NULL;
+            iof_channels[i].tail = NULL;
+            iof_channels[i].pending_bytes = 0;
+        }
+        pthread_mutex_unlock(&iof_lock);
+
+        /*
+         * The file writers free the chunks once they are done with them.
+         */
+        if (iof_file_writers_running) {
+            iof_queue_batch(chunks);
+            pthread_mutex_lock(&iof_lock);
+            continue;
+        }
+
+        for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+            if (0 < iof_aggregate_ms) {
+                iof_agg_chunks(i, chunks[i]);
+            }
+            else {
+                iof_write_chunks(&iof_channels[i], chunks[i]);
+            }
+        }
+        if (0 < iof_aggregate_ms) {
+            iof_agg_flush(0);
+        }
+
+        pthread_mutex_lock(&iof_lock);
+        for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+            iof_free_chunks_list(chunks[i]);
+        }
+    }
+    pthread_mutex_unlock(&iof_lock);
+
+    if (0 < iof_aggregate_ms) {
+        iof_agg_flush(1);
+    }
+
+    return NULL;
+}
+
+/**
+ * @name   iof_free_chunks_list
+ * @brief  Free a list of chunks, keeping a few for reuse. Called with
+ *         iof_lock held.
+ * @param  chunks: List of chunks
+ */
+void iof_free_chunks_list(iof_chunk_t *chunks)
+{
+    iof_chunk_t *chunk;
+
+    while (NULL != chunks) {
+        chunk = chunks;
+        chunks = chunk->next;
+        if (IOF_CHUNK_SIZE == chunk->capacity &&
+            IOF_MAX_FREE_CHUNKS > iof_num_free_chunks) {
+            chunk->next = iof_free_chunks;
+            iof_free_chunks = chunk;
+            iof_num_free_chunks++;
+        }
+        else {
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS,
+                                 sizeof(iof_chunk_t) + chunk->capacity);
+            free(chunk);
+        }
+    }
+}
+
+/**
+ * @name   iof_write_chunks
+ * @brief  Write out the records of a list of chunks, gathering up to
+ *         IOF_MAX_IOVECS pieces per writev. With a prefix, each line of
+ *         output is one iovec, preceded by the iovec of its prefix.
+ * @param  ch: Channel to write to
+ * @param  chunks: List of chunks
+ */
+void iof_write_chunks(iof_channel_t *ch, iof_chunk_t *chunks)
+{
+    static char prefixes[IOF_MAX_IOVECS / 2][IOF_PREFIX_SIZE];
+    struct iovec iov[IOF_MAX_IOVECS];
+    iof_chunk_t *chunk;
+    iof_record_t *record;
+    unsigned char *mid_line;
+    char *line, *end, *newline;
+    size_t offset;
+    int iovcnt = 0, num_prefixes = 0;
+
+    for (chunk = chunks; NULL != chunk; chunk = chunk->next) {
+        for (offset = 0; offset < chunk->used; offset += IOF_RECORD_SPACE(record->size)) {
+            record = (iof_record_t *)((char *)chunk->data + offset);
+            line = (char *)(record + 1);
+            end = line + record->size;
+
+            if (0 == iof_prefix) {
+                if (IOF_MAX_IOVECS == iovcnt) {
+                    iof_writev(ch, iov, iovcnt);
+                    iovcnt = 0;
+                }
+                iov[iovcnt].iov_base = line;
+                iov[iovcnt].iov_len = record->size;
+                iovcnt++;
+                continue;
+            }
+
+            mid_line = iof_line_state(&ch->lines, record->job_index, record->rank);
+            while (line < end) {
+                newline = memchr(line, '\n', end - line);
+                newline = (NULL == newline) ? end : newline + 1;
+
+                if (IOF_MAX_IOVECS - 1 <= iovcnt) {
+                    iof_writev(ch, iov, iovcnt);
+                    iovcnt = 0;
+                    num_prefixes = 0;
+                }
+                if (NULL == mid_line || !*mid_line) {
+                    iov[iovcnt].iov_base = prefixes[num_prefixes];
+                    iov[iovcnt].iov_len = iof_format_prefix(prefixes[num_prefixes],
+                                                            record, iof_prefix);
+                    iovcnt++;
+                    num_prefixes++;
+                }
+                iov[iovcnt].iov_base = line;
+                iov[iovcnt].iov_len = newline - line;
+                iovcnt++;
+
+                if (NULL != mid_line) {
+                    *mid_line = ('\n' != newline[-1]);
+                }
+                line = newline;
+            }
+        }
+    }
+
+    if (0 < iovcnt) {
+        iof_writev(ch, iov, iovcnt);
+    }
+}
+
+/**
+ * @name   iof_line_state
+ * @brief  Get the mid-line flag of a rank of a job, growing the flags as
+ *         needed.
+ * @param  lines: Mid-line flags of the calling thread for one channel
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @return Pointer to the flag, NULL if it cannot be allocated
+ */
+unsigned char *iof_line_state(iof_lines_t *lines, int job_index, pmix_rank_t rank)
+{
+    iof_line_state_t *states, *state;
+    unsigned char *mid_line;
+    size_t size;
+
+    if (0 > job_index || PMIX_RANK_VALID < rank) {
+        return NULL;
+    }
+
+    if (lines->num_states <= job_index) {
+        states = realloc(lines->states, (job_index + 1) * sizeof(iof_line_state_t));
+        if (NULL == states) {
+            return NULL;
+        }
+        memset(&states[lines->num_states], 0,
+               (job_index + 1 - lines->num_states) * sizeof(iof_line_state_t));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (job_index + 1 - lines->num_states) * sizeof(iof_line_state_t));
+        lines->states = states;
+        lines->num_states = job_index + 1;
+    }
+
+    state = &lines->states[job_index];
+    if (state->size <= rank) {
+        size = (0 == state->size) ? 1024 : state->size;
+        while (size <= rank) {
+            size *= 2;
+        }
+        mid_line = realloc(state->mid_line, size);
+        if (NULL == mid_line) {
+            return NULL;
+        }
+        memset(&mid_line[state->size], 0, size - state->size);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES, size - state->size);
+        state->mid_line = mid_line;
+        state->size = size;
+    }
+    return &state->mid_line[rank];
+}
+
+/**
+ * @name   iof_free_lines
+ * @brief  Free the mid-line flags of one thread and channel.
+ * @param  lines: The flags
+ */
+void iof_free_lines(iof_lines_t *lines)
+{
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                         lines->num_states * sizeof(iof_line_state_t));
+    while (0 < lines->num_states) {
+        lines->num_states--;
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                             lines->states[lines->num_states].size);
+        free(lines->states[lines->num_states].mid_line);
+    }
+    free(lines->states);
+    lines->states = NULL;
+}
+
+/**
+ * @name   iof_format_prefix
+ * @brief  Format the prefix of a line of output.
+ * @param  prefix: Buffer of IOF_PREFIX_SIZE bytes
+ * @param  record: Record the line belongs to
+ * @param  flags: IOF_PREFIX_* bits
+ * @return Length of the prefix
+ */
+int iof_format_prefix(char *prefix, const iof_record_t *record, int flags)
+{
+    struct tm tm;
+    int len = 0;
+
+    if (flags & IOF_PREFIX_TIME) {
+        localtime_r(&record->time.tv_sec, &tm);
+        len += (int)strftime(prefix, IOF_PREFIX_SIZE, "%H:%M:%S", &tm);
+        len += snprintf(prefix + len, IOF_PREFIX_SIZE - len, ".%06ld ",
+                        record->time.tv_nsec / 1000);
+    }
+    if (flags & IOF_PREFIX_RANK) {
+        if (1 < iof_num_jobs) {
+            len += snprintf(prefix + len, IOF_PREFIX_SIZE - len, "[%d,%u] ",
+                            record->job_index, record->rank);
+        }
+        else {
+            len += snprintf(prefix + len, IOF_PREFIX_SIZE - len, "[%u] ",
+                            record->rank);
+        }
+    }
+    return (IOF_PREFIX_SIZE <= len) ? IOF_PREFIX_SIZE - 1 : len;
+}
+
+/**
+ * @name   iof_writev
+ * @brief  Write a set of iovecs completely, resuming after short writes.
+ * @param  ch: Channel to write to
+ * @param  iov: The iovecs, modified
+ * @param  iovcnt: Number of iovecs
+ */
+void iof_writev(iof_channel_t *ch, struct iovec *iov, int iovcnt)
+{
+    ssize_t n;
+
+    while (0 < iovcnt) {
+        n = writev(ch->fd, iov, iovcnt);
+        if (0 > n) {
+            if (EINTR == errno || EAGAIN == errno) {
+                continue;
+            }
+            return;
+        }
+        iof_writev_calls++;
+        iof_bytes += n;
+        while (0 < iovcnt && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (0 < iovcnt) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/**
+ * @name   iof_start_file_writers
+ * @brief  Start the file writer threads.
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int iof_start_file_writers(void)
+{
+    iof_file_writer_t *writer;
+    int i, j, rc;
+
+    for (i = 0; i < IOF_NUM_FILE_WRITERS; i++) {
+        writer = &iof_file_writers[i];
+        memset(writer, 0, sizeof(*writer));
+        writer->index = i;
+        pthread_cond_init(&writer->cond, NULL);
+        rc = pthread_create(&writer->thread, NULL, iof_file_writer_main, writer);
+        if (0 != rc) {
+            fprintf(stderr, "Unable to start the output file writers: %s.\n",
+                    strerror(rc));
+            pthread_mutex_lock(&iof_file_lock);
+            iof_file_writers_stopping = 1;
+            for (j = 0; j < i; j++) {
+                pthread_cond_signal(&iof_file_writers[j].cond);
+            }
+            pthread_mutex_unlock(&iof_file_lock);
+            for (j = 0; j < i; j++) {
+                pthread_join(iof_file_writers[j].thread, NULL);
+            }
+            iof_file_writers_stopping = 0;
+            return STATUS_FAIL;
+        }
+    }
+    iof_file_writers_running = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   iof_stop_file_writers
+ * @brief  Let the file writers finish their queued output, close the files
+ *         and stop.
+ */
+void iof_stop_file_writers(void)
+{
+    int i;
+
+    if (!iof_file_writers_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&iof_file_lock);
+    iof_file_writers_stopping = 1;
+    for (i = 0; i < IOF_NUM_FILE_WRITERS; i++) {
+        pthread_cond_signal(&iof_file_writers[i].cond);
+    }
+    pthread_mutex_unlock(&iof_file_lock);
+
+    for (i = 0; i < IOF_NUM_FILE_WRITERS; i++) {
+        pthread_join(iof_file_writers[i].thread, NULL);
+    }
+    iof_file_writers_running = 0;
+}
+
+/**
+ * @name   iof_queue_batch
+ * @brief  Hand the chunks taken by the writer to every file writer.
+ * @param  chunks: The chunks of each channel
+ */
+void iof_queue_batch(iof_chunk_t *chunks[])
+{
+    iof_batch_t *batch;
+    iof_batch_ref_t *refs;
+    iof_file_writer_t *writer;
+    int i;
+
+    batch = malloc(sizeof(iof_batch_t));
+    refs = malloc(IOF_NUM_FILE_WRITERS * sizeof(iof_batch_ref_t));
+    if (NULL == batch || NULL == refs) {
+        fprintf(stderr, "Unable to queue output for the file writers, output lost.\n");
+        free(batch);
+        free(refs);
+        pthread_mutex_lock(&iof_lock);
+        for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+            iof_free_chunks_list(chunks[i]);
+        }
+        pthread_mutex_unlock(&iof_lock);
+        return;
+    }
+    for (i = 0; i < IOF_NUM_CHANNELS; i++) {
+        batch->chunks[i] = chunks[i];
+    }
+    batch->refs = IOF_NUM_FILE_WRITERS;
+
+    pthread_mutex_lock(&iof_file_lock);
+    for (i = 0; i < IOF_NUM_FILE_WRITERS; i++) {
+        writer = &iof_file_writers[i];
+        refs[i].batch = batch;
+        refs[i].next = NULL;
+        if (NULL == writer->tail) {
+            writer->head = &refs[i];
+        }
+        else {
+            writer->tail->next = &refs[i];
+        }
+        writer->tail = &refs[i];
+        pthread_cond_signal(&writer->cond);
+    }
+    pthread_mutex_unlock(&iof_file_lock);
+}
+
+/**
+ * @name   iof_file_writer_main
+ * @brief  File writer thread: write the records of the files it owns from
+ *         each queued batch, until stopped and drained.
+ * @param  arg: The iof_file_writer_t of this thread
+ * @return NULL
+ */
+void *iof_file_writer_main(void *arg)
+{
+    iof_file_writer_t *writer = (iof_file_writer_t *)arg;
+    iof_batch_ref_t *ref;
+    iof_batch_t *batch;
+    size_t i;
+    int c, last;
+
+    pthread_mutex_lock(&iof_file_lock);
+    for (;;) {
+        if (NULL == writer->head) {
+            if (iof_file_writers_stopping) {
+                break;
+            }
+            // Nothing left to write for now, make the files current
+            pthread_mutex_unlock(&iof_file_lock);
+            iof_file_flush_all(writer);
+            pthread_mutex_lock(&iof_file_lock);
+            if (NULL == writer->head && !iof_file_writers_stopping) {
+                pthread_cond_wait(&writer->cond, &iof_file_lock);
+            }
+            continue;
+        }
+
+        ref = writer->head;
+        writer->head = ref->next;
+        if (NULL == writer->head) {
+            writer->tail = NULL;
+        }
+        batch = ref->batch;
+        pthread_mutex_unlock(&iof_file_lock);
+
+        iof_file_write_batch(writer, batch);
+
+        pthread_mutex_lock(&iof_file_lock);
+        last = (0 == --batch->refs);
+        pthread_mutex_unlock(&iof_file_lock);
+        if (last) {
+            pthread_mutex_lock(&iof_lock);
+            for (c = 0; c < IOF_NUM_CHANNELS; c++) {
+                iof_free_chunks_list(batch->chunks[c]);
+            }
+            pthread_mutex_unlock(&iof_lock);
+            // The references of a batch were allocated as one array, indexed
+            // by file writer
+            free(ref - writer->index);
+            free(batch);
+        }
+        pthread_mutex_lock(&iof_file_lock);
+    }
+    pthread_mutex_unlock(&iof_file_lock);
+
+    for (i = 0; i < writer->files_capacity; i++) {
+        if (NULL != writer->files[i]) {
+            iof_file_close(writer->files[i]);
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES, sizeof(iof_file_t) +
+                                 strlen(writer->files[i]->name) + 1);
+            free(writer->files[i]->name);
+            free(writer->files[i]);
+        }
+    }
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                         writer->files_capacity * sizeof(iof_file_t *));
+    free(writer->files);
+    writer->files = NULL;
+    for (c = 0; c < IOF_NUM_CHANNELS; c++) {
+        iof_free_lines(&writer->lines[c]);
+    }
+    return NULL;
+}
+
+/**
+ * @name   iof_file_write_batch
+ * @brief  Write the records of a batch that belong to the files of a file
+ *         writer. A rank's file is chosen by its rank, a node's file by the
+ *         host name hash, so each file has a single writer.
+ * @param  writer: The file writer
+ * @param  batch: The batch
+ */
+void iof_file_write_batch(iof_file_writer_t *writer, iof_batch_t *batch)
+{
+    char name[PATH_MAX], prefix[IOF_PREFIX_SIZE];
+    iof_chunk_t *chunk;
+    iof_record_t *record;
+    iof_file_t *file;
+    unsigned char *mid_line;
+    const char *host, *suffix, *c;
+    char *line, *end, *newline;
+    size_t offset, hash;
+    int ch, flags;
+
+    // One file per node holds several ranks, so its lines are always tagged
+    flags = iof_prefix | (iof_output_per_node ? IOF_PREFIX_RANK : 0);
+
+    for (ch = 0; ch < IOF_NUM_CHANNELS; ch++) {
+        // Standard error goes to its own files, as it does to the terminal
+        suffix = (STDERR_FILENO == iof_channels[ch].fd) ? ".err" : "";
+        for (chunk = batch->chunks[ch]; NULL != chunk; chunk = chunk->next) {
+            for (offset = 0; offset < chunk->used; offset += IOF_RECORD_SPACE(record->size)) {
+                record = (iof_record_t *)((char *)chunk->data + offset);
+
+                if (iof_output_per_node) {
+                    host = mpir_shim_rank_host(record->job_index, record->rank);
+                    if (NULL == host) {
+                        host = "unknown";
+                    }
+                    hash = 2166136261u;
+                    for (c = host; '\0' != *c; c++) {
+                        hash = (hash ^ (unsigned char)*c) * 16777619u;
+                    }
+                    if ((int)(hash % IOF_NUM_FILE_WRITERS) != writer->index) {
+                        continue;
+                    }
+                    snprintf(name, sizeof(name), "%s/%s%s", iof_output_dir, host,
+                             suffix);
+                }
+                else {
+                    if ((int)(record->rank % IOF_NUM_FILE_WRITERS) != writer->index) {
+                        continue;
+                    }
+                    if (1 < iof_num_jobs) {
+                        snprintf(name, sizeof(name), "%s/job.%d.rank.%u%s",
+                                 iof_output_dir, record->job_index, record->rank,
+                                 suffix);
+                    }
+                    else {
+                        snprintf(name, sizeof(name), "%s/rank.%u%s",
+                                 iof_output_dir, record->rank, suffix);
+                    }
+                }
+
+                file = iof_file_get(writer, name);
+                if (NULL == file) {
+                    continue;
+                }
+
+                writer->bytes += record->size;
+                line = (char *)(record + 1);
+                end = line + record->size;
+                if (0 == flags) {
+                    iof_file_write(file, line, record->size);
+                    continue;
+                }
+
+                mid_line = iof_line_state(&writer->lines[ch], record->job_index,
+                                          record->rank);
+                while (line < end) {
+                    newline = memchr(line, '\n', end - line);
+                    newline = (NULL == newline) ? end : newline + 1;
+                    if (NULL == mid_line || !*mid_line) {
+                        iof_file_write(file, prefix,
+                                       iof_format_prefix(prefix, record, flags));
+                    }
+                    iof_file_write(file, line, newline - line);
+                    if (NULL != mid_line) {
+                        *mid_line = ('\n' != newline[-1]);
+                    }
+                    line = newline;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @name   iof_file_get
+ * @brief  Find or create the output file with a name, and make sure it is
+ *         open, closing the least recently used file of the writer when too
+ *         many are open.
+ * @param  writer: The file writer owning the file
+ * @param  name: Path of the file, without the compression suffix
+ * @return The file, NULL if it cannot be opened
+ */
+iof_file_t *iof_file_get(iof_file_writer_t *writer, const char *name)
+{
+    iof_file_t **new_files, *file;
+    size_t new_capacity, hash, i, j;
+    const char *c;
+
+    if (writer->files_capacity <= 2 * (writer->num_files + 1)) {
+        new_capacity = (0 == writer->files_capacity) ? 256 : 2 * writer->files_capacity;
+        new_files = calloc(new_capacity, sizeof(iof_file_t *));
+        if (NULL == new_files) {
+            return NULL;
+        }
+        for (i = 0; i < writer->files_capacity; i++) {
+            if (NULL == writer->files[i]) {
+                continue;
+            }
+            hash = 2166136261u;
+            for (c = writer->files[i]->name; '\0' != *c; c++) {
+                hash = (hash ^ (unsigned char)*c) * 16777619u;
+            }
+            for (j = hash & (new_capacity - 1); NULL != new_files[j];
+                 j = (j + 1) & (new_capacity - 1)) {
+            }
+            new_files[j] = writer->files[i];
+        }
+        free(writer->files);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (new_capacity - writer->files_capacity) * sizeof(iof_file_t *));
+        writer->files = new_files;
+        writer->files_capacity = new_capacity;
+    }
+
+    hash = 2166136261u;
+    for (c = name; '\0' != *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    for (i = hash & (writer->files_capacity - 1); NULL != writer->files[i];
+         i = (i + 1) & (writer->files_capacity - 1)) {
+        if (0 == strcmp(writer->files[i]->name, name)) {
+            break;
+        }
+    }
+
+    file = writer->files[i];
+    if (NULL == file) {
+        file = calloc(1, sizeof(iof_file_t));
+        if (NULL == file || NULL == (file->name = strdup(name))) {
+            free(file);
+            return NULL;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES, sizeof(iof_file_t) + strlen(name) + 1);
+        writer->files[i] = file;
+        writer->num_files++;
+    }
+
+    file->last_use = ++writer->use_count;
+    if (STATUS_OK != iof_file_open(writer, file)) {
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * @name   iof_file_open
+ * @brief  Open an output file for appending, if it is not open yet.
+ * @param  writer: The file writer owning the file
+ * @param  file: The file
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int iof_file_open(iof_file_writer_t *writer, iof_file_t *file)
+{
+    char path[PATH_MAX];
+    iof_file_t *oldest = NULL;
+    size_t i;
+
+#ifdef MPIRSHIM_HAVE_ZLIB
+    if (NULL != file->gz) {
+        return STATUS_OK;
+    }
+#endif
+    if (NULL != file->file) {
+        return STATUS_OK;
+    }
+
+    if (IOF_MAX_OPEN_FILES <= writer->num_open) {
+        for (i = 0; i < writer->files_capacity; i++) {
+            if (NULL == writer->files[i] || writer->files[i] == file) {
+                continue;
+            }
+#ifdef MPIRSHIM_HAVE_ZLIB
+            if (NULL == writer->files[i]->gz && NULL == writer->files[i]->file) {
+                continue;
+            }
+#else
+            if (NULL == writer->files[i]->file) {
+                continue;
+            }
+#endif
+            if (NULL == oldest || writer->files[i]->last_use < oldest->last_use) {
+                oldest = writer->files[i];
+            }
+        }
+        if (NULL != oldest) {
+            iof_file_close(oldest);
+            writer->num_open--;
+        }
+    }
+
+    /*
+     * Files are opened in append mode, so a file closed to make room is
+     * continued when reopened. A reopened compressed file gets a new gzip
+     * member, which gunzip reads as one stream.
+     */
+#ifdef MPIRSHIM_HAVE_ZLIB
+    if (iof_output_compress) {
+        snprintf(path, sizeof(path), "%s.gz", file->name);
+        file->gz = gzopen(path, "ab1");
+        if (NULL == file->gz) {
+            fprintf(stderr, "Unable to open output file '%s'.\n", path);
+            return STATUS_FAIL;
+        }
+        gzbuffer(file->gz, IOF_FILE_BUFFER_SIZE);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_FILE_BUFFER_SIZE);
+        writer->num_open++;
+        writer->opens++;
+        return STATUS_OK;
+    }
+#endif
+    snprintf(path, sizeof(path), "%s", file->name);
+    file->file = fopen(path, "a");
+    if (NULL == file->file) {
+        fprintf(stderr, "Unable to open output file '%s': %s.\n", path,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+    setvbuf(file->file, NULL, _IOFBF, IOF_FILE_BUFFER_SIZE);
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_FILE_BUFFER_SIZE);
+    writer->num_open++;
+    writer->opens++;
+    return STATUS_OK;
+}
+
+/**
+ * @name   iof_file_close
+ * @brief  Close an output file, if open.
+ * @param  file: The file
+ */
+void iof_file_close(iof_file_t *file)
+{
+#ifdef MPIRSHIM_HAVE_ZLIB
+    if (NULL != file->gz) {
+        gzclose(file->gz);
+        file->gz = NULL;
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_FILE_BUFFER_SIZE);
+    }
+#endif
+    if (NULL != file->file) {
+        fclose(file->file);
+        file->file = NULL;
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_FILE_BUFFER_SIZE);
+    }
+}
+
+/**
+ * @name   iof_file_write
+ * @brief  Append data to an open output file, through its buffer.
+ * @param  file: The file
+ * @param  data: Data to write
+ * @param  size: Number of bytes
+ */
+void iof_file_write(iof_file_t *file, const void *data, size_t size)
+{
+#ifdef MPIRSHIM_HAVE_ZLIB
+    if (NULL != file->gz) {
+        gzwrite(file->gz, data, (unsigned)size);
+        return;
+    }
+#endif
+    fwrite(data, 1, size, file->file);
+}
+
+/**
+ * @name   iof_file_flush_all
+ * @brief  Flush the buffers of every open file of a file writer.
+ * @param  writer: The file writer
+ */
+void iof_file_flush_all(iof_file_writer_t *writer)
+{
+    size_t i;
+
+    for (i = 0; i < writer->files_capacity; i++) {
+        if (NULL == writer->files[i]) {
+            continue;
+        }
+#ifdef MPIRSHIM_HAVE_ZLIB
+        if (NULL != writer->files[i]->gz) {
+            gzflush(writer->files[i]->gz, Z_SYNC_FLUSH);
+        }
+#endif
+        if (NULL != writer->files[i]->file) {
+            fflush(writer->files[i]->file);
+        }
+    }
+}
+
+/**
+ * @name   iof_agg_chunks
+ * @brief  Split the records of a channel into lines and add them to the
+ *         aggregation table. The start of a line is kept until the rest of
+ *         it arrives.
+ * @param  channel: Index of the channel
+ * @param  chunks: The chunks
+ */
+void iof_agg_chunks(int channel, iof_chunk_t *chunks)
+{
+    iof_chunk_t *chunk;
+    iof_record_t *record;
+    iof_agg_partial_t *partial;
+    char *line, *end, *newline, *text;
+    size_t offset, size, capacity;
+
+    for (chunk = chunks; NULL != chunk; chunk = chunk->next) {
+        for (offset = 0; offset < chunk->used; offset += IOF_RECORD_SPACE(record->size)) {
+            record = (iof_record_t *)((char *)chunk->data + offset);
+            line = (char *)(record + 1);
+            end = line + record->size;
+
+            while (line < end) {
+                newline = memchr(line, '\n', end - line);
+                newline = (NULL == newline) ? end : newline + 1;
+                size = newline - line;
+                partial = iof_agg_partial(channel, record->job_index, record->rank);
+
+                if ('\n' == newline[-1] && (NULL == partial || 0 == partial->size)) {
+                    iof_agg_add(channel, record->job_index, record->rank,
+                                &record->time, line, size);
+                    line = newline;
+                    continue;
+                }
+                if (NULL == partial) {
+                    // No room to keep it, print the piece as a line
+                    iof_agg_add(channel, record->job_index, record->rank,
+                                &record->time, line, size);
+                    line = newline;
+                    continue;
+                }
+
+                if (partial->capacity < partial->size + size) {
+                    capacity = (0 == partial->capacity) ? 256 : partial->capacity;
+                    while (capacity < partial->size + size) {
+                        capacity *= 2;
+                    }
+                    text = realloc(partial->text, capacity);
+                    if (NULL == text) {
+                        line = newline;
+                        continue;
+                    }
+                    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS,
+                                         capacity - partial->capacity);
+                    partial->text = text;
+                    partial->capacity = capacity;
+                }
+                if (0 == partial->size) {
+                    partial->time = record->time;
+                }
+                memcpy(partial->text + partial->size, line, size);
+                partial->size += size;
+                if ('\n' == newline[-1]) {
+                    iof_agg_add(channel, record->job_index, record->rank,
+                                &partial->time, partial->text, partial->size);
+                    partial->size = 0;
+                }
+                line = newline;
+            }
+        }
+    }
+}
+
+/**
+ * @name   iof_agg_partial
+ * @brief  Get the partial line of a rank on a channel, growing the tables as
+ *         needed.
+ * @param  channel: Index of the channel
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @return The partial line, NULL for an unknown rank or if out of memory
+ */
+iof_agg_partial_t *iof_agg_partial(int channel, int job_index, pmix_rank_t rank)
+{
+    iof_agg_job_t *jobs, *job;
+    iof_agg_partial_t *partials;
+    pmix_rank_t num_partials;
+
+    if (0 > job_index || PMIX_RANK_VALID < rank) {
+        return NULL;
+    }
+
+    if (iof_agg_num_jobs[channel] <= job_index) {
+        jobs = realloc(iof_agg_jobs[channel], (job_index + 1) * sizeof(iof_agg_job_t));
+        if (NULL == jobs) {
+            return NULL;
+        }
+        memset(&jobs[iof_agg_num_jobs[channel]], 0,
+               (job_index + 1 - iof_agg_num_jobs[channel]) * sizeof(iof_agg_job_t));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (job_index + 1 - iof_agg_num_jobs[channel]) *
+                             sizeof(iof_agg_job_t));
+        iof_agg_jobs[channel] = jobs;
+        iof_agg_num_jobs[channel] = job_index + 1;
+    }
+
+    job = &iof_agg_jobs[channel][job_index];
+    if (job->num_partials <= rank) {
+        num_partials = (0 == job->num_partials) ? 64 : job->num_partials;
+        while (num_partials <= rank) {
+            num_partials *= 2;
+        }
+        partials = realloc(job->partials, num_partials * sizeof(iof_agg_partial_t));
+        if (NULL == partials) {
+            return NULL;
+        }
+        memset(&partials[job->num_partials], 0,
+               (num_partials - job->num_partials) * sizeof(iof_agg_partial_t));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (num_partials - job->num_partials) * sizeof(iof_agg_partial_t));
+        job->partials = partials;
+        job->num_partials = num_partials;
+    }
+    return &job->partials[rank];
+}
+
+/**
+ * @name   iof_agg_add
+ * @brief  Add a line printed by a rank to the aggregation table. The first
+ *         line added starts a new window.
+ * @param  channel: Index of the channel
+ * @param  job_index: Index of the job
+ * @param  rank: Rank within the job
+ * @param  time: When the line was received, for the time prefix
+ * @param  text: The line, normally ending with a newline
+ * @param  size: Length of the line
+ */
+void iof_agg_add(int channel, int job_index, pmix_rank_t rank,
+                 const struct timespec *time, const char *text, size_t size)
+{
+    iof_agg_line_t **table, *line;
+    pmix_rank_t *ranks;
+    size_t hash, capacity, i, j;
+
+    iof_agg_lines_in++;
+
+    if (NULL == iof_agg_head) {
+        clock_gettime(CLOCK_REALTIME, &iof_agg_deadline);
+        iof_agg_deadline.tv_sec += iof_aggregate_ms / 1000;
+        iof_agg_deadline.tv_nsec += (long)(iof_aggregate_ms % 1000) * 1000000;
+        if (1000000000 <= iof_agg_deadline.tv_nsec) {
+            iof_agg_deadline.tv_sec++;
+            iof_agg_deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    // Keep the table at most half full
+    if (iof_agg_capacity <= 2 * (iof_agg_count + 1)) {
+        capacity = (0 == iof_agg_capacity) ? 1024 : 2 * iof_agg_capacity;
+        table = calloc(capacity, sizeof(iof_agg_line_t *));
+        if (NULL == table) {
+            return;
+        }
+        for (i = 0; i < iof_agg_capacity; i++) {
+            if (NULL == iof_agg_table[i]) {
+                continue;
+            }
+            for (j = iof_agg_table[i]->hash & (capacity - 1); NULL != table[j];
+                 j = (j + 1) & (capacity - 1)) {
+            }
+            table[j] = iof_agg_table[i];
+        }
+        free(iof_agg_table);
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (capacity - iof_agg_capacity) * sizeof(iof_agg_line_t *));
+        iof_agg_table = table;
+        iof_agg_capacity = capacity;
+    }
+
+    hash = 2166136261u;
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    hash = (hash ^ (size_t)channel) * 16777619u;
+    hash = (hash ^ (size_t)job_index) * 16777619u;
+
+    for (i = hash & (iof_agg_capacity - 1); NULL != iof_agg_table[i];
+         i = (i + 1) & (iof_agg_capacity - 1)) {
+        line = iof_agg_table[i];
+        if (line->hash == hash && line->channel == channel &&
+            line->job_index == job_index && line->size == size &&
+            0 == memcmp(line->text, text, size)) {
+            break;
+        }
+    }
+
+    line = iof_agg_table[i];
+    if (NULL == line) {
+        line = malloc(sizeof(iof_agg_line_t) + size);
+        if (NULL == line) {
+            return;
+        }
+        memset(line, 0, sizeof(iof_agg_line_t));
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES, sizeof(iof_agg_line_t) + size);
+        line->hash = hash;
+        line->channel = channel;
+        line->job_index = job_index;
+        line->time = *time;
+        line->ranks_sorted = 1;
+        line->size = size;
+        memcpy(line->text, text, size);
+        iof_agg_table[i] = line;
+        iof_agg_count++;
+        if (NULL == iof_agg_tail) {
+            iof_agg_head = line;
+        }
+        else {
+            iof_agg_tail->next = line;
+        }
+        iof_agg_tail = line;
+    }
+
+    if (line->num_ranks == line->ranks_capacity) {
+        capacity = (0 == line->ranks_capacity) ? 16 : 2 * line->ranks_capacity;
+        ranks = realloc(line->ranks, capacity * sizeof(pmix_rank_t));
+        if (NULL == ranks) {
+            return;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_CACHES,
+                             (capacity - line->ranks_capacity) * sizeof(pmix_rank_t));
+        line->ranks = ranks;
+        line->ranks_capacity = capacity;
+    }
+    if (0 < line->num_ranks && rank < line->ranks[line->num_ranks - 1]) {
+        line->ranks_sorted = 0;
+    }
+    line->ranks[line->num_ranks++] = rank;
+}
+
+/**
+ * @name   iof_agg_flush
+ * @brief  Print the distinct lines of the aggregation window, in the order
+ *         they were first seen, once the window is over.
+ * @param  force: Non-zero to print them now, along with any partial lines
+ */
+void iof_agg_flush(int force)
+{
+    struct iovec iov[IOF_MAX_IOVECS];
+    char *prefixes[IOF_MAX_IOVECS / 2];
+    struct timespec now;
+    iof_agg_line_t *line, *next;
+    iof_agg_partial_t *partial;
+    pmix_rank_t r;
+    char *text;
+    int iovcnt = 0, num_prefixes = 0, channel = 0, c, j, i;
+
+    if (force) {
+        // Lines never finished are printed as they are, with a newline
+        for (c = 0; c < IOF_NUM_CHANNELS; c++) {
+            for (j = 0; j < iof_agg_num_jobs[c]; j++) {
+                for (r = 0; r < iof_agg_jobs[c][j].num_partials; r++) {
+                    partial = &iof_agg_jobs[c][j].partials[r];
+                    if (0 == partial->size) {
+                        continue;
+                    }
+                    if (partial->size == partial->capacity) {
+                        text = realloc(partial->text, partial->size + 1);
+                        if (NULL == text) {
+                            continue;
+                        }
+                        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS, 1);
+                        partial->text = text;
+                        partial->capacity++;
+                    }
+                    partial->text[partial->size++] = '\n';
+                    iof_agg_add(c, j, r, &partial->time, partial->text, partial->size);
+                    partial->size = 0;
+                }
+            }
+        }
+    }
+
+    if (NULL == iof_agg_head) {
+        return;
+    }
+    if (!force) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (now.tv_sec < iof_agg_deadline.tv_sec ||
+            (now.tv_sec == iof_agg_deadline.tv_sec &&
+             now.tv_nsec < iof_agg_deadline.tv_nsec)) {
+            return;
+        }
+    }
+
+    for (line = iof_agg_head; NULL != line; line = line->next) {
+        if (0 < iovcnt && (line->channel != channel || IOF_MAX_IOVECS - 1 <= iovcnt)) {
+            iof_writev(&iof_channels[channel], iov, iovcnt);
+            for (i = 0; i < num_prefixes; i++) {
+                free(prefixes[i]);
+            }
+            iovcnt = 0;
+            num_prefixes = 0;
+        }
+        channel = line->channel;
+
+        prefixes[num_prefixes] = iof_agg_format_prefix(line);
+        if (NULL != prefixes[num_prefixes]) {
+            iov[iovcnt].iov_base = prefixes[num_prefixes];
+            iov[iovcnt].iov_len = strlen(prefixes[num_prefixes]);
+            iovcnt++;
+            num_prefixes++;
+        }
+        iov[iovcnt].iov_base = line->text;
+        iov[iovcnt].iov_len = line->size;
+        iovcnt++;
+        iof_agg_lines_out++;
+    }
+    if (0 < iovcnt) {
+        iof_writev(&iof_channels[channel], iov, iovcnt);
+        for (i = 0; i < num_prefixes; i++) {
+            free(prefixes[i]);
+        }
+    }
+
+    for (line = iof_agg_head; NULL != line; line = next) {
+        next = line->next;
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES, sizeof(iof_agg_line_t) + line->size +
+                             line->ranks_capacity * sizeof(pmix_rank_t));
+        free(line->ranks);
+        free(line);
+    }
+    iof_agg_head = NULL;
+    iof_agg_tail = NULL;
+    memset(iof_agg_table, 0, iof_agg_capacity * sizeof(iof_agg_line_t *));
+    iof_agg_count = 0;
+}
+
+/**
+ * @name   iof_agg_format_prefix
+ * @brief  Format the prefix of an aggregated line: the time, if requested,
+ *         and the ranks that printed it as ranges, such as "[0-3,8] ". With
+ *         several jobs the job index comes first, "[1,0-3] ". When a rank
+ *         printed the line more than once the count of lines is added.
+ * @param  line: The line; its ranks are sorted
+ * @return The prefix, to be freed, NULL if out of memory
+ */
+char *iof_agg_format_prefix(iof_agg_line_t *line)
+{
+    iof_record_t record;
+    char *prefix;
+    size_t i, first, num_distinct, num_ranges, len, size;
+
+    if (!line->ranks_sorted) {
+        qsort(line->ranks, line->num_ranks, sizeof(pmix_rank_t), iof_compare_ranks);
+        line->ranks_sorted = 1;
+    }
+
+    num_distinct = (0 < line->num_ranks) ? 1 : 0;
+    num_ranges = num_distinct;
+    for (i = 1; i < line->num_ranks; i++) {
+        if (line->ranks[i] == line->ranks[i - 1]) {
+            continue;
+        }
+        num_distinct++;
+        if (line->ranks[i] != line->ranks[i - 1] + 1) {
+            num_ranges++;
+        }
+    }
+
+    size = 2 * IOF_PREFIX_SIZE + num_ranges * IOF_RANGE_SIZE;
+    prefix = malloc(size);
+    if (NULL == prefix) {
+        return NULL;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.time = line->time;
+    len = iof_format_prefix(prefix, &record, iof_prefix & IOF_PREFIX_TIME);
+    len += snprintf(prefix + len, size - len, "[");
+    if (1 < iof_num_jobs) {
+        len += snprintf(prefix + len, size - len, "%d,", line->job_index);
+    }
+    for (i = 0; i < line->num_ranks; ) {
+        first = i;
+        while (i + 1 < line->num_ranks &&
+               (line->ranks[i + 1] == line->ranks[i] ||
+                line->ranks[i + 1] == line->ranks[i] + 1)) {
+            i++;
+        }
+        if (line->ranks[i] == line->ranks[first]) {
+            len += snprintf(prefix + len, size - len, "%s%u",
+                            (0 == first) ? "" : ",", line->ranks[first]);
+        }
+        else {
+            len += snprintf(prefix + len, size - len, "%s%u-%u",
+                            (0 == first) ? "" : ",", line->ranks[first],
+                            line->ranks[i]);
+        }
+        i++;
+    }
+    if (line->num_ranks != num_distinct) {
+        snprintf(prefix + len, size - len, "] (%lu lines) ",
+                 (unsigned long)line->num_ranks);
+    }
+    else {
+        snprintf(prefix + len, size - len, "] ");
+    }
+    return prefix;
+}
+
+/**
+ * @name   iof_compare_ranks
+ * @brief  qsort comparison of two ranks.
+ * @param  a: First rank
+ * @param  b: Second rank
+ * @return Negative, zero or positive as a is less, equal or greater than b
+ */
+int iof_compare_ranks(const void *a, const void *b)
+{
+    pmix_rank_t ra = *(const pmix_rank_t *)a;
+    pmix_rank_t rb = *(const pmix_rank_t *)b;
+
+    return (ra < rb) ? -1 : (ra > rb);
+}
+
+/**
+ * @name   iof_agg_free
+ * @brief  Free the aggregation table and partial lines.
+ */
+void iof_agg_free(void)
+{
+    pmix_rank_t r;
+    int c, j;
+
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                         iof_agg_capacity * sizeof(iof_agg_line_t *));
+    free(iof_agg_table);
+    iof_agg_table = NULL;
+    iof_agg_capacity = 0;
+    for (c = 0; c < IOF_NUM_CHANNELS; c++) {
+        for (j = 0; j < iof_agg_num_jobs[c]; j++) {
+            for (r = 0; r < iof_agg_jobs[c][j].num_partials; r++) {
+                MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS,
+                                     iof_agg_jobs[c][j].partials[r].capacity);
+                free(iof_agg_jobs[c][j].partials[r].text);
+            }
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES, iof_agg_jobs[c][j].num_partials *
+                                 sizeof(iof_agg_partial_t));
+            free(iof_agg_jobs[c][j].partials);
+        }
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_CACHES,
+                             iof_agg_num_jobs[c] * sizeof(iof_agg_job_t));
+        free(iof_agg_jobs[c]);
+        iof_agg_jobs[c] = NULL;
+        iof_agg_num_jobs[c] = 0;
+    }
+}
+
+/**
+ * @name   mpir_shim_iof_set_stdin
+ * @brief  Select the ranks stdin is forwarded to.
+ * @param  enable: Zero to not forward stdin
+ * @param  ranks: Target ranks, NULL for all ranks; owned from now on
+ * @param  num_ranks: Number of target ranks
+ */
+void mpir_shim_iof_set_stdin(int enable, pmix_rank_t *ranks, size_t num_ranks)
+{
+    free(iof_stdin_ranks);
+    iof_stdin_enabled = enable;
+    iof_stdin_ranks = ranks;
+    iof_stdin_num_ranks = num_ranks;
+}
+
+/**
+ * @name   mpir_shim_iof_stdin_enabled
+ * @brief  Check whether stdin forwarding was requested.
+ * @return Non-zero if enabled
+ */
+int mpir_shim_iof_stdin_enabled(void)
+{
+    return iof_stdin_enabled;
+}
+
+/**
+ * @name   mpir_shim_iof_stdin_start
+ * @brief  Start the stdin reader thread, pushing to the target ranks of an
+ *         application.
+ * @param  application_proc: Application namespace
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int mpir_shim_iof_stdin_start(const pmix_proc_t *application_proc)
+{
+    size_t i;
+    int rc;
+
+    if (!iof_stdin_enabled || iof_stdin_running) {
+        return STATUS_OK;
+    }
+
+    iof_stdin_num_targets = (NULL == iof_stdin_ranks) ? 1 : iof_stdin_num_ranks;
+    iof_stdin_targets = calloc(iof_stdin_num_targets, sizeof(pmix_proc_t));
+    if (NULL == iof_stdin_targets) {
+        fprintf(stderr, "Unable to allocate the stdin targets.\n");
+        return STATUS_FAIL;
+    }
+    if (NULL == iof_stdin_ranks) {
+        PMIX_PROC_LOAD(&iof_stdin_targets[0], application_proc->nspace,
+                       PMIX_RANK_WILDCARD);
+    }
+    for (i = 0; NULL != iof_stdin_ranks && i < iof_stdin_num_ranks; i++) {
+        PMIX_PROC_LOAD(&iof_stdin_targets[i], application_proc->nspace,
+                       iof_stdin_ranks[i]);
+    }
+
+    if (0 != pipe(iof_stdin_wake)) {
+        fprintf(stderr, "Unable to create the stdin wakeup pipe: %s.\n",
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+
+    rc = pthread_create(&iof_stdin_reader, NULL, iof_stdin_main, NULL);
+    if (0 != rc) {
+        fprintf(stderr, "Unable to start the stdin reader: %s.\n", strerror(rc));
+        close(iof_stdin_wake[0]);
+        close(iof_stdin_wake[1]);
+        return STATUS_FAIL;
+    }
+    iof_stdin_running = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   iof_stdin_main
+ * @brief  Stdin reader thread: push stdin to the targets until end of file,
+ *         an error, or iof_stdin_stop.
+ * @param  arg: Unused
+ * @return NULL
+ */
+void *iof_stdin_main(void *arg)
+{
+    struct pollfd fds[2];
+    struct stat st;
+    char *buffer, *map;
+    off_t offset;
+    size_t size;
+    ssize_t n;
+
+    (void)arg;
+
+    if (0 != fstat(STDIN_FILENO, &st)) {
+        st.st_mode = 0;
+    }
+
+    /*
+     * A regular file is pushed from a read-only mapping, without reading it
+     * into a buffer first.
+     */
+    offset = S_ISREG(st.st_mode) ? lseek(STDIN_FILENO, 0, SEEK_CUR) : -1;
+    if (0 <= offset && offset < st.st_size) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+        if (MAP_FAILED != map) {
+            (void)madvise(map, st.st_size, MADV_SEQUENTIAL);
+            while (offset < st.st_size) {
+                size = st.st_size - offset;
+                if (IOF_STDIN_CHUNK_SIZE < size) {
+                    size = IOF_STDIN_CHUNK_SIZE;
+                }
+                if (STATUS_OK != iof_stdin_push(map + offset, size)) {
+                    break;
+                }
+                offset += size;
+            }
+            munmap(map, st.st_size);
+            iof_stdin_close();
+            return NULL;
+        }
+    }
+
+#ifdef F_SETPIPE_SZ
+    // A larger pipe lets each read take more of the input at once
+    if (S_ISFIFO(st.st_mode)) {
+        (void)fcntl(STDIN_FILENO, F_SETPIPE_SZ, IOF_STDIN_CHUNK_SIZE);
+    }
+#endif
+
+    buffer = malloc(IOF_STDIN_CHUNK_SIZE);
+    if (NULL == buffer) {
+        fprintf(stderr, "Unable to allocate the stdin buffer.\n");
+        return NULL;
+    }
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_STDIN_CHUNK_SIZE);
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = iof_stdin_wake[0];
+    fds[1].events = POLLIN;
+    for (;;) {
+        if (0 > poll(fds, 2, -1)) {
+            if (EINTR == errno) {
+                continue;
+            }
+            break;
+        }
+        if (0 != fds[1].revents) {
+            // Stopping, the application is gone
+            free(buffer);
+            MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_STDIN_CHUNK_SIZE);
+            return NULL;
+        }
+        n = read(STDIN_FILENO, buffer, IOF_STDIN_CHUNK_SIZE);
+        if (0 > n) {
+            if (EINTR == errno || EAGAIN == errno) {
+                continue;
+            }
+            break;
+        }
+        if (0 == n || STATUS_OK != iof_stdin_push(buffer, n)) {
+            break;
+        }
+    }
+
+    free(buffer);
+    MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_IO_BUFFERS, IOF_STDIN_CHUNK_SIZE);
+    iof_stdin_close();
+    return NULL;
+}
+
+/**
+ * @name   iof_stdin_push
+ * @brief  Push a piece of stdin to the targets. The push is blocking, so
+ *         the data can be reused when it returns.
+ * @param  data: The data
+ * @param  size: Number of bytes
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int iof_stdin_push(const void *data, size_t size)
+{
+    pmix_byte_object_t bo;
+    pmix_status_t rc;
+
+    bo.bytes = (char *)data;
+    bo.size = size;
+    rc = PMIx_IOF_push(iof_stdin_targets, iof_stdin_num_targets, &bo, NULL, 0,
+                       NULL, NULL);
+    if (PMIX_SUCCESS != rc && PMIX_OPERATION_SUCCEEDED != rc) {
+        fprintf(stderr, "An error occurred forwarding stdin: %s.\n",
+                PMIx_Error_string(rc));
+        return STATUS_FAIL;
+    }
+    iof_stdin_bytes += size;
+    MPIR_SHIM_METRIC_ADD(MPIR_SHIM_METRIC_STDIN_BYTES, size);
+    iof_stdin_pushes++;
+    return STATUS_OK;
+}
+
+/**
+ * @name   iof_stdin_close
+ * @brief  Tell the targets stdin is closed.
+ */
+void iof_stdin_close(void)
+{
+    pmix_info_t info;
+    bool complete = true;
+
+    PMIX_INFO_LOAD(&info, PMIX_IOF_COMPLETE, &complete, PMIX_BOOL);
+    (void)PMIx_IOF_push(iof_stdin_targets, iof_stdin_num_targets, NULL, &info, 1,
+                        NULL, NULL);
+    PMIX_INFO_DESTRUCT(&info);
+}
+
+/**
+ * @name   iof_stdin_stop
+ * @brief  Stop the stdin reader thread, if running.
+ */
+void iof_stdin_stop(void)
+{
+    ssize_t rc;
+
+    if (!iof_stdin_running) {
+        return;
+    }
+
+    rc = write(iof_stdin_wake[1], "", 1);
+    (void)rc;
+    pthread_join(iof_stdin_reader, NULL);
+    iof_stdin_running = 0;
+    close(iof_stdin_wake[0]);
+    close(iof_stdin_wake[1]);
+
+    if (iof_debug) {
+        fprintf(stderr, "Stdin forwarding: %lu bytes in %lu pushes\n",
+                iof_stdin_bytes, iof_stdin_pushes);
+    }
+    free(iof_stdin_targets);
+    iof_stdin_targets = NULL;
+}
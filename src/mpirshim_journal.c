@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_journal.c
+ * @brief  Event journal of the shim.
+ *
+ * The journal file is mapped shared, so appending a record is a store into
+ * memory: one atomic increment of the head in the header reserves the
+ * record, and its sequence number is set last. The kernel writes the pages
+ * back on its own; the shim only asks it to start at the end of each
+ * session and at exit. When the shim is killed or hangs, the file holds
+ * every record up to the last one, for the mpirjournal decoder.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// Records of the journal by default, 8 MB
+#define JOURNAL_DEFAULT_RECORDS 65536
+
+static mpir_shim_journal_header_t *journal = NULL;
+static mpir_shim_journal_record_t *journal_records = NULL;
+static size_t journal_size = 0;
+static int journal_exit_handler_set = 0;
+
+static uint64_t journal_now(void);
+static void journal_close(void);
+
+/**
+ * @name   MPIR_Shim_set_journal
+ * @brief  Record the events of the shim in a journal file.
+ * @param  file: The file, replaced, NULL to stop journaling
+ * @param  num_records: Records kept before the oldest are overwritten, 0
+ *         for the default
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_journal(const char *file, int num_records)
+{
+    mpir_shim_journal_header_t *header;
+    struct timespec now;
+    size_t size;
+    int fd;
+
+    if (0 > num_records) {
+        fprintf(stderr, "Invalid number of journal records %d.\n", num_records);
+        return STATUS_FAIL;
+    }
+    journal_close();
+    if (NULL == file) {
+        return STATUS_OK;
+    }
+    if (0 == num_records) {
+        num_records = JOURNAL_DEFAULT_RECORDS;
+    }
+
+    size = MPIR_SHIM_JOURNAL_HEADER_SIZE +
+           (size_t)num_records * sizeof(mpir_shim_journal_record_t);
+    fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (0 > fd) {
+        fprintf(stderr, "Unable to open the journal file '%s': %s.\n", file,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+    if (0 != ftruncate(fd, (off_t)size)) {
+        fprintf(stderr, "Unable to size the journal file '%s': %s.\n", file,
+                strerror(errno));
+        close(fd);
+        return STATUS_FAIL;
+    }
+    header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == header) {
+        fprintf(stderr, "Unable to map the journal file '%s': %s.\n", file,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+
+    // The file is zeroed, so every record is unwritten
+    memcpy(header->magic, MPIR_SHIM_JOURNAL_MAGIC, sizeof(header->magic));
+    header->version = MPIR_SHIM_JOURNAL_VERSION;
+    header->pid = (uint32_t)getpid();
+    header->record_size = sizeof(mpir_shim_journal_record_t);
+    header->num_records = (uint32_t)num_records;
+    header->monotonic_ns = journal_now();
+    clock_gettime(CLOCK_REALTIME, &now);
+    header->realtime_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    header->head = 0;
+
+    journal_records = (mpir_shim_journal_record_t *)((char *)header +
+                                                     MPIR_SHIM_JOURNAL_HEADER_SIZE);
+    journal_size = size;
+    __atomic_store_n(&journal, header, __ATOMIC_RELEASE);
+
+    if (!journal_exit_handler_set) {
+        if (0 != atexit(mpir_shim_journal_flush)) {
+            fprintf(stderr, "An error occurred setting an exit handler.\n");
+            return STATUS_FAIL;
+        }
+        journal_exit_handler_set = 1;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_journal_append
+ * @brief  Append a record to the journal, if there is one, from any thread.
+ * @param  type: Type of the record
+ * @param  job: Index of the job, -1 for none
+ * @param  status: Status, see the record types
+ * @param  rank: Rank, see the record types
+ * @param  value: Value, see the record types
+ * @param  text: Text, truncated to fit, may be NULL
+ */
+void mpir_shim_journal_append(mpir_shim_journal_type_t type, int job, int status,
+                              uint32_t rank, int64_t value, const char *text)
+{
+    mpir_shim_journal_header_t *header;
+    mpir_shim_journal_record_t *record;
+    uint64_t index;
+
+    header = __atomic_load_n(&journal, __ATOMIC_ACQUIRE);
+    if (NULL == header) {
+        return;
+    }
+
+    index = __atomic_fetch_add(&header->head, 1, __ATOMIC_RELAXED);
+    record = &journal_records[index % header->num_records];
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record->time_ns = journal_now();
+    record->type = (uint16_t)type;
+    record->job = (int16_t)job;
+    record->tid = (int32_t)syscall(SYS_gettid);
+    record->status = status;
+    record->rank = rank;
+    record->value = value;
+    memset(record->text, 0, sizeof(record->text));
+    if (NULL != text) {
+        strncpy(record->text, text, sizeof(record->text) - 1);
+    }
+
+    __atomic_store_n(&record->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @name   mpir_shim_journal_session_start
+ * @brief  Open the journal named by MPIR_SHIM_JOURNAL if none was set, and
+ *         record the start of a session.
+ * @param  mode: The shim mode
+ * @param  num_jobs: Number of jobs of the session
+ * @param  launcher: The launcher of the first job, may be NULL
+ */
+void mpir_shim_journal_session_start(int mode, int num_jobs, const char *launcher)
+{
+    const char *file;
+
+    // Lets a site keep a journal of every session
+    file = getenv("MPIR_SHIM_JOURNAL");
+    if (NULL == journal && NULL != file && '\0' != *file) {
+        (void)MPIR_Shim_set_journal(file, 0);
+    }
+    mpir_shim_journal_append(MPIR_SHIM_JOURNAL_SESSION_START, -1, mode, 0,
+                             num_jobs, launcher);
+}
+
+/**
+ * @name   mpir_shim_journal_flush
+ * @brief  Start writing the journal back to its file, without waiting.
+ */
+void mpir_shim_journal_flush(void)
+{
+    if (NULL != journal) {
+        (void)msync(journal, journal_size, MS_ASYNC);
+    }
+}
+
+/**
+ * @name   journal_now
+ * @brief  Read the clock of the records.
+ * @return Nanoseconds
+ */
+uint64_t journal_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @name   journal_close
+ * @brief  Stop journaling, writing the journal back to its file. A thread
+ *         appending at the same time writes to a mapping that is gone, so
+ *         the journal is only changed between sessions.
+ */
+void journal_close(void)
+{
+    mpir_shim_journal_header_t *header = journal;
+
+    if (NULL == header) {
+        return;
+    }
+    __atomic_store_n(&journal, NULL, __ATOMIC_RELEASE);
+    (void)msync(header, journal_size, MS_ASYNC);
+    (void)munmap(header, journal_size);
+    journal_records = NULL;
+    journal_size = 0;
+}
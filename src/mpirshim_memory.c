@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_memory.c
+ * @brief  Memory accounting of the shim's data structures.
+ *
+ * The shim counts the bytes it allocates for each kind of data structure
+ * (see mpirshim_memory.h), and their peaks. The report shows them next to
+ * the resident set size of the process, its peak, and the usage and limit
+ * of its cgroup, so the structure that grows with the job size can be told
+ * apart before a login node runs out of memory. It is written at exit,
+ * before the shim frees its tables, on SIGUSR2, and on request.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_memory.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+static const char *memory_names[MPIR_SHIM_NUM_MEMORY] = {
+    "proctable",
+    "strings",
+    "events",
+    "io_buffers",
+    "caches"
+};
+
+// Bytes in use and peak of each kind, and of all of them
+static long memory_current[MPIR_SHIM_NUM_MEMORY];
+static long memory_peak[MPIR_SHIM_NUM_MEMORY];
+static long memory_total = 0;
+static long memory_total_peak = 0;
+
+static int memory_report_on = 0;
+// Where the report goes, stderr if NULL
+static char *memory_file = NULL;
+
+// Memory of the process and of its cgroup, -1 where unknown
+typedef struct memory_usage_t {
+    long rss;
+    long peak_rss;
+    char cgroup[512];
+    long cgroup_usage;
+    long cgroup_peak;
+    long cgroup_limit;
+} memory_usage_t;
+
+static void update_peak(long *peak, long now);
+static void read_usage(memory_usage_t *usage);
+static long read_number(const char *path);
+
+/**
+ * @name   MPIR_Shim_set_memory_report
+ * @brief  Report the memory used by the shim at exit and on SIGUSR2.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_memory_report(const char *file)
+{
+    char *copy = NULL;
+
+    if (NULL != file && NULL == (copy = strdup(file))) {
+        fprintf(stderr, "Unable to allocate the memory report file name.\n");
+        return STATUS_FAIL;
+    }
+    free(memory_file);
+    memory_file = copy;
+    memory_report_on = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_write_memory_report
+ * @brief  Write the memory used by the shim now, and its peaks.
+ * @param  file: File to write the report to as JSON, NULL to print it to
+ *         stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_write_memory_report(const char *file)
+{
+    FILE *stream;
+    memory_usage_t usage;
+    long current, peak;
+    int i;
+
+    if (NULL == file) {
+        stream = stderr;
+    }
+    else if (NULL == (stream = fopen(file, "w"))) {
+        fprintf(stderr, "Unable to open the memory report file '%s': %s.\n",
+                file, strerror(errno));
+        return STATUS_FAIL;
+    }
+
+    read_usage(&usage);
+
+    if (NULL == file) {
+        fprintf(stream, "Shim memory (bytes):\n");
+        fprintf(stream, "%-12s %14s %14s\n", "structure", "current", "peak");
+        for (i = 0; i < MPIR_SHIM_NUM_MEMORY; i++) {
+            current = __atomic_load_n(&memory_current[i], __ATOMIC_RELAXED);
+            peak = __atomic_load_n(&memory_peak[i], __ATOMIC_RELAXED);
+            fprintf(stream, "%-12s %14ld %14ld\n", memory_names[i], current, peak);
+        }
+        fprintf(stream, "%-12s %14ld %14ld\n", "total",
+                __atomic_load_n(&memory_total, __ATOMIC_RELAXED),
+                __atomic_load_n(&memory_total_peak, __ATOMIC_RELAXED));
+        fprintf(stream, "%-12s %14ld %14ld\n", "process rss", usage.rss, usage.peak_rss);
+        if (0 <= usage.cgroup_usage) {
+            fprintf(stream, "%-12s %14ld %14ld  cgroup %s, ", "cgroup",
+                    usage.cgroup_usage, usage.cgroup_peak, usage.cgroup);
+            if (0 <= usage.cgroup_limit) {
+                fprintf(stream, "limit %ld\n", usage.cgroup_limit);
+            }
+            else {
+                fprintf(stream, "no limit\n");
+            }
+        }
+        return STATUS_OK;
+    }
+
+    fprintf(stream, "{\n  \"structures\": [");
+    for (i = 0; i < MPIR_SHIM_NUM_MEMORY; i++) {
+        current = __atomic_load_n(&memory_current[i], __ATOMIC_RELAXED);
+        peak = __atomic_load_n(&memory_peak[i], __ATOMIC_RELAXED);
+        fprintf(stream, "%s\n    {\"name\": \"%s\", \"bytes\": %ld, \"peak_bytes\": %ld}",
+                (0 == i) ? "" : ",", memory_names[i], current, peak);
+    }
+    fprintf(stream, "\n  ],\n  \"total_bytes\": %ld,\n  \"peak_total_bytes\": %ld,\n",
+            __atomic_load_n(&memory_total, __ATOMIC_RELAXED),
+            __atomic_load_n(&memory_total_peak, __ATOMIC_RELAXED));
+    fprintf(stream, "  \"rss_bytes\": %ld,\n  \"peak_rss_bytes\": %ld", usage.rss,
+            usage.peak_rss);
+    if (0 <= usage.cgroup_usage) {
+        fprintf(stream, ",\n  \"cgroup\": {\"path\": \"%s\", \"bytes\": %ld, "
+                "\"peak_bytes\": %ld, \"limit_bytes\": ", usage.cgroup,
+                usage.cgroup_usage, usage.cgroup_peak);
+        if (0 <= usage.cgroup_limit) {
+            fprintf(stream, "%ld}", usage.cgroup_limit);
+        }
+        else {
+            fprintf(stream, "null}");
+        }
+    }
+    fprintf(stream, "\n}\n");
+    if (0 != fclose(stream)) {
+        fprintf(stderr, "Unable to write the memory report file '%s': %s.\n",
+                file, strerror(errno));
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_memory_add
+ * @brief  Account for memory allocated or freed, from any thread.
+ * @param  kind: Kind of data structure
+ * @param  delta: Bytes allocated, negative if freed
+ */
+void mpir_shim_memory_add(mpir_shim_memory_t kind, long delta)
+{
+    update_peak(&memory_peak[kind],
+                __atomic_add_fetch(&memory_current[kind], delta, __ATOMIC_RELAXED));
+    update_peak(&memory_total_peak,
+                __atomic_add_fetch(&memory_total, delta, __ATOMIC_RELAXED));
+}
+
+/**
+ * @name   mpir_shim_memory_report_enabled
+ * @brief  Whether a memory report was requested.
+ * @return Non-zero if so
+ */
+int mpir_shim_memory_report_enabled(void)
+{
+    return memory_report_on;
+}
+
+/**
+ * @name   mpir_shim_memory_report
+ * @brief  Write the memory report where it was asked for, if it was.
+ */
+void mpir_shim_memory_report(void)
+{
+    if (memory_report_on) {
+        (void)MPIR_Shim_write_memory_report(memory_file);
+    }
+}
+
+/**
+ * @name   update_peak
+ * @brief  Raise a peak to a new value if it is higher.
+ * @param  peak: The peak
+ * @param  now: The new value
+ */
+void update_peak(long *peak, long now)
+{
+    long seen = __atomic_load_n(peak, __ATOMIC_RELAXED);
+
+    while (now > seen &&
+           !__atomic_compare_exchange_n(peak, &seen, now, 1, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @name   read_usage
+ * @brief  Read the memory used by the process and by its memory cgroup,
+ *         of the unified (v2) hierarchy, or else of the v1 one.
+ * @param  usage: Set to what was found, -1 for what was not
+ */
+void read_usage(memory_usage_t *usage)
+{
+    struct rusage rusage;
+    char line[512], v1_path[512], v2_path[512], path[576];
+    char *controllers, *controller, *cgroup;
+    FILE *stream;
+    long kb;
+
+    usage->rss = -1;
+    usage->peak_rss = -1;
+    usage->cgroup[0] = '\0';
+    usage->cgroup_usage = -1;
+    usage->cgroup_peak = -1;
+    usage->cgroup_limit = -1;
+    v1_path[0] = '\0';
+    v2_path[0] = '\0';
+
+    stream = fopen("/proc/self/status", "r");
+    if (NULL != stream) {
+        while (NULL != fgets(line, sizeof(line), stream)) {
+            if (1 == sscanf(line, "VmRSS: %ld kB", &kb)) {
+                usage->rss = kb * 1024;
+            }
+            else if (1 == sscanf(line, "VmHWM: %ld kB", &kb)) {
+                usage->peak_rss = kb * 1024;
+            }
+        }
+        fclose(stream);
+    }
+    if (0 > usage->peak_rss && 0 == getrusage(RUSAGE_SELF, &rusage)) {
+        usage->peak_rss = rusage.ru_maxrss * 1024L;
+    }
+
+    /*
+     * The unified (v2) hierarchy is the line "0::PATH", the v1 memory
+     * controller the line "N:...memory...:PATH".
+     */
+    stream = fopen("/proc/self/cgroup", "r");
+    if (NULL == stream) {
+        return;
+    }
+    while (NULL != fgets(line, sizeof(line), stream)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (0 == strncmp(line, "0::", 3)) {
+            snprintf(v2_path, sizeof(v2_path), "%s", &line[3]);
+        }
+        else if (NULL != (controllers = strchr(line, ':')) &&
+                 NULL != (cgroup = strchr(controllers + 1, ':')) &&
+                 NULL != (controller = strstr(controllers, "memory")) &&
+                 controller < cgroup) {
+            snprintf(v1_path, sizeof(v1_path), "%s", cgroup + 1);
+        }
+    }
+    fclose(stream);
+
+    if ('\0' != v2_path[0]) {
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.current", v2_path);
+        usage->cgroup_usage = read_number(path);
+    }
+    if (0 <= usage->cgroup_usage) {
+        snprintf(usage->cgroup, sizeof(usage->cgroup), "%s", v2_path);
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.peak", v2_path);
+        usage->cgroup_peak = read_number(path);
+        // "max", no limit, reads as -1
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.max", v2_path);
+        usage->cgroup_limit = read_number(path);
+    }
+    else if ('\0' != v1_path[0]) {
+        snprintf(path, sizeof(path), "/sys/fs/cgroup/memory%s/memory.usage_in_bytes",
+                 v1_path);
+        usage->cgroup_usage = read_number(path);
+        snprintf(usage->cgroup, sizeof(usage->cgroup), "%s", v1_path);
+        snprintf(path, sizeof(path), "/sys/fs/cgroup/memory%s/memory.max_usage_in_bytes",
+                 v1_path);
+        usage->cgroup_peak = read_number(path);
+        snprintf(path, sizeof(path), "/sys/fs/cgroup/memory%s/memory.limit_in_bytes",
+                 v1_path);
+        usage->cgroup_limit = read_number(path);
+        // No limit reads as the largest multiple of the page size
+        if (LONG_MAX / 2 < usage->cgroup_limit) {
+            usage->cgroup_limit = -1;
+        }
+    }
+}
+
+/**
+ * @name   read_number
+ * @brief  Read a file holding a single number.
+ * @param  path: The file
+ * @return The number, -1 if the file cannot be read or is not a number
+ */
+long read_number(const char *path)
+{
+    FILE *stream;
+    long value;
+
+    stream = fopen(path, "r");
+    if (NULL == stream) {
+        return -1;
+    }
+    if (1 != fscanf(stream, "%ld", &value)) {
+        value = -1;
+    }
+    fclose(stream);
+    return value;
+}
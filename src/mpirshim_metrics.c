@@ -0,0 +1,712 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_metrics.c
+ * @brief  Session metrics of the shim.
+ *
+ * The counters cost one relaxed atomic increment where they are counted.
+ * Nothing else happens until the session ends, when its metrics are
+ * written to the sink:
+ *  - JSON: one line per session appended to a file with a single write, so
+ *    that the sessions of a node can share the file.
+ *  - Prometheus: the text format. A file is merged with the metrics of the
+ *    session under a lock and replaced, so that it holds the totals of all
+ *    the sessions writing to it, as read by a textfile collector. The values
+ *    are all counters or histograms, which add up.
+ * Either goes to a local socket instead when the destination is
+ * unix:PATH, one connection per session, never blocking.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// Prefix of a local socket destination
+#define METRICS_SOCKET_PREFIX "unix:"
+
+// Prometheus families, in output order
+typedef struct metric_family_t {
+    const char *name;
+    const char *type;
+    const char *help;
+} metric_family_t;
+
+static const metric_family_t metric_families[] = {
+    {"mpirshim_sessions_total", "counter", "MPIR shim sessions by mode and exit reason."},
+    {"mpirshim_phase_seconds", "histogram", "Time spent in each phase of the sessions."},
+    {"mpirshim_proctable_procs", "histogram", "Processes in the process table of the sessions."},
+    {"mpirshim_events_total", "counter", "PMIx events handled, by handler."},
+    {"mpirshim_connect_retries_total", "counter", "Connections to a launcher that were retried."},
+    {"mpirshim_connections_lost_total", "counter", "Connections to the PMIx server that were lost."},
+    {"mpirshim_server_switches_total", "counter", "Switches of the PMIx server between launchers."},
+    {"mpirshim_output_bytes_total", "counter", "Application output forwarded, by channel."},
+    {"mpirshim_output_suppressed_bytes_total", "counter", "Application output dropped by the rate limit."},
+    {"mpirshim_stdin_bytes_total", "counter", "Standard input forwarded to the application."},
+    {"mpirshim_signals_forwarded_total", "counter", "Signals forwarded to the application."}
+};
+#define METRIC_NUM_FAMILIES (sizeof(metric_families) / sizeof(metric_families[0]))
+
+// Prometheus series and JSON key of each counter
+typedef struct metric_counter_t {
+    const char *series;
+    const char *key;
+} metric_counter_t;
+
+static const metric_counter_t metric_counters[MPIR_SHIM_NUM_METRICS] = {
+    {"mpirshim_events_total{handler=\"default\"}", "events_default"},
+    {"mpirshim_events_total{handler=\"launcher_complete\"}", "events_launcher_complete"},
+    {"mpirshim_events_total{handler=\"launcher_ready\"}", "events_launcher_ready"},
+    {"mpirshim_events_total{handler=\"launcher_terminate\"}", "events_launcher_terminate"},
+    {"mpirshim_events_total{handler=\"application_terminate\"}", "events_application_terminate"},
+    {"mpirshim_events_total{handler=\"proc_failure\"}", "events_proc_failure"},
+    {"mpirshim_connect_retries_total", "connect_retries"},
+    {"mpirshim_connections_lost_total", "connections_lost"},
+    {"mpirshim_server_switches_total", "server_switches"},
+    {"mpirshim_output_bytes_total{channel=\"stdout\"}", "stdout_bytes"},
+    {"mpirshim_output_bytes_total{channel=\"stderr\"}", "stderr_bytes"},
+    {"mpirshim_output_suppressed_bytes_total", "suppressed_bytes"},
+    {"mpirshim_stdin_bytes_total", "stdin_bytes"},
+    {"mpirshim_signals_forwarded_total", "signals_forwarded"}
+};
+
+// Histogram bucket bounds
+static const double phase_buckets[] = {0.001, 0.01, 0.1, 0.5, 1, 2, 5, 10, 30, 60, 300};
+static const double procs_buckets[] = {1, 4, 16, 64, 256, 1024, 4096, 16384, 65536,
+                                       262144, 1048576};
+#define NUM_BUCKETS(buckets) (sizeof(buckets) / sizeof(buckets[0]))
+
+// Prometheus samples, series names with their labels
+typedef struct metric_sample_t {
+    char *series;
+    double value;
+} metric_sample_t;
+
+typedef struct metric_samples_t {
+    metric_sample_t *samples;
+    size_t num_samples;
+    size_t capacity;
+} metric_samples_t;
+
+unsigned long mpir_shim_metrics[MPIR_SHIM_NUM_METRICS];
+
+// The sink: a file or unix:PATH, NULL if none
+static char *metrics_destination = NULL;
+static int metrics_prometheus = 0;
+static int metrics_session_active = 0;
+static int metrics_num_procs = -1;
+
+static int samples_add(metric_samples_t *samples, double value, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+static int samples_observe(metric_samples_t *samples, const char *name, const char *labels,
+                           double value, const double *buckets, size_t num_buckets);
+static void samples_free(metric_samples_t *samples);
+static int session_samples(metric_samples_t *samples, const char *mode,
+                           const char *exit_reason);
+static void write_prometheus(FILE *stream, const metric_samples_t *samples);
+static void write_sample(FILE *stream, const metric_sample_t *sample);
+static void write_json(FILE *stream, const char *mode, const char *launcher,
+                       const char *exit_reason, int status);
+static void write_json_string(FILE *stream, const char *string);
+static int merge_prometheus_file(const metric_samples_t *session);
+static int send_to_socket(const char *path, const char *data, size_t size);
+
+/**
+ * @name   MPIR_Shim_set_metrics
+ * @brief  Write the metrics of each session to a sink when it ends.
+ * @param  destination: A file, "unix:PATH" for a local socket, or NULL to
+ *         not write metrics
+ * @param  format: "json" (default) for one JSON line per session, or
+ *         "prometheus" for the Prometheus text format
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_metrics(const char *destination, const char *format)
+{
+    char *copy = NULL;
+    int prometheus;
+
+    if (NULL == format || 0 == strcmp(format, "json")) {
+        prometheus = 0;
+    }
+    else if (0 == strcmp(format, "prometheus")) {
+        prometheus = 1;
+    }
+    else {
+        fprintf(stderr, "Invalid metrics format '%s'.\n", format);
+        return STATUS_FAIL;
+    }
+
+    if (NULL != destination) {
+        if (0 == strncmp(destination, METRICS_SOCKET_PREFIX, strlen(METRICS_SOCKET_PREFIX)) &&
+            sizeof(((struct sockaddr_un *)NULL)->sun_path) <=
+            strlen(destination + strlen(METRICS_SOCKET_PREFIX))) {
+            fprintf(stderr, "Metrics socket path '%s' is too long.\n", destination);
+            return STATUS_FAIL;
+        }
+        copy = strdup(destination);
+        if (NULL == copy) {
+            fprintf(stderr, "Unable to allocate the metrics destination.\n");
+            return STATUS_FAIL;
+        }
+    }
+    free(metrics_destination);
+    metrics_destination = copy;
+    metrics_prometheus = prometheus;
+    return STATUS_OK;
+}
+
+/**
+ * @name   mpir_shim_metrics_session_start
+ * @brief  Reset the counters at the start of a session.
+ */
+void mpir_shim_metrics_session_start(void)
+{
+    const char *destination;
+    int i;
+
+    for (i = 0; i < MPIR_SHIM_NUM_METRICS; i++) {
+        __atomic_store_n(&mpir_shim_metrics[i], 0, __ATOMIC_RELAXED);
+    }
+    metrics_num_procs = -1;
+    metrics_session_active = 1;
+
+    // Lets a site collect the metrics of every session
+    destination = getenv("MPIR_SHIM_METRICS");
+    if (NULL == metrics_destination && NULL != destination && '\0' != *destination) {
+        (void)MPIR_Shim_set_metrics(destination, getenv("MPIR_SHIM_METRICS_FORMAT"));
+    }
+}
+
+/**
+ * @name   mpir_shim_metrics_proctable
+ * @brief  Record the number of processes of the process table.
+ * @param  num_procs: Number of processes
+ */
+void mpir_shim_metrics_proctable(int num_procs)
+{
+    metrics_num_procs = num_procs;
+}
+
+/**
+ * @name   mpir_shim_metrics_session_end
+ * @brief  Write the metrics of the session to the sink.
+ * @param  mode: proxy, non-proxy or attach
+ * @param  launcher: Name of the launcher
+ * @param  exit_reason: Why the session ended
+ * @param  status: Return code of MPIR_Shim_common
+ */
+void mpir_shim_metrics_session_end(const char *mode, const char *launcher,
+                                   const char *exit_reason, int status)
+{
+    metric_samples_t samples = {NULL, 0, 0};
+    char *data = NULL;
+    size_t size = 0;
+    FILE *stream;
+    int fd, rc = STATUS_OK;
+
+    if (!metrics_session_active) {
+        return;
+    }
+    metrics_session_active = 0;
+    if (NULL == metrics_destination) {
+        return;
+    }
+
+    if (metrics_prometheus) {
+        if (STATUS_OK != session_samples(&samples, mode, exit_reason)) {
+            samples_free(&samples);
+            fprintf(stderr, "Unable to allocate the metrics.\n");
+            return;
+        }
+        if (0 != strncmp(metrics_destination, METRICS_SOCKET_PREFIX,
+                         strlen(METRICS_SOCKET_PREFIX))) {
+            (void)merge_prometheus_file(&samples);
+            samples_free(&samples);
+            return;
+        }
+    }
+
+    stream = open_memstream(&data, &size);
+    if (NULL == stream) {
+        samples_free(&samples);
+        fprintf(stderr, "Unable to allocate the metrics.\n");
+        return;
+    }
+    if (metrics_prometheus) {
+        write_prometheus(stream, &samples);
+    }
+    else {
+        write_json(stream, mode, launcher, exit_reason, status);
+    }
+    fclose(stream);
+    samples_free(&samples);
+
+    if (0 == strncmp(metrics_destination, METRICS_SOCKET_PREFIX,
+                     strlen(METRICS_SOCKET_PREFIX))) {
+        rc = send_to_socket(metrics_destination + strlen(METRICS_SOCKET_PREFIX),
+                            data, size);
+    }
+    else {
+        // One write per line keeps the lines of concurrent sessions whole
+        fd = open(metrics_destination, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (0 > fd || (ssize_t)size != write(fd, data, size)) {
+            rc = STATUS_FAIL;
+        }
+        if (0 <= fd) {
+            close(fd);
+        }
+    }
+    if (STATUS_OK != rc) {
+        fprintf(stderr, "Unable to write the metrics to '%s': %s.\n",
+                metrics_destination, strerror(errno));
+    }
+    free(data);
+}
+
+/**
+ * @name   samples_add
+ * @brief  Add a value to a sample, creating the sample if needed.
+ * @param  samples: The samples
+ * @param  value: Value to add
+ * @param  format: printf format of the series
+ * @return STATUS_OK if successful, STATUS_FAIL if out of memory
+ */
+int samples_add(metric_samples_t *samples, double value, const char *format, ...)
+{
+    metric_sample_t *new_samples;
+    char series[512];
+    va_list args;
+    size_t i;
+
+    va_start(args, format);
+    vsnprintf(series, sizeof(series), format, args);
+    va_end(args);
+
+    for (i = 0; i < samples->num_samples; i++) {
+        if (0 == strcmp(samples->samples[i].series, series)) {
+            samples->samples[i].value += value;
+            return STATUS_OK;
+        }
+    }
+
+    if (samples->num_samples == samples->capacity) {
+        samples->capacity = (0 == samples->capacity) ? 128 : 2 * samples->capacity;
+        new_samples = realloc(samples->samples, samples->capacity * sizeof(metric_sample_t));
+        if (NULL == new_samples) {
+            return STATUS_FAIL;
+        }
+        samples->samples = new_samples;
+    }
+    samples->samples[i].series = strdup(series);
+    if (NULL == samples->samples[i].series) {
+        return STATUS_FAIL;
+    }
+    samples->samples[i].value = value;
+    samples->num_samples++;
+    return STATUS_OK;
+}
+
+/**
+ * @name   samples_observe
+ * @brief  Add an observation to a histogram.
+ * @param  samples: The samples
+ * @param  name: Name of the histogram
+ * @param  labels: Labels of the histogram, followed by a comma, or ""
+ * @param  value: The observation
+ * @param  buckets: Upper bounds of the buckets
+ * @param  num_buckets: Number of bounds
+ * @return STATUS_OK if successful, STATUS_FAIL if out of memory
+ */
+int samples_observe(metric_samples_t *samples, const char *name, const char *labels,
+                    double value, const double *buckets, size_t num_buckets)
+{
+    size_t b;
+    int rc = STATUS_OK;
+
+    for (b = 0; b < num_buckets; b++) {
+        rc |= samples_add(samples, (value <= buckets[b]) ? 1 : 0,
+                          "%s_bucket{%sle=\"%.15g\"}", name, labels, buckets[b]);
+    }
+    rc |= samples_add(samples, 1, "%s_bucket{%sle=\"+Inf\"}", name, labels);
+    if ('\0' == *labels) {
+        rc |= samples_add(samples, value, "%s_sum", name);
+        rc |= samples_add(samples, 1, "%s_count", name);
+    }
+    else {
+        // Without the comma closing the labels
+        rc |= samples_add(samples, value, "%s_sum{%.*s}", name,
+                          (int)strlen(labels) - 1, labels);
+        rc |= samples_add(samples, 1, "%s_count{%.*s}", name,
+                          (int)strlen(labels) - 1, labels);
+    }
+    return rc;
+}
+
+/**
+ * @name   samples_free
+ * @brief  Free samples.
+ * @param  samples: The samples
+ */
+void samples_free(metric_samples_t *samples)
+{
+    size_t i;
+
+    for (i = 0; i < samples->num_samples; i++) {
+        free(samples->samples[i].series);
+    }
+    free(samples->samples);
+    samples->samples = NULL;
+    samples->num_samples = samples->capacity = 0;
+}
+
+/**
+ * @name   session_samples
+ * @brief  Build the Prometheus samples of the session that ended.
+ * @param  samples: The samples
+ * @param  mode: Mode of the session
+ * @param  exit_reason: Why the session ended
+ * @return STATUS_OK if successful, STATUS_FAIL if out of memory
+ */
+int session_samples(metric_samples_t *samples, const char *mode, const char *exit_reason)
+{
+    const MPIR_Shim_timing_t *timings;
+    char labels[128];
+    int num_timings = 0;
+    int i, rc;
+
+    rc = samples_add(samples, 1, "mpirshim_sessions_total{mode=\"%s\",exit_reason=\"%s\"}",
+                     mode, exit_reason);
+
+    (void)MPIR_Shim_get_timings(&timings, &num_timings);
+    for (i = 0; i < num_timings; i++) {
+        snprintf(labels, sizeof(labels), "phase=\"%s\",", timings[i].phase);
+        rc |= samples_observe(samples, "mpirshim_phase_seconds", labels,
+                              timings[i].elapsed_ms / 1e3, phase_buckets,
+                              NUM_BUCKETS(phase_buckets));
+    }
+
+    if (0 <= metrics_num_procs) {
+        rc |= samples_observe(samples, "mpirshim_proctable_procs", "", metrics_num_procs,
+                              procs_buckets, NUM_BUCKETS(procs_buckets));
+    }
+
+    for (i = 0; i < MPIR_SHIM_NUM_METRICS; i++) {
+        rc |= samples_add(samples, __atomic_load_n(&mpir_shim_metrics[i], __ATOMIC_RELAXED),
+                          "%s", metric_counters[i].series);
+    }
+    return rc;
+}
+
+/**
+ * @name   write_prometheus
+ * @brief  Write samples in the Prometheus text format, grouped by family.
+ * @param  stream: Where to write
+ * @param  samples: The samples
+ */
+void write_prometheus(FILE *stream, const metric_samples_t *samples)
+{
+    const metric_family_t *family;
+    const char *rest;
+    char *written;
+    size_t f, i, length;
+    int header;
+
+    written = calloc(samples->num_samples + 1, 1);
+    if (NULL == written) {
+        return;
+    }
+
+    for (f = 0; f < METRIC_NUM_FAMILIES; f++) {
+        family = &metric_families[f];
+        length = strlen(family->name);
+        header = 0;
+        for (i = 0; i < samples->num_samples; i++) {
+            if (0 != strncmp(samples->samples[i].series, family->name, length)) {
+                continue;
+            }
+            rest = samples->samples[i].series + length;
+            if ('h' == family->type[0]) {
+                if (0 == strncmp(rest, "_bucket", 7)) {
+                    rest += 7;
+                }
+                else if (0 == strncmp(rest, "_sum", 4)) {
+                    rest += 4;
+                }
+                else if (0 == strncmp(rest, "_count", 6)) {
+                    rest += 6;
+                }
+            }
+            if ('{' != *rest && '\0' != *rest) {
+                continue;
+            }
+
+            if (!header) {
+                fprintf(stream, "# HELP %s %s\n# TYPE %s %s\n", family->name,
+                        family->help, family->name, family->type);
+                header = 1;
+            }
+            write_sample(stream, &samples->samples[i]);
+            written[i] = 1;
+        }
+    }
+
+    // Series of a newer version of the shim, kept as they were
+    for (i = 0; i < samples->num_samples; i++) {
+        if (!written[i]) {
+            write_sample(stream, &samples->samples[i]);
+        }
+    }
+    free(written);
+}
+
+/**
+ * @name   write_sample
+ * @brief  Write one Prometheus sample. Counts are written in full, sums of
+ *         times to a precision that hides the rounding of the additions.
+ * @param  stream: Where to write
+ * @param  sample: The sample
+ */
+void write_sample(FILE *stream, const metric_sample_t *sample)
+{
+    if (sample->value == (double)(long long)sample->value) {
+        fprintf(stream, "%s %lld\n", sample->series, (long long)sample->value);
+    }
+    else {
+        fprintf(stream, "%s %.9g\n", sample->series, sample->value);
+    }
+}
+
+/**
+ * @name   write_json
+ * @brief  Write the metrics of the session as one JSON line.
+ * @param  stream: Where to write
+ * @param  mode: Mode of the session
+ * @param  launcher: Name of the launcher
+ * @param  exit_reason: Why the session ended
+ * @param  status: Return code of MPIR_Shim_common
+ */
+void write_json(FILE *stream, const char *mode, const char *launcher,
+                const char *exit_reason, int status)
+{
+    const MPIR_Shim_timing_t *timings;
+    struct timespec now;
+    char host[256];
+    double elapsed_ms;
+    int num_timings = 0;
+    int i, j, first;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (0 != gethostname(host, sizeof(host))) {
+        host[0] = '\0';
+    }
+    host[sizeof(host) - 1] = '\0';
+
+    fprintf(stream, "{\"time\": %ld.%06ld, \"pid\": %d, \"host\": ", (long)now.tv_sec,
+            now.tv_nsec / 1000, (int)getpid());
+    write_json_string(stream, host);
+    fprintf(stream, ", \"mode\": \"%s\", \"launcher\": ", mode);
+    write_json_string(stream, launcher);
+    fprintf(stream, ", \"exit_reason\": \"%s\", \"status\": %d, \"num_procs\": %d",
+            exit_reason, status, metrics_num_procs);
+
+    // The phases of several jobs add up
+    fprintf(stream, ", \"phases_ms\": {");
+    (void)MPIR_Shim_get_timings(&timings, &num_timings);
+    for (i = 0, first = 1; i < num_timings; i++) {
+        for (j = 0; j < i && 0 != strcmp(timings[j].phase, timings[i].phase); j++) {
+        }
+        if (j < i) {
+            continue;
+        }
+        for (elapsed_ms = 0, j = i; j < num_timings; j++) {
+            if (0 == strcmp(timings[j].phase, timings[i].phase)) {
+                elapsed_ms += timings[j].elapsed_ms;
+            }
+        }
+        fprintf(stream, "%s\"%s\": %.3f", first ? "" : ", ", timings[i].phase, elapsed_ms);
+        first = 0;
+    }
+
+    fprintf(stream, "}, \"counters\": {");
+    for (i = 0; i < MPIR_SHIM_NUM_METRICS; i++) {
+        fprintf(stream, "%s\"%s\": %lu", (0 == i) ? "" : ", ", metric_counters[i].key,
+                __atomic_load_n(&mpir_shim_metrics[i], __ATOMIC_RELAXED));
+    }
+    fprintf(stream, "}}\n");
+}
+
+/**
+ * @name   write_json_string
+ * @brief  Write a string as a quoted JSON string.
+ * @param  stream: Where to write
+ * @param  string: The string
+ */
+void write_json_string(FILE *stream, const char *string)
+{
+    const unsigned char *c;
+
+    fputc('"', stream);
+    for (c = (const unsigned char *)string; '\0' != *c; c++) {
+        if ('"' == *c || '\\' == *c) {
+            fprintf(stream, "\\%c", *c);
+        }
+        else if (0x20 > *c) {
+            fprintf(stream, "\\u%04x", *c);
+        }
+        else {
+            fputc(*c, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+/**
+ * @name   merge_prometheus_file
+ * @brief  Add the samples of the session to the Prometheus file. Sessions
+ *         writing the same file take turns with a lock on FILE.lock, and
+ *         the file is replaced so that readers never see it half written.
+ * @param  session: Samples of the session
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int merge_prometheus_file(const metric_samples_t *session)
+{
+    metric_samples_t merged = {NULL, 0, 0};
+    char *lock_path = NULL, *temp_path = NULL;
+    char line[1024];
+    char *space, *end;
+    double value;
+    FILE *stream;
+    size_t i;
+    int lock_fd = -1;
+    int rc = STATUS_FAIL;
+
+    if (0 > asprintf(&lock_path, "%s.lock", metrics_destination) ||
+        0 > asprintf(&temp_path, "%s.%d.tmp", metrics_destination, (int)getpid())) {
+        fprintf(stderr, "Unable to allocate the metrics file names.\n");
+        goto done;
+    }
+
+    lock_fd = open(lock_path, O_RDWR | O_CREAT, 0644);
+    if (0 > lock_fd || 0 != flock(lock_fd, LOCK_EX)) {
+        fprintf(stderr, "Unable to lock the metrics file '%s': %s.\n", lock_path,
+                strerror(errno));
+        goto done;
+    }
+
+    stream = fopen(metrics_destination, "r");
+    if (NULL != stream) {
+        while (NULL != fgets(line, sizeof(line), stream)) {
+            line[strcspn(line, "\n")] = '\0';
+            space = strrchr(line, ' ');
+            if ('#' == line[0] || NULL == space) {
+                continue;
+            }
+            *space = '\0';
+            value = strtod(space + 1, &end);
+            if (end != space + 1 && STATUS_OK != samples_add(&merged, value, "%s", line)) {
+                fclose(stream);
+                fprintf(stderr, "Unable to allocate the metrics.\n");
+                goto done;
+            }
+        }
+        fclose(stream);
+    }
+
+    for (i = 0; i < session->num_samples; i++) {
+        if (STATUS_OK != samples_add(&merged, session->samples[i].value, "%s",
+                                     session->samples[i].series)) {
+            fprintf(stderr, "Unable to allocate the metrics.\n");
+            goto done;
+        }
+    }
+
+    stream = fopen(temp_path, "w");
+    if (NULL == stream) {
+        fprintf(stderr, "Unable to open the metrics file '%s': %s.\n", temp_path,
+                strerror(errno));
+        goto done;
+    }
+    write_prometheus(stream, &merged);
+    if (0 != fclose(stream) || 0 != rename(temp_path, metrics_destination)) {
+        fprintf(stderr, "Unable to write the metrics file '%s': %s.\n",
+                metrics_destination, strerror(errno));
+        unlink(temp_path);
+        goto done;
+    }
+    rc = STATUS_OK;
+
+done:
+    if (0 <= lock_fd) {
+        close(lock_fd);
+    }
+    samples_free(&merged);
+    free(lock_path);
+    free(temp_path);
+    return rc;
+}
+
+/**
+ * @name   send_to_socket
+ * @brief  Send the metrics to a local socket, stream or datagram, without
+ *         waiting for a busy listener.
+ * @param  path: Path of the socket
+ * @param  data: The metrics
+ * @param  size: Their size
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int send_to_socket(const char *path, const char *data, size_t size)
+{
+    static const int types[] = {SOCK_STREAM, SOCK_DGRAM};
+    struct sockaddr_un address;
+    size_t t;
+    int fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    for (t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        fd = socket(AF_UNIX, types[t] | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (0 > fd) {
+            return STATUS_FAIL;
+        }
+        if (0 == connect(fd, (struct sockaddr *)&address, sizeof(address))) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+        // A datagram socket refuses stream connections
+        if (EPROTOTYPE != errno) {
+            return STATUS_FAIL;
+        }
+    }
+    if (0 > fd) {
+        return STATUS_FAIL;
+    }
+
+    if ((ssize_t)size != send(fd, data, size, MSG_NOSIGNAL)) {
+        close(fd);
+        return STATUS_FAIL;
+    }
+    close(fd);
+    return STATUS_OK;
+}
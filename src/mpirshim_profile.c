@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_profile.c
+ * @brief  Profiling of the PMIx calls made by the shim.
+ *
+ * Each profiled PMIx call goes through a wrapper here (see
+ * mpirshim_profile.h). With profiling on, the wrapper times the call with a
+ * monotonic clock and records its count, a latency histogram with power of
+ * two microsecond buckets, and its return codes. The summary is printed, or
+ * written as JSON, at exit. Telling the time spent in the PMIx library and
+ * server from the time spent in the shim shows where a slow launch goes.
+ * When the PMIx traffic is recorded or replayed, the wrapper hands the call
+ * to mpirshim_replay.c instead of making it.
+ */
+
+#define MPIR_SHIM_PROFILE_IMPL
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_profile.h"
+#include "mpirshim_replay.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// The profiled calls
+typedef enum {
+    PROF_TOOL_INIT = 0,
+    PROF_TOOL_FINALIZE,
+    PROF_TOOL_SET_SERVER,
+    PROF_SPAWN,
+    PROF_QUERY_INFO,
+    PROF_NOTIFY_EVENT,
+    PROF_REGISTER_EVENT_HANDLER,
+    PROF_GET,
+    PROF_JOB_CONTROL,
+    PROF_JOB_CONTROL_NB,
+    PROF_IOF_PULL,
+    PROF_IOF_PUSH,
+    PROF_NUM_CALLS
+} prof_call_id_t;
+
+static const char *prof_names[PROF_NUM_CALLS] = {
+    "PMIx_tool_init",
+    "PMIx_tool_finalize",
+    "PMIx_tool_set_server",
+    "PMIx_Spawn",
+    "PMIx_Query_info",
+    "PMIx_Notify_event",
+    "PMIx_Register_event_handler",
+    "PMIx_Get",
+    "PMIx_Job_control",
+    "PMIx_Job_control_nb",
+    "PMIx_IOF_pull",
+    "PMIx_IOF_push"
+};
+
+// Bucket b of the latency histogram counts the calls that took less than
+// 2^b microseconds, the last one everything longer
+#define PROF_NUM_BUCKETS 32
+// Distinct return codes counted per call, the others are counted together
+#define PROF_MAX_CODES 8
+
+typedef struct prof_code_t {
+    pmix_status_t code;
+    unsigned long count;
+} prof_code_t;
+
+// Statistics of one profiled call
+typedef struct prof_call_t {
+    unsigned long count;
+    unsigned long errors;
+    double total_us;
+    double min_us;
+    double max_us;
+    unsigned long buckets[PROF_NUM_BUCKETS];
+    prof_code_t codes[PROF_MAX_CODES];
+    int num_codes;
+    unsigned long other_codes;
+} prof_call_t;
+
+int mpir_shim_profile_enabled = 0;
+
+static prof_call_t prof_calls[PROF_NUM_CALLS];
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+// Where the summary goes at exit, stderr if NULL
+static char *prof_file = NULL;
+static int prof_exit_registered = 0;
+
+static void prof_record(prof_call_id_t id, const struct timespec *start,
+                        pmix_status_t rc);
+static double prof_percentile(const prof_call_t *call, double fraction);
+static void prof_exit_handler(void);
+
+/*
+ * Body of a wrapper: make the call directly when profiling is off,
+ * otherwise time it and record it.
+ */
+#define PROF_CALL(id_, call_)                                           \
+    pmix_status_t rc;                                                   \
+    struct timespec start;                                              \
+                                                                        \
+    if (!mpir_shim_profile_enabled) {                                   \
+        return call_;                                                   \
+    }                                                                   \
+    clock_gettime(CLOCK_MONOTONIC, &start);                             \
+    rc = call_;                                                         \
+    prof_record(id_, &start, rc);                                       \
+    return rc
+
+/*
+ * The call a wrapper makes: the PMIx call itself, or its recording or
+ * replay.
+ */
+#define PROF_PMIX(name_, args_)                                         \
+    ((MPIR_SHIM_REPLAY_OFF == mpir_shim_replay_mode) ?                  \
+     PMIx_##name_ args_ : mpir_shim_replay_PMIx_##name_ args_)
+
+/**
+ * @name   MPIR_Shim_set_pmix_profile
+ * @brief  Profile the PMIx calls of the shim, and report them at exit.
+ * @param  file: File to write the profile to as JSON, NULL to print a
+ *         summary to stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_profile(const char *file)
+{
+    char *copy = NULL;
+
+    if (NULL != file && NULL == (copy = strdup(file))) {
+        fprintf(stderr, "Unable to allocate the PMIx profile file name.\n");
+        return STATUS_FAIL;
+    }
+    free(prof_file);
+    prof_file = copy;
+
+    if (!prof_exit_registered) {
+        if (0 != atexit(prof_exit_handler)) {
+            fprintf(stderr, "An error occurred setting an exit handler.\n");
+            return STATUS_FAIL;
+        }
+        prof_exit_registered = 1;
+    }
+    mpir_shim_profile_enabled = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_write_pmix_profile
+ * @brief  Write the PMIx call profile gathered so far.
+ * @param  file: File to write the profile to as JSON, NULL to print a
+ *         summary to stderr
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_write_pmix_profile(const char *file)
+{
+    FILE *stream;
+    prof_call_t *call;
+    int i, b, c, first;
+
+    if (NULL == file) {
+        stream = stderr;
+    }
+    else if (NULL == (stream = fopen(file, "w"))) {
+        fprintf(stderr, "Unable to open the PMIx profile file '%s': %s.\n",
+                file, strerror(errno));
+        return STATUS_FAIL;
+    }
+
+    pthread_mutex_lock(&prof_lock);
+    if (NULL == file) {
+        fprintf(stream, "PMIx call profile (times in microseconds):\n");
+        fprintf(stream, "%-28s %8s %7s %12s %10s %10s %10s %10s %10s\n", "call",
+                "count", "errors", "total", "min", "avg", "p50", "p99", "max");
+    }
+    else {
+        fprintf(stream, "{\n  \"calls\": [");
+    }
+
+    first = 1;
+    for (i = 0; i < PROF_NUM_CALLS; i++) {
+        call = &prof_calls[i];
+        if (0 == call->count) {
+            continue;
+        }
+
+        if (NULL == file) {
+            fprintf(stream, "%-28s %8lu %7lu %12.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                    prof_names[i], call->count, call->errors, call->total_us,
+                    call->min_us, call->total_us / call->count,
+                    prof_percentile(call, 0.5), prof_percentile(call, 0.99),
+                    call->max_us);
+            if (0 != call->errors) {
+                fprintf(stream, "%-28s", "  return codes:");
+                for (c = 0; c < call->num_codes; c++) {
+                    fprintf(stream, " %s=%lu", PMIx_Error_string(call->codes[c].code),
+                            call->codes[c].count);
+                }
+                if (0 != call->other_codes) {
+                    fprintf(stream, " other=%lu", call->other_codes);
+                }
+                fprintf(stream, "\n");
+            }
+            continue;
+        }
+
+        fprintf(stream, "%s\n    {\"name\": \"%s\", \"count\": %lu, \"errors\": %lu, "
+                "\"total_us\": %.3f, \"min_us\": %.3f, \"max_us\": %.3f,\n",
+                first ? "" : ",", prof_names[i], call->count, call->errors,
+                call->total_us, call->min_us, call->max_us);
+        first = 0;
+        fprintf(stream, "     \"histogram\": [");
+        for (b = 0, c = 0; b < PROF_NUM_BUCKETS; b++) {
+            if (0 == call->buckets[b]) {
+                continue;
+            }
+            if (PROF_NUM_BUCKETS - 1 == b) {
+                fprintf(stream, "%s{\"lt_us\": null, \"count\": %lu}",
+                        (0 == c++) ? "" : ", ", call->buckets[b]);
+            }
+            else {
+                fprintf(stream, "%s{\"lt_us\": %lu, \"count\": %lu}",
+                        (0 == c++) ? "" : ", ", 1UL << b, call->buckets[b]);
+            }
+        }
+        fprintf(stream, "],\n     \"return_codes\": [");
+        for (c = 0; c < call->num_codes; c++) {
+            fprintf(stream, "%s{\"code\": %d, \"name\": \"%s\", \"count\": %lu}",
+                    (0 == c) ? "" : ", ", call->codes[c].code,
+                    PMIx_Error_string(call->codes[c].code), call->codes[c].count);
+        }
+        fprintf(stream, "], \"other_codes\": %lu}", call->other_codes);
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    if (NULL == file) {
+        return STATUS_OK;
+    }
+    fprintf(stream, "\n  ]\n}\n");
+    if (0 != fclose(stream)) {
+        fprintf(stderr, "Unable to write the PMIx profile file '%s': %s.\n",
+                file, strerror(errno));
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   prof_record
+ * @brief  Record a profiled call that just returned.
+ * @param  id: The call
+ * @param  start: When the call was made
+ * @param  rc: What it returned
+ */
+void prof_record(prof_call_id_t id, const struct timespec *start, pmix_status_t rc)
+{
+    struct timespec now;
+    prof_call_t *call = &prof_calls[id];
+    double us;
+    int b, c;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+
+    for (b = 0; b < PROF_NUM_BUCKETS - 1 && (double)(1UL << b) <= us; b++) {
+    }
+
+    pthread_mutex_lock(&prof_lock);
+    if (0 == call->count || us < call->min_us) {
+        call->min_us = us;
+    }
+    if (us > call->max_us) {
+        call->max_us = us;
+    }
+    call->count++;
+    call->total_us += us;
+    call->buckets[b]++;
+
+    // Non-negative results, such as handler ids, are successes
+    if (0 > rc && PMIX_OPERATION_SUCCEEDED != rc) {
+        call->errors++;
+    }
+    for (c = 0; c < call->num_codes; c++) {
+        if (call->codes[c].code == (0 < rc ? PMIX_SUCCESS : rc)) {
+            break;
+        }
+    }
+    if (c == call->num_codes && PROF_MAX_CODES > c) {
+        call->codes[c].code = (0 < rc ? PMIX_SUCCESS : rc);
+        call->num_codes++;
+    }
+    if (c < call->num_codes) {
+        call->codes[c].count++;
+    }
+    else {
+        call->other_codes++;
+    }
+    pthread_mutex_unlock(&prof_lock);
+}
+
+/**
+ * @name   prof_percentile
+ * @brief  Estimate a latency percentile of a call from its histogram, as the
+ *         upper bound of the bucket it falls in, capped by the maximum.
+ * @param  call: The call
+ * @param  fraction: The percentile, between 0 and 1
+ * @return Microseconds
+ */
+double prof_percentile(const prof_call_t *call, double fraction)
+{
+    unsigned long seen = 0;
+    int b;
+
+    for (b = 0; b < PROF_NUM_BUCKETS - 1; b++) {
+        seen += call->buckets[b];
+        if (seen >= fraction * call->count) {
+            break;
+        }
+    }
+    if (PROF_NUM_BUCKETS - 1 == b || call->max_us < (double)(1UL << b)) {
+        return call->max_us;
+    }
+    return (double)(1UL << b);
+}
+
+/**
+ * @name   prof_exit_handler
+ * @brief  Report the profile at exit.
+ */
+void prof_exit_handler(void)
+{
+    if (mpir_shim_profile_enabled) {
+        (void)MPIR_Shim_write_pmix_profile(prof_file);
+    }
+}
+
+pmix_status_t mpir_shim_prof_PMIx_tool_init(pmix_proc_t *proc,
+                                            pmix_info_t info[], size_t ninfo)
+{
+    PROF_CALL(PROF_TOOL_INIT, PROF_PMIX(tool_init, (proc, info, ninfo)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_tool_finalize(void)
+{
+    PROF_CALL(PROF_TOOL_FINALIZE, PROF_PMIX(tool_finalize, ()));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_tool_set_server(const pmix_proc_t *server,
+                                                  pmix_info_t info[], size_t ninfo)
+{
+    PROF_CALL(PROF_TOOL_SET_SERVER,
+              PROF_PMIX(tool_set_server, (server, info, ninfo)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Spawn(const pmix_info_t job_info[], size_t ninfo,
+                                        const pmix_app_t apps[], size_t napps,
+                                        pmix_nspace_t nspace)
+{
+    PROF_CALL(PROF_SPAWN, PROF_PMIX(Spawn, (job_info, ninfo, apps, napps, nspace)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Query_info(pmix_query_t queries[], size_t nqueries,
+                                             pmix_info_t **results, size_t *nresults)
+{
+    PROF_CALL(PROF_QUERY_INFO,
+              PROF_PMIX(Query_info, (queries, nqueries, results, nresults)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Notify_event(pmix_status_t status,
+                                               const pmix_proc_t *source,
+                                               pmix_data_range_t range,
+                                               const pmix_info_t info[], size_t ninfo,
+                                               pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    PROF_CALL(PROF_NOTIFY_EVENT,
+              PROF_PMIX(Notify_event, (status, source, range, info, ninfo,
+                                       cbfunc, cbdata)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Register_event_handler(pmix_status_t codes[],
+                                                         size_t ncodes,
+                                                         pmix_info_t info[], size_t ninfo,
+                                                         pmix_notification_fn_t evhdlr,
+                                                         pmix_hdlr_reg_cbfunc_t cbfunc,
+                                                         void *cbdata)
+{
+    PROF_CALL(PROF_REGISTER_EVENT_HANDLER,
+              PROF_PMIX(Register_event_handler, (codes, ncodes, info, ninfo, evhdlr,
+                                                 cbfunc, cbdata)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Get(const pmix_proc_t *proc, const char key[],
+                                      const pmix_info_t info[], size_t ninfo,
+                                      pmix_value_t **val)
+{
+    PROF_CALL(PROF_GET, PROF_PMIX(Get, (proc, key, info, ninfo, val)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Job_control(const pmix_proc_t targets[], size_t ntargets,
+                                              const pmix_info_t directives[], size_t ndirs,
+                                              pmix_info_t **results, size_t *nresults)
+{
+    PROF_CALL(PROF_JOB_CONTROL,
+              PROF_PMIX(Job_control, (targets, ntargets, directives, ndirs,
+                                      results, nresults)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_Job_control_nb(const pmix_proc_t targets[],
+                                                 size_t ntargets,
+                                                 const pmix_info_t directives[],
+                                                 size_t ndirs,
+                                                 pmix_info_cbfunc_t cbfunc, void *cbdata)
+{
+    PROF_CALL(PROF_JOB_CONTROL_NB,
+              PROF_PMIX(Job_control_nb, (targets, ntargets, directives, ndirs,
+                                         cbfunc, cbdata)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_IOF_pull(const pmix_proc_t procs[], size_t nprocs,
+                                           const pmix_info_t directives[], size_t ndirs,
+                                           pmix_iof_channel_t channel,
+                                           pmix_iof_cbfunc_t cbfunc,
+                                           pmix_hdlr_reg_cbfunc_t regcbfunc,
+                                           void *regcbdata)
+{
+    PROF_CALL(PROF_IOF_PULL,
+              PROF_PMIX(IOF_pull, (procs, nprocs, directives, ndirs, channel,
+                                   cbfunc, regcbfunc, regcbdata)));
+}
+
+pmix_status_t mpir_shim_prof_PMIx_IOF_push(const pmix_proc_t targets[], size_t ntargets,
+                                           pmix_byte_object_t *bo,
+                                           const pmix_info_t directives[], size_t ndirs,
+                                           pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    PROF_CALL(PROF_IOF_PUSH,
+              PROF_PMIX(IOF_push, (targets, ntargets, bo, directives, ndirs,
+                                   cbfunc, cbdata)));
+}
@@ -0,0 +1,2335 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_replay.c
+ * @brief  Recording and replay of the PMIx traffic of the shim.
+ *
+ * A capture holds four kinds of records:
+ *   call      What a PMIx call returned: its return code and its outputs,
+ *             such as the process table of a query or the namespace of a
+ *             spawn, with when it was made and how long it took.
+ *   event     An event delivered to one of the handlers of the shim.
+ *   output    Application output delivered to one of the output pulls.
+ *   complete  The completion of a non-blocking job control request.
+ * Calls are numbered in the order they were made. An event, output or
+ * completion records how many calls had been made when it arrived and how
+ * long after the last of them, which is what it waits for when replayed.
+ * Handlers and pulls are named by the order they were registered in, since
+ * the ids PMIx gave them only mean something to that PMIx.
+ *
+ * When replaying, each call takes the next record of the same call with the
+ * same request, such as the same query keys and qualifiers, or the last one
+ * again once they are used up, as a process table query polled more often
+ * than when recorded would. Calls return at once and events
+ * follow their call at once, unless the replay is timed, in which case
+ * calls take and events wait as long as they did.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_replay.h"
+#include "mpirshim_memory.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// The recorded calls, in the order of mpirshim_profile.c
+typedef enum {
+    REPLAY_TOOL_INIT = 0,
+    REPLAY_TOOL_FINALIZE,
+    REPLAY_TOOL_SET_SERVER,
+    REPLAY_SPAWN,
+    REPLAY_QUERY_INFO,
+    REPLAY_NOTIFY_EVENT,
+    REPLAY_REGISTER_EVENT_HANDLER,
+    REPLAY_GET,
+    REPLAY_JOB_CONTROL,
+    REPLAY_JOB_CONTROL_NB,
+    REPLAY_IOF_PULL,
+    REPLAY_IOF_PUSH,
+    REPLAY_NUM_CALLS
+} replay_call_id_t;
+
+static const char *replay_names[REPLAY_NUM_CALLS] = {
+    "PMIx_tool_init",
+    "PMIx_tool_finalize",
+    "PMIx_tool_set_server",
+    "PMIx_Spawn",
+    "PMIx_Query_info",
+    "PMIx_Notify_event",
+    "PMIx_Register_event_handler",
+    "PMIx_Get",
+    "PMIx_Job_control",
+    "PMIx_Job_control_nb",
+    "PMIx_IOF_pull",
+    "PMIx_IOF_push"
+};
+
+// Kinds of records
+typedef enum {
+    REPLAY_RECORD_CALL = 0,
+    REPLAY_RECORD_EVENT,
+    REPLAY_RECORD_OUTPUT,
+    REPLAY_RECORD_COMPLETE
+} replay_record_kind_t;
+
+// An event handler or output pull, in the order they were registered
+typedef struct replay_handler_t {
+    // PMIx_Register_event_handler or PMIx_IOF_pull
+    replay_call_id_t call;
+    pmix_notification_fn_t evhdlr;
+    pmix_iof_cbfunc_t iofhdlr;
+    // Completion of the registration, given by the shim
+    pmix_hdlr_reg_cbfunc_t cbfunc;
+    void *cbdata;
+    // PMIX_EVENT_RETURN_OBJECT of the registration, given back with events
+    void *return_object;
+    size_t id;
+    int have_id;
+    // The registration call while recording, written once it completed
+    uint64_t seq;
+    uint64_t start_us;
+    uint64_t duration_us;
+    pmix_status_t rc;
+    pmix_status_t reg_status;
+    int returned;
+    int registered;
+} replay_handler_t;
+
+// A non-blocking job control request, in the order they were made
+typedef struct replay_request_t {
+    pmix_info_cbfunc_t cbfunc;
+    void *cbdata;
+    uint32_t ordinal;
+} replay_request_t;
+
+// A record being written
+typedef struct replay_buffer_t {
+    unsigned char *data;
+    size_t size;
+    size_t used;
+    int failed;
+} replay_buffer_t;
+
+// A record being read
+typedef struct replay_cursor_t {
+    const unsigned char *next;
+    const unsigned char *end;
+    int failed;
+} replay_cursor_t;
+
+// A record of the capture being replayed
+typedef struct replay_record_t {
+    const unsigned char *body;
+    size_t size;
+    replay_record_kind_t kind;
+    // Calls made before an event, output or completion, and when it came
+    uint64_t after;
+    uint64_t time_us;
+} replay_record_t;
+
+// The records of one call with one request, or the stream of the others
+typedef struct replay_list_t {
+    replay_call_id_t call;
+    uint64_t signature;
+    replay_record_t *records;
+    size_t num;
+    size_t capacity;
+    size_t next;
+} replay_list_t;
+
+mpir_shim_replay_mode_t mpir_shim_replay_mode = MPIR_SHIM_REPLAY_OFF;
+
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+// Signaled as calls are replayed, on the monotonic clock
+static pthread_cond_t replay_cond;
+static int replay_cond_ready = 0;
+// Calls made so far, recorded or replayed
+static uint64_t replay_num_calls = 0;
+static replay_handler_t **replay_handlers = NULL;
+static size_t replay_num_handlers = 0;
+static replay_handler_t **replay_pulls = NULL;
+static size_t replay_num_pulls = 0;
+static replay_request_t *replay_requests = NULL;
+static size_t replay_requests_capacity = 0;
+static uint32_t replay_num_requests = 0;
+
+// Recording
+static FILE *record_stream = NULL;
+static int record_exit_registered = 0;
+
+// Replaying
+static unsigned char *play_capture = NULL;
+static size_t play_capture_size = 0;
+static int play_timed = 0;
+static replay_list_t *play_calls = NULL;
+static size_t play_num_calls = 0;
+static size_t play_calls_capacity = 0;
+static replay_list_t play_stream;
+// When each call started, as recorded and as replayed, by call number
+static uint64_t *play_recorded_start = NULL;
+static uint64_t *play_replayed_start = NULL;
+static uint64_t play_num_starts = 0;
+static pthread_t play_thread;
+static int play_thread_running = 0;
+static int play_stop = 0;
+// Set while a registration is replayed, between the call being counted and
+// its handler being added, when an event due after the call must wait
+static int play_registering = 0;
+static int play_missing_reported[REPLAY_NUM_CALLS];
+
+static uint64_t replay_now_us(void);
+static int replay_grow(void **array, size_t *capacity, size_t count, size_t size);
+static void replay_reset(void);
+static int replay_add_handler(replay_handler_t ***handlers, size_t *num_handlers,
+                              replay_handler_t *handler);
+static replay_handler_t *replay_find_handler(replay_handler_t **handlers,
+                                             size_t num_handlers, size_t id,
+                                             uint32_t *index);
+static uint64_t replay_signature(replay_buffer_t *buf);
+static uint64_t sign_query(const pmix_query_t queries[], size_t nqueries);
+static uint64_t sign_get(const pmix_proc_t *proc, const char key[]);
+static uint64_t sign_infos(const pmix_info_t info[], size_t ninfo);
+static size_t element_size(pmix_data_type_t type);
+static size_t scalar_size(pmix_data_type_t type);
+
+static void put(replay_buffer_t *buf, const void *data, size_t size);
+static void put_u32(replay_buffer_t *buf, uint32_t value);
+static void put_u64(replay_buffer_t *buf, uint64_t value);
+static void put_i32(replay_buffer_t *buf, int32_t value);
+static void put_string(replay_buffer_t *buf, const char *string);
+static void put_proc(replay_buffer_t *buf, const pmix_proc_t *proc);
+static void put_element(replay_buffer_t *buf, pmix_data_type_t type, const void *element);
+static void put_value(replay_buffer_t *buf, const pmix_value_t *value);
+static void put_infos(replay_buffer_t *buf, const pmix_info_t *info, size_t ninfo);
+
+static void get(replay_cursor_t *cur, void *data, size_t size);
+static uint32_t get_u32(replay_cursor_t *cur);
+static uint64_t get_u64(replay_cursor_t *cur);
+static int32_t get_i32(replay_cursor_t *cur);
+static char *get_string(replay_cursor_t *cur);
+static void get_string_to(replay_cursor_t *cur, char *dest, size_t size);
+static void get_proc(replay_cursor_t *cur, pmix_proc_t *proc);
+static void get_element(replay_cursor_t *cur, pmix_data_type_t type, void *element,
+                        void *return_object);
+static void get_value(replay_cursor_t *cur, pmix_value_t *value, const char *key,
+                      void *return_object);
+static pmix_info_t *get_infos(replay_cursor_t *cur, size_t *ninfo, void *return_object);
+
+static void record_begin(replay_buffer_t *buf, uint64_t *seq, uint64_t *start_us);
+static void record_returned(replay_buffer_t *buf, uint64_t seq, uint64_t signature,
+                            uint64_t start_us, pmix_status_t rc);
+static void record_write(replay_record_kind_t kind, replay_call_id_t call,
+                         replay_buffer_t *buf);
+static void record_write_locked(replay_record_kind_t kind, replay_call_id_t call,
+                                replay_buffer_t *buf);
+static void record_begin_callback(replay_buffer_t *buf);
+static void record_registration(replay_handler_t *handler);
+static void record_registered(pmix_status_t status, size_t refid, void *cbdata);
+static void record_event(size_t evhdlr_registration_id, pmix_status_t status,
+                         const pmix_proc_t *source, pmix_info_t info[], size_t ninfo,
+                         pmix_info_t results[], size_t nresults,
+                         pmix_event_notification_cbfunc_fn_t cbfunc, void *cbdata);
+static void record_output(size_t iofhdlr, pmix_iof_channel_t channel,
+                          pmix_proc_t *source, pmix_byte_object_t *payload,
+                          pmix_info_t info[], size_t ninfo);
+static void record_completed(pmix_status_t status, pmix_info_t *info, size_t ninfo,
+                             void *cbdata, pmix_release_cbfunc_t release_fn,
+                             void *release_cbdata);
+static void record_close(void);
+
+static int play_load(const char *file);
+static replay_list_t *play_find_calls(replay_call_id_t call, uint64_t signature,
+                                      int create);
+static pmix_status_t play_call(replay_call_id_t call, uint64_t signature,
+                               replay_cursor_t *cur);
+static pmix_status_t play_check(replay_call_id_t call, replay_cursor_t *cur,
+                                pmix_status_t rc);
+static pmix_status_t play_registration(replay_handler_t *handler,
+                                       pmix_hdlr_reg_cbfunc_t cbfunc, void *cbdata);
+static void play_start(void);
+static void play_finish(void);
+static void *play_thread_main(void *arg);
+static void play_deliver(const replay_record_t *record);
+static void play_event_done(pmix_status_t status, pmix_info_t *results, size_t nresults,
+                            pmix_op_cbfunc_t cbfunc, void *thiscbdata,
+                            void *notification_cbdata);
+
+/**
+ * @name   MPIR_Shim_set_pmix_record
+ * @brief  Record the PMIx traffic of the shim in a capture file.
+ * @param  file: The file, replaced, NULL to stop recording
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_record(const char *file)
+{
+    FILE *stream;
+    uint32_t version = MPIR_SHIM_REPLAY_VERSION;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        fprintf(stderr, "PMIx traffic cannot be recorded while it is replayed.\n");
+        return STATUS_FAIL;
+    }
+    record_close();
+    if (NULL == file) {
+        return STATUS_OK;
+    }
+
+    stream = fopen(file, "w");
+    if (NULL == stream) {
+        fprintf(stderr, "Unable to open the PMIx capture file '%s': %s.\n", file,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+    if (1 != fwrite(MPIR_SHIM_REPLAY_MAGIC, 8, 1, stream) ||
+        1 != fwrite(&version, sizeof(version), 1, stream)) {
+        fprintf(stderr, "Unable to write the PMIx capture file '%s': %s.\n", file,
+                strerror(errno));
+        fclose(stream);
+        return STATUS_FAIL;
+    }
+
+    if (!record_exit_registered) {
+        if (0 != atexit(record_close)) {
+            fprintf(stderr, "An error occurred setting an exit handler.\n");
+            fclose(stream);
+            return STATUS_FAIL;
+        }
+        record_exit_registered = 1;
+    }
+
+    replay_reset();
+    pthread_mutex_lock(&replay_lock);
+    record_stream = stream;
+    pthread_mutex_unlock(&replay_lock);
+    mpir_shim_replay_mode = MPIR_SHIM_REPLAY_RECORD;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_pmix_replay
+ * @brief  Replay a capture instead of calling PMIx.
+ * @param  file: The capture, NULL to stop replaying
+ * @param  timed: Non-zero to take as long as the recorded calls and events
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_pmix_replay(const char *file, int timed)
+{
+    pthread_condattr_t attr;
+
+    if (MPIR_SHIM_REPLAY_RECORD == mpir_shim_replay_mode) {
+        fprintf(stderr, "PMIx traffic cannot be replayed while it is recorded.\n");
+        return STATUS_FAIL;
+    }
+    if (play_thread_running) {
+        fprintf(stderr, "The PMIx capture cannot be changed during a session.\n");
+        return STATUS_FAIL;
+    }
+    mpir_shim_replay_mode = MPIR_SHIM_REPLAY_OFF;
+    replay_reset();
+    if (NULL == file) {
+        return STATUS_OK;
+    }
+
+    if (!replay_cond_ready) {
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&replay_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        replay_cond_ready = 1;
+    }
+    if (STATUS_OK != play_load(file)) {
+        replay_reset();
+        return STATUS_FAIL;
+    }
+    play_timed = timed;
+    mpir_shim_replay_mode = MPIR_SHIM_REPLAY_PLAY;
+    return STATUS_OK;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_tool_init(pmix_proc_t *proc,
+                                              pmix_info_t info[], size_t ninfo)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_TOOL_INIT, 0, &cur);
+        get_proc(&cur, proc);
+        rc = play_check(REPLAY_TOOL_INIT, &cur, rc);
+        play_start();
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_tool_init(proc, info, ninfo);
+    record_returned(&buf, seq, 0, start_us, rc);
+    put_proc(&buf, proc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_TOOL_INIT, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_tool_finalize(void)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        // PMIx delivers nothing once finalized
+        play_finish();
+        rc = play_call(REPLAY_TOOL_FINALIZE, 0, &cur);
+        return play_check(REPLAY_TOOL_FINALIZE, &cur, rc);
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_tool_finalize();
+    record_returned(&buf, seq, 0, start_us, rc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_TOOL_FINALIZE, &buf);
+
+    pthread_mutex_lock(&replay_lock);
+    if (NULL != record_stream) {
+        fflush(record_stream);
+    }
+    pthread_mutex_unlock(&replay_lock);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_tool_set_server(const pmix_proc_t *server,
+                                                    pmix_info_t info[], size_t ninfo)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_TOOL_SET_SERVER, 0, &cur);
+        return play_check(REPLAY_TOOL_SET_SERVER, &cur, rc);
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_tool_set_server(server, info, ninfo);
+    record_returned(&buf, seq, 0, start_us, rc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_TOOL_SET_SERVER, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Spawn(const pmix_info_t job_info[], size_t ninfo,
+                                          const pmix_app_t apps[], size_t napps,
+                                          pmix_nspace_t nspace)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_nspace_t spawned;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_SPAWN, 0, &cur);
+        get_string_to(&cur, spawned, sizeof(spawned));
+        rc = play_check(REPLAY_SPAWN, &cur, rc);
+        if (PMIX_SUCCESS == rc && NULL != nspace) {
+            PMIX_LOAD_NSPACE(nspace, spawned);
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Spawn(job_info, ninfo, apps, napps, nspace);
+    record_returned(&buf, seq, 0, start_us, rc);
+    put_string(&buf, (PMIX_SUCCESS == rc && NULL != nspace) ? nspace : "");
+    record_write(REPLAY_RECORD_CALL, REPLAY_SPAWN, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Query_info(pmix_query_t queries[], size_t nqueries,
+                                               pmix_info_t **results, size_t *nresults)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_info_t *infos;
+    size_t ninfos;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_QUERY_INFO, sign_query(queries, nqueries), &cur);
+        infos = get_infos(&cur, &ninfos, NULL);
+        rc = play_check(REPLAY_QUERY_INFO, &cur, rc);
+        if (NULL != infos && (PMIX_SUCCESS != rc || NULL == results)) {
+            PMIX_INFO_FREE(infos, ninfos);
+            infos = NULL;
+            ninfos = 0;
+        }
+        if (NULL != results) {
+            *results = infos;
+            *nresults = ninfos;
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Query_info(queries, nqueries, results, nresults);
+    record_returned(&buf, seq, sign_query(queries, nqueries), start_us, rc);
+    if (PMIX_SUCCESS == rc && NULL != results) {
+        put_infos(&buf, *results, *nresults);
+    }
+    else {
+        put_infos(&buf, NULL, 0);
+    }
+    record_write(REPLAY_RECORD_CALL, REPLAY_QUERY_INFO, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Notify_event(pmix_status_t status,
+                                                 const pmix_proc_t *source,
+                                                 pmix_data_range_t range,
+                                                 const pmix_info_t info[], size_t ninfo,
+                                                 pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_NOTIFY_EVENT, 0, &cur);
+        rc = play_check(REPLAY_NOTIFY_EVENT, &cur, rc);
+        if (PMIX_SUCCESS == rc && NULL != cbfunc) {
+            cbfunc(PMIX_SUCCESS, cbdata);
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Notify_event(status, source, range, info, ninfo, cbfunc, cbdata);
+    record_returned(&buf, seq, 0, start_us, rc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_NOTIFY_EVENT, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Register_event_handler(pmix_status_t codes[],
+                                                           size_t ncodes,
+                                                           pmix_info_t info[],
+                                                           size_t ninfo,
+                                                           pmix_notification_fn_t evhdlr,
+                                                           pmix_hdlr_reg_cbfunc_t cbfunc,
+                                                           void *cbdata)
+{
+    replay_handler_t *handler;
+    pmix_status_t rc;
+    size_t i;
+
+    handler = calloc(1, sizeof(replay_handler_t));
+    if (NULL == handler) {
+        fprintf(stderr, "Unable to allocate a recorded event handler.\n");
+        return PMIX_ERR_NOMEM;
+    }
+    handler->call = REPLAY_REGISTER_EVENT_HANDLER;
+    handler->evhdlr = evhdlr;
+    for (i = 0; i < ninfo; i++) {
+        if (PMIX_CHECK_KEY(&info[i], PMIX_EVENT_RETURN_OBJECT)) {
+            handler->return_object = info[i].value.data.ptr;
+        }
+    }
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        return play_registration(handler, cbfunc, cbdata);
+    }
+
+    handler->cbfunc = cbfunc;
+    handler->cbdata = cbdata;
+    if (STATUS_OK != replay_add_handler(&replay_handlers, &replay_num_handlers, handler)) {
+        free(handler);
+        return PMIX_ERR_NOMEM;
+    }
+    record_begin(NULL, &handler->seq, &handler->start_us);
+    rc = PMIx_Register_event_handler(codes, ncodes, info, ninfo, record_event,
+                                     (NULL == cbfunc) ? NULL : record_registered,
+                                     handler);
+    pthread_mutex_lock(&replay_lock);
+    handler->duration_us = replay_now_us() - handler->start_us;
+    handler->rc = rc;
+    handler->returned = 1;
+    // Without a callback the call is blocking and returns the id
+    if (NULL == cbfunc || PMIX_SUCCESS != rc) {
+        handler->registered = 1;
+        handler->reg_status = (0 > rc) ? rc : PMIX_SUCCESS;
+        if (0 <= rc) {
+            handler->id = (size_t)rc;
+            handler->have_id = 1;
+        }
+    }
+    if (handler->registered) {
+        record_registration(handler);
+    }
+    pthread_mutex_unlock(&replay_lock);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Get(const pmix_proc_t *proc, const char key[],
+                                        const pmix_info_t info[], size_t ninfo,
+                                        pmix_value_t **val)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_value_t *value = NULL;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_GET, sign_get(proc, key), &cur);
+        if (0 != get_u32(&cur)) {
+            PMIX_VALUE_CREATE(value, 1);
+            if (NULL == value) {
+                cur.failed = 1;
+            }
+            else {
+                get_value(&cur, value, key, NULL);
+            }
+        }
+        rc = play_check(REPLAY_GET, &cur, rc);
+        if (NULL != value && (PMIX_SUCCESS != rc || NULL == val)) {
+            PMIX_VALUE_RELEASE(value);
+            value = NULL;
+        }
+        if (NULL != val) {
+            *val = value;
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Get(proc, key, info, ninfo, val);
+    record_returned(&buf, seq, sign_get(proc, key), start_us, rc);
+    if (PMIX_SUCCESS == rc && NULL != val && NULL != *val) {
+        put_u32(&buf, 1);
+        put_value(&buf, *val);
+    }
+    else {
+        put_u32(&buf, 0);
+    }
+    record_write(REPLAY_RECORD_CALL, REPLAY_GET, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Job_control(const pmix_proc_t targets[],
+                                                size_t ntargets,
+                                                const pmix_info_t directives[],
+                                                size_t ndirs,
+                                                pmix_info_t **results, size_t *nresults)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_info_t *infos;
+    size_t ninfos;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_JOB_CONTROL, sign_infos(directives, ndirs), &cur);
+        infos = get_infos(&cur, &ninfos, NULL);
+        rc = play_check(REPLAY_JOB_CONTROL, &cur, rc);
+        if (NULL != infos && NULL == results) {
+            PMIX_INFO_FREE(infos, ninfos);
+            infos = NULL;
+            ninfos = 0;
+        }
+        if (NULL != results) {
+            *results = infos;
+            *nresults = ninfos;
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Job_control(targets, ntargets, directives, ndirs, results, nresults);
+    record_returned(&buf, seq, sign_infos(directives, ndirs), start_us, rc);
+    if (NULL != results && NULL != nresults) {
+        put_infos(&buf, *results, *nresults);
+    }
+    else {
+        put_infos(&buf, NULL, 0);
+    }
+    record_write(REPLAY_RECORD_CALL, REPLAY_JOB_CONTROL, &buf);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_Job_control_nb(const pmix_proc_t targets[],
+                                                   size_t ntargets,
+                                                   const pmix_info_t directives[],
+                                                   size_t ndirs,
+                                                   pmix_info_cbfunc_t cbfunc, void *cbdata)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    replay_request_t *request = NULL;
+    uint64_t seq, start_us;
+    uint32_t ordinal;
+    pmix_status_t rc;
+
+    pthread_mutex_lock(&replay_lock);
+    ordinal = replay_num_requests++;
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        // Kept until the recorded completion is delivered
+        if (STATUS_OK == replay_grow((void **)&replay_requests, &replay_requests_capacity,
+                                     (size_t)ordinal + 1, sizeof(replay_request_t))) {
+            replay_requests[ordinal].cbfunc = cbfunc;
+            replay_requests[ordinal].cbdata = cbdata;
+            replay_requests[ordinal].ordinal = ordinal;
+        }
+        pthread_mutex_unlock(&replay_lock);
+        rc = play_call(REPLAY_JOB_CONTROL_NB, sign_infos(directives, ndirs), &cur);
+        rc = play_check(REPLAY_JOB_CONTROL_NB, &cur, rc);
+        if (PMIX_SUCCESS != rc) {
+            pthread_mutex_lock(&replay_lock);
+            if (ordinal < replay_requests_capacity) {
+                replay_requests[ordinal].cbfunc = NULL;
+            }
+            pthread_mutex_unlock(&replay_lock);
+        }
+        return rc;
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    if (NULL != cbfunc) {
+        request = malloc(sizeof(replay_request_t));
+        if (NULL == request) {
+            fprintf(stderr, "Unable to allocate a recorded job control request.\n");
+            return PMIX_ERR_NOMEM;
+        }
+        request->cbfunc = cbfunc;
+        request->cbdata = cbdata;
+        request->ordinal = ordinal;
+    }
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_Job_control_nb(targets, ntargets, directives, ndirs,
+                             (NULL == request) ? NULL : record_completed, request);
+    record_returned(&buf, seq, sign_infos(directives, ndirs), start_us, rc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_JOB_CONTROL_NB, &buf);
+    if (PMIX_SUCCESS != rc) {
+        free(request);
+    }
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_IOF_pull(const pmix_proc_t procs[], size_t nprocs,
+                                             const pmix_info_t directives[], size_t ndirs,
+                                             pmix_iof_channel_t channel,
+                                             pmix_iof_cbfunc_t cbfunc,
+                                             pmix_hdlr_reg_cbfunc_t regcbfunc,
+                                             void *regcbdata)
+{
+    replay_handler_t *handler;
+    pmix_status_t rc;
+
+    handler = calloc(1, sizeof(replay_handler_t));
+    if (NULL == handler) {
+        fprintf(stderr, "Unable to allocate a recorded output pull.\n");
+        return PMIX_ERR_NOMEM;
+    }
+    handler->call = REPLAY_IOF_PULL;
+    handler->iofhdlr = cbfunc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        return play_registration(handler, regcbfunc, regcbdata);
+    }
+
+    handler->cbfunc = regcbfunc;
+    handler->cbdata = regcbdata;
+    if (STATUS_OK != replay_add_handler(&replay_pulls, &replay_num_pulls, handler)) {
+        free(handler);
+        return PMIX_ERR_NOMEM;
+    }
+    record_begin(NULL, &handler->seq, &handler->start_us);
+    rc = PMIx_IOF_pull(procs, nprocs, directives, ndirs, channel,
+                       (NULL == cbfunc) ? NULL : record_output,
+                       (NULL == regcbfunc) ? NULL : record_registered, handler);
+    pthread_mutex_lock(&replay_lock);
+    handler->duration_us = replay_now_us() - handler->start_us;
+    handler->rc = rc;
+    handler->returned = 1;
+    if (NULL == regcbfunc || PMIX_SUCCESS != rc) {
+        handler->registered = 1;
+        handler->reg_status = (0 > rc) ? rc : PMIX_SUCCESS;
+        if (0 <= rc) {
+            handler->id = (size_t)rc;
+            handler->have_id = 1;
+        }
+    }
+    if (handler->registered) {
+        record_registration(handler);
+    }
+    pthread_mutex_unlock(&replay_lock);
+    return rc;
+}
+
+pmix_status_t mpir_shim_replay_PMIx_IOF_push(const pmix_proc_t targets[], size_t ntargets,
+                                             pmix_byte_object_t *bo,
+                                             const pmix_info_t directives[], size_t ndirs,
+                                             pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    replay_buffer_t buf;
+    replay_cursor_t cur;
+    uint64_t seq, start_us;
+    pmix_status_t rc;
+
+    if (MPIR_SHIM_REPLAY_PLAY == mpir_shim_replay_mode) {
+        rc = play_call(REPLAY_IOF_PUSH, 0, &cur);
+        rc = play_check(REPLAY_IOF_PUSH, &cur, rc);
+        if (PMIX_SUCCESS == rc && NULL != cbfunc) {
+            cbfunc(PMIX_SUCCESS, cbdata);
+        }
+        return rc;
+    }
+
+    record_begin(&buf, &seq, &start_us);
+    rc = PMIx_IOF_push(targets, ntargets, bo, directives, ndirs, cbfunc, cbdata);
+    record_returned(&buf, seq, 0, start_us, rc);
+    record_write(REPLAY_RECORD_CALL, REPLAY_IOF_PUSH, &buf);
+    return rc;
+}
+
+/**
+ * @name   replay_now_us
+ * @brief  Read the clock of the capture.
+ * @return Microseconds
+ */
+uint64_t replay_now_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * @name   replay_grow
+ * @brief  Make room in an array for a number of elements, doubling it.
+ * @param  array: The array, replaced when it moves
+ * @param  capacity: Elements it has room for, updated
+ * @param  count: Elements it needs room for
+ * @param  size: Size of an element
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int replay_grow(void **array, size_t *capacity, size_t count, size_t size)
+{
+    size_t new_capacity;
+    void *new_array;
+
+    if (count <= *capacity) {
+        return STATUS_OK;
+    }
+    new_capacity = (0 == *capacity) ? 16 : *capacity;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+    new_array = realloc(*array, new_capacity * size);
+    if (NULL == new_array) {
+        fprintf(stderr, "Unable to allocate the PMIx capture tables.\n");
+        return STATUS_FAIL;
+    }
+    memset((char *)new_array + *capacity * size, 0, (new_capacity - *capacity) * size);
+    *array = new_array;
+    *capacity = new_capacity;
+    return STATUS_OK;
+}
+
+/**
+ * @name   replay_reset
+ * @brief  Forget the capture being replayed and the handlers and requests
+ *         seen so far.
+ */
+void replay_reset(void)
+{
+    size_t i;
+
+    pthread_mutex_lock(&replay_lock);
+    for (i = 0; i < replay_num_handlers; i++) {
+        free(replay_handlers[i]);
+    }
+    free(replay_handlers);
+    replay_handlers = NULL;
+    replay_num_handlers = 0;
+    for (i = 0; i < replay_num_pulls; i++) {
+        free(replay_pulls[i]);
+    }
+    free(replay_pulls);
+    replay_pulls = NULL;
+    replay_num_pulls = 0;
+    free(replay_requests);
+    replay_requests = NULL;
+    replay_requests_capacity = 0;
+    replay_num_requests = 0;
+    replay_num_calls = 0;
+
+    for (i = 0; i < play_num_calls; i++) {
+        free(play_calls[i].records);
+    }
+    free(play_calls);
+    play_calls = NULL;
+    play_num_calls = 0;
+    play_calls_capacity = 0;
+    memset(play_missing_reported, 0, sizeof(play_missing_reported));
+    free(play_stream.records);
+    memset(&play_stream, 0, sizeof(play_stream));
+    free(play_recorded_start);
+    free(play_replayed_start);
+    play_recorded_start = NULL;
+    play_replayed_start = NULL;
+    play_num_starts = 0;
+    if (NULL != play_capture) {
+        free(play_capture);
+        MPIR_SHIM_MEMORY_SUB(MPIR_SHIM_MEMORY_EVENTS, play_capture_size);
+        play_capture = NULL;
+        play_capture_size = 0;
+    }
+    pthread_mutex_unlock(&replay_lock);
+}
+
+/**
+ * @name   replay_add_handler
+ * @brief  Add a handler or pull to the end of a table.
+ * @param  handlers: The table
+ * @param  num_handlers: Number of entries of the table, updated
+ * @param  handler: The handler
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int replay_add_handler(replay_handler_t ***handlers, size_t *num_handlers,
+                       replay_handler_t *handler)
+{
+    replay_handler_t **new_handlers;
+
+    pthread_mutex_lock(&replay_lock);
+    new_handlers = realloc(*handlers, (*num_handlers + 1) * sizeof(replay_handler_t *));
+    if (NULL == new_handlers) {
+        pthread_mutex_unlock(&replay_lock);
+        fprintf(stderr, "Unable to allocate the PMIx handler table.\n");
+        return STATUS_FAIL;
+    }
+    new_handlers[*num_handlers] = handler;
+    *handlers = new_handlers;
+    (*num_handlers)++;
+    pthread_mutex_unlock(&replay_lock);
+    return STATUS_OK;
+}
+
+/**
+ * @name   replay_find_handler
+ * @brief  Find a handler or pull by the id PMIx gave it. Called with the
+ *         lock held.
+ * @param  handlers: The table
+ * @param  num_handlers: Number of entries of the table
+ * @param  id: The id
+ * @param  index: Set to the index of the handler in the table
+ * @return The handler, NULL if not found
+ */
+replay_handler_t *replay_find_handler(replay_handler_t **handlers, size_t num_handlers,
+                                      size_t id, uint32_t *index)
+{
+    size_t i;
+
+    for (i = 0; i < num_handlers; i++) {
+        if (handlers[i]->have_id && id == handlers[i]->id) {
+            *index = (uint32_t)i;
+            return handlers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @name   replay_signature
+ * @brief  Hash a request written to a buffer, with FNV-1a, and free it.
+ * @param  buf: The request
+ * @return The signature of the request, 0 if it could not be written
+ */
+uint64_t replay_signature(replay_buffer_t *buf)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+
+    if (buf->failed) {
+        free(buf->data);
+        return 0;
+    }
+    for (i = 0; i < buf->used; i++) {
+        hash = (hash ^ buf->data[i]) * 1099511628211ULL;
+    }
+    free(buf->data);
+    return hash;
+}
+
+/**
+ * @name   sign_query
+ * @brief  Get the signature of the keys and qualifiers of queries.
+ * @param  queries: The queries
+ * @param  nqueries: Number of queries
+ * @return The signature
+ */
+uint64_t sign_query(const pmix_query_t queries[], size_t nqueries)
+{
+    replay_buffer_t buf;
+    size_t i, k;
+
+    memset(&buf, 0, sizeof(buf));
+    for (i = 0; NULL != queries && i < nqueries; i++) {
+        for (k = 0; NULL != queries[i].keys && NULL != queries[i].keys[k]; k++) {
+            put_string(&buf, queries[i].keys[k]);
+        }
+        put_infos(&buf, queries[i].qualifiers, queries[i].nqual);
+    }
+    return replay_signature(&buf);
+}
+
+/**
+ * @name   sign_get
+ * @brief  Get the signature of the process and key of a PMIx_Get.
+ * @param  proc: The process, may be NULL
+ * @param  key: The key
+ * @return The signature
+ */
+uint64_t sign_get(const pmix_proc_t *proc, const char key[])
+{
+    replay_buffer_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+    if (NULL != proc) {
+        put_proc(&buf, proc);
+    }
+    put_string(&buf, key);
+    return replay_signature(&buf);
+}
+
+/**
+ * @name   sign_infos
+ * @brief  Get the signature of the directives of a request.
+ * @param  info: The directives
+ * @param  ninfo: Number of directives
+ * @return The signature
+ */
+uint64_t sign_infos(const pmix_info_t info[], size_t ninfo)
+{
+    replay_buffer_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+    put_infos(&buf, info, ninfo);
+    return replay_signature(&buf);
+}
+
+/**
+ * @name   scalar_size
+ * @brief  Get the size of the data types stored as is.
+ * @param  type: The data type
+ * @return Bytes, 0 if the type is not stored as is
+ */
+size_t scalar_size(pmix_data_type_t type)
+{
+    switch (type) {
+        case PMIX_BOOL:
+            return sizeof(bool);
+        case PMIX_BYTE:
+        case PMIX_INT8:
+        case PMIX_UINT8:
+        case PMIX_PROC_STATE:
+        case PMIX_DATA_RANGE:
+        case PMIX_PERSIST:
+        case PMIX_SCOPE:
+        case PMIX_JOB_STATE:
+        case PMIX_LINK_STATE:
+        case PMIX_ALLOC_DIRECTIVE:
+            return sizeof(uint8_t);
+        case PMIX_INT16:
+        case PMIX_UINT16:
+        case PMIX_IOF_CHANNEL:
+        case PMIX_DATA_TYPE:
+        case PMIX_LOCTYPE:
+            return sizeof(uint16_t);
+        case PMIX_INT:
+            return sizeof(int);
+        case PMIX_UINT:
+            return sizeof(unsigned int);
+        case PMIX_INT32:
+        case PMIX_UINT32:
+        case PMIX_STATUS:
+        case PMIX_PROC_RANK:
+        case PMIX_INFO_DIRECTIVES:
+            return sizeof(uint32_t);
+        case PMIX_INT64:
+        case PMIX_UINT64:
+            return sizeof(uint64_t);
+        case PMIX_SIZE:
+            return sizeof(size_t);
+        case PMIX_PID:
+            return sizeof(pid_t);
+        case PMIX_FLOAT:
+            return sizeof(float);
+        case PMIX_DOUBLE:
+            return sizeof(double);
+        case PMIX_TIMEVAL:
+            return sizeof(struct timeval);
+        case PMIX_TIME:
+            return sizeof(time_t);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @name   element_size
+ * @brief  Get the size of an element of a data array.
+ * @param  type: The data type of the elements
+ * @return Bytes, 0 if data arrays of the type are not recorded
+ */
+size_t element_size(pmix_data_type_t type)
+{
+    switch (type) {
+        case PMIX_STRING:
+            return sizeof(char *);
+        case PMIX_PROC:
+            return sizeof(pmix_proc_t);
+        case PMIX_PROC_INFO:
+            return sizeof(pmix_proc_info_t);
+        case PMIX_BYTE_OBJECT:
+            return sizeof(pmix_byte_object_t);
+        case PMIX_DATA_ARRAY:
+            return sizeof(pmix_data_array_t);
+        case PMIX_INFO:
+            return sizeof(pmix_info_t);
+        default:
+            return scalar_size(type);
+    }
+}
+
+/**
+ * @name   put
+ * @brief  Append data to a record being written.
+ * @param  buf: The record
+ * @param  data: The data
+ * @param  size: Number of bytes
+ */
+void put(replay_buffer_t *buf, const void *data, size_t size)
+{
+    if (buf->failed) {
+        return;
+    }
+    if (buf->size - buf->used < size &&
+        STATUS_OK != replay_grow((void **)&buf->data, &buf->size, buf->used + size, 1)) {
+        buf->failed = 1;
+        return;
+    }
+    memcpy(buf->data + buf->used, data, size);
+    buf->used += size;
+}
+
+void put_u32(replay_buffer_t *buf, uint32_t value)
+{
+    put(buf, &value, sizeof(value));
+}
+
+void put_u64(replay_buffer_t *buf, uint64_t value)
+{
+    put(buf, &value, sizeof(value));
+}
+
+void put_i32(replay_buffer_t *buf, int32_t value)
+{
+    put(buf, &value, sizeof(value));
+}
+
+void put_string(replay_buffer_t *buf, const char *string)
+{
+    uint32_t length;
+
+    if (NULL == string) {
+        put_u32(buf, UINT32_MAX);
+        return;
+    }
+    length = (uint32_t)strlen(string);
+    put_u32(buf, length);
+    put(buf, string, length);
+}
+
+void put_proc(replay_buffer_t *buf, const pmix_proc_t *proc)
+{
+    put_string(buf, proc->nspace);
+    put_u32(buf, proc->rank);
+}
+
+/**
+ * @name   put_element
+ * @brief  Append one item of data, without its type.
+ * @param  buf: The record
+ * @param  type: Its data type, one element_size knows
+ * @param  element: The item, as stored in a data array
+ */
+void put_element(replay_buffer_t *buf, pmix_data_type_t type, const void *element)
+{
+    const pmix_proc_info_t *pinfo;
+    const pmix_byte_object_t *bo;
+    const pmix_data_array_t *darray;
+    const pmix_info_t *info;
+    pmix_data_type_t element_type;
+    size_t i, size;
+
+    switch (type) {
+        case PMIX_STRING:
+            put_string(buf, *(char * const *)element);
+            break;
+        case PMIX_PROC:
+            put_proc(buf, element);
+            break;
+        case PMIX_PROC_INFO:
+            pinfo = element;
+            put_proc(buf, &pinfo->proc);
+            put_string(buf, pinfo->hostname);
+            put_string(buf, pinfo->executable_name);
+            put_i32(buf, pinfo->pid);
+            put_i32(buf, pinfo->exit_code);
+            put_u32(buf, pinfo->state);
+            break;
+        case PMIX_BYTE_OBJECT:
+            bo = element;
+            put_u64(buf, (NULL == bo->bytes) ? 0 : bo->size);
+            if (NULL != bo->bytes) {
+                put(buf, bo->bytes, bo->size);
+            }
+            break;
+        case PMIX_DATA_ARRAY:
+            darray = element;
+            element_type = darray->type;
+            if (0 == element_size(element_type) || NULL == darray->array) {
+                put_u32(buf, PMIX_UNDEF);
+                put_u64(buf, 0);
+                break;
+            }
+            put_u32(buf, element_type);
+            put_u64(buf, darray->size);
+            size = element_size(element_type);
+            for (i = 0; i < darray->size; i++) {
+                put_element(buf, element_type, (const char *)darray->array + i * size);
+            }
+            break;
+        case PMIX_INFO:
+            info = element;
+            put_string(buf, info->key);
+            put_u32(buf, info->flags);
+            put_value(buf, &info->value);
+            break;
+        default:
+            put(buf, element, scalar_size(type));
+            break;
+    }
+}
+
+/**
+ * @name   put_value
+ * @brief  Append a value with its type. Pointers are recorded as NULL, and
+ *         types that are not recorded as PMIX_UNDEF.
+ * @param  buf: The record
+ * @param  value: The value
+ */
+void put_value(replay_buffer_t *buf, const pmix_value_t *value)
+{
+    switch (value->type) {
+        case PMIX_POINTER:
+            put_u32(buf, PMIX_POINTER);
+            break;
+        case PMIX_PROC:
+            put_u32(buf, (NULL == value->data.proc) ? PMIX_UNDEF : PMIX_PROC);
+            if (NULL != value->data.proc) {
+                put_element(buf, PMIX_PROC, value->data.proc);
+            }
+            break;
+        case PMIX_PROC_INFO:
+            put_u32(buf, (NULL == value->data.pinfo) ? PMIX_UNDEF : PMIX_PROC_INFO);
+            if (NULL != value->data.pinfo) {
+                put_element(buf, PMIX_PROC_INFO, value->data.pinfo);
+            }
+            break;
+        case PMIX_DATA_ARRAY:
+            put_u32(buf, (NULL == value->data.darray) ? PMIX_UNDEF : PMIX_DATA_ARRAY);
+            if (NULL != value->data.darray) {
+                put_element(buf, PMIX_DATA_ARRAY, value->data.darray);
+            }
+            break;
+        case PMIX_INFO:
+            put_u32(buf, PMIX_UNDEF);
+            break;
+        default:
+            if (0 == element_size(value->type)) {
+                put_u32(buf, PMIX_UNDEF);
+                break;
+            }
+            put_u32(buf, value->type);
+            put_element(buf, value->type, &value->data);
+            break;
+    }
+}
+
+void put_infos(replay_buffer_t *buf, const pmix_info_t *info, size_t ninfo)
+{
+    size_t i;
+
+    put_u64(buf, (NULL == info) ? 0 : ninfo);
+    for (i = 0; NULL != info && i < ninfo; i++) {
+        put_element(buf, PMIX_INFO, &info[i]);
+    }
+}
+
+/**
+ * @name   get
+ * @brief  Read data from a record. Reading past its end fails the cursor,
+ *         and reads zeroes from then on.
+ * @param  cur: The cursor
+ * @param  data: Set to the data
+ * @param  size: Number of bytes
+ */
+void get(replay_cursor_t *cur, void *data, size_t size)
+{
+    if (cur->failed || (size_t)(cur->end - cur->next) < size) {
+        cur->failed = 1;
+        memset(data, 0, size);
+        return;
+    }
+    memcpy(data, cur->next, size);
+    cur->next += size;
+}
+
+uint32_t get_u32(replay_cursor_t *cur)
+{
+    uint32_t value;
+
+    get(cur, &value, sizeof(value));
+    return value;
+}
+
+uint64_t get_u64(replay_cursor_t *cur)
+{
+    uint64_t value;
+
+    get(cur, &value, sizeof(value));
+    return value;
+}
+
+int32_t get_i32(replay_cursor_t *cur)
+{
+    int32_t value;
+
+    get(cur, &value, sizeof(value));
+    return value;
+}
+
+char *get_string(replay_cursor_t *cur)
+{
+    uint32_t length;
+    char *string;
+
+    length = get_u32(cur);
+    if (UINT32_MAX == length || cur->failed) {
+        return NULL;
+    }
+    if ((size_t)(cur->end - cur->next) < length ||
+        NULL == (string = malloc((size_t)length + 1))) {
+        cur->failed = 1;
+        return NULL;
+    }
+    memcpy(string, cur->next, length);
+    string[length] = '\0';
+    cur->next += length;
+    return string;
+}
+
+/**
+ * @name   get_string_to
+ * @brief  Read a string into a fixed size array, such as a key or a
+ *         namespace, truncating it to fit.
+ * @param  cur: The cursor
+ * @param  dest: The array
+ * @param  size: Size of the array
+ */
+void get_string_to(replay_cursor_t *cur, char *dest, size_t size)
+{
+    uint32_t length;
+
+    memset(dest, 0, size);
+    length = get_u32(cur);
+    if (UINT32_MAX == length || cur->failed) {
+        return;
+    }
+    if ((size_t)(cur->end - cur->next) < length) {
+        cur->failed = 1;
+        return;
+    }
+    memcpy(dest, cur->next, (length < size) ? length : size - 1);
+    cur->next += length;
+}
+
+void get_proc(replay_cursor_t *cur, pmix_proc_t *proc)
+{
+    get_string_to(cur, proc->nspace, sizeof(proc->nspace));
+    proc->rank = get_u32(cur);
+}
+
+/**
+ * @name   get_element
+ * @brief  Read one item of data written by put_element.
+ * @param  cur: The cursor
+ * @param  type: Its data type
+ * @param  element: Set to the item, as stored in a data array
+ * @param  return_object: Given back for PMIX_EVENT_RETURN_OBJECT
+ */
+void get_element(replay_cursor_t *cur, pmix_data_type_t type, void *element,
+                 void *return_object)
+{
+    pmix_proc_info_t *pinfo;
+    pmix_byte_object_t *bo;
+    pmix_data_array_t *darray;
+    pmix_info_t *info;
+    size_t i, size;
+    uint64_t count;
+
+    switch (type) {
+        case PMIX_STRING:
+            *(char **)element = get_string(cur);
+            break;
+        case PMIX_PROC:
+            get_proc(cur, element);
+            break;
+        case PMIX_PROC_INFO:
+            pinfo = element;
+            get_proc(cur, &pinfo->proc);
+            pinfo->hostname = get_string(cur);
+            pinfo->executable_name = get_string(cur);
+            pinfo->pid = get_i32(cur);
+            pinfo->exit_code = get_i32(cur);
+            pinfo->state = (pmix_proc_state_t)get_u32(cur);
+            break;
+        case PMIX_BYTE_OBJECT:
+            bo = element;
+            count = get_u64(cur);
+            bo->bytes = NULL;
+            bo->size = 0;
+            if (0 == count || cur->failed) {
+                break;
+            }
+            if ((uint64_t)(cur->end - cur->next) < count ||
+                NULL == (bo->bytes = malloc(count))) {
+                cur->failed = 1;
+                break;
+            }
+            get(cur, bo->bytes, count);
+            bo->size = count;
+            break;
+        case PMIX_DATA_ARRAY:
+            darray = element;
+            darray->type = (pmix_data_type_t)get_u32(cur);
+            count = get_u64(cur);
+            darray->size = 0;
+            darray->array = NULL;
+            size = element_size(darray->type);
+            if (0 == count || cur->failed) {
+                break;
+            }
+            // Every recorded element takes at least one byte
+            if (0 == size || (uint64_t)(cur->end - cur->next) < count ||
+                NULL == (darray->array = calloc(count, size))) {
+                cur->failed = 1;
+                break;
+            }
+            darray->size = count;
+            for (i = 0; i < count && !cur->failed; i++) {
+                get_element(cur, darray->type, (char *)darray->array + i * size,
+                            return_object);
+            }
+            break;
+        case PMIX_INFO:
+            info = element;
+            get_string_to(cur, info->key, sizeof(info->key));
+            info->flags = get_u32(cur);
+            get_value(cur, &info->value, info->key, return_object);
+            break;
+        default:
+            size = scalar_size(type);
+            if (0 == size) {
+                cur->failed = 1;
+                break;
+            }
+            get(cur, element, size);
+            break;
+    }
+}
+
+/**
+ * @name   get_value
+ * @brief  Read a value written by put_value.
+ * @param  cur: The cursor
+ * @param  value: Set to the value
+ * @param  key: Its key, NULL if none
+ * @param  return_object: Given back for PMIX_EVENT_RETURN_OBJECT
+ */
+void get_value(replay_cursor_t *cur, pmix_value_t *value, const char *key,
+               void *return_object)
+{
+    value->type = (pmix_data_type_t)get_u32(cur);
+    switch (value->type) {
+        case PMIX_UNDEF:
+            break;
+        case PMIX_POINTER:
+            value->data.ptr = NULL;
+            if (NULL != key &&
+                0 == strncmp(key, PMIX_EVENT_RETURN_OBJECT, PMIX_MAX_KEYLEN)) {
+                value->data.ptr = return_object;
+            }
+            break;
+        case PMIX_PROC:
+            PMIX_PROC_CREATE(value->data.proc, 1);
+            if (NULL == value->data.proc) {
+                value->type = PMIX_UNDEF;
+                cur->failed = 1;
+                break;
+            }
+            get_element(cur, PMIX_PROC, value->data.proc, return_object);
+            break;
+        case PMIX_PROC_INFO:
+            PMIX_PROC_INFO_CREATE(value->data.pinfo, 1);
+            if (NULL == value->data.pinfo) {
+                value->type = PMIX_UNDEF;
+                cur->failed = 1;
+                break;
+            }
+            get_element(cur, PMIX_PROC_INFO, value->data.pinfo, return_object);
+            break;
+        case PMIX_DATA_ARRAY:
+            value->data.darray = calloc(1, sizeof(pmix_data_array_t));
+            if (NULL == value->data.darray) {
+                value->type = PMIX_UNDEF;
+                cur->failed = 1;
+                break;
+            }
+            get_element(cur, PMIX_DATA_ARRAY, value->data.darray, return_object);
+            break;
+        default:
+            if (0 == scalar_size(value->type) && PMIX_STRING != value->type &&
+                PMIX_BYTE_OBJECT != value->type) {
+                value->type = PMIX_UNDEF;
+                cur->failed = 1;
+                break;
+            }
+            get_element(cur, value->type, &value->data, return_object);
+            break;
+    }
+}
+
+/**
+ * @name   get_infos
+ * @brief  Read an info array written by put_infos.
+ * @param  cur: The cursor
+ * @param  ninfo: Set to the number of infos
+ * @param  return_object: Given back for PMIX_EVENT_RETURN_OBJECT
+ * @return The infos, to free with PMIX_INFO_FREE, NULL if none
+ */
+pmix_info_t *get_infos(replay_cursor_t *cur, size_t *ninfo, void *return_object)
+{
+    pmix_info_t *info = NULL;
+    uint64_t count;
+    size_t i;
+
+    *ninfo = 0;
+    count = get_u64(cur);
+    if (0 == count || cur->failed) {
+        return NULL;
+    }
+    if ((uint64_t)(cur->end - cur->next) < count) {
+        cur->failed = 1;
+        return NULL;
+    }
+    PMIX_INFO_CREATE(info, count);
+    if (NULL == info) {
+        cur->failed = 1;
+        return NULL;
+    }
+    for (i = 0; i < count && !cur->failed; i++) {
+        get_element(cur, PMIX_INFO, &info[i], return_object);
+    }
+    *ninfo = count;
+    return info;
+}
+
+/**
+ * @name   record_begin
+ * @brief  Number a call being recorded and note when it started.
+ * @param  buf: Its record, emptied, NULL if written later
+ * @param  seq: Set to the number of the call
+ * @param  start_us: Set to when it started
+ */
+void record_begin(replay_buffer_t *buf, uint64_t *seq, uint64_t *start_us)
+{
+    if (NULL != buf) {
+        memset(buf, 0, sizeof(*buf));
+    }
+    pthread_mutex_lock(&replay_lock);
+    *seq = replay_num_calls++;
+    pthread_mutex_unlock(&replay_lock);
+    *start_us = replay_now_us();
+}
+
+/**
+ * @name   record_returned
+ * @brief  Start the record of a call that returned, its outputs follow.
+ * @param  buf: The record
+ * @param  seq: The number of the call
+ * @param  signature: The request it was made with
+ * @param  start_us: When it started
+ * @param  rc: What it returned
+ */
+void record_returned(replay_buffer_t *buf, uint64_t seq, uint64_t signature,
+                     uint64_t start_us, pmix_status_t rc)
+{
+    put_u64(buf, seq);
+    put_u64(buf, signature);
+    put_u64(buf, start_us);
+    put_u64(buf, replay_now_us() - start_us);
+    put_i32(buf, rc);
+}
+
+/**
+ * @name   record_begin_callback
+ * @brief  Start the record of an event, output or completion, with the
+ *         calls made so far and the time.
+ * @param  buf: The record, emptied
+ */
+void record_begin_callback(replay_buffer_t *buf)
+{
+    uint64_t after;
+
+    memset(buf, 0, sizeof(*buf));
+    pthread_mutex_lock(&replay_lock);
+    after = replay_num_calls;
+    pthread_mutex_unlock(&replay_lock);
+    put_u64(buf, after);
+    put_u64(buf, replay_now_us());
+}
+
+/**
+ * @name   record_write
+ * @brief  Write a record to the capture, from any thread, and free it.
+ * @param  kind: Kind of record
+ * @param  call: The call it belongs to
+ * @param  buf: The record
+ */
+void record_write(replay_record_kind_t kind, replay_call_id_t call, replay_buffer_t *buf)
+{
+    pthread_mutex_lock(&replay_lock);
+    record_write_locked(kind, call, buf);
+    pthread_mutex_unlock(&replay_lock);
+}
+
+/**
+ * @name   record_write_locked
+ * @brief  Write a record to the capture with the lock held, and free it.
+ * @param  kind: Kind of record
+ * @param  call: The call it belongs to
+ * @param  buf: The record
+ */
+void record_write_locked(replay_record_kind_t kind, replay_call_id_t call,
+                         replay_buffer_t *buf)
+{
+    uint32_t header[2];
+    uint64_t size = buf->used;
+
+    if (buf->failed) {
+        fprintf(stderr, "Unable to allocate a %s record of the PMIx capture.\n",
+                replay_names[call]);
+        free(buf->data);
+        return;
+    }
+    header[0] = kind;
+    header[1] = call;
+    if (NULL != record_stream &&
+        (1 != fwrite(header, sizeof(header), 1, record_stream) ||
+         1 != fwrite(&size, sizeof(size), 1, record_stream) ||
+         (0 != size && 1 != fwrite(buf->data, size, 1, record_stream)))) {
+        fprintf(stderr, "Unable to write the PMIx capture: %s.\n", strerror(errno));
+        fclose(record_stream);
+        record_stream = NULL;
+    }
+    free(buf->data);
+}
+
+/**
+ * @name   record_registration
+ * @brief  Write the record of a handler or pull registration once it both
+ *         returned and completed. Called with the lock held.
+ * @param  handler: The handler
+ */
+void record_registration(replay_handler_t *handler)
+{
+    replay_buffer_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+    put_u64(&buf, handler->seq);
+    put_u64(&buf, 0);
+    put_u64(&buf, handler->start_us);
+    put_u64(&buf, handler->duration_us);
+    put_i32(&buf, handler->rc);
+    put_i32(&buf, handler->reg_status);
+    put_u64(&buf, handler->id);
+    record_write_locked(REPLAY_RECORD_CALL, handler->call, &buf);
+}
+
+/**
+ * @name   record_registered
+ * @brief  Completion of a handler or pull registration while recording.
+ *         Notes the id PMIx gave it, then completes the registration of the
+ *         shim.
+ * @param  status: Status of the registration
+ * @param  refid: The id
+ * @param  cbdata: The handler
+ */
+void record_registered(pmix_status_t status, size_t refid, void *cbdata)
+{
+    replay_handler_t *handler = (replay_handler_t *)cbdata;
+
+    pthread_mutex_lock(&replay_lock);
+    handler->reg_status = status;
+    handler->id = refid;
+    handler->have_id = (PMIX_SUCCESS == status);
+    handler->registered = 1;
+    if (handler->returned) {
+        record_registration(handler);
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    if (NULL != handler->cbfunc) {
+        handler->cbfunc(status, refid, handler->cbdata);
+    }
+}
+
+/**
+ * @name   record_event
+ * @brief  Event handler registered in place of those of the shim while
+ *         recording. Records the event, then passes it on.
+ */
+void record_event(size_t evhdlr_registration_id, pmix_status_t status,
+                  const pmix_proc_t *source, pmix_info_t info[], size_t ninfo,
+                  pmix_info_t results[], size_t nresults,
+                  pmix_event_notification_cbfunc_fn_t cbfunc, void *cbdata)
+{
+    replay_handler_t *handler;
+    replay_buffer_t buf;
+    uint32_t index = 0;
+
+    pthread_mutex_lock(&replay_lock);
+    handler = replay_find_handler(replay_handlers, replay_num_handlers,
+                                  evhdlr_registration_id, &index);
+    pthread_mutex_unlock(&replay_lock);
+    if (NULL == handler) {
+        fprintf(stderr, "Event %s for unknown handler %lu not recorded.\n",
+                PMIx_Error_string(status), (unsigned long)evhdlr_registration_id);
+        if (NULL != cbfunc) {
+            cbfunc(PMIX_EVENT_NO_ACTION_TAKEN, NULL, 0, NULL, NULL, cbdata);
+        }
+        return;
+    }
+
+    record_begin_callback(&buf);
+    put_u32(&buf, index);
+    put_i32(&buf, status);
+    put_u32(&buf, (NULL != source));
+    if (NULL != source) {
+        put_proc(&buf, source);
+    }
+    put_infos(&buf, info, ninfo);
+    record_write(REPLAY_RECORD_EVENT, REPLAY_REGISTER_EVENT_HANDLER, &buf);
+
+    handler->evhdlr(evhdlr_registration_id, status, source, info, ninfo, results,
+                    nresults, cbfunc, cbdata);
+}
+
+/**
+ * @name   record_output
+ * @brief  Output handler pulled in place of that of the shim while
+ *         recording. Records the output, then passes it on.
+ */
+void record_output(size_t iofhdlr, pmix_iof_channel_t channel,
+                   pmix_proc_t *source, pmix_byte_object_t *payload,
+                   pmix_info_t info[], size_t ninfo)
+{
+    replay_handler_t *handler;
+    replay_buffer_t buf;
+    uint32_t index = 0;
+
+    pthread_mutex_lock(&replay_lock);
+    handler = replay_find_handler(replay_pulls, replay_num_pulls, iofhdlr, &index);
+    pthread_mutex_unlock(&replay_lock);
+    if (NULL == handler) {
+        fprintf(stderr, "Output for unknown handler %lu not recorded.\n",
+                (unsigned long)iofhdlr);
+        return;
+    }
+
+    record_begin_callback(&buf);
+    put_u32(&buf, index);
+    put_u32(&buf, channel);
+    put_u32(&buf, (NULL != source));
+    if (NULL != source) {
+        put_proc(&buf, source);
+    }
+    put_u32(&buf, (NULL != payload));
+    if (NULL != payload) {
+        put_element(&buf, PMIX_BYTE_OBJECT, payload);
+    }
+    put_infos(&buf, info, ninfo);
+    record_write(REPLAY_RECORD_OUTPUT, REPLAY_IOF_PULL, &buf);
+
+    handler->iofhdlr(iofhdlr, channel, source, payload, info, ninfo);
+}
+
+/**
+ * @name   record_completed
+ * @brief  Completion of a job control request while recording. Records the
+ *         status, then completes the request of the shim.
+ */
+void record_completed(pmix_status_t status, pmix_info_t *info, size_t ninfo,
+                      void *cbdata, pmix_release_cbfunc_t release_fn,
+                      void *release_cbdata)
+{
+    replay_request_t *request = (replay_request_t *)cbdata;
+    replay_buffer_t buf;
+
+    record_begin_callback(&buf);
+    put_u32(&buf, request->ordinal);
+    put_i32(&buf, status);
+    record_write(REPLAY_RECORD_COMPLETE, REPLAY_JOB_CONTROL_NB, &buf);
+
+    request->cbfunc(status, info, ninfo, request->cbdata, release_fn, release_cbdata);
+    free(request);
+}
+
+/**
+ * @name   record_close
+ * @brief  Stop recording, writing what is buffered to the capture.
+ */
+void record_close(void)
+{
+    pthread_mutex_lock(&replay_lock);
+    if (NULL != record_stream && 0 != fclose(record_stream)) {
+        fprintf(stderr, "Unable to write the PMIx capture: %s.\n", strerror(errno));
+    }
+    record_stream = NULL;
+    pthread_mutex_unlock(&replay_lock);
+}
+
+/**
+ * @name   play_load
+ * @brief  Read a capture and index its records.
+ * @param  file: The capture
+ * @return STATUS_OK if successful, otherwise STATUS_FAIL
+ */
+int play_load(const char *file)
+{
+    replay_record_t *record;
+    replay_list_t *list;
+    replay_cursor_t cur, body;
+    const unsigned char *record_body;
+    uint32_t header[2], version;
+    uint64_t size, seq, start_us;
+    size_t capacity = 0;
+    char magic[8];
+    FILE *stream;
+    long length;
+
+    stream = fopen(file, "r");
+    if (NULL == stream) {
+        fprintf(stderr, "Unable to open the PMIx capture file '%s': %s.\n", file,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+    if (0 != fseek(stream, 0, SEEK_END) || 0 > (length = ftell(stream)) ||
+        0 != fseek(stream, 0, SEEK_SET)) {
+        fprintf(stderr, "Unable to read the PMIx capture file '%s': %s.\n", file,
+                strerror(errno));
+        fclose(stream);
+        return STATUS_FAIL;
+    }
+    play_capture = malloc((0 == length) ? 1 : (size_t)length);
+    if (NULL == play_capture) {
+        fprintf(stderr, "Unable to allocate the PMIx capture of %ld bytes.\n", length);
+        fclose(stream);
+        return STATUS_FAIL;
+    }
+    play_capture_size = (size_t)length;
+    MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS, play_capture_size);
+    if (0 != length && 1 != fread(play_capture, (size_t)length, 1, stream)) {
+        fprintf(stderr, "Unable to read the PMIx capture file '%s'.\n", file);
+        fclose(stream);
+        return STATUS_FAIL;
+    }
+    fclose(stream);
+
+    cur.next = play_capture;
+    cur.end = play_capture + play_capture_size;
+    cur.failed = 0;
+    get(&cur, magic, sizeof(magic));
+    version = get_u32(&cur);
+    if (cur.failed || 0 != memcmp(magic, MPIR_SHIM_REPLAY_MAGIC, sizeof(magic))) {
+        fprintf(stderr, "'%s' is not a PMIx capture.\n", file);
+        return STATUS_FAIL;
+    }
+    if (MPIR_SHIM_REPLAY_VERSION != version) {
+        fprintf(stderr, "The PMIx capture '%s' has version %u, not %d.\n", file,
+                version, MPIR_SHIM_REPLAY_VERSION);
+        return STATUS_FAIL;
+    }
+
+    while (cur.next < cur.end) {
+        get(&cur, header, sizeof(header));
+        size = get_u64(&cur);
+        if (cur.failed || (uint64_t)(cur.end - cur.next) < size ||
+            REPLAY_RECORD_COMPLETE < header[0] || REPLAY_NUM_CALLS <= header[1]) {
+            fprintf(stderr, "The PMIx capture '%s' is corrupt at byte %ld.\n", file,
+                    (long)(cur.next - play_capture));
+            return STATUS_FAIL;
+        }
+        record_body = body.next = cur.next;
+        body.end = cur.next + size;
+        body.failed = 0;
+        cur.next += size;
+
+        if (REPLAY_RECORD_CALL == header[0]) {
+            (void)get_u64(&body);
+            list = play_find_calls((replay_call_id_t)header[1], get_u64(&body), 1);
+            if (NULL == list) {
+                return STATUS_FAIL;
+            }
+            body.next = record_body;
+        }
+        else {
+            list = &play_stream;
+        }
+        if (STATUS_OK != replay_grow((void **)&list->records, &list->capacity,
+                                     list->num + 1, sizeof(replay_record_t))) {
+            return STATUS_FAIL;
+        }
+        record = &list->records[list->num++];
+        record->body = record_body;
+        record->size = size;
+        record->kind = (replay_record_kind_t)header[0];
+
+        if (REPLAY_RECORD_CALL == header[0]) {
+            seq = get_u64(&body);
+            (void)get_u64(&body);
+            start_us = get_u64(&body);
+            // Call numbers are a count, anything far beyond is corrupt
+            if (body.failed || seq > play_capture_size) {
+                fprintf(stderr, "The PMIx capture '%s' has a corrupt %s call.\n",
+                        file, replay_names[header[1]]);
+                return STATUS_FAIL;
+            }
+            if (STATUS_OK != replay_grow((void **)&play_recorded_start, &capacity,
+                                         seq + 1, sizeof(uint64_t))) {
+                return STATUS_FAIL;
+            }
+            play_recorded_start[seq] = start_us;
+            if (play_num_starts <= seq) {
+                play_num_starts = seq + 1;
+            }
+        }
+        else {
+            record->after = get_u64(&body);
+            record->time_us = get_u64(&body);
+        }
+    }
+
+    play_replayed_start = calloc((0 == play_num_starts) ? 1 : play_num_starts,
+                                 sizeof(uint64_t));
+    if (NULL == play_replayed_start) {
+        fprintf(stderr, "Unable to allocate the PMIx capture tables.\n");
+        return STATUS_FAIL;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * @name   play_find_calls
+ * @brief  Find the records of a call made with a request.
+ * @param  call: The call
+ * @param  signature: The request
+ * @param  create: Non-zero to add an empty list if there is none
+ * @return The records, NULL if there are none
+ */
+replay_list_t *play_find_calls(replay_call_id_t call, uint64_t signature, int create)
+{
+    replay_list_t *list;
+    size_t i;
+
+    for (i = 0; i < play_num_calls; i++) {
+        if (call == play_calls[i].call && signature == play_calls[i].signature) {
+            return &play_calls[i];
+        }
+    }
+    if (!create || STATUS_OK != replay_grow((void **)&play_calls, &play_calls_capacity,
+                                            play_num_calls + 1, sizeof(replay_list_t))) {
+        return NULL;
+    }
+    list = &play_calls[play_num_calls++];
+    list->call = call;
+    list->signature = signature;
+    return list;
+}
+
+/**
+ * @name   play_call
+ * @brief  Replay a call: take its next record and, if timed, take as long
+ *         as it did.
+ * @param  call: The call
+ * @param  signature: The request it is made with
+ * @param  cur: Set to read the outputs of the call, failed if there is no
+ *         record of it
+ * @return What the call returned
+ */
+pmix_status_t play_call(replay_call_id_t call, uint64_t signature, replay_cursor_t *cur)
+{
+    replay_list_t *list;
+    replay_record_t *record = NULL;
+    struct timespec delay;
+    uint64_t seq, duration_us;
+    pmix_status_t rc;
+    int report = 0;
+
+    pthread_mutex_lock(&replay_lock);
+    seq = replay_num_calls++;
+    if (seq < play_num_starts) {
+        play_replayed_start[seq] = replay_now_us();
+    }
+    list = play_find_calls(call, signature, 0);
+    if (NULL == list) {
+        if (!play_missing_reported[call]) {
+            play_missing_reported[call] = 1;
+            report = 1;
+        }
+    }
+    else if (list->next < list->num) {
+        record = &list->records[list->next++];
+    }
+    else if (0 < list->num) {
+        record = &list->records[list->num - 1];
+    }
+    pthread_cond_broadcast(&replay_cond);
+    pthread_mutex_unlock(&replay_lock);
+
+    if (NULL == record) {
+        if (report) {
+            fprintf(stderr, "The PMIx capture has no %s call with this request.\n",
+                    replay_names[call]);
+        }
+        cur->next = cur->end = NULL;
+        cur->failed = 1;
+        return PMIX_ERR_NOT_SUPPORTED;
+    }
+
+    cur->next = record->body;
+    cur->end = record->body + record->size;
+    cur->failed = 0;
+    (void)get_u64(cur);
+    (void)get_u64(cur);
+    (void)get_u64(cur);
+    duration_us = get_u64(cur);
+    rc = get_i32(cur);
+
+    if (play_timed && 0 < duration_us) {
+        delay.tv_sec = duration_us / 1000000;
+        delay.tv_nsec = (duration_us % 1000000) * 1000;
+        while (0 != nanosleep(&delay, &delay) && EINTR == errno) {
+        }
+    }
+    return rc;
+}
+
+/**
+ * @name   play_check
+ * @brief  Check the outputs of a replayed call were read in full.
+ * @param  call: The call
+ * @param  cur: The cursor its outputs were read with
+ * @param  rc: What the call returned
+ * @return rc, or an error if its record is missing or corrupt
+ */
+pmix_status_t play_check(replay_call_id_t call, replay_cursor_t *cur, pmix_status_t rc)
+{
+    if (NULL == cur->end) {
+        return rc;
+    }
+    if (cur->failed) {
+        fprintf(stderr, "The PMIx capture has a corrupt %s call.\n", replay_names[call]);
+        return PMIX_ERR_UNPACK_FAILURE;
+    }
+    return rc;
+}
+
+/**
+ * @name   play_registration
+ * @brief  Replay the registration of an event handler or an output pull,
+ *         giving it the id it was given when recorded.
+ * @param  handler: The handler, kept
+ * @param  cbfunc: Completion of the registration, NULL if blocking
+ * @param  cbdata: Passed to cbfunc
+ * @return What the call returned
+ */
+pmix_status_t play_registration(replay_handler_t *handler,
+                                pmix_hdlr_reg_cbfunc_t cbfunc, void *cbdata)
+{
+    replay_call_id_t call = handler->call;
+    replay_cursor_t cur;
+    pmix_status_t rc, reg_status;
+
+    pthread_mutex_lock(&replay_lock);
+    play_registering = 1;
+    pthread_mutex_unlock(&replay_lock);
+    rc = play_call(call, 0, &cur);
+    reg_status = get_i32(&cur);
+    handler->id = (size_t)get_u64(&cur);
+    rc = play_check(call, &cur, rc);
+    if (cur.failed) {
+        reg_status = rc;
+    }
+    handler->have_id = (PMIX_SUCCESS == reg_status);
+
+    if (STATUS_OK != replay_add_handler((REPLAY_IOF_PULL == call) ? &replay_pulls :
+                                        &replay_handlers,
+                                        (REPLAY_IOF_PULL == call) ? &replay_num_pulls :
+                                        &replay_num_handlers, handler)) {
+        free(handler);
+        handler = NULL;
+    }
+    pthread_mutex_lock(&replay_lock);
+    play_registering = 0;
+    pthread_cond_broadcast(&replay_cond);
+    pthread_mutex_unlock(&replay_lock);
+    if (NULL == handler) {
+        return PMIX_ERR_NOMEM;
+    }
+    if (PMIX_SUCCESS == rc && NULL != cbfunc) {
+        cbfunc(reg_status, handler->id, cbdata);
+    }
+    return rc;
+}
+
+/**
+ * @name   play_start
+ * @brief  Start the thread replaying events, output and completions.
+ */
+void play_start(void)
+{
+    if (play_thread_running) {
+        return;
+    }
+    play_stop = 0;
+    if (0 != pthread_create(&play_thread, NULL, play_thread_main, NULL)) {
+        fprintf(stderr, "Unable to start the PMIx replay thread.\n");
+        return;
+    }
+    play_thread_running = 1;
+}
+
+/**
+ * @name   play_finish
+ * @brief  Stop the replay thread. What it has not delivered yet is left for
+ *         the next session.
+ */
+void play_finish(void)
+{
+    if (!play_thread_running) {
+        return;
+    }
+    pthread_mutex_lock(&replay_lock);
+    play_stop = 1;
+    pthread_cond_broadcast(&replay_cond);
+    pthread_mutex_unlock(&replay_lock);
+    if (!pthread_equal(pthread_self(), play_thread)) {
+        pthread_join(play_thread, NULL);
+    }
+    else {
+        pthread_detach(play_thread);
+    }
+    play_thread_running = 0;
+}
+
+/**
+ * @name   play_thread_main
+ * @brief  Deliver the recorded events, output and completions in order,
+ *         each once the calls made before it when recorded were replayed.
+ * @param  arg: Unused
+ * @return NULL
+ */
+void *play_thread_main(void *arg)
+{
+    replay_record_t *record;
+    struct timespec deadline;
+    uint64_t due_us;
+
+    (void)arg;
+    pthread_mutex_lock(&replay_lock);
+    while (!play_stop && play_stream.next < play_stream.num) {
+        record = &play_stream.records[play_stream.next];
+        if (replay_num_calls < record->after) {
+            pthread_cond_wait(&replay_cond, &replay_lock);
+            continue;
+        }
+
+        // As long after the last of those calls started as when recorded
+        if (play_timed && 0 < record->after && record->after <= play_num_starts) {
+            due_us = play_replayed_start[record->after - 1];
+            if (record->time_us > play_recorded_start[record->after - 1]) {
+                due_us += record->time_us - play_recorded_start[record->after - 1];
+            }
+            if (replay_now_us() < due_us) {
+                deadline.tv_sec = due_us / 1000000;
+                deadline.tv_nsec = (due_us % 1000000) * 1000;
+                pthread_cond_timedwait(&replay_cond, &replay_lock, &deadline);
+                continue;
+            }
+        }
+
+        play_stream.next++;
+        pthread_mutex_unlock(&replay_lock);
+        play_deliver(record);
+        pthread_mutex_lock(&replay_lock);
+    }
+    pthread_mutex_unlock(&replay_lock);
+    return NULL;
+}
+
+/**
+ * @name   play_deliver
+ * @brief  Call the shim back with an event, output or completion.
+ * @param  record: Its record
+ */
+void play_deliver(const replay_record_t *record)
+{
+    replay_handler_t *handler = NULL;
+    replay_request_t request;
+    replay_cursor_t cur;
+    pmix_byte_object_t payload;
+    pmix_proc_t source;
+    pmix_info_t *info;
+    pmix_status_t status = PMIX_SUCCESS;
+    pmix_iof_channel_t channel = 0;
+    size_t ninfo;
+    uint32_t index;
+    int has_source, has_payload = 0;
+
+    cur.next = record->body;
+    cur.end = record->body + record->size;
+    cur.failed = 0;
+    (void)get_u64(&cur);
+    (void)get_u64(&cur);
+    index = get_u32(&cur);
+
+    if (REPLAY_RECORD_COMPLETE == record->kind) {
+        status = get_i32(&cur);
+        memset(&request, 0, sizeof(request));
+        pthread_mutex_lock(&replay_lock);
+        if (index < replay_requests_capacity) {
+            request = replay_requests[index];
+            replay_requests[index].cbfunc = NULL;
+        }
+        pthread_mutex_unlock(&replay_lock);
+        if (!cur.failed && NULL != request.cbfunc) {
+            request.cbfunc(status, NULL, 0, request.cbdata, NULL, NULL);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&replay_lock);
+    while (play_registering &&
+           ((REPLAY_RECORD_EVENT == record->kind && index >= replay_num_handlers) ||
+            (REPLAY_RECORD_OUTPUT == record->kind && index >= replay_num_pulls))) {
+        pthread_cond_wait(&replay_cond, &replay_lock);
+    }
+    if (REPLAY_RECORD_EVENT == record->kind && index < replay_num_handlers) {
+        handler = replay_handlers[index];
+    }
+    else if (REPLAY_RECORD_OUTPUT == record->kind && index < replay_num_pulls) {
+        handler = replay_pulls[index];
+    }
+    pthread_mutex_unlock(&replay_lock);
+    if (NULL == handler) {
+        fprintf(stderr, "The PMIx capture delivers to handler %u, never registered.\n",
+                index);
+        return;
+    }
+
+    if (REPLAY_RECORD_EVENT == record->kind) {
+        status = get_i32(&cur);
+    }
+    else {
+        channel = (pmix_iof_channel_t)get_u32(&cur);
+    }
+    has_source = get_u32(&cur);
+    if (has_source) {
+        get_proc(&cur, &source);
+    }
+    if (REPLAY_RECORD_OUTPUT == record->kind) {
+        has_payload = get_u32(&cur);
+        memset(&payload, 0, sizeof(payload));
+        if (has_payload) {
+            get_element(&cur, PMIX_BYTE_OBJECT, &payload, NULL);
+        }
+    }
+    info = get_infos(&cur, &ninfo, handler->return_object);
+
+    if (cur.failed) {
+        fprintf(stderr, "The PMIx capture has a corrupt %s.\n",
+                (REPLAY_RECORD_EVENT == record->kind) ? "event" : "output");
+    }
+    else if (REPLAY_RECORD_EVENT == record->kind) {
+        handler->evhdlr(handler->id, status, has_source ? &source : NULL, info, ninfo,
+                        NULL, 0, play_event_done, NULL);
+    }
+    else {
+        handler->iofhdlr(handler->id, channel, has_source ? &source : NULL,
+                         has_payload ? &payload : NULL, info, ninfo);
+    }
+
+    if (NULL != info) {
+        PMIX_INFO_FREE(info, ninfo);
+    }
+    if (has_payload) {
+        free(payload.bytes);
+    }
+}
+
+/**
+ * @name   play_event_done
+ * @brief  Completion of a replayed event by the handler of the shim.
+ */
+void play_event_done(pmix_status_t status, pmix_info_t *results, size_t nresults,
+                     pmix_op_cbfunc_t cbfunc, void *thiscbdata,
+                     void *notification_cbdata)
+{
+    (void)status;
+    (void)results;
+    (void)nresults;
+    (void)notification_cbdata;
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, thiscbdata);
+    }
+}
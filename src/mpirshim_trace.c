@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file   mpirshim_trace.c
+ * @brief  Binary trace of the shim.
+ *
+ * Each thread owns a ring of fixed size records that only it writes, so
+ * recording takes no lock and makes no system call besides reading the
+ * clock. A record keeps the category, the time, the address of the printf
+ * format and the raw arguments, strings copied in. Formatting is left to
+ * the mpirtrace decoder, which reads the dumps written by trace_dump().
+ *
+ * A dump reads the rings while their threads keep recording. Each record
+ * carries the sequence number it was written with, set last, and a record
+ * that changed while it was copied is skipped. The dump only uses
+ * async-signal-safe calls so that it can run when the process crashes.
+ */
+
+#include "mpirshim_config.h"
+#include "mpirshim.h"
+#include "mpirshim_trace.h"
+#include "mpirshim_memory.h"
+
+#include <pthread.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATUS_OK 0
+#define STATUS_FAIL 1
+
+// Records per thread, and their size
+#define TRACE_RING_SIZE 1024
+#define TRACE_RECORD_SIZE 256
+#define TRACE_PAYLOAD_SIZE (TRACE_RECORD_SIZE - 32)
+// Distinct formats remembered while dumping, the others are repeated
+#define TRACE_DUMP_FORMATS 1024
+
+typedef struct trace_record_t {
+    uint64_t seq;           // Index in the ring plus one, 0 while written
+    uint64_t time_ns;
+    const char *format;
+    int32_t tid;
+    uint16_t category;
+    uint16_t payload_size;
+    unsigned char payload[TRACE_PAYLOAD_SIZE];
+} trace_record_t;
+
+typedef struct trace_ring_t {
+    uint64_t head;          // Records written so far
+    int in_use;             // Zero once the owning thread exited
+    int32_t tid;
+    struct trace_ring_t *next;
+    trace_record_t records[TRACE_RING_SIZE];
+} trace_ring_t;
+
+// Signals that dump the trace before the process dies
+static const int trace_crash_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+#define TRACE_NUM_CRASH_SIGNALS (sizeof(trace_crash_signals) / sizeof(trace_crash_signals[0]))
+
+unsigned int mpir_shim_trace_mask = MPIR_SHIM_TRACE_ALL;
+
+// Rings of every thread that recorded, pushed without locking
+static trace_ring_t *trace_rings = NULL;
+static __thread trace_ring_t *trace_ring = NULL;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static pthread_mutex_t trace_echo_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Where to dump at exit and on crash
+static char *trace_file = NULL;
+static int trace_handlers_installed = 0;
+static struct sigaction trace_old_actions[TRACE_NUM_CRASH_SIGNALS];
+
+// Dump state, only used by the one dump in progress
+static int trace_dumping = 0;
+static char dump_buffer[65536];
+static size_t dump_used;
+static int dump_fd;
+static int dump_failed;
+static const char *dump_formats[TRACE_DUMP_FORMATS];
+static uint32_t dump_format_ids[TRACE_DUMP_FORMATS];
+static uint32_t dump_num_formats;
+
+static void trace_init(void);
+static void trace_release_ring(void *ring);
+static trace_ring_t *trace_get_ring(void);
+static void trace_record(unsigned int category, const char *format, va_list *args);
+static int trace_modifier(const char *start, const char *end);
+static int trace_dump(int fd);
+static void dump_write(const void *data, size_t size);
+static void dump_flush(void);
+static uint32_t dump_format_id(const char *format);
+static void trace_exit_handler(void);
+static void trace_crash_handler(int signum);
+
+/**
+ * @name   MPIR_Shim_set_trace
+ * @brief  Select the categories of the binary trace.
+ * @param  categories: "all" (default), "none", or a comma separated list of
+ *         flow, general, event, signal and procs
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_trace(const char *categories)
+{
+    static const char *names[] = MPIR_SHIM_TRACE_NAMES;
+    unsigned int mask = 0;
+    const char *name;
+    size_t length;
+    int i;
+
+    if (NULL == categories || 0 == strcmp(categories, "all")) {
+        mpir_shim_trace_mask = MPIR_SHIM_TRACE_ALL;
+        return STATUS_OK;
+    }
+    if (0 == strcmp(categories, "none")) {
+        mpir_shim_trace_mask = 0;
+        return STATUS_OK;
+    }
+
+    for (name = categories; ; name += length + 1) {
+        length = strcspn(name, ",");
+        for (i = 0; i < MPIR_SHIM_TRACE_NUM_CATEGORIES; i++) {
+            if (strlen(names[i]) == length && 0 == strncmp(name, names[i], length)) {
+                mask |= 1U << i;
+                break;
+            }
+        }
+        if (MPIR_SHIM_TRACE_NUM_CATEGORIES == i) {
+            fprintf(stderr, "Invalid trace category '%.*s'.\n", (int)length, name);
+            return STATUS_FAIL;
+        }
+        if ('\0' == name[length]) {
+            break;
+        }
+    }
+    mpir_shim_trace_mask = mask;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_set_trace_file
+ * @brief  Dump the binary trace to a file at exit and if the process
+ *         crashes.
+ * @param  file: The file, NULL to not dump
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_set_trace_file(const char *file)
+{
+    struct sigaction action;
+    char *copy = NULL;
+    size_t i;
+
+    if (NULL != file && NULL == (copy = strdup(file))) {
+        fprintf(stderr, "Unable to allocate the trace file name.\n");
+        return STATUS_FAIL;
+    }
+    free(trace_file);
+    trace_file = copy;
+
+    if (NULL == trace_file || trace_handlers_installed) {
+        return STATUS_OK;
+    }
+
+    if (0 != atexit(trace_exit_handler)) {
+        fprintf(stderr, "An error occurred setting an exit handler.\n");
+        return STATUS_FAIL;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = trace_crash_handler;
+    sigemptyset(&action.sa_mask);
+    for (i = 0; i < TRACE_NUM_CRASH_SIGNALS; i++) {
+        if (0 != sigaction(trace_crash_signals[i], &action, &trace_old_actions[i])) {
+            fprintf(stderr, "An error occurred setting a signal handler: %s.\n",
+                    strerror(errno));
+            return STATUS_FAIL;
+        }
+    }
+    trace_handlers_installed = 1;
+    return STATUS_OK;
+}
+
+/**
+ * @name   MPIR_Shim_dump_trace
+ * @brief  Dump the binary trace recorded so far to a file, for mpirtrace.
+ * @param  file: The file
+ * @return 0 if successful, 1 if failed
+ */
+int MPIR_Shim_dump_trace(const char *file)
+{
+    int fd;
+    int rc;
+
+    fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 > fd) {
+        fprintf(stderr, "Unable to open the trace file '%s': %s.\n", file,
+                strerror(errno));
+        return STATUS_FAIL;
+    }
+    rc = trace_dump(fd);
+    if (0 != close(fd)) {
+        rc = STATUS_FAIL;
+    }
+    if (STATUS_OK != rc) {
+        fprintf(stderr, "Unable to write the trace file '%s'.\n", file);
+    }
+    return rc;
+}
+
+/**
+ * @name   mpir_shim_trace
+ * @brief  Record a trace message, and print it if asked to.
+ * @param  category: One of the MPIR_SHIM_TRACE_* categories
+ * @param  echo: Non-zero to also print the message to stdout
+ * @param  format: printf format, a string literal
+ */
+void mpir_shim_trace(unsigned int category, int echo, const char *format, ...)
+{
+    va_list args;
+
+    if (MPIR_SHIM_TRACE_ON(category)) {
+        va_start(args, format);
+        trace_record(category, format, &args);
+        va_end(args);
+    }
+
+    if (echo) {
+        pthread_mutex_lock(&trace_echo_lock);
+
+        va_start(args, format);
+        printf("DEBUG: ");
+        vprintf(format, args);
+        va_end(args);
+        fflush(stdout);
+
+        pthread_mutex_unlock(&trace_echo_lock);
+    }
+}
+
+/**
+ * @name   mpir_shim_trace_conversion
+ * @brief  Find the next conversion of a printf format.
+ * @param  format: Where to start looking
+ * @param  start_: Set to the '%' of the conversion
+ * @param  end_: Set past the conversion character
+ * @param  num_stars_: Set to the number of '*' widths and precisions
+ * @return The kind of the value, -1 if there are no more conversions
+ */
+int mpir_shim_trace_conversion(const char *format, const char **start_,
+                               const char **end_, int *num_stars_)
+{
+    const char *p;
+    int num_stars = 0;
+
+    p = strchr(format, '%');
+    if (NULL == p) {
+        return -1;
+    }
+    *start_ = p++;
+
+    while ('\0' != *p && NULL != strchr("-+ #0'", *p)) {
+        p++;
+    }
+    if ('*' == *p) {
+        num_stars++;
+        p++;
+    }
+    while (isdigit((unsigned char)*p)) {
+        p++;
+    }
+    if ('.' == *p) {
+        p++;
+        if ('*' == *p) {
+            num_stars++;
+            p++;
+        }
+        while (isdigit((unsigned char)*p)) {
+            p++;
+        }
+    }
+    while ('\0' != *p && NULL != strchr("hlLqjzt", *p)) {
+        p++;
+    }
+
+    if ('\0' == *p) {
+        return -1;
+    }
+    *end_ = p + 1;
+    *num_stars_ = num_stars;
+
+    switch (*p) {
+        case 'd':
+        case 'i':
+        case 'c':
+            return MPIR_SHIM_TRACE_ARG_SIGNED;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            return MPIR_SHIM_TRACE_ARG_UNSIGNED;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            return MPIR_SHIM_TRACE_ARG_DOUBLE;
+        case 'p':
+            return MPIR_SHIM_TRACE_ARG_POINTER;
+        case 's':
+            return MPIR_SHIM_TRACE_ARG_STRING;
+        default:
+            // %% (%n is not supported)
+            *num_stars_ = 0;
+            return MPIR_SHIM_TRACE_ARG_NONE;
+    }
+}
+
+/**
+ * @name   trace_init
+ * @brief  Create the key that releases the ring of an exiting thread.
+ */
+void trace_init(void)
+{
+    (void)pthread_key_create(&trace_key, trace_release_ring);
+}
+
+/**
+ * @name   trace_release_ring
+ * @brief  Let another thread reuse the ring of an exiting thread. Its
+ *         records stay until they are overwritten.
+ * @param  ring: The ring
+ */
+void trace_release_ring(void *ring)
+{
+    __atomic_store_n(&((trace_ring_t *)ring)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @name   trace_get_ring
+ * @brief  Get the ring of the calling thread, reusing the ring of an exited
+ *         thread or allocating one the first time the thread records.
+ * @return The ring, NULL if out of memory
+ */
+trace_ring_t *trace_get_ring(void)
+{
+    trace_ring_t *ring;
+    int expected;
+
+    if (NULL != trace_ring) {
+        return trace_ring;
+    }
+    pthread_once(&trace_once, trace_init);
+
+    for (ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); NULL != ring;
+         ring = ring->next) {
+        expected = 0;
+        if (__atomic_compare_exchange_n(&ring->in_use, &expected, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (NULL == ring) {
+        ring = calloc(1, sizeof(trace_ring_t));
+        if (NULL == ring) {
+            return NULL;
+        }
+        MPIR_SHIM_MEMORY_ADD(MPIR_SHIM_MEMORY_EVENTS, sizeof(trace_ring_t));
+        ring->in_use = 1;
+        ring->next = __atomic_load_n(&trace_rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&trace_rings, &ring->next, ring, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    ring->tid = (int32_t)syscall(SYS_gettid);
+    (void)pthread_setspecific(trace_key, ring);
+    trace_ring = ring;
+    return ring;
+}
+
+/**
+ * @name   trace_record
+ * @brief  Write a record to the ring of the calling thread.
+ * @param  category: Category of the message
+ * @param  format: printf format, a string literal
+ * @param  args: The arguments of the format
+ */
+void trace_record(unsigned int category, const char *format, va_list *args)
+{
+    trace_ring_t *ring;
+    trace_record_t *record;
+    struct timespec now;
+    const char *p, *start, *end;
+    const char *string;
+    uint64_t index, value;
+    size_t size = 0, length;
+    int kind, num_stars, modifier;
+    double real;
+
+    ring = trace_get_ring();
+    if (NULL == ring) {
+        return;
+    }
+
+    index = ring->head;
+    record = &ring->records[index % TRACE_RING_SIZE];
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    record->time_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    record->format = format;
+    record->tid = ring->tid;
+    record->category = (uint16_t)category;
+
+    // Store the arguments as the format consumes them. Whatever does not
+    // fit is dropped, and shown as missing by the decoder.
+    p = format;
+    while (0 <= (kind = mpir_shim_trace_conversion(p, &start, &end, &num_stars))) {
+        p = end;
+        if (MPIR_SHIM_TRACE_ARG_NONE == kind) {
+            continue;
+        }
+        if (TRACE_PAYLOAD_SIZE < size + 8 * (num_stars + 1)) {
+            break;
+        }
+        for (; 0 < num_stars; num_stars--) {
+            value = (uint64_t)(int64_t)va_arg(*args, int);
+            memcpy(&record->payload[size], &value, 8);
+            size += 8;
+        }
+
+        modifier = trace_modifier(start, end);
+        if (MPIR_SHIM_TRACE_ARG_SIGNED == kind) {
+            switch (modifier) {
+                case 'l': value = (uint64_t)(int64_t)va_arg(*args, long); break;
+                case 'q': value = (uint64_t)(int64_t)va_arg(*args, long long); break;
+                case 'z': value = (uint64_t)(int64_t)va_arg(*args, ssize_t); break;
+                case 'j': value = (uint64_t)(int64_t)va_arg(*args, intmax_t); break;
+                case 't': value = (uint64_t)(int64_t)va_arg(*args, ptrdiff_t); break;
+                default:  value = (uint64_t)(int64_t)va_arg(*args, int); break;
+            }
+        }
+        else if (MPIR_SHIM_TRACE_ARG_UNSIGNED == kind) {
+            switch (modifier) {
+                case 'l': value = va_arg(*args, unsigned long); break;
+                case 'q': value = va_arg(*args, unsigned long long); break;
+                case 'z': value = va_arg(*args, size_t); break;
+                case 'j': value = va_arg(*args, uintmax_t); break;
+                case 't': value = (uint64_t)va_arg(*args, ptrdiff_t); break;
+                default:  value = va_arg(*args, unsigned int); break;
+            }
+        }
+        else if (MPIR_SHIM_TRACE_ARG_DOUBLE == kind) {
+            real = ('L' == modifier) ? (double)va_arg(*args, long double)
+                                     : va_arg(*args, double);
+            memcpy(&value, &real, 8);
+        }
+        else if (MPIR_SHIM_TRACE_ARG_POINTER == kind) {
+            value = (uint64_t)(uintptr_t)va_arg(*args, void *);
+        }
+        else {
+            string = va_arg(*args, const char *);
+            if (NULL == string) {
+                record->payload[size++] = MPIR_SHIM_TRACE_NULL_STRING;
+                continue;
+            }
+            length = strnlen(string, MPIR_SHIM_TRACE_MAX_STRING);
+            if (TRACE_PAYLOAD_SIZE - size - 1 < length) {
+                length = TRACE_PAYLOAD_SIZE - size - 1;
+            }
+            record->payload[size++] = (unsigned char)length;
+            memcpy(&record->payload[size], string, length);
+            size += length;
+            continue;
+        }
+        memcpy(&record->payload[size], &value, 8);
+        size += 8;
+    }
+    record->payload_size = (uint16_t)size;
+
+    __atomic_store_n(&record->seq, index + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @name   trace_modifier
+ * @brief  Get the length modifier of a conversion.
+ * @param  start: The '%' of the conversion
+ * @param  end: Past the conversion character
+ * @return 'l' for long, 'q' for long long, 'L' for long double, 'z', 'j'
+ *         or 't', 0 for int and double (hh and h are promoted to int)
+ */
+int trace_modifier(const char *start, const char *end)
+{
+    const char *p = end - 2;
+
+    if (p <= start) {
+        return 0;
+    }
+    switch (*p) {
+        case 'l':
+            return ('l' == p[-1]) ? 'q' : 'l';
+        case 'q':
+        case 'L':
+        case 'z':
+        case 'j':
+        case 't':
+            return *p;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @name   trace_dump
+ * @brief  Write the rings to a file. Async-signal-safe. Only one dump runs
+ *         at a time, another one fails.
+ * @param  fd: The file
+ * @return 0 if successful, 1 if failed
+ */
+int trace_dump(int fd)
+{
+    mpir_shim_trace_header_t header;
+    mpir_shim_trace_entry_t entry;
+    trace_record_t record;
+    trace_record_t *slot;
+    trace_ring_t *ring;
+    struct timespec now;
+    uint64_t head, index, seq;
+    char tag = MPIR_SHIM_TRACE_TAG_RECORD;
+
+    if (__atomic_exchange_n(&trace_dumping, 1, __ATOMIC_ACQUIRE)) {
+        return STATUS_FAIL;
+    }
+    dump_fd = fd;
+    dump_used = 0;
+    dump_failed = 0;
+    dump_num_formats = 0;
+    memset(dump_formats, 0, sizeof(dump_formats));
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MPIR_SHIM_TRACE_MAGIC, sizeof(header.magic));
+    header.version = MPIR_SHIM_TRACE_VERSION;
+    header.pid = (uint32_t)getpid();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    header.monotonic_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.realtime_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    dump_write(&header, sizeof(header));
+
+    for (ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); NULL != ring;
+         ring = ring->next) {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (index = (TRACE_RING_SIZE < head) ? head - TRACE_RING_SIZE : 0;
+             index < head; index++) {
+            slot = &ring->records[index % TRACE_RING_SIZE];
+            seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            if (index + 1 != seq) {
+                continue;
+            }
+            memcpy(&record, slot, sizeof(record));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) ||
+                TRACE_PAYLOAD_SIZE < record.payload_size) {
+                continue;
+            }
+
+            memset(&entry, 0, sizeof(entry));
+            entry.time_ns = record.time_ns;
+            entry.format_id = dump_format_id(record.format);
+            entry.tid = record.tid;
+            entry.category = record.category;
+            entry.payload_size = record.payload_size;
+            dump_write(&tag, 1);
+            dump_write(&entry, sizeof(entry));
+            dump_write(record.payload, record.payload_size);
+        }
+    }
+    dump_flush();
+
+    __atomic_store_n(&trace_dumping, 0, __ATOMIC_RELEASE);
+    return dump_failed ? STATUS_FAIL : STATUS_OK;
+}
+
+/**
+ * @name   dump_write
+ * @brief  Buffer data for the dump file.
+ * @param  data: The data
+ * @param  size: Its size, at most the size of the buffer
+ */
+void dump_write(const void *data, size_t size)
+{
+    if (sizeof(dump_buffer) - dump_used < size) {
+        dump_flush();
+    }
+    memcpy(&dump_buffer[dump_used], data, size);
+    dump_used += size;
+}
+
+/**
+ * @name   dump_flush
+ * @brief  Write the buffered data to the dump file.
+ */
+void dump_flush(void)
+{
+    size_t done = 0;
+    ssize_t rc;
+
+    while (done < dump_used && !dump_failed) {
+        rc = write(dump_fd, &dump_buffer[done], dump_used - done);
+        if (0 > rc && EINTR != errno) {
+            dump_failed = 1;
+        }
+        else if (0 < rc) {
+            done += (size_t)rc;
+        }
+    }
+    dump_used = 0;
+}
+
+/**
+ * @name   dump_format_id
+ * @brief  Get the id of a format in the dump, writing the format the first
+ *         time it is seen.
+ * @param  format: The format
+ * @return The id
+ */
+uint32_t dump_format_id(const char *format)
+{
+    size_t slot = ((uintptr_t)format >> 3) % TRACE_DUMP_FORMATS;
+    size_t probes;
+    uint32_t id, length;
+    char tag = MPIR_SHIM_TRACE_TAG_FORMAT;
+
+    for (probes = 0; probes < TRACE_DUMP_FORMATS; probes++) {
+        if (NULL == dump_formats[slot] || format == dump_formats[slot]) {
+            break;
+        }
+        slot = (slot + 1) % TRACE_DUMP_FORMATS;
+    }
+    if (probes < TRACE_DUMP_FORMATS && format == dump_formats[slot]) {
+        return dump_format_ids[slot];
+    }
+
+    // A new format, remembered unless the table is full
+    id = dump_num_formats++;
+    if (probes < TRACE_DUMP_FORMATS) {
+        dump_formats[slot] = format;
+        dump_format_ids[slot] = id;
+    }
+    length = (uint32_t)strlen(format);
+    dump_write(&tag, 1);
+    dump_write(&id, sizeof(id));
+    dump_write(&length, sizeof(length));
+    for (; sizeof(dump_buffer) < length; length -= sizeof(dump_buffer)) {
+        dump_write(format, sizeof(dump_buffer));
+        format += sizeof(dump_buffer);
+    }
+    dump_write(format, length);
+    return id;
+}
+
+/**
+ * @name   trace_exit_handler
+ * @brief  Dump the trace to the trace file at exit.
+ */
+void trace_exit_handler(void)
+{
+    if (NULL != trace_file) {
+        (void)MPIR_Shim_dump_trace(trace_file);
+    }
+}
+
+/**
+ * @name   trace_crash_handler
+ * @brief  Dump the trace to the trace file when the process crashes, then
+ *         let the previous handler of the signal run.
+ * @param  signum: The signal
+ */
+void trace_crash_handler(int signum)
+{
+    size_t i;
+    int fd;
+
+    if (NULL != trace_file) {
+        fd = open(trace_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (0 <= fd) {
+            (void)trace_dump(fd);
+            close(fd);
+        }
+    }
+
+    for (i = 0; i < TRACE_NUM_CRASH_SIGNALS; i++) {
+        if (trace_crash_signals[i] == signum) {
+            sigaction(signum, &trace_old_actions[i], NULL);
+        }
+    }
+    raise(signum);
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * mpirtrace: print the binary trace dumps of the MPIR shim as text, the
+ * records of all threads merged in time order.
+ */
+#include "mpirshim.h"
+#include "mpirshim_config.h"
+#include "mpirshim_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <argp.h>
+
+/* Use argp to parse the command line
+ *   https://www.gnu.org/software/libc/manual/html_node/Argp.html
+ */
+static error_t trace_parse_opt(int key, char *arg, struct argp_state *state);
+
+static char args_doc[] = "FILE...";
+static char args_extra_doc[] =
+    "Print MPIR shim trace dumps\n"
+    "\n"
+    "FILE:\n"
+    "  A trace dump written with mpirc --trace-file, MPIR_SHIM_TRACE_FILE or\n"
+    "  MPIR_Shim_dump_trace(), on a machine of the same byte order.\n"
+    "\n"
+    "Each line shows the wall clock time of the record, the thread id, the\n"
+    "category and the message.\n"
+    "\n"
+    "OPTIONS:";
+static struct argp_option args_options[] =
+    {
+        {"categories", 'c', "CATEGORIES", 0, "Print only these categories (e.g., event,signal)"},
+        {0}
+    };
+static struct argp argp = { args_options, trace_parse_opt, args_doc, args_extra_doc};
+
+// A record of a dump
+typedef struct trace_line_t {
+    mpir_shim_trace_entry_t entry;
+    const unsigned char *payload;
+    size_t order;
+} trace_line_t;
+
+static int decode_file(const char *path);
+static int compare_lines(const void *a, const void *b);
+static void print_message(const char *format, const unsigned char *payload,
+                          size_t payload_size);
+
+int main(int argc, char **argv)
+{
+    int first_file;
+    int rc = 0;
+
+    // The files are left unparsed, from first_file on
+    if (0 != argp_parse(&argp, argc, argv, 0, &first_file, NULL)) {
+        return 1;
+    }
+    if (first_file >= argc) {
+        argp_help(&argp, stderr, ARGP_HELP_USAGE, argv[0]);
+        return 1;
+    }
+    for (; first_file < argc; first_file++) {
+        if (0 != decode_file(argv[first_file])) {
+            rc = 1;
+        }
+    }
+    return rc;
+}
+
+/**
+ * @name   trace_parse_opt
+ * @brief  Parse one command line option.
+ */
+static error_t trace_parse_opt(int key, char *arg, struct argp_state *state)
+{
+    switch (key) {
+        case 'c':
+            // The category names are those of the shim
+            if (0 != MPIR_Shim_set_trace(arg)) {
+                argp_error(state, "Invalid categories '%s'.", arg);
+            }
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/**
+ * @name   decode_file
+ * @brief  Print one dump.
+ * @param  path: The dump
+ * @return 0 if successful, 1 if failed
+ */
+int decode_file(const char *path)
+{
+    static const char *names[] = MPIR_SHIM_TRACE_NAMES;
+    mpir_shim_trace_header_t header;
+    FILE *stream;
+    unsigned char *data = NULL;
+    size_t size = 0, allocated = 0, got, offset;
+    char **formats = NULL;
+    size_t num_formats = 0;
+    trace_line_t *lines = NULL;
+    size_t num_lines = 0, allocated_lines = 0, i;
+    uint32_t id, length;
+    unsigned int category;
+    time_t seconds;
+    uint64_t wall_ns;
+    struct tm tm;
+    char when[32];
+    const char *name;
+    int rc = 1;
+
+    stream = fopen(path, "rb");
+    if (NULL == stream) {
+        perror(path);
+        return 1;
+    }
+    do {
+        if (size == allocated) {
+            allocated = allocated ? 2 * allocated : 1 << 20;
+            data = realloc(data, allocated);
+            if (NULL == data) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                fclose(stream);
+                return 1;
+            }
+        }
+        got = fread(data + size, 1, allocated - size, stream);
+        size += got;
+    } while (0 < got);
+    fclose(stream);
+
+    if (sizeof(header) > size) {
+        fprintf(stderr, "%s: not an MPIR shim trace\n", path);
+        goto done;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (0 != memcmp(header.magic, MPIR_SHIM_TRACE_MAGIC, sizeof(header.magic)) ||
+        MPIR_SHIM_TRACE_VERSION != header.version) {
+        fprintf(stderr, "%s: not an MPIR shim trace of version %d\n", path,
+                MPIR_SHIM_TRACE_VERSION);
+        goto done;
+    }
+
+    for (offset = sizeof(header); offset < size; ) {
+        if (MPIR_SHIM_TRACE_TAG_FORMAT == data[offset] &&
+            offset + 1 + 2 * sizeof(uint32_t) <= size) {
+            memcpy(&id, &data[offset + 1], sizeof(id));
+            memcpy(&length, &data[offset + 1 + sizeof(id)], sizeof(length));
+            offset += 1 + 2 * sizeof(uint32_t);
+            if (size - offset < length) {
+                break;
+            }
+            if (id >= num_formats) {
+                formats = realloc(formats, (id + 1) * sizeof(char *));
+                if (NULL == formats) {
+                    fprintf(stderr, "%s: out of memory\n", path);
+                    goto done;
+                }
+                memset(&formats[num_formats], 0, (id + 1 - num_formats) * sizeof(char *));
+                num_formats = id + 1;
+            }
+            free(formats[id]);
+            formats[id] = strndup((const char *)&data[offset], length);
+            offset += length;
+        }
+        else if (MPIR_SHIM_TRACE_TAG_RECORD == data[offset] &&
+                 offset + 1 + sizeof(mpir_shim_trace_entry_t) <= size) {
+            if (num_lines == allocated_lines) {
+                allocated_lines = allocated_lines ? 2 * allocated_lines : 4096;
+                lines = realloc(lines, allocated_lines * sizeof(trace_line_t));
+                if (NULL == lines) {
+                    fprintf(stderr, "%s: out of memory\n", path);
+                    goto done;
+                }
+            }
+            memcpy(&lines[num_lines].entry, &data[offset + 1],
+                   sizeof(mpir_shim_trace_entry_t));
+            offset += 1 + sizeof(mpir_shim_trace_entry_t);
+            if (size - offset < lines[num_lines].entry.payload_size) {
+                break;
+            }
+            lines[num_lines].payload = &data[offset];
+            lines[num_lines].order = num_lines;
+            offset += lines[num_lines].entry.payload_size;
+            num_lines++;
+        }
+        else {
+            break;
+        }
+    }
+    if (offset < size) {
+        fprintf(stderr, "%s: truncated or corrupt at offset %lu\n", path,
+                (unsigned long)offset);
+    }
+
+    qsort(lines, num_lines, sizeof(trace_line_t), compare_lines);
+
+    seconds = (time_t)(header.realtime_ns / 1000000000ULL);
+    localtime_r(&seconds, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("# %s: pid %u, dumped %s, %lu records\n", path, header.pid, when,
+           (unsigned long)num_lines);
+
+    for (i = 0; i < num_lines; i++) {
+        category = lines[i].entry.category;
+        if (!(mpir_shim_trace_mask & category)) {
+            continue;
+        }
+
+        // Records use the monotonic clock, convert to the wall clock
+        wall_ns = header.realtime_ns - (header.monotonic_ns - lines[i].entry.time_ns);
+        seconds = (time_t)(wall_ns / 1000000000ULL);
+        localtime_r(&seconds, &tm);
+        strftime(when, sizeof(when), "%H:%M:%S", &tm);
+
+        for (name = "?", id = 0; id < MPIR_SHIM_TRACE_NUM_CATEGORIES; id++) {
+            if ((1U << id) == category) {
+                name = names[id];
+            }
+        }
+        printf("%s.%06lu %7d %-7s ", when,
+               (unsigned long)(wall_ns % 1000000000ULL / 1000), lines[i].entry.tid, name);
+
+        if (lines[i].entry.format_id < num_formats &&
+            NULL != formats[lines[i].entry.format_id]) {
+            print_message(formats[lines[i].entry.format_id], lines[i].payload,
+                          lines[i].entry.payload_size);
+        }
+        printf("\n");
+    }
+    rc = 0;
+
+done:
+    for (i = 0; i < num_formats; i++) {
+        free(formats[i]);
+    }
+    free(formats);
+    free(lines);
+    free(data);
+    return rc;
+}
+
+/**
+ * @name   compare_lines
+ * @brief  Order records by time, keeping the dump order of equal times.
+ */
+int compare_lines(const void *a, const void *b)
+{
+    const trace_line_t *line_a = a;
+    const trace_line_t *line_b = b;
+
+    if (line_a->entry.time_ns != line_b->entry.time_ns) {
+        return (line_a->entry.time_ns < line_b->entry.time_ns) ? -1 : 1;
+    }
+    return (line_a->order < line_b->order) ? -1 : (line_a->order > line_b->order);
+}
+
+/**
+ * @name   print_message
+ * @brief  Print the message of a record, formatting its arguments. Missing
+ *         arguments, dropped because the record was full, print as '?'.
+ * @param  format: The printf format of the record
+ * @param  payload: The arguments
+ * @param  payload_size: Size of the arguments
+ */
+/*
+ * The formats given to printf below are built at run time, but each is a
+ * single conversion validated by mpir_shim_trace_conversion, rebuilt with
+ * the length modifier of the argument stored for it.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+void print_message(const char *format, const unsigned char *payload,
+                   size_t payload_size)
+{
+    const char *p = format, *start, *end, *c;
+    char spec[64];
+    char string[MPIR_SHIM_TRACE_MAX_STRING + 1];
+    size_t used, offset = 0;
+    int kind, num_stars, missing = 0;
+    uint64_t value;
+    int64_t star;
+    double real;
+
+    while (0 <= (kind = mpir_shim_trace_conversion(p, &start, &end, &num_stars))) {
+        fwrite(p, 1, start - p, stdout);
+        p = end;
+        if (MPIR_SHIM_TRACE_ARG_NONE == kind) {
+            fwrite(start, 1, end - start, stdout);
+            continue;
+        }
+        if (missing || payload_size < offset + 8 * num_stars +
+            (MPIR_SHIM_TRACE_ARG_STRING == kind ? 1 : 8)) {
+            missing = 1;
+            printf("?");
+            continue;
+        }
+
+        // Rebuild the conversion for the stored argument types
+        for (used = 0, c = start; c < end - 1 && used < sizeof(spec) - 24; c++) {
+            if ('*' == *c) {
+                memcpy(&star, &payload[offset], 8);
+                offset += 8;
+                used += snprintf(&spec[used], sizeof(spec) - used, "%d", (int)star);
+            }
+            else if (NULL == strchr("hlLqjzt", *c)) {
+                spec[used++] = *c;
+            }
+        }
+        if ((MPIR_SHIM_TRACE_ARG_SIGNED == kind || MPIR_SHIM_TRACE_ARG_UNSIGNED == kind) &&
+            'c' != end[-1]) {
+            spec[used++] = 'l';
+            spec[used++] = 'l';
+        }
+        spec[used++] = end[-1];
+        spec[used] = '\0';
+
+        if (MPIR_SHIM_TRACE_ARG_STRING == kind) {
+            used = payload[offset++];
+            if (MPIR_SHIM_TRACE_NULL_STRING == used) {
+                printf(spec, "(null)");
+                continue;
+            }
+            if (payload_size - offset < used) {
+                used = payload_size - offset;
+            }
+            memcpy(string, &payload[offset], used);
+            string[used] = '\0';
+            offset += used;
+            printf(spec, string);
+            continue;
+        }
+
+        memcpy(&value, &payload[offset], 8);
+        offset += 8;
+        if ('c' == end[-1]) {
+            printf(spec, (int)value);
+        }
+        else if (MPIR_SHIM_TRACE_ARG_SIGNED == kind) {
+            printf(spec, (long long)value);
+        }
+        else if (MPIR_SHIM_TRACE_ARG_UNSIGNED == kind) {
+            printf(spec, (unsigned long long)value);
+        }
+        else if (MPIR_SHIM_TRACE_ARG_DOUBLE == kind) {
+            memcpy(&real, &value, 8);
+            printf(spec, real);
+        }
+        else {
+            printf(spec, (void *)(uintptr_t)value);
+        }
+    }
+
+    // The rest of the format, without its final newline
+    used = strlen(p);
+    if (0 < used && '\n' == p[used - 1]) {
+        used--;
+    }
+    fwrite(p, 1, used, stdout);
+}
+#pragma GCC diagnostic pop
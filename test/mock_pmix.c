@@ -0,0 +1,1231 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file  mock_pmix.c
+ * @brief Stand-in for the PMIx server side of the tool calls made by the
+ *        shim, see mock_pmix.h.
+ *
+ * Events are queued with the time they are due and delivered, one at a
+ * time, by a progress thread, as the PMIx progress thread would. The
+ * process table is built when it is queried, so a job of any size only
+ * costs a few bytes per rank until then.
+ */
+#include "mock_pmix.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MOCK_MAX_HANDLERS 64
+#define MOCK_MAX_JOBS 64
+#define MOCK_MAX_PULLS 64
+
+// Exit code of a rank asked to abort
+#define MOCK_ABORT_CODE 134
+
+typedef struct mock_handler_t {
+    int active;
+    size_t id;
+    pmix_status_t *codes;       // NULL for a default handler
+    size_t num_codes;
+    int has_affected;
+    pmix_proc_t affected;
+    void *return_object;
+    pmix_notification_fn_t handler;
+} mock_handler_t;
+
+// A registration for the output of the ranks
+typedef struct mock_pull_t {
+    size_t id;
+    pmix_proc_t source;         // An empty namespace for every process
+    pmix_iof_cbfunc_t handler;
+} mock_pull_t;
+
+typedef struct mock_job_t {
+    pmix_nspace_t launcher_nspace;
+    pmix_nspace_t application_nspace;
+    char executable[PATH_MAX];
+    int num_ranks;
+    int launched;
+    double launch_ms;           // When launch complete is sent
+    unsigned char *held;        // Per rank, held by a launch directive
+    unsigned char *released;    // Per rank, released by the tool
+    int num_released;
+    int num_releases;           // Notifications that released ranks
+    int failed;                 // The fail rank aborted
+    long *stdin_bytes;          // Per rank, stdin pushed to it, NULL if none
+    unsigned char *stdin_closed; // Per rank, told stdin is complete
+} mock_job_t;
+
+typedef struct mock_event_t {
+    struct mock_event_t *next;
+    double due_ms;
+    pmix_status_t status;
+    pmix_proc_t source;
+    pmix_proc_t affected;
+    pmix_nspace_t nspace;       // Application of a launch complete event
+    int has_exit_code;
+    int exit_code;
+    int fail_job;               // Job whose fail rank aborts, -1 for none
+    int output;                 // The affected rank writes its output instead
+} mock_event_t;
+
+/*
+ * Settings, from the environment
+ */
+static int mock_nodes = 1;
+static const char *mock_host_prefix = "node";
+static int mock_cyclic = 0;
+static int mock_launch_ms = 10;
+static int mock_ready_ms = 20;
+static int mock_connect_ms = 0;
+static int mock_exit_ms = 10;
+static int mock_exit_code = 0;
+static int mock_fail_rank = -1;
+static int mock_fail_ms = -1;
+static const char *mock_output = NULL;
+static int mock_output_count = 1;
+
+/*
+ * State, protected by mock_lock. Handlers are called without it held, so
+ * that they can call back into the mock.
+ */
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mock_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t mock_thread;
+static int mock_running = 0;
+static mock_handler_t mock_handlers[MOCK_MAX_HANDLERS];
+static size_t mock_num_handlers = 0;
+static mock_pull_t mock_pulls[MOCK_MAX_PULLS];
+static size_t mock_num_pulls = 0;
+static mock_job_t mock_jobs[MOCK_MAX_JOBS];
+static int mock_num_jobs = 0;
+static mock_event_t *mock_events = NULL;
+static int mock_queries = 0;
+static long mock_allocations = 0;
+
+static double mock_now(void);
+static int mock_getenv_int(const char *name, int default_value);
+static void *mock_progress(void *arg);
+static void mock_schedule(mock_event_t *event, double delay_ms);
+static mock_event_t *mock_job_event(mock_job_t *job, pmix_status_t status, int launcher,
+                                    pmix_rank_t rank);
+static void mock_dispatch(mock_event_t *event);
+static void mock_write_output(mock_event_t *event);
+static void mock_event_complete(pmix_status_t status, pmix_info_t *results, size_t num_results,
+                                pmix_op_cbfunc_t cbfunc, void *thiscbdata, void *notification_cbdata);
+static int mock_proc_match(const pmix_proc_t *filter, const pmix_proc_t *proc);
+static void mock_hold_directives(mock_job_t *job, const pmix_info_t info[], size_t num_info);
+static void mock_release(const pmix_proc_t *proc);
+static void mock_release_rank(mock_job_t *job, int index, int rank);
+
+/**
+ * @name   mock_pmix_load_settings
+ * @brief  Read the settings of the mock from the environment.
+ */
+void mock_pmix_load_settings(void)
+{
+    const char *mapping, *prefix;
+
+    mock_nodes = mock_getenv_int("MOCK_PMIX_NODES", 1);
+    if (1 > mock_nodes) {
+        mock_nodes = 1;
+    }
+    prefix = getenv("MOCK_PMIX_HOST_PREFIX");
+    mock_host_prefix = (NULL != prefix) ? prefix : "node";
+    mapping = getenv("MOCK_PMIX_MAPPING");
+    mock_cyclic = (NULL != mapping && 0 == strcmp(mapping, "cyclic"));
+    mock_launch_ms = mock_getenv_int("MOCK_PMIX_LAUNCH_MS", 10);
+    mock_ready_ms = mock_getenv_int("MOCK_PMIX_READY_MS", 20);
+    mock_connect_ms = mock_getenv_int("MOCK_PMIX_CONNECT_MS", 0);
+    mock_exit_ms = mock_getenv_int("MOCK_PMIX_EXIT_MS", 10);
+    mock_exit_code = mock_getenv_int("MOCK_PMIX_EXIT_CODE", 0);
+    mock_fail_rank = mock_getenv_int("MOCK_PMIX_FAIL_RANK", -1);
+    mock_fail_ms = mock_getenv_int("MOCK_PMIX_FAIL_MS", -1);
+    mock_output = getenv("MOCK_PMIX_OUTPUT");
+    if (NULL != mock_output && '\0' == *mock_output) {
+        mock_output = NULL;
+    }
+    mock_output_count = mock_getenv_int("MOCK_PMIX_OUTPUT_COUNT", 1);
+}
+
+/**
+ * @name   mock_pmix_hostname
+ * @brief  Get the node of a rank as the process table reports it.
+ * @param  rank: The rank
+ * @param  num_ranks: Number of ranks of the job
+ * @param  hostname: Set to the name of the node
+ * @param  size: Size of hostname
+ */
+void mock_pmix_hostname(pmix_rank_t rank, int num_ranks, char *hostname, size_t size)
+{
+    int ranks_per_node;
+
+    if (mock_cyclic) {
+        snprintf(hostname, size, "%s%04d", mock_host_prefix, (int)(rank % mock_nodes));
+    }
+    else {
+        ranks_per_node = (num_ranks + mock_nodes - 1) / mock_nodes;
+        snprintf(hostname, size, "%s%04d", mock_host_prefix,
+                 (int)(rank / (0 < ranks_per_node ? ranks_per_node : 1)));
+    }
+}
+
+/**
+ * @name   mock_pmix_num_released
+ * @brief  Get how many ranks of a job were released.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @return The number of ranks, -1 for an unknown job
+ */
+int mock_pmix_num_released(int job_index)
+{
+    int num_released = -1;
+
+    pthread_mutex_lock(&mock_lock);
+    if (0 <= job_index && job_index < mock_num_jobs) {
+        num_released = mock_jobs[job_index].num_released;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return num_released;
+}
+
+/**
+ * @name   mock_pmix_num_releases
+ * @brief  Get how many release notifications released ranks of a job.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @return The number of notifications, -1 for an unknown job
+ */
+int mock_pmix_num_releases(int job_index)
+{
+    int num_releases = -1;
+
+    pthread_mutex_lock(&mock_lock);
+    if (0 <= job_index && job_index < mock_num_jobs) {
+        num_releases = mock_jobs[job_index].num_releases;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return num_releases;
+}
+
+/**
+ * @name   mock_pmix_num_queries
+ * @brief  Get how many process table queries were answered.
+ * @return The number of queries
+ */
+int mock_pmix_num_queries(void)
+{
+    int num_queries;
+
+    pthread_mutex_lock(&mock_lock);
+    num_queries = mock_queries;
+    pthread_mutex_unlock(&mock_lock);
+    return num_queries;
+}
+
+/**
+ * @name   mock_pmix_num_allocations
+ * @brief  Get how many blocks the mock allocated with malloc, calloc or
+ *         strdup, to tell them from those of the shim.
+ * @return The number of allocations
+ */
+long mock_pmix_num_allocations(void)
+{
+    long num_allocations;
+
+    pthread_mutex_lock(&mock_lock);
+    num_allocations = mock_allocations;
+    pthread_mutex_unlock(&mock_lock);
+    return num_allocations;
+}
+
+/**
+ * @name   mock_pmix_stdin_bytes
+ * @brief  Get how much stdin was pushed to a rank.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @param  rank: The rank
+ * @param  closed: Set to whether the rank was told stdin is complete, may be
+ *         NULL
+ * @return The number of bytes, -1 for an unknown job or rank
+ */
+long mock_pmix_stdin_bytes(int job_index, int rank, int *closed)
+{
+    long bytes = -1;
+
+    if (NULL != closed) {
+        *closed = 0;
+    }
+    pthread_mutex_lock(&mock_lock);
+    if (0 <= job_index && job_index < mock_num_jobs && 0 <= rank &&
+        rank < mock_jobs[job_index].num_ranks) {
+        bytes = 0;
+        if (NULL != mock_jobs[job_index].stdin_bytes) {
+            bytes = mock_jobs[job_index].stdin_bytes[rank];
+            if (NULL != closed) {
+                *closed = mock_jobs[job_index].stdin_closed[rank];
+            }
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return bytes;
+}
+
+/*
+ * The PMIx calls of the shim
+ */
+pmix_status_t PMIx_tool_init(pmix_proc_t *proc, pmix_info_t info[], size_t ninfo)
+{
+    int j;
+
+    (void)info;
+    (void)ninfo;
+
+    for (j = 0; j < mock_num_jobs; j++) {
+        free(mock_jobs[j].held);
+        free(mock_jobs[j].released);
+        free(mock_jobs[j].stdin_bytes);
+        free(mock_jobs[j].stdin_closed);
+    }
+    mock_num_jobs = 0;
+    mock_queries = 0;
+    mock_allocations = 0;
+    mock_pmix_load_settings();
+
+    PMIX_LOAD_PROCID(proc, "mock-tool", 0);
+    mock_running = 1;
+    if (0 != pthread_create(&mock_thread, NULL, mock_progress, NULL)) {
+        mock_running = 0;
+        return PMIX_ERR_OUT_OF_RESOURCE;
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_tool_finalize(void)
+{
+    mock_event_t *event;
+    size_t i;
+
+    pthread_mutex_lock(&mock_lock);
+    if (!mock_running) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_SUCCESS;
+    }
+    mock_running = 0;
+    pthread_cond_signal(&mock_cond);
+    pthread_mutex_unlock(&mock_lock);
+    pthread_join(mock_thread, NULL);
+
+    while (NULL != mock_events) {
+        event = mock_events;
+        mock_events = event->next;
+        free(event);
+    }
+    for (i = 0; i < mock_num_handlers; i++) {
+        free(mock_handlers[i].codes);
+    }
+    mock_num_handlers = 0;
+    mock_num_pulls = 0;
+    // The jobs are kept for the test to check, until the next init
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_tool_set_server(const pmix_proc_t *server, pmix_info_t info[], size_t ninfo)
+{
+    (void)server;
+    (void)info;
+    (void)ninfo;
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Get(const pmix_proc_t *proc, const char key[],
+                       const pmix_info_t info[], size_t ninfo, pmix_value_t **val)
+{
+    pmix_rank_t rank = 0;
+
+    (void)proc;
+    (void)info;
+    (void)ninfo;
+
+    PMIX_VALUE_CREATE(*val, 1);
+    if (0 == strncmp(key, PMIX_SERVER_NSPACE, PMIX_MAX_KEYLEN)) {
+        PMIX_VALUE_LOAD(*val, "mock-server", PMIX_STRING);
+    }
+    else if (0 == strncmp(key, PMIX_SERVER_RANK, PMIX_MAX_KEYLEN)) {
+        PMIX_VALUE_LOAD(*val, &rank, PMIX_PROC_RANK);
+    }
+    else {
+        // The server URIs
+        PMIX_VALUE_LOAD(*val, "mock-server;tcp4://127.0.0.1:0", PMIX_STRING);
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Spawn(const pmix_info_t job_info[], size_t ninfo,
+                         const pmix_app_t apps[], size_t napps, pmix_nspace_t nspace)
+{
+    mock_job_t *job;
+    size_t i;
+    int daemons = 0, skip_value = 0;
+    char **argv;
+
+    for (i = 0; i < ninfo; i++) {
+        if (PMIX_CHECK_KEY(&job_info[i], PMIX_DEBUGGER_DAEMONS)) {
+            daemons = 1;
+        }
+    }
+
+    pthread_mutex_lock(&mock_lock);
+    if (1 > napps || MOCK_MAX_JOBS == mock_num_jobs) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_OUT_OF_RESOURCE;
+    }
+    job = &mock_jobs[mock_num_jobs];
+    memset(job, 0, sizeof(*job));
+
+    if (daemons) {
+        // One daemon per node, running as soon as they are spawned
+        snprintf(job->launcher_nspace, sizeof(job->launcher_nspace),
+                 "mock-daemons.%d", mock_num_jobs);
+        PMIX_LOAD_NSPACE(job->application_nspace, job->launcher_nspace);
+        snprintf(job->executable, sizeof(job->executable), "%s",
+                 NULL != apps[0].cmd ? apps[0].cmd : "");
+        job->num_ranks = mock_nodes;
+        job->launched = 1;
+    }
+    else {
+        snprintf(job->launcher_nspace, sizeof(job->launcher_nspace),
+                 "mock-launcher.%d", mock_num_jobs);
+        snprintf(job->application_nspace, sizeof(job->application_nspace),
+                 "mock-app.%d", mock_num_jobs);
+        job->num_ranks = 1;
+        argv = apps[0].argv;
+        for (i = 1; NULL != argv && NULL != argv[i]; i++) {
+            if (0 == strcmp(argv[i], "-n") || 0 == strcmp(argv[i], "-np")) {
+                if (NULL != argv[i + 1]) {
+                    job->num_ranks = atoi(argv[i + 1]);
+                }
+                skip_value = 1;
+            }
+            else if (skip_value) {
+                skip_value = 0;
+            }
+            else if ('-' != argv[i][0] && '\0' == job->executable[0]) {
+                snprintf(job->executable, sizeof(job->executable), "%s", argv[i]);
+            }
+        }
+        if (1 > job->num_ranks) {
+            job->num_ranks = 1;
+        }
+    }
+
+    job->held = calloc(job->num_ranks, 1);
+    job->released = calloc(job->num_ranks, 1);
+    mock_allocations += 2;
+    if (NULL == job->held || NULL == job->released) {
+        free(job->held);
+        free(job->released);
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_OUT_OF_RESOURCE;
+    }
+    if (!daemons) {
+        mock_hold_directives(job, job_info, ninfo);
+    }
+    mock_num_jobs++;
+    PMIX_LOAD_NSPACE(nspace, job->launcher_nspace);
+    pthread_mutex_unlock(&mock_lock);
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Register_event_handler(pmix_status_t codes[], size_t ncodes,
+                                          pmix_info_t info[], size_t ninfo,
+                                          pmix_notification_fn_t evhdlr,
+                                          pmix_hdlr_reg_cbfunc_t cbfunc, void *cbdata)
+{
+    mock_handler_t *handler;
+    size_t i, id;
+
+    pthread_mutex_lock(&mock_lock);
+    if (MOCK_MAX_HANDLERS == mock_num_handlers) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_OUT_OF_RESOURCE;
+    }
+    handler = &mock_handlers[mock_num_handlers];
+    memset(handler, 0, sizeof(*handler));
+    handler->active = 1;
+    handler->id = id = mock_num_handlers + 1;
+    handler->handler = evhdlr;
+    if (0 < ncodes) {
+        handler->codes = malloc(ncodes * sizeof(pmix_status_t));
+        if (NULL == handler->codes) {
+            pthread_mutex_unlock(&mock_lock);
+            return PMIX_ERR_OUT_OF_RESOURCE;
+        }
+        memcpy(handler->codes, codes, ncodes * sizeof(pmix_status_t));
+        mock_allocations++;
+        handler->num_codes = ncodes;
+    }
+    for (i = 0; i < ninfo; i++) {
+        if (PMIX_CHECK_KEY(&info[i], PMIX_EVENT_RETURN_OBJECT)) {
+            handler->return_object = info[i].value.data.ptr;
+        }
+        else if (PMIX_CHECK_KEY(&info[i], PMIX_EVENT_AFFECTED_PROC)) {
+            handler->has_affected = 1;
+            handler->affected = *info[i].value.data.proc;
+        }
+    }
+    mock_num_handlers++;
+    pthread_mutex_unlock(&mock_lock);
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, id, cbdata);
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Deregister_event_handler(size_t evhdlr_ref, pmix_op_cbfunc_t cbfunc,
+                                            void *cbdata)
+{
+    size_t i;
+
+    pthread_mutex_lock(&mock_lock);
+    for (i = 0; i < mock_num_handlers; i++) {
+        if (mock_handlers[i].id == evhdlr_ref) {
+            mock_handlers[i].active = 0;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, cbdata);
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Notify_event(pmix_status_t status, const pmix_proc_t *source,
+                                pmix_data_range_t range, const pmix_info_t info[], size_t ninfo,
+                                pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    int num_released[MOCK_MAX_JOBS];
+    pmix_proc_t *procs;
+    size_t i, k;
+    int j;
+
+    (void)source;
+    (void)range;
+
+    // Releasing held processes is the only event a tool sends to the server
+    if (PMIX_ERR_DEBUGGER_RELEASE == status) {
+        pthread_mutex_lock(&mock_lock);
+        for (j = 0; j < mock_num_jobs; j++) {
+            num_released[j] = mock_jobs[j].num_released;
+        }
+        for (i = 0; i < ninfo; i++) {
+            if (!PMIX_CHECK_KEY(&info[i], PMIX_EVENT_CUSTOM_RANGE)) {
+                continue;
+            }
+            if (PMIX_PROC == info[i].value.type) {
+                mock_release(info[i].value.data.proc);
+            }
+            else if (PMIX_DATA_ARRAY == info[i].value.type &&
+                     PMIX_PROC == info[i].value.data.darray->type) {
+                procs = info[i].value.data.darray->array;
+                for (k = 0; k < info[i].value.data.darray->size; k++) {
+                    mock_release(&procs[k]);
+                }
+            }
+        }
+        for (j = 0; j < mock_num_jobs; j++) {
+            if (num_released[j] != mock_jobs[j].num_released) {
+                mock_jobs[j].num_releases++;
+            }
+        }
+        pthread_mutex_unlock(&mock_lock);
+    }
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, cbdata);
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Query_info(pmix_query_t queries[], size_t nqueries,
+                              pmix_info_t **results, size_t *nresults)
+{
+    pmix_data_array_t *proc_table;
+    pmix_proc_info_t *proc_info;
+    mock_job_t *job = NULL;
+    const char *nspace = NULL;
+    char hostname[MOCK_PMIX_MAX_HOSTNAME], namespaces[MOCK_MAX_JOBS * (PMIX_MAX_NSLEN + 1)];
+    double connected_ms;
+    pmix_rank_t rank;
+    size_t i;
+    int j;
+
+    if (1 > nqueries || NULL == queries[0].keys || NULL == queries[0].keys[0]) {
+        return PMIX_ERR_BAD_PARAM;
+    }
+    for (i = 0; i < queries[0].nqual; i++) {
+        if (PMIX_CHECK_KEY(&queries[0].qualifiers[i], PMIX_NSPACE)) {
+            nspace = queries[0].qualifiers[i].value.data.string;
+        }
+    }
+
+    pthread_mutex_lock(&mock_lock);
+    if (0 == strcmp(queries[0].keys[0], PMIX_QUERY_NAMESPACES)) {
+        namespaces[0] = '\0';
+        for (j = 0; j < mock_num_jobs; j++) {
+            if (mock_jobs[j].launched) {
+                if ('\0' != namespaces[0]) {
+                    strcat(namespaces, ",");
+                }
+                strcat(namespaces, mock_jobs[j].application_nspace);
+            }
+        }
+        pthread_mutex_unlock(&mock_lock);
+        if ('\0' == namespaces[0]) {
+            return PMIX_ERR_NOT_FOUND;
+        }
+        PMIX_INFO_CREATE(*results, 1);
+        PMIX_INFO_LOAD(&(*results)[0], PMIX_QUERY_NAMESPACES, namespaces, PMIX_STRING);
+        *nresults = 1;
+        return PMIX_SUCCESS;
+    }
+    if (0 != strcmp(queries[0].keys[0], PMIX_QUERY_PROC_TABLE)) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_NOT_SUPPORTED;
+    }
+
+    for (j = 0; NULL != nspace && j < mock_num_jobs; j++) {
+        if (PMIX_CHECK_NSPACE(nspace, mock_jobs[j].application_nspace) &&
+            mock_jobs[j].launched) {
+            job = &mock_jobs[j];
+        }
+    }
+    if (NULL == job) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_NOT_FOUND;
+    }
+    mock_queries++;
+    mock_allocations += 2 * (long)job->num_ranks;
+
+    /*
+     * Ranks are listed last first, since a server gives no order. Each rank
+     * connects to its server in turn over the connect time.
+     */
+    connected_ms = mock_now() - job->launch_ms;
+    PMIX_DATA_ARRAY_CREATE(proc_table, (size_t)job->num_ranks, PMIX_PROC_INFO);
+    proc_info = proc_table->array;
+    for (j = 0; j < job->num_ranks; j++) {
+        rank = job->num_ranks - 1 - j;
+        mock_pmix_hostname(rank, job->num_ranks, hostname, sizeof(hostname));
+        PMIX_LOAD_PROCID(&proc_info[j].proc, job->application_nspace, rank);
+        proc_info[j].hostname = strdup(hostname);
+        proc_info[j].executable_name = strdup(job->executable);
+        proc_info[j].pid = MOCK_PMIX_PID_BASE + rank;
+        if (job->failed && (pmix_rank_t)mock_fail_rank == rank) {
+            proc_info[j].state = PMIX_PROC_STATE_ABORTED;
+        }
+        else if (0 <= connected_ms &&
+                 (double)mock_connect_ms * (rank + 1) <= connected_ms * job->num_ranks) {
+            proc_info[j].state = PMIX_PROC_STATE_CONNECTED;
+        }
+        else {
+            proc_info[j].state = PMIX_PROC_STATE_RUNNING;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+
+    // The array is handed over to the results, not copied
+    PMIX_INFO_CREATE(*results, 1);
+    PMIX_LOAD_KEY((*results)[0].key, PMIX_QUERY_PROC_TABLE);
+    (*results)[0].value.type = PMIX_DATA_ARRAY;
+    (*results)[0].value.data.darray = proc_table;
+    *nresults = 1;
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Job_control(const pmix_proc_t targets[], size_t ntargets,
+                               const pmix_info_t directives[], size_t ndirs,
+                               pmix_info_t **results, size_t *nresults)
+{
+    (void)targets;
+    (void)ntargets;
+    (void)directives;
+    (void)ndirs;
+
+    if (NULL != results) {
+        *results = NULL;
+    }
+    if (NULL != nresults) {
+        *nresults = 0;
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_Job_control_nb(const pmix_proc_t targets[], size_t ntargets,
+                                  const pmix_info_t directives[], size_t ndirs,
+                                  pmix_info_cbfunc_t cbfunc, void *cbdata)
+{
+    (void)targets;
+    (void)ntargets;
+    (void)directives;
+    (void)ndirs;
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, NULL, 0, cbdata, NULL, NULL);
+    }
+    return PMIX_SUCCESS;
+}
+
+pmix_status_t PMIx_IOF_pull(const pmix_proc_t procs[], size_t nprocs,
+                            const pmix_info_t directives[], size_t ndirs,
+                            pmix_iof_channel_t channel, pmix_iof_cbfunc_t cbfunc,
+                            pmix_hdlr_reg_cbfunc_t regcbfunc, void *regcbdata)
+{
+    mock_pull_t *pull;
+    size_t id;
+
+    (void)directives;
+    (void)ndirs;
+    (void)channel;
+
+    pthread_mutex_lock(&mock_lock);
+    if (MOCK_MAX_PULLS == mock_num_pulls) {
+        pthread_mutex_unlock(&mock_lock);
+        return PMIX_ERR_OUT_OF_RESOURCE;
+    }
+    pull = &mock_pulls[mock_num_pulls];
+    pull->id = id = mock_num_pulls + 1;
+    if (0 < nprocs) {
+        pull->source = procs[0];
+    }
+    else {
+        PMIX_LOAD_PROCID(&pull->source, NULL, PMIX_RANK_WILDCARD);
+    }
+    pull->handler = cbfunc;
+    mock_num_pulls++;
+    pthread_mutex_unlock(&mock_lock);
+
+    if (NULL != regcbfunc) {
+        regcbfunc(PMIX_SUCCESS, id, regcbdata);
+        return PMIX_SUCCESS;
+    }
+    // Without a registration callback the handler id is returned
+    return (pmix_status_t)id;
+}
+
+pmix_status_t PMIx_IOF_push(const pmix_proc_t targets[], size_t ntargets,
+                            pmix_byte_object_t *bo, const pmix_info_t directives[],
+                            size_t ndirs, pmix_op_cbfunc_t cbfunc, void *cbdata)
+{
+    mock_job_t *job;
+    size_t i, k;
+    int complete = 0, j, rank;
+
+    for (k = 0; k < ndirs; k++) {
+        if (PMIX_CHECK_KEY(&directives[k], PMIX_IOF_COMPLETE)) {
+            complete = PMIX_INFO_TRUE(&directives[k]);
+        }
+    }
+
+    pthread_mutex_lock(&mock_lock);
+    for (i = 0; i < ntargets; i++) {
+        for (j = 0; j < mock_num_jobs; j++) {
+            job = &mock_jobs[j];
+            if (!PMIX_CHECK_NSPACE(targets[i].nspace, job->application_nspace) ||
+                PMIX_CHECK_NSPACE(job->launcher_nspace, job->application_nspace)) {
+                continue;
+            }
+            if (NULL == job->stdin_bytes) {
+                job->stdin_bytes = calloc(job->num_ranks, sizeof(long));
+                job->stdin_closed = calloc(job->num_ranks, 1);
+                mock_allocations += 2;
+                if (NULL == job->stdin_bytes || NULL == job->stdin_closed) {
+                    free(job->stdin_bytes);
+                    free(job->stdin_closed);
+                    job->stdin_bytes = NULL;
+                    job->stdin_closed = NULL;
+                    pthread_mutex_unlock(&mock_lock);
+                    return PMIX_ERR_OUT_OF_RESOURCE;
+                }
+            }
+            for (rank = 0; rank < job->num_ranks; rank++) {
+                if (PMIX_RANK_WILDCARD != targets[i].rank &&
+                    (pmix_rank_t)rank != targets[i].rank) {
+                    continue;
+                }
+                if (NULL != bo) {
+                    job->stdin_bytes[rank] += (long)bo->size;
+                }
+                if (complete) {
+                    job->stdin_closed[rank] = 1;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, cbdata);
+    }
+    return PMIX_SUCCESS;
+}
+
+/**
+ * @name   mock_now
+ * @brief  Read the clock events are scheduled by.
+ * @return Milliseconds
+ */
+double mock_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * @name   mock_getenv_int
+ * @brief  Read an integer setting from the environment.
+ * @param  name: The environment variable
+ * @param  default_value: The value if the variable is not set
+ * @return The value
+ */
+int mock_getenv_int(const char *name, int default_value)
+{
+    const char *value;
+
+    value = getenv(name);
+    if (NULL == value || '\0' == *value) {
+        return default_value;
+    }
+    return atoi(value);
+}
+
+/**
+ * @name   mock_progress
+ * @brief  Deliver the queued events when they are due, until finalized.
+ * @param  arg: Unused
+ * @return NULL
+ */
+void *mock_progress(void *arg)
+{
+    mock_event_t *event;
+    struct timespec until;
+    double wait_ms;
+
+    (void)arg;
+
+    pthread_mutex_lock(&mock_lock);
+    while (mock_running) {
+        if (NULL == mock_events) {
+            pthread_cond_wait(&mock_cond, &mock_lock);
+            continue;
+        }
+        wait_ms = mock_events->due_ms - mock_now();
+        if (0 < wait_ms) {
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += (time_t)(wait_ms / 1e3);
+            until.tv_nsec += (long)((wait_ms - (time_t)(wait_ms / 1e3) * 1e3) * 1e6);
+            if (1000000000L <= until.tv_nsec) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&mock_cond, &mock_lock, &until);
+            continue;
+        }
+        event = mock_events;
+        mock_events = event->next;
+        if (0 <= event->fail_job) {
+            mock_jobs[event->fail_job].failed = 1;
+        }
+        pthread_mutex_unlock(&mock_lock);
+        if (event->output) {
+            mock_write_output(event);
+        }
+        else {
+            mock_dispatch(event);
+        }
+        free(event);
+        pthread_mutex_lock(&mock_lock);
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return NULL;
+}
+
+/**
+ * @name   mock_schedule
+ * @brief  Queue an event, in the order events are due. Called with
+ *         mock_lock held.
+ * @param  event: The event, freed once delivered
+ * @param  delay_ms: Time until the event is due
+ */
+void mock_schedule(mock_event_t *event, double delay_ms)
+{
+    mock_event_t **next;
+
+    event->due_ms = mock_now() + delay_ms;
+    for (next = &mock_events; NULL != *next && (*next)->due_ms <= event->due_ms;
+         next = &(*next)->next) {
+    }
+    event->next = *next;
+    *next = event;
+    pthread_cond_signal(&mock_cond);
+}
+
+/**
+ * @name   mock_job_event
+ * @brief  Create an event sent by the launcher of a job.
+ * @param  job: The job
+ * @param  status: The event
+ * @param  launcher: 1 if the launcher is affected, 0 for the application
+ * @param  rank: The affected rank
+ * @return The event, NULL if out of memory
+ */
+mock_event_t *mock_job_event(mock_job_t *job, pmix_status_t status, int launcher,
+                             pmix_rank_t rank)
+{
+    mock_event_t *event;
+
+    event = calloc(1, sizeof(*event));
+    if (NULL == event) {
+        fprintf(stderr, "mock_pmix: out of memory\n");
+        return NULL;
+    }
+    mock_allocations++;
+    event->status = status;
+    event->fail_job = -1;
+    PMIX_LOAD_PROCID(&event->source, job->launcher_nspace, 0);
+    PMIX_LOAD_PROCID(&event->affected,
+                     launcher ? job->launcher_nspace : job->application_nspace, rank);
+    return event;
+}
+
+/**
+ * @name   mock_dispatch
+ * @brief  Deliver an event to the first handler registered for it whose
+ *         affected process matches, else to the first default handler.
+ * @param  event: The event
+ */
+void mock_dispatch(mock_event_t *event)
+{
+    mock_handler_t handler;
+    pmix_info_t info[4];
+    size_t i, k, num_info = 0;
+    int found = 0;
+
+    pthread_mutex_lock(&mock_lock);
+    for (i = 0; i < mock_num_handlers && !found; i++) {
+        if (!mock_handlers[i].active || NULL == mock_handlers[i].codes) {
+            continue;
+        }
+        for (k = 0; k < mock_handlers[i].num_codes && !found; k++) {
+            found = (mock_handlers[i].codes[k] == event->status &&
+                     (!mock_handlers[i].has_affected ||
+                      mock_proc_match(&mock_handlers[i].affected, &event->affected)));
+        }
+        if (found) {
+            handler = mock_handlers[i];
+        }
+    }
+    for (i = 0; i < mock_num_handlers && !found; i++) {
+        if (mock_handlers[i].active && NULL == mock_handlers[i].codes) {
+            handler = mock_handlers[i];
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (!found) {
+        return;
+    }
+
+    PMIX_INFO_LOAD(&info[num_info], PMIX_EVENT_AFFECTED_PROC, &event->affected, PMIX_PROC);
+    num_info++;
+    if ('\0' != event->nspace[0]) {
+        PMIX_INFO_LOAD(&info[num_info], PMIX_NSPACE, event->nspace, PMIX_STRING);
+        num_info++;
+    }
+    if (event->has_exit_code) {
+        PMIX_INFO_LOAD(&info[num_info], PMIX_EXIT_CODE, &event->exit_code, PMIX_INT);
+        num_info++;
+    }
+    if (NULL != handler.return_object) {
+        PMIX_INFO_LOAD(&info[num_info], PMIX_EVENT_RETURN_OBJECT, handler.return_object,
+                       PMIX_POINTER);
+        num_info++;
+    }
+    handler.handler(handler.id, event->status, &event->source, info, num_info,
+                    NULL, 0, mock_event_complete, NULL);
+    for (i = 0; i < num_info; i++) {
+        PMIX_INFO_DESTRUCT(&info[i]);
+    }
+}
+
+/**
+ * @name   mock_write_output
+ * @brief  Deliver the output of a rank to every registration for it. Each
+ *         "%h" of the output is replaced with the node of the rank.
+ * @param  event: The event, whose affected process is the rank
+ */
+void mock_write_output(mock_event_t *event)
+{
+    char hostname[MOCK_PMIX_MAX_HOSTNAME];
+    mock_pull_t pulls[MOCK_MAX_PULLS];
+    pmix_byte_object_t payload;
+    const char *c;
+    char *text;
+    size_t i, num_pulls = 0, host_len, size;
+    int j, num_ranks = 1, k;
+
+    pthread_mutex_lock(&mock_lock);
+    for (j = 0; j < mock_num_jobs; j++) {
+        if (PMIX_CHECK_NSPACE(mock_jobs[j].application_nspace, event->affected.nspace)) {
+            num_ranks = mock_jobs[j].num_ranks;
+        }
+    }
+    for (i = 0; i < mock_num_pulls; i++) {
+        if (mock_proc_match(&mock_pulls[i].source, &event->affected)) {
+            pulls[num_pulls++] = mock_pulls[i];
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (0 == num_pulls) {
+        return;
+    }
+
+    mock_pmix_hostname(event->affected.rank, num_ranks, hostname, sizeof(hostname));
+    host_len = strlen(hostname);
+    size = strlen(mock_output) + 1;
+    for (c = strstr(mock_output, "%h"); NULL != c; c = strstr(c + 2, "%h")) {
+        size += host_len;
+    }
+    text = malloc(size);
+    if (NULL == text) {
+        fprintf(stderr, "mock_pmix: out of memory\n");
+        return;
+    }
+    mock_allocations++;
+    for (c = mock_output, size = 0; '\0' != *c; c++) {
+        if ('%' == c[0] && 'h' == c[1]) {
+            memcpy(&text[size], hostname, host_len);
+            size += host_len;
+            c++;
+        }
+        else {
+            text[size++] = *c;
+        }
+    }
+
+    payload.bytes = text;
+    payload.size = size;
+    for (k = 0; k < mock_output_count; k++) {
+        for (i = 0; i < num_pulls; i++) {
+            pulls[i].handler(pulls[i].id, PMIX_FWD_STDOUT_CHANNEL, &event->affected,
+                             &payload, NULL, 0);
+        }
+    }
+    free(text);
+}
+
+/**
+ * @name   mock_event_complete
+ * @brief  Take note that a handler is done with an event.
+ */
+void mock_event_complete(pmix_status_t status, pmix_info_t *results, size_t num_results,
+                         pmix_op_cbfunc_t cbfunc, void *thiscbdata, void *notification_cbdata)
+{
+    (void)status;
+    (void)results;
+    (void)num_results;
+    (void)notification_cbdata;
+
+    if (NULL != cbfunc) {
+        cbfunc(PMIX_SUCCESS, thiscbdata);
+    }
+}
+
+/**
+ * @name   mock_proc_match
+ * @brief  Check whether a process is selected by a filter.
+ * @param  filter: The filter, rank may be PMIX_RANK_WILDCARD
+ * @param  proc: The process, rank may be PMIX_RANK_WILDCARD
+ * @return 1 if it is, 0 if not
+ */
+int mock_proc_match(const pmix_proc_t *filter, const pmix_proc_t *proc)
+{
+    return (PMIX_CHECK_NSPACE(filter->nspace, proc->nspace) &&
+            (PMIX_RANK_WILDCARD == filter->rank || PMIX_RANK_WILDCARD == proc->rank ||
+             filter->rank == proc->rank));
+}
+
+/**
+ * @name   mock_hold_directives
+ * @brief  Mark the ranks a job is asked to hold, in init, at exec or in the
+ *         application, by its job info or launch directives. Called with
+ *         mock_lock held.
+ * @param  job: The job
+ * @param  info: The job info
+ * @param  num_info: Number of job info
+ */
+void mock_hold_directives(mock_job_t *job, const pmix_info_t info[], size_t num_info)
+{
+    pmix_rank_t *ranks;
+    size_t i, k;
+    int rank;
+
+    for (i = 0; i < num_info; i++) {
+        if (PMIX_CHECK_KEY(&info[i], PMIX_LAUNCH_DIRECTIVES) &&
+            PMIX_DATA_ARRAY == info[i].value.type &&
+            PMIX_INFO == info[i].value.data.darray->type) {
+            mock_hold_directives(job, info[i].value.data.darray->array,
+                                 info[i].value.data.darray->size);
+            continue;
+        }
+        if (!PMIX_CHECK_KEY(&info[i], PMIX_DEBUG_STOP_IN_INIT) &&
+            !PMIX_CHECK_KEY(&info[i], PMIX_DEBUG_STOP_ON_EXEC) &&
+            !PMIX_CHECK_KEY(&info[i], PMIX_DEBUG_STOP_IN_APP)) {
+            continue;
+        }
+        if (PMIX_BOOL == info[i].value.type) {
+            memset(job->held, info[i].value.data.flag ? 1 : 0, job->num_ranks);
+        }
+        else if (PMIX_PROC_RANK == info[i].value.type) {
+            if (info[i].value.data.rank < (pmix_rank_t)job->num_ranks) {
+                job->held[info[i].value.data.rank] = 1;
+            }
+        }
+        else if (PMIX_DATA_ARRAY == info[i].value.type &&
+                 PMIX_PROC_RANK == info[i].value.data.darray->type) {
+            ranks = info[i].value.data.darray->array;
+            for (k = 0; k < info[i].value.data.darray->size; k++) {
+                rank = (int)ranks[k];
+                if (0 <= rank && rank < job->num_ranks) {
+                    job->held[rank] = 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @name   mock_release
+ * @brief  Release a launcher, which starts its launch, or application
+ *         processes. Called with mock_lock held.
+ * @param  proc: The process, rank may be PMIX_RANK_WILDCARD
+ */
+void mock_release(const pmix_proc_t *proc)
+{
+    mock_job_t *job;
+    mock_event_t *event;
+    int i, rank;
+
+    for (i = 0; i < mock_num_jobs; i++) {
+        job = &mock_jobs[i];
+        if (PMIX_CHECK_NSPACE(proc->nspace, job->launcher_nspace) && !job->launched) {
+            job->launched = 1;
+            job->launch_ms = mock_now() + mock_launch_ms;
+            event = mock_job_event(job, PMIX_LAUNCH_COMPLETE, 1, 0);
+            if (NULL != event) {
+                PMIX_LOAD_NSPACE(event->nspace, job->application_nspace);
+                mock_schedule(event, mock_launch_ms);
+            }
+            event = mock_job_event(job, PMIX_READY_FOR_DEBUG, 1, 0);
+            if (NULL != event) {
+                mock_schedule(event, mock_ready_ms);
+            }
+            if (0 <= mock_fail_ms && 0 <= mock_fail_rank && mock_fail_rank < job->num_ranks) {
+                event = mock_job_event(job, PMIX_ERR_PROC_ABORTED, 0,
+                                       (pmix_rank_t)mock_fail_rank);
+                if (NULL != event) {
+                    event->has_exit_code = 1;
+                    event->exit_code = MOCK_ABORT_CODE;
+                    event->fail_job = i;
+                    mock_schedule(event, mock_fail_ms);
+                }
+            }
+            for (rank = 0; rank < job->num_ranks; rank++) {
+                if (!job->held[rank]) {
+                    mock_release_rank(job, i, rank);
+                }
+            }
+        }
+        else if (PMIX_CHECK_NSPACE(proc->nspace, job->application_nspace) && job->launched) {
+            if (PMIX_RANK_WILDCARD == proc->rank) {
+                for (rank = 0; rank < job->num_ranks; rank++) {
+                    mock_release_rank(job, i, rank);
+                }
+            }
+            else if (proc->rank < (pmix_rank_t)job->num_ranks) {
+                mock_release_rank(job, i, (int)proc->rank);
+            }
+        }
+    }
+}
+
+/**
+ * @name   mock_release_rank
+ * @brief  Release one rank. Once all are, end the job: the application
+ *         terminates, after the fail rank aborts if there is one and it has
+ *         not already, and then its launcher. Called with mock_lock held.
+ * @param  job: The job
+ * @param  index: Index of the job
+ * @param  rank: The rank
+ */
+void mock_release_rank(mock_job_t *job, int index, int rank)
+{
+    mock_event_t *event;
+    double delay_ms = mock_exit_ms;
+    int exit_code = mock_exit_code;
+
+    if (job->released[rank]) {
+        return;
+    }
+    job->released[rank] = 1;
+    job->num_released++;
+    if (NULL != mock_output &&
+        !PMIX_CHECK_NSPACE(job->launcher_nspace, job->application_nspace)) {
+        event = mock_job_event(job, PMIX_SUCCESS, 0, (pmix_rank_t)rank);
+        if (NULL != event) {
+            event->output = 1;
+            mock_schedule(event, 0);
+        }
+    }
+    if (job->num_released < job->num_ranks ||
+        PMIX_CHECK_NSPACE(job->launcher_nspace, job->application_nspace)) {
+        return;
+    }
+
+    // A rank that aborts on its own schedule already did
+    if (0 <= mock_fail_rank && mock_fail_rank < job->num_ranks && 0 > mock_fail_ms) {
+        event = mock_job_event(job, PMIX_ERR_PROC_ABORTED, 0, (pmix_rank_t)mock_fail_rank);
+        if (NULL != event) {
+            event->has_exit_code = 1;
+            event->exit_code = MOCK_ABORT_CODE;
+            event->fail_job = index;
+            mock_schedule(event, delay_ms);
+        }
+        delay_ms += mock_exit_ms;
+    }
+    if (0 <= mock_fail_rank && mock_fail_rank < job->num_ranks) {
+        exit_code = MOCK_ABORT_CODE;
+    }
+    event = mock_job_event(job, PMIX_ERR_JOB_TERMINATED, 0, PMIX_RANK_WILDCARD);
+    if (NULL != event) {
+        event->has_exit_code = 1;
+        event->exit_code = exit_code;
+        mock_schedule(event, delay_ms);
+    }
+    event = mock_job_event(job, PMIX_ERR_JOB_TERMINATED, 1, 0);
+    if (NULL != event) {
+        event->has_exit_code = 1;
+        event->exit_code = exit_code;
+        mock_schedule(event, delay_ms + 1);
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * Stand-in for the PMIx server side of the tool calls made by the shim, so
+ * that the shim can be tested without PRRTE and without running any rank.
+ *
+ * Linked into a test program ahead of libpmix, mock_pmix.c replaces the
+ * calls the shim makes to a server: tool init and finalize, selecting a
+ * server, spawning a launcher, registering event handlers, notifying events
+ * (the release of held processes), process table and namespace queries,
+ * job control and forwarding I/O; stdin pushed to the ranks is counted.
+ * The rest of libpmix, such as the string and info list functions, is used
+ * as is.
+ *
+ * Spawning a launcher answers with its namespace; the number of ranks is
+ * the "-n" or "-np" argument of its command line, the executable the first
+ * argument after the launcher that is not an option. Releasing the
+ * launcher starts the launch: the launch complete and ready for debug
+ * events follow after the configured delays. The ranks not held are
+ * released then. Once every rank is released, the job ends after the
+ * configured delay, or a rank aborts first if asked to. The rank can also
+ * abort at a set time after the launcher release, even before the job is
+ * ready for debug. A released rank writes its output, if it has any, to
+ * the registrations for it.
+ *
+ * The mock reads its settings from the environment in PMIx_tool_init:
+ *   MOCK_PMIX_NODES       Number of nodes the ranks are spread over (1)
+ *   MOCK_PMIX_MAPPING     "block" (default) or "cyclic" placement of ranks
+ *   MOCK_PMIX_HOST_PREFIX Node names, followed by the node number ("node")
+ *   MOCK_PMIX_LAUNCH_MS   Delay from the launcher release to launch complete (10)
+ *   MOCK_PMIX_READY_MS    Delay from the launcher release to ready for debug (20)
+ *   MOCK_PMIX_CONNECT_MS  Time over which the ranks connect to their server,
+ *                         from launch complete, as seen in the process table (0)
+ *   MOCK_PMIX_EXIT_MS     Delay from the release of the last rank to the end of
+ *                         the job (10)
+ *   MOCK_PMIX_EXIT_CODE   Exit code of the application (0)
+ *   MOCK_PMIX_FAIL_RANK   Rank that aborts with code 134 once released (none)
+ *   MOCK_PMIX_FAIL_MS     Delay from the launcher release to the abort of the
+ *                         fail rank, instead of once released, so that it
+ *                         can abort while held (-1)
+ *   MOCK_PMIX_OUTPUT      What each rank writes to its stdout once released,
+ *                         each "%h" replaced with its node (none)
+ *   MOCK_PMIX_OUTPUT_COUNT Number of times each rank writes it (1)
+ */
+
+#ifndef MOCK_PMIX_H
+#define MOCK_PMIX_H
+
+#include <pmix_tool.h>
+
+// Pid of rank 0 of each job, the pids of the other ranks follow
+#define MOCK_PMIX_PID_BASE 100000
+// Longest node name, with its number
+#define MOCK_PMIX_MAX_HOSTNAME 1024
+
+/**
+ * @name   mock_pmix_load_settings
+ * @brief  Read the settings of the mock from the environment, as
+ *         PMIx_tool_init does. For a test checking a session that did not
+ *         run on the mock, such as a replayed one, against its layout.
+ */
+void mock_pmix_load_settings(void);
+
+/**
+ * @name   mock_pmix_hostname
+ * @brief  Get the node of a rank as the process table reports it.
+ * @param  rank: The rank
+ * @param  num_ranks: Number of ranks of the job
+ * @param  hostname: Set to the name of the node
+ * @param  size: Size of hostname
+ */
+void mock_pmix_hostname(pmix_rank_t rank, int num_ranks, char *hostname, size_t size);
+
+/**
+ * @name   mock_pmix_num_released
+ * @brief  Get how many ranks of a job were released.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @return The number of ranks, -1 for an unknown job
+ */
+int mock_pmix_num_released(int job_index);
+
+/**
+ * @name   mock_pmix_num_releases
+ * @brief  Get how many release notifications released ranks of a job, one
+ *         per wave when the ranks are released in waves.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @return The number of notifications, -1 for an unknown job
+ */
+int mock_pmix_num_releases(int job_index);
+
+/**
+ * @name   mock_pmix_stdin_bytes
+ * @brief  Get how much stdin was pushed to a rank.
+ * @param  job_index: Index of the job, in the order the launchers were spawned
+ * @param  rank: The rank
+ * @param  closed: Set to whether the rank was told stdin is complete, may be
+ *         NULL
+ * @return The number of bytes, -1 for an unknown job or rank
+ */
+long mock_pmix_stdin_bytes(int job_index, int rank, int *closed);
+
+/**
+ * @name   mock_pmix_num_queries
+ * @brief  Get how many process table queries were answered.
+ * @return The number of queries
+ */
+int mock_pmix_num_queries(void);
+
+/**
+ * @name   mock_pmix_num_allocations
+ * @brief  Get how many blocks the mock allocated with malloc, calloc or
+ *         strdup, to tell them from those of the shim.
+ * @return The number of allocations
+ */
+long mock_pmix_num_allocations(void);
+
+#endif /* MOCK_PMIX_H */
@@ -0,0 +1,1472 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file  mock_test.c
+ * @brief Run the shim against the mock PMIx server of mock_pmix.c, without
+ *        PRRTE, and check what it gives a debugger through the MPIR
+ *        symbols. Each scenario runs a session in a child process, with the
+ *        mock set up by its environment.
+ *
+ *   mock_test            Run every scenario
+ *   mock_test SCENARIO   Run one scenario, by name
+ *
+ * A replay scenario records the PMIx traffic of its session, then replays
+ * it in a second session that must see the same without calling the mock.
+ * A scenario with several jobs launches the same command line once per job.
+ * A scenario with a release policy checks how many release notifications
+ * the ranks of each job took, one per wave. A scenario with its own release
+ * function releases the ranks with it instead of MPIR_Shim_release_application.
+ * An aborting rank must be reported once, after the process table, with its
+ * node, even if it aborts while still held. A scenario with a setup function
+ * selects the features it tests before the session, and its verify function
+ * checks what they did once the session returns, such as the application
+ * output the session wrote, captured from stdout and stderr.
+ *
+ * The unit tests check parts of the shim that need no session, in this
+ * process.
+ */
+#include "mpirshim.h"
+#include "mpirshim_test.h"
+#include "mock_pmix.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct MPIR_PROCDESC {
+  const char *host_name;
+  const char *executable_name;
+  int pid;
+} MPIR_PROCDESC;
+
+extern int MPIR_debug_state;
+extern int MPIR_proctable_size;
+extern MPIR_PROCDESC *MPIR_proctable;
+extern int MPIR_Shim_jobtable_size;
+extern char *MPIR_debug_abort_string;
+
+typedef struct mock_scenario_t {
+    const char *name;
+    const char *num_ranks;
+    const char *nodes;
+    const char *mapping;
+    const char *fail_rank;
+    int expect_abort;
+    int replay;
+    int num_jobs;               // 0 for one
+    const char *release_policy; // NULL for all at once
+    int num_releases;           // Release notifications per job, 0 for one
+    void (*release)(void);      // Releases the ranks, NULL for all jobs at once
+    const char *fail_ms;        // When the rank aborts, NULL once released
+    void (*setup)(void);        // Called before the session, NULL for none
+    void (*verify)(void);       // Called after the session, NULL for none
+} mock_scenario_t;
+
+// A check that needs no session
+typedef struct mock_unit_test_t {
+    const char *name;
+    void (*run)(void);
+} mock_unit_test_t;
+
+static void release_by_api(void);
+static void setup_rate_limit(void);
+static void verify_rate_limit(void);
+static void setup_aggregation(void);
+static void verify_aggregation(void);
+static void setup_stdin_ranks(void);
+static void verify_stdin_ranks(void);
+static void setup_stdin_all(void);
+static void verify_stdin_all(void);
+static void setup_timings(void);
+static void verify_timings(void);
+static void setup_profile(void);
+static void verify_profile(void);
+static void setup_trace(void);
+static void verify_trace(void);
+static void verify_memory(void);
+static void setup_hold_report(void);
+static void verify_hold_report(void);
+static void setup_journal(void);
+static void verify_journal(void);
+static void test_rank_lists(void);
+
+// Name, ranks of each job, nodes, mapping, aborting rank, whether the
+// session aborts, whether it is replayed, number of jobs, release policy,
+// release notifications per job, release function, when the rank aborts,
+// setup and verify functions
+static mock_scenario_t scenarios[] = {
+    {"launch", "16", "4", "cyclic", NULL, 0},
+    {"block", "10", "3", "block", NULL, 0},
+    {"abort", "8", "2", "block", "5", 1},
+    {"held-abort", "8", "2", "block", "5", 1, 0, 0, NULL, 0, NULL, "15"},
+    {"million", "1000000", "1000", "block", NULL, 0},
+    {"replay", "64", "8", "cyclic", NULL, 0, 1},
+    {"jobs", "12", "3", "block", NULL, 0, 0, 3},
+    {"rank-waves", "16", "4", "block", NULL, 0, 0, 0, "ranks:5", 4},
+    {"node-waves", "16", "4", "cyclic", NULL, 0, 0, 2, "nodes:1", 4},
+    {"rate-waves", "16", "4", "block", NULL, 0, 0, 0, "rate:40", 4},
+    {"release-api", "16", "4", "block", NULL, 0, 0, 0, "manual", 4, release_by_api},
+    {"rate-limit", "16", "4", "block", NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+     setup_rate_limit, verify_rate_limit},
+    {"aggregation", "16", "4", "cyclic", NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+     setup_aggregation, verify_aggregation},
+    {"stdin-ranks", "8", "2", "block", NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+     setup_stdin_ranks, verify_stdin_ranks},
+    {"stdin-all", "8", "2", "block", NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+     setup_stdin_all, verify_stdin_all},
+    {"timings", "8", "2", "block", NULL, 0, 0, 2, NULL, 0, NULL, NULL,
+     setup_timings, verify_timings},
+    {"profile", "8", "2", "block", NULL, 0, 0, 2, NULL, 0, NULL, NULL,
+     setup_profile, verify_profile},
+    {"trace", "8", "2", "block", NULL, 0, 0, 2, NULL, 0, NULL, NULL,
+     setup_trace, verify_trace},
+    {"memory", "1000", "10", "block", NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+     NULL, verify_memory},
+    {"hold-report", "16", "4", "block", NULL, 0, 0, 0, "ranks:5", 4, NULL, NULL,
+     setup_hold_report, verify_hold_report},
+    {"journal", "8", "2", "block", NULL, 0, 0, 2, NULL, 0, NULL, NULL,
+     setup_journal, verify_journal},
+    {NULL}
+};
+
+static mock_unit_test_t unit_tests[] = {
+    {"rank-lists", test_rank_lists},
+    {NULL}
+};
+
+// Stdin forwarded by the stdin scenarios
+#define STDIN_FILE_SIZE (3 * 1024 * 1024 + 1000)
+#define STDIN_FILE_OFFSET 500
+#define STDIN_PIPE_TEXT "first line\nsecond line\nlast line\n"
+#define STDIN_PIPE_SIZE ((ssize_t)sizeof(STDIN_PIPE_TEXT) - 1)
+
+// The scenario running in this process
+static mock_scenario_t *scenario = NULL;
+static int num_failures = 0;
+static int num_spawned = 0;
+static int num_aborting = 0;
+// Output of the session while captured, and once captured
+static int saved_stdout = -1;
+static int saved_stderr = -1;
+static char *captured_stdout = NULL;
+static char *captured_stderr = NULL;
+
+static int run_replay_scenario(mock_scenario_t *test);
+static int run_scenario(mock_scenario_t *test, const char *capture, int replay);
+static int run_unit_test(mock_unit_test_t *test);
+static void check(int condition, const char *message, int value);
+static void check_proctable(void);
+static void check_abort(void);
+static int num_jobs(void);
+static void temp_path(char *path, size_t size, const char *suffix);
+static void capture_start(void);
+static void capture_stop(void);
+static void check_stdin(const char *targeted, long size);
+static int count_timings(const MPIR_Shim_timing_t *timings, int num_timings,
+                         const char *phase, int job);
+static unsigned long sum_counts(const char *list);
+static int read_hold_stats(const char *json, const char *name, double stats[6]);
+static char *read_file(const char *path);
+static char *run_tool(const char *command);
+static char *read_stream(FILE *stream);
+static const char *next_line(const char *line);
+
+void MPIR_Breakpoint_hook(void)
+{
+    if (1 == MPIR_debug_state) {
+        num_spawned++;
+        check_proctable();
+        if (NULL != scenario->release) {
+            scenario->release();
+        }
+        else if (0 != MPIR_Shim_release_application()) {
+            check(0, "MPIR_Shim_release_application failed", 0);
+        }
+    }
+    else if (2 == MPIR_debug_state) {
+        num_aborting++;
+        check_abort();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int i, ran = 0, rc = 0;
+
+    for (i = 0; NULL != scenarios[i].name; i++) {
+        if (1 < argc && 0 != strcmp(argv[1], scenarios[i].name)) {
+            continue;
+        }
+        ran++;
+        if (scenarios[i].replay) {
+            if (0 != run_replay_scenario(&scenarios[i])) {
+                rc = 1;
+            }
+        }
+        else if (0 != run_scenario(&scenarios[i], NULL, 0)) {
+            rc = 1;
+        }
+    }
+    for (i = 0; NULL != unit_tests[i].name; i++) {
+        if (1 < argc && 0 != strcmp(argv[1], unit_tests[i].name)) {
+            continue;
+        }
+        ran++;
+        if (0 != run_unit_test(&unit_tests[i])) {
+            rc = 1;
+        }
+    }
+    if (0 == ran) {
+        fprintf(stderr, "Unknown scenario '%s'.\n", argv[1]);
+        return 1;
+    }
+    return rc;
+}
+
+/**
+ * @name   run_replay_scenario
+ * @brief  Record a session, then replay it.
+ * @param  test: The scenario
+ * @return 0 if both passed, 1 if either failed
+ */
+int run_replay_scenario(mock_scenario_t *test)
+{
+    char capture[PATH_MAX];
+    int rc;
+
+    temp_path(capture, sizeof(capture), "pmix");
+    rc = run_scenario(test, capture, 0);
+    if (0 == rc) {
+        rc = run_scenario(test, capture, 1);
+    }
+    unlink(capture);
+    return rc;
+}
+
+/**
+ * @name   run_scenario
+ * @brief  Run one session of the shim in a child process and check it.
+ * @param  test: The scenario
+ * @param  capture: File to record the PMIx traffic in or replay it from,
+ *         NULL for neither
+ * @param  replay: Non-zero to replay capture instead of recording it
+ * @return 0 if it passed, 1 if it failed
+ */
+int run_scenario(mock_scenario_t *test, const char *capture, int replay)
+{
+    char *launcher[] = {"prterun", "-n", NULL, "./hello", NULL};
+    int ranks[] = {0};
+    pid_t pid;
+    int status, rc, j;
+
+    fflush(stdout);
+    pid = fork();
+    if (0 > pid) {
+        perror("fork");
+        return 1;
+    }
+    if (0 == pid) {
+        scenario = test;
+        launcher[2] = (char *)test->num_ranks;
+        setenv("MOCK_PMIX_NODES", test->nodes, 1);
+        setenv("MOCK_PMIX_MAPPING", test->mapping, 1);
+        if (NULL != test->fail_rank) {
+            setenv("MOCK_PMIX_FAIL_RANK", test->fail_rank, 1);
+        }
+        if (NULL != test->fail_ms) {
+            setenv("MOCK_PMIX_FAIL_MS", test->fail_ms, 1);
+        }
+        for (j = 1; j < num_jobs(); j++) {
+            if (0 != MPIR_Shim_add_job(4, launcher)) {
+                _exit(1);
+            }
+        }
+        if (NULL != test->release_policy &&
+            0 != MPIR_Shim_set_release_policy(test->release_policy)) {
+            _exit(1);
+        }
+        if (NULL != capture && 0 != (replay ? MPIR_Shim_set_pmix_replay(capture, 0) :
+                                     MPIR_Shim_set_pmix_record(capture))) {
+            _exit(1);
+        }
+        if (replay) {
+            // The layout the recorded session had
+            mock_pmix_load_settings();
+        }
+        if (NULL != test->setup) {
+            test->setup();
+        }
+
+        rc = MPIR_Shim_common(MPIR_SHIM_PROXY_MODE, 0, 0, 4, launcher, NULL);
+
+        if (NULL != test->verify) {
+            test->verify();
+        }
+        if (0 < num_failures && NULL != captured_stdout && NULL != captured_stderr) {
+            printf("%s: stdout of the session:\n%s%s: stderr of the session:\n%s",
+                   test->name, captured_stdout, test->name, captured_stderr);
+        }
+
+        check(1 == num_spawned, "MPIR_Breakpoint called %d times in MPIR_DEBUG_SPAWNED",
+              num_spawned);
+        // The jobs are gone, while MPIR_Shim_jobtable still describes them
+        check(0 != MPIR_Shim_release_ranks(0, ranks, 1),
+              "Released rank %d after the session", ranks[0]);
+        check(0 != MPIR_Shim_release_rank_ranges(0, "0"),
+              "Released rank %d after the session", ranks[0]);
+        if (replay) {
+            // Nothing may reach the mock server
+            check(-1 == mock_pmix_num_released(0), "%d ranks released by the mock",
+                  mock_pmix_num_released(0));
+            check(0 == mock_pmix_num_queries(), "%d process table queries to the mock",
+                  mock_pmix_num_queries());
+        }
+        else {
+            for (j = 0; j < num_jobs(); j++) {
+                check(atoi(test->num_ranks) == mock_pmix_num_released(j),
+                      "%d ranks released", mock_pmix_num_released(j));
+                check(((0 < test->num_releases) ? test->num_releases : 1) ==
+                      mock_pmix_num_releases(j), "Released in %d notifications",
+                      mock_pmix_num_releases(j));
+            }
+            check(0 < mock_pmix_num_queries(), "%d process table queries",
+                  mock_pmix_num_queries());
+        }
+        if (test->expect_abort) {
+            check(0 < num_aborting, "MPIR_DEBUG_ABORTING reported %d times", num_aborting);
+            check(0 != rc, "Session returned %d", rc);
+        }
+        else {
+            check(0 == num_aborting, "MPIR_DEBUG_ABORTING reported %d times", num_aborting);
+            check(0 == rc, "Session returned %d", rc);
+        }
+        fflush(stdout);
+        _exit(0 == num_failures ? 0 : 1);
+    }
+
+    if (0 > waitpid(pid, &status, 0)) {
+        perror("waitpid");
+        return 1;
+    }
+    if (WIFEXITED(status) && 0 == WEXITSTATUS(status)) {
+        printf("PASS: %s%s\n", test->name,
+               (NULL == capture) ? "" : (replay ? " (replayed)" : " (recorded)"));
+        return 0;
+    }
+    printf("FAIL: %s%s\n", test->name,
+           (NULL == capture) ? "" : (replay ? " (replayed)" : " (recorded)"));
+    return 1;
+}
+
+/**
+ * @name   run_unit_test
+ * @brief  Run a unit test in this process.
+ * @param  test: The unit test
+ * @return 0 if it passed, 1 if it failed
+ */
+int run_unit_test(mock_unit_test_t *test)
+{
+    mock_scenario_t unit = {NULL};
+
+    unit.name = test->name;
+    scenario = &unit;
+    num_failures = 0;
+    test->run();
+    scenario = NULL;
+    printf("%s: %s\n", (0 == num_failures) ? "PASS" : "FAIL", test->name);
+    return (0 == num_failures) ? 0 : 1;
+}
+
+/**
+ * @name   test_rank_lists
+ * @brief  Check rank lists are sorted and have no duplicates, and that bad,
+ *         reversed and huge lists are refused without allocating them.
+ */
+void test_rank_lists(void)
+{
+    const char *bad[] = {"", "x", "1,", "1-", "-3", "1,,2", "1-2-3", "2 ", "5-2",
+                         "0-4000000000", "4294967295", "0-16777216",
+                         "0-9999999,10000000-16777215,0", NULL};
+    uint32_t expected[] = {0, 1, 2, 3, 4, 5, 8};
+    uint32_t *list = NULL;
+    size_t num_ranks = 0, i;
+    int j;
+
+    for (j = 0; NULL != bad[j]; j++) {
+        list = NULL;
+        if (0 == MPIR_Shim_parse_rank_list(bad[j], &list, &num_ranks)) {
+            printf("%s: rank list '%s' accepted\n", scenario->name, bad[j]);
+            check(0, "Accepted bad rank list %d", j);
+            free(list);
+        }
+    }
+
+    // Overlapping ranges and repeated ranks, out of order
+    check(0 == MPIR_Shim_parse_rank_list("8,2-5,0-3,3,8", &list, &num_ranks),
+          "Refused overlapping rank list %d", 0);
+    check(sizeof(expected) / sizeof(expected[0]) == num_ranks,
+          "Overlapping rank list gave %d ranks", (int)num_ranks);
+    for (i = 0; i < num_ranks && i < sizeof(expected) / sizeof(expected[0]); i++) {
+        check(expected[i] == list[i], "Rank list entry %d is wrong", (int)i);
+    }
+    free(list);
+
+    // The largest list allowed
+    list = NULL;
+    check(0 == MPIR_Shim_parse_rank_list("0-16777215", &list, &num_ranks),
+          "Refused rank list of %d ranks", 16777216);
+    check(16777216 == num_ranks, "Largest rank list gave %d ranks", (int)num_ranks);
+    check(NULL != list && 16777215 == list[num_ranks - 1], "Last rank of largest list %d",
+          (NULL != list) ? (int)list[num_ranks - 1] : -1);
+    free(list);
+}
+
+/**
+ * @name   release_by_api
+ * @brief  Release the ranks of the first job with the public release calls,
+ *         checking invalid requests are refused and each call releases what
+ *         it names: ranks 0 and 1, then 2 to 5 and 7, then the node of rank
+ *         8, then the rest. For 16 ranks placed in blocks of 4 per node.
+ */
+void release_by_api(void)
+{
+    char hostname[MOCK_PMIX_MAX_HOSTNAME];
+    int ranks[] = {0, 1, 16};
+
+    check(0 == mock_pmix_num_released(0), "%d ranks released before MPIR_Breakpoint returned",
+          mock_pmix_num_released(0));
+
+    check(0 != MPIR_Shim_release_ranks(1, ranks, 2), "Released ranks of job %d", 1);
+    check(0 != MPIR_Shim_release_ranks(0, &ranks[2], 1), "Released rank %d", ranks[2]);
+    check(0 != MPIR_Shim_release_rank_ranges(0, "5-2"), "Released rank range %d-2", 5);
+    check(0 != MPIR_Shim_release_rank_ranges(0, "1,x"), "Released rank list %d,x", 1);
+    check(0 != MPIR_Shim_release_rank_ranges(0, "15-16"), "Released rank %d", 16);
+    check(0 != MPIR_Shim_release_host("no-such-node"), "Released unknown host %d", 0);
+    check(0 == mock_pmix_num_released(0), "%d ranks released by invalid requests",
+          mock_pmix_num_released(0));
+
+    check(0 == MPIR_Shim_release_ranks(0, ranks, 2), "MPIR_Shim_release_ranks failed", 0);
+    check(2 == mock_pmix_num_released(0), "%d ranks released after ranks 0 and 1",
+          mock_pmix_num_released(0));
+    check(0 == MPIR_Shim_release_rank_ranges(0, "2-5,7"),
+          "MPIR_Shim_release_rank_ranges failed", 0);
+    check(7 == mock_pmix_num_released(0), "%d ranks released after ranks 2-5,7",
+          mock_pmix_num_released(0));
+    mock_pmix_hostname(8, atoi(scenario->num_ranks), hostname, sizeof(hostname));
+    check(0 == MPIR_Shim_release_host(hostname), "MPIR_Shim_release_host failed", 0);
+    check(11 == mock_pmix_num_released(0), "%d ranks released after the node of rank 8",
+          mock_pmix_num_released(0));
+    check(0 == MPIR_Shim_release_rank_ranges(0, "6,12-15"),
+          "MPIR_Shim_release_rank_ranges failed", 0);
+}
+
+/**
+ * @name   setup_rate_limit
+ * @brief  Limit each rank to 1000 bytes of output a second, noting what is
+ *         suppressed, and have every rank write 30 lines of 100 bytes at
+ *         once, with rank prefixes.
+ */
+void setup_rate_limit(void)
+{
+    char line[101];
+
+    memset(line, 'x', sizeof(line) - 2);
+    line[sizeof(line) - 2] = '\n';
+    line[sizeof(line) - 1] = '\0';
+    setenv("MOCK_PMIX_OUTPUT", line, 1);
+    setenv("MOCK_PMIX_OUTPUT_COUNT", "30", 1);
+    check(0 == MPIR_Shim_set_output_prefix("rank"), "Output prefix refused %d", 0);
+    check(0 == MPIR_Shim_set_output_rate_limit(1000, 0, "summarize"),
+          "Output rate limit refused %d", 0);
+    capture_start();
+}
+
+/**
+ * @name   verify_rate_limit
+ * @brief  Check each rank got its burst of 1000 bytes through, give or take
+ *         a line for the tokens refilled meanwhile, that the notes in its
+ *         stderr add up to the rest, and that the total suppressed is
+ *         reported.
+ */
+void verify_rate_limit(void)
+{
+    unsigned long lines[16] = {0}, noted[16] = {0}, bytes, expected = 0, total = 0, pieces = 0;
+    unsigned int rank;
+    const char *line;
+    int r;
+
+    capture_stop();
+
+    for (line = captured_stdout; NULL != line && '\0' != *line; line = next_line(line)) {
+        if (1 != sscanf(line, "[%u] ", &rank) || 16 <= rank) {
+            check(0, "Unexpected output at offset %d", (int)(line - captured_stdout));
+            break;
+        }
+        lines[rank]++;
+    }
+    for (line = captured_stderr; NULL != line && '\0' != *line; line = next_line(line)) {
+        if (2 == sscanf(line, "[%u] [%lu bytes of output suppressed", &rank, &bytes) &&
+            16 > rank) {
+            noted[rank] += bytes;
+        }
+        else {
+            (void)sscanf(line, "%lu bytes of application output in %lu pieces", &total,
+                         &pieces);
+        }
+    }
+
+    for (r = 0; r < 16; r++) {
+        check(10 <= lines[r] && 13 >= lines[r], "Rank %d got the wrong number of lines", r);
+        check((30 - lines[r]) * 100 == noted[r], "Rank %d noted the wrong suppressed bytes", r);
+        expected += (30 - lines[r]) * 100;
+    }
+    check(expected == total, "%d bytes reported suppressed", (int)total);
+    check(100 * pieces == total, "%d pieces reported suppressed", (int)pieces);
+}
+
+/**
+ * @name   setup_aggregation
+ * @brief  Aggregate the output over a window longer than the session, with
+ *         every rank writing a line naming its node and the start of a line
+ *         it never finishes.
+ */
+void setup_aggregation(void)
+{
+    setenv("MOCK_PMIX_OUTPUT", "hello from %h\ndone", 1);
+    check(0 == MPIR_Shim_set_output_aggregation(5000), "Output aggregation refused %d", 0);
+    capture_start();
+}
+
+/**
+ * @name   verify_aggregation
+ * @brief  Check each distinct line was printed once, in the order first
+ *         seen, with the ranges of ranks that printed it. The unfinished
+ *         lines come last, when the output is drained.
+ */
+void verify_aggregation(void)
+{
+    const char *expected =
+        "[0,4,8,12] hello from node0000\n"
+        "[1,5,9,13] hello from node0001\n"
+        "[2,6,10,14] hello from node0002\n"
+        "[3,7,11,15] hello from node0003\n"
+        "[0-15] done\n";
+
+    capture_stop();
+    check(NULL != captured_stdout && 0 == strcmp(expected, captured_stdout),
+          "Aggregated output does not match %d", 0);
+}
+
+/**
+ * @name   setup_stdin_ranks
+ * @brief  Forward a file of a little over 3 chunks as stdin to ranks 1, 3
+ *         and 4, the ranks given out of order and twice. Stdin is left at
+ *         an offset into the file, where forwarding starts.
+ */
+void setup_stdin_ranks(void)
+{
+    char path[PATH_MAX], buffer[4096];
+    long written;
+    int fd;
+
+    temp_path(path, sizeof(path), "stdin");
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    check(0 <= fd, "Unable to create the stdin file %d", fd);
+    unlink(path);
+    memset(buffer, 's', sizeof(buffer));
+    for (written = 0; 0 <= fd && written < STDIN_FILE_SIZE; written += sizeof(buffer)) {
+        check((ssize_t)sizeof(buffer) == write(fd, buffer, sizeof(buffer)),
+              "Unable to write the stdin file at offset %d", (int)written);
+    }
+    check(0 == ftruncate(fd, STDIN_FILE_SIZE), "Unable to size the stdin file %d", fd);
+    check(STDIN_FILE_OFFSET == lseek(fd, STDIN_FILE_OFFSET, SEEK_SET),
+          "Unable to seek the stdin file %d", fd);
+    check(STDIN_FILENO == dup2(fd, STDIN_FILENO), "Unable to redirect stdin %d", fd);
+    close(fd);
+    check(0 == MPIR_Shim_set_stdin_target("4,1,3-4"), "Stdin target refused %d", 0);
+}
+
+/**
+ * @name   verify_stdin_ranks
+ * @brief  Check only ranks 1, 3 and 4 got the file, and were told it ended.
+ */
+void verify_stdin_ranks(void)
+{
+    check_stdin("01011000", STDIN_FILE_SIZE - STDIN_FILE_OFFSET);
+}
+
+/**
+ * @name   setup_stdin_all
+ * @brief  Forward a pipe holding a few lines as stdin to all ranks.
+ */
+void setup_stdin_all(void)
+{
+    int fds[2];
+
+    check(0 == pipe(fds), "Unable to create the stdin pipe %d", 0);
+    check(STDIN_PIPE_SIZE == write(fds[1], STDIN_PIPE_TEXT, STDIN_PIPE_SIZE),
+          "Unable to write the stdin pipe %d", 0);
+    close(fds[1]);
+    check(STDIN_FILENO == dup2(fds[0], STDIN_FILENO), "Unable to redirect stdin %d", 0);
+    close(fds[0]);
+    check(0 == MPIR_Shim_set_stdin_target("all"), "Stdin target refused %d", 0);
+}
+
+/**
+ * @name   verify_stdin_all
+ * @brief  Check every rank got the lines and was told stdin ended.
+ */
+void verify_stdin_all(void)
+{
+    check_stdin("11111111", STDIN_PIPE_SIZE);
+}
+
+/**
+ * @name   setup_timings
+ * @brief  Write the phase timings of the session to a temporary file.
+ */
+void setup_timings(void)
+{
+    char path[PATH_MAX];
+
+    temp_path(path, sizeof(path), "timings");
+    check(0 == MPIR_Shim_set_timings_file(path), "Timings file refused %d", 0);
+}
+
+/**
+ * @name   verify_timings
+ * @brief  Check the timings file describes the session, that its phases are
+ *         the ones MPIR_Shim_get_timings returns, in the same order, and
+ *         that the main phases of each job and of the session were timed,
+ *         in the order they ended, within the total.
+ */
+void verify_timings(void)
+{
+    static const char *job_phases[] = {"spawn", "release_launcher", "ready_for_debug",
+                                       "register_application_terminate_handler",
+                                       "terminate", NULL};
+    static const char *session_phases[] = {"tool_init", "proctable_build", "breakpoint",
+                                           "tool_finalize", "total", NULL};
+    const MPIR_Shim_timing_t *timings = NULL;
+    char path[PATH_MAX], expected[256], *json;
+    const char *line;
+    double end_ms = 0;
+    int num_timings = 0, num_lines = 0, i, j;
+
+    temp_path(path, sizeof(path), "timings");
+    json = read_file(path);
+    unlink(path);
+    check(NULL != json, "Timings file not written %d", 0);
+    if (NULL == json) {
+        return;
+    }
+    check(0 == MPIR_Shim_get_timings(&timings, &num_timings), "No timings %d", 0);
+
+    check(NULL != strstr(json, "\n  \"version\": 1,\n"), "No version %d", 1);
+    check(NULL != strstr(json, "\n  \"mode\": \"proxy\",\n"), "Mode is not proxy %d", 0);
+    check(NULL != strstr(json, "\n  \"launcher\": \"prterun\",\n"),
+          "Launcher is not prterun %d", 0);
+    snprintf(expected, sizeof(expected), "\n  \"num_jobs\": %d,\n  \"num_procs\": %d,\n",
+             num_jobs(), num_jobs() * atoi(scenario->num_ranks));
+    check(NULL != strstr(json, expected), "Wrong counts of %d jobs", num_jobs());
+    check(NULL != strstr(json, "\n  \"status\": 0,\n"), "Status is not %d", 0);
+
+    for (line = json; NULL != line && '\0' != *line; line = next_line(line)) {
+        if (0 != strncmp(line, "    {\"phase\": ", 14)) {
+            continue;
+        }
+        if (num_lines < num_timings) {
+            snprintf(expected, sizeof(expected),
+                     "    {\"phase\": \"%s\", \"job\": %d, \"start_ms\": %.3f, "
+                     "\"elapsed_ms\": %.3f}",
+                     timings[num_lines].phase, timings[num_lines].job_index,
+                     timings[num_lines].start_ms, timings[num_lines].elapsed_ms);
+            check(0 == strncmp(line, expected, strlen(expected)),
+                  "Phase %d does not match MPIR_Shim_get_timings", num_lines);
+        }
+        num_lines++;
+    }
+    check(num_timings == num_lines, "%d phases in the timings file", num_lines);
+    free(json);
+
+    for (j = 0; j < num_jobs(); j++) {
+        for (i = 0; NULL != job_phases[i]; i++) {
+            check(1 == count_timings(timings, num_timings, job_phases[i], j),
+                  "Phase of job %d timed other than once", j);
+        }
+    }
+    for (i = 0; NULL != session_phases[i]; i++) {
+        check(1 == count_timings(timings, num_timings, session_phases[i], -1),
+              "Session phase %d timed other than once", i);
+    }
+    for (i = 0; i < num_timings; i++) {
+        check(0 <= timings[i].start_ms && 0 <= timings[i].elapsed_ms,
+              "Phase %d has a negative time", i);
+        check(end_ms <= timings[i].start_ms + timings[i].elapsed_ms + 1e-6,
+              "Phase %d ended before the one ahead of it", i);
+        end_ms = timings[i].start_ms + timings[i].elapsed_ms;
+    }
+    check(0 < num_timings && 0 == strcmp("total", timings[num_timings - 1].phase) &&
+          0 == timings[num_timings - 1].start_ms, "Total is not the last of %d phases",
+          num_timings);
+}
+
+/**
+ * @name   setup_profile
+ * @brief  Profile the PMIx calls of the session.
+ */
+void setup_profile(void)
+{
+    char path[PATH_MAX];
+
+    temp_path(path, sizeof(path), "profile");
+    check(0 == MPIR_Shim_set_pmix_profile(path), "PMIx profile refused %d", 0);
+}
+
+/**
+ * @name   verify_profile
+ * @brief  Write the profile of the session and check it counted the calls
+ *         the session made to the mock, none of them failed, and each call's
+ *         histogram and return codes add up to its count. Each job releases
+ *         its launcher and its ranks.
+ */
+void verify_profile(void)
+{
+    // Calls of the session, at least the given number per job or per
+    // session, exactly if marked so
+    static const struct {
+        const char *name;
+        int per_job;
+        int exact;
+        unsigned long count;
+    } expected[] = {
+        {"PMIx_tool_init", 0, 1, 1},
+        {"PMIx_tool_finalize", 0, 1, 1},
+        {"PMIx_Spawn", 1, 1, 1},
+        {"PMIx_Query_info", 1, 0, 1},
+        {"PMIx_Notify_event", 1, 1, 2},
+        {"PMIx_Register_event_handler", 1, 0, 5},
+        {NULL}
+    };
+    unsigned long count = 0, errors, other, calls[sizeof(expected) / sizeof(expected[0])] = {0};
+    char path[PATH_MAX], name[64], *json;
+    const char *line, *histogram, *codes;
+    int i, num_calls = 0;
+
+    temp_path(path, sizeof(path), "profile");
+    check(0 == MPIR_Shim_write_pmix_profile(path), "Unable to write the profile %d", 0);
+    json = read_file(path);
+    unlink(path);
+    check(NULL != json, "Profile file not written %d", 0);
+    if (NULL == json) {
+        return;
+    }
+
+    for (line = json; NULL != line && '\0' != *line; line = next_line(line)) {
+        if (3 != sscanf(line, "    {\"name\": \"%63[^\"]\", \"count\": %lu, \"errors\": %lu,",
+                        name, &count, &errors)) {
+            continue;
+        }
+        num_calls++;
+        check(0 == errors, "Call %d of the profile has errors", num_calls);
+        histogram = next_line(line);
+        line = (NULL == histogram) ? NULL : next_line(histogram);
+        codes = (NULL == line) ? NULL : strstr(line, "], \"other_codes\": ");
+        if (NULL == codes || 0 != strncmp(histogram, "     \"histogram\": [", 19) ||
+            0 != strncmp(line, "     \"return_codes\": [", 22) ||
+            1 != sscanf(codes, "], \"other_codes\": %lu", &other)) {
+            check(0, "Call %d of the profile is malformed", num_calls);
+            break;
+        }
+        check(count == sum_counts(histogram), "Histogram of call %d does not add up",
+              num_calls);
+        check(count == sum_counts(line) + other, "Return codes of call %d do not add up",
+              num_calls);
+        for (i = 0; NULL != expected[i].name; i++) {
+            if (0 == strcmp(name, expected[i].name)) {
+                calls[i] = count;
+            }
+        }
+    }
+    free(json);
+
+    for (i = 0; NULL != expected[i].name; i++) {
+        count = expected[i].count * (expected[i].per_job ? (unsigned long)num_jobs() : 1);
+        check(expected[i].exact ? count == calls[i] : count <= calls[i],
+              "Profile counted %d calls of one kind", (int)calls[i]);
+    }
+    // Every PMIx_Query_info is a query the mock answered
+    check(mock_pmix_num_queries() == (int)calls[3], "Profile counted %d queries",
+          (int)calls[3]);
+}
+
+/**
+ * @name   setup_trace
+ * @brief  Trace every category of the session.
+ */
+void setup_trace(void)
+{
+    check(0 == MPIR_Shim_set_trace("all"), "Trace categories refused %d", 0);
+}
+
+/**
+ * @name   verify_trace
+ * @brief  Dump the trace of the session and decode it with mpirtrace. Check
+ *         the records are in time order, name the namespaces and the
+ *         termination of each job, and that mpirtrace -c prints only the
+ *         records of the category.
+ */
+void verify_trace(void)
+{
+    char path[PATH_MAX], command[PATH_MAX + 32], expected[128], category[16];
+    unsigned int hours, minutes, seconds;
+    unsigned long us, records = 0, time_us, last_us = 0, num_events = 0, num_lines;
+    char *text;
+    const char *line;
+    int tid, j;
+
+    temp_path(path, sizeof(path), "trace");
+    check(0 == MPIR_Shim_dump_trace(path), "Unable to dump the trace %d", 0);
+    snprintf(command, sizeof(command), "mpirtrace %s", path);
+    text = run_tool(command);
+    check(NULL != text, "mpirtrace failed %d", 0);
+    if (NULL == text) {
+        unlink(path);
+        return;
+    }
+
+    snprintf(expected, sizeof(expected), "# %s: pid %d, dumped ", path, (int)getpid());
+    check(0 == strncmp(text, expected, strlen(expected)) &&
+          1 == sscanf(strstr(text, ", dumped ") + 9, "%*s %*s %lu records", &records) &&
+          0 < records, "Wrong trace header of %d records", (int)records);
+    for (num_lines = 0, line = next_line(text); NULL != line; line = next_line(line)) {
+        if (6 != sscanf(line, "%2u:%2u:%2u.%6lu %d %15s ", &hours, &minutes, &seconds, &us,
+                        &tid, category)) {
+            check(0, "Trace line %d is malformed", (int)num_lines);
+            break;
+        }
+        time_us = ((hours * 60 + minutes) * 60 + seconds) * 1000000UL + us;
+        check(last_us <= time_us, "Trace line %d is out of order", (int)num_lines);
+        last_us = time_us;
+        if (0 == strcmp(category, "event")) {
+            num_events++;
+        }
+        num_lines++;
+    }
+    check(records == num_lines, "mpirtrace printed %d records", (int)num_lines);
+    for (j = 0; j < num_jobs(); j++) {
+        snprintf(expected, sizeof(expected),
+                 " general Job %d application namespace is 'mock-app.%d'\n", j, j);
+        check(NULL != strstr(text, expected), "No namespace traced for job %d", j);
+        snprintf(expected, sizeof(expected),
+                 " event   Notified job terminated, affected 'mock-app.%d', exit status 0\n",
+                 j);
+        check(NULL != strstr(text, expected), "No termination traced for job %d", j);
+    }
+    check(NULL != strstr(text, " flow    >>> ENTER (MPIR_Shim_release_application): "),
+          "No function entry traced %d", 0);
+    free(text);
+
+    snprintf(command, sizeof(command), "mpirtrace -c event %s", path);
+    text = run_tool(command);
+    unlink(path);
+    check(NULL != text, "mpirtrace -c event failed %d", 0);
+    if (NULL == text) {
+        return;
+    }
+    for (num_lines = 0, line = next_line(text); NULL != line; line = next_line(line)) {
+        check(6 == sscanf(line, "%2u:%2u:%2u.%6lu %d %15s ", &hours, &minutes, &seconds,
+                          &us, &tid, category) && 0 == strcmp(category, "event"),
+              "Line %d of the event records is not an event", (int)num_lines);
+        num_lines++;
+    }
+    check(num_events == num_lines, "mpirtrace -c event printed %d records", (int)num_lines);
+    free(text);
+}
+
+/**
+ * @name   verify_memory
+ * @brief  Write the memory report of the shim, which still holds the tables
+ *         of the session, and check the process table and its strings are
+ *         accounted for, the total is the sum of the structures, and no
+ *         current use exceeds its peak.
+ */
+void verify_memory(void)
+{
+    static const char *names[] = {"proctable", "strings", "events", "io_buffers", "caches",
+                                  NULL};
+    long bytes[5] = {0}, peaks[5] = {0}, sum = 0, sum_peaks = 0, total = -1, peak_total = -1;
+    long rss = -1, peak_rss = -1;
+    char path[PATH_MAX], name[16], *json;
+    char hostname[MOCK_PMIX_MAX_HOSTNAME], last_hostname[MOCK_PMIX_MAX_HOSTNAME] = "";
+    const char *line;
+    size_t strings = 0;
+    int i, num_structures = 0;
+
+    temp_path(path, sizeof(path), "memory");
+    check(0 == MPIR_Shim_write_memory_report(path), "Unable to write the memory report %d",
+          0);
+    json = read_file(path);
+    unlink(path);
+    check(NULL != json, "Memory report not written %d", 0);
+    if (NULL == json) {
+        return;
+    }
+
+    for (line = json; NULL != line && '\0' != *line; line = next_line(line)) {
+        if (num_structures < 5 &&
+            3 == sscanf(line, "    {\"name\": \"%15[^\"]\", \"bytes\": %ld, \"peak_bytes\": %ld}",
+                        name, &bytes[num_structures], &peaks[num_structures])) {
+            check(0 == strcmp(names[num_structures], name), "Structure %d is misnamed",
+                  num_structures);
+            check(0 <= bytes[num_structures] && bytes[num_structures] <= peaks[num_structures],
+                  "Structure %d is over its peak", num_structures);
+            sum += bytes[num_structures];
+            sum_peaks += peaks[num_structures];
+            num_structures++;
+        }
+        (void)sscanf(line, "  \"total_bytes\": %ld,", &total);
+        (void)sscanf(line, "  \"peak_total_bytes\": %ld,", &peak_total);
+        (void)sscanf(line, "  \"rss_bytes\": %ld,", &rss);
+        (void)sscanf(line, "  \"peak_rss_bytes\": %ld", &peak_rss);
+    }
+    free(json);
+
+    check(5 == num_structures, "Memory report has %d structures", num_structures);
+    check((long)(MPIR_proctable_size * sizeof(MPIR_PROCDESC)) <= bytes[0],
+          "Process table of %d bytes", (int)bytes[0]);
+    // The process table was built from the query results, since freed
+    check(bytes[0] < peaks[0], "Process table peak of %d bytes", (int)peaks[0]);
+    // The strings hold at least each host name, the ranks of a host being
+    // together, and the executable
+    for (i = 0; i < atoi(scenario->num_ranks); i++) {
+        mock_pmix_hostname(i, atoi(scenario->num_ranks), hostname, sizeof(hostname));
+        if (0 != strcmp(last_hostname, hostname)) {
+            strings += strlen(hostname) + 1;
+            strcpy(last_hostname, hostname);
+        }
+    }
+    strings += strlen("./hello") + 1;
+    check((long)strings <= bytes[1], "Strings of %d bytes", (int)bytes[1]);
+    check(sum == total, "Total of %d bytes", (int)total);
+    check(total <= peak_total && peak_total <= sum_peaks, "Peak total of %d bytes",
+          (int)peak_total);
+    check(0 < rss && rss <= peak_rss, "Resident size of %d bytes", (int)rss);
+}
+
+/**
+ * @name   setup_hold_report
+ * @brief  Report the hold and release latency of the session, released in
+ *         waves of 5 ranks.
+ */
+void setup_hold_report(void)
+{
+    char path[PATH_MAX];
+
+    temp_path(path, sizeof(path), "hold");
+    check(0 == MPIR_Shim_set_hold_report(path), "Hold report refused %d", 0);
+}
+
+/**
+ * @name   verify_hold_report
+ * @brief  Check the report covers every rank of the job and its release
+ *         waves, that no rank is reported held before it was forked, and
+ *         that each node is listed once, slowest first, with its ranks.
+ */
+void verify_hold_report(void)
+{
+    static const char *names[] = {"spawn_to_forked_ms", "spawn_to_held_ms", "held_ms",
+                                  "release_delivered_ms", NULL};
+    double stats[4][6], held_p50, held_max, release_max, last_held_max = -1;
+    unsigned long ranks = 0, node_ranks;
+    char path[PATH_MAX], host[32], *json;
+    const char *line, *node;
+    int polls = 0, releases = 0, i, k, num_nodes = 0, seen_nodes = 0;
+
+    temp_path(path, sizeof(path), "hold");
+    json = read_file(path);
+    unlink(path);
+    check(NULL != json, "Hold report not written %d", 0);
+    if (NULL == json) {
+        return;
+    }
+
+    line = strstr(json, "    {\"job\": 0, ");
+    check(NULL != line && 2 == sscanf(line, "    {\"job\": 0, \"ranks\": %lu, \"polls\": %d,",
+                                      &ranks, &polls), "No report of job %d", 0);
+    check(16 == ranks && 0 < polls, "Report of %d ranks", (int)ranks);
+    line = strstr(json, "\"releases\": ");
+    check(NULL != line && 1 == sscanf(line, "\"releases\": %d", &releases) && 4 == releases,
+          "Report of %d releases", releases);
+
+    // The ranks, minimum, 50th, 90th and 99th percentiles and maximum
+    for (i = 0; NULL != names[i]; i++) {
+        check(0 == read_hold_stats(json, names[i], stats[i]),
+              "Distribution %d of the report is missing", i);
+        check(16 == stats[i][0] && 0 <= stats[i][1],
+              "Distribution %d does not cover every rank", i);
+        for (k = 2; k < 6; k++) {
+            check(stats[i][k - 1] <= stats[i][k], "Distribution %d is out of order", i);
+        }
+    }
+    check(stats[0][1] <= stats[1][1] && stats[0][5] <= stats[1][5],
+          "Ranks held before forked, %d", 0);
+
+    node = strstr(json, "\"slowest_nodes\": [");
+    for (node = (NULL == node) ? NULL : strchr(node, '{'); NULL != node;
+         node = strstr(node + 1, ", {")) {
+        node = strchr(node, '{');
+        if (5 != sscanf(node, "{\"host\": \"%31[^\"]\", \"ranks\": %lu, \"held_p50_ms\": %lf, "
+                        "\"held_max_ms\": %lf, \"release_max_ms\": %lf}", host, &node_ranks,
+                        &held_p50, &held_max, &release_max)) {
+            check(0, "Node %d of the report is malformed", num_nodes);
+            break;
+        }
+        check(0 == strncmp(host, "node000", 7) && '0' <= host[7] && '3' >= host[7] &&
+              '\0' == host[8] && !(seen_nodes & (1 << (host[7] - '0'))),
+              "Node %d of the report is not a new node", num_nodes);
+        seen_nodes |= 1 << (host[7] - '0');
+        check(4 == node_ranks, "Node %d does not have 4 ranks", num_nodes);
+        check(held_p50 <= held_max && held_max <= stats[1][5] &&
+              release_max <= stats[3][5], "Node %d is out of the job's range", num_nodes);
+        check(0 > last_held_max || held_max <= last_held_max,
+              "Node %d is slower than the one before", num_nodes);
+        last_held_max = held_max;
+        num_nodes++;
+    }
+    check(4 == num_nodes, "Report lists %d nodes", num_nodes);
+    free(json);
+}
+
+/**
+ * @name   setup_journal
+ * @brief  Journal the session.
+ */
+void setup_journal(void)
+{
+    char path[PATH_MAX];
+
+    temp_path(path, sizeof(path), "journal");
+    check(0 == MPIR_Shim_set_journal(path, 0), "Journal refused %d", 0);
+}
+
+/**
+ * @name   verify_journal
+ * @brief  Decode the journal with mpirjournal and check every record was
+ *         kept, in sequence, from the start of the session to its end, with
+ *         the process table, releases and exit of each job.
+ */
+void verify_journal(void)
+{
+    char path[PATH_MAX], command[PATH_MAX + 32], expected[PATH_MAX + 64], type[32];
+    char record[128], *text;
+    unsigned long records = 0, kept = 0, seq, num_lines = 0;
+    const char *first, *line, *last = NULL;
+    int tid, j, num_spawned = 0;
+
+    temp_path(path, sizeof(path), "journal");
+    snprintf(command, sizeof(command), "mpirjournal %s", path);
+    text = run_tool(command);
+    unlink(path);
+    check(NULL != text, "mpirjournal failed %d", 0);
+    if (NULL == text) {
+        return;
+    }
+
+    // Nothing overwritten or left incomplete
+    snprintf(expected, sizeof(expected), "# %s: pid %d, opened ", path, (int)getpid());
+    first = next_line(text);
+    check(0 == strncmp(text, expected, strlen(expected)) && NULL != first &&
+          2 == sscanf(text + strlen(expected), "%*s %*s %lu records appended, %lu kept",
+                      &records, &kept) && records == kept &&
+          0 == strncmp(first - 6, " kept\n", 6), "Wrong journal header of %d records",
+          (int)records);
+    for (line = first; NULL != line; line = next_line(line)) {
+        num_lines++;
+        if (3 != sscanf(line, "%*s %lu %d %31s", &seq, &tid, type) || num_lines != seq) {
+            check(0, "Journal record %d is malformed or out of sequence", (int)num_lines);
+            break;
+        }
+        if (0 == strcmp(type, "state") && NULL != strstr(line, " MPIR_DEBUG_SPAWNED\n")) {
+            num_spawned++;
+        }
+        last = line;
+    }
+    check(records == num_lines, "mpirjournal printed %d records", (int)num_lines);
+    check(1 == num_spawned, "MPIR_DEBUG_SPAWNED journaled %d times", num_spawned);
+
+    snprintf(expected, sizeof(expected), "%-13s %8sproxy mode, %d jobs, launcher 'prterun'\n",
+             "session_start", "", num_jobs());
+    check(NULL != first && NULL != strstr(first, expected) &&
+          strstr(first, expected) < strchr(first, '\n'), "Session start is not record %d", 1);
+    snprintf(expected, sizeof(expected), "%-13s %8sstatus 0, success\n", "session_end", "");
+    check(NULL != last && NULL != strstr(last, expected), "Session end is not record %d",
+          (int)num_lines);
+
+    for (j = 0; j < num_jobs(); j++) {
+        snprintf(record, sizeof(record), "1 processes from mock-launcher.%d:0", j);
+        snprintf(expected, sizeof(expected), "%-13s job %-3d %s\n", "release", j, record);
+        check(NULL != strstr(text, expected), "No launcher release journaled for job %d", j);
+        snprintf(record, sizeof(record), "generation 0, %d processes at %d, mock-app.%d",
+                 atoi(scenario->num_ranks), j * atoi(scenario->num_ranks), j);
+        snprintf(expected, sizeof(expected), "%-13s job %-3d %s\n", "proctable", j, record);
+        check(NULL != strstr(text, expected), "No process table journaled for job %d", j);
+        snprintf(record, sizeof(record), "%d processes from mock-app.%d:*",
+                 atoi(scenario->num_ranks), j);
+        snprintf(expected, sizeof(expected), "%-13s job %-3d %s\n", "release", j, record);
+        check(NULL != strstr(text, expected), "No release journaled for job %d", j);
+        snprintf(record, sizeof(record), "exit code 0, mock-app.%d:*", j);
+        snprintf(expected, sizeof(expected), "%-13s job %-3d %s\n", "exit", j, record);
+        check(NULL != strstr(text, expected), "No exit journaled for job %d", j);
+    }
+    free(text);
+}
+
+/**
+ * @name   check
+ * @brief  Report a failed check of the running scenario.
+ * @param  condition: Whether the check passed
+ * @param  message: Format of the failure, with one %d
+ * @param  value: The value printed with the failure
+ */
+void check(int condition, const char *message, int value)
+{
+    if (condition) {
+        return;
+    }
+    num_failures++;
+    printf("%s: ", scenario->name);
+    printf(message, value);
+    printf("\n");
+}
+
+/**
+ * @name   check_proctable
+ * @brief  Check MPIR_proctable against the layout of the mock: one slice per
+ *         job, with one entry per rank, in rank order, with the node,
+ *         executable and pid of the rank.
+ */
+void check_proctable(void)
+{
+    char hostname[MOCK_PMIX_MAX_HOSTNAME];
+    MPIR_PROCDESC *procdesc;
+    int num_ranks, job, offset, size, rank, num_bad = 0;
+
+    num_ranks = atoi(scenario->num_ranks);
+    check(num_jobs() == MPIR_Shim_jobtable_size, "MPIR_Shim_jobtable_size is %d",
+          MPIR_Shim_jobtable_size);
+    check(num_jobs() * num_ranks == MPIR_proctable_size, "MPIR_proctable_size is %d",
+          MPIR_proctable_size);
+    if (num_jobs() != MPIR_Shim_jobtable_size || num_jobs() * num_ranks != MPIR_proctable_size) {
+        return;
+    }
+    for (job = 0; job < num_jobs(); job++) {
+        if (0 != MPIR_Shim_get_job_view(job, &offset, &size) || num_ranks != size) {
+            check(0, "No MPIR_proctable slice of %d ranks for job %d", job);
+            continue;
+        }
+        for (rank = 0; rank < num_ranks; rank++) {
+            mock_pmix_hostname(rank, num_ranks, hostname, sizeof(hostname));
+            procdesc = &MPIR_proctable[offset + rank];
+            if (MOCK_PMIX_PID_BASE + rank != procdesc->pid ||
+                NULL == procdesc->host_name ||
+                0 != strcmp(hostname, procdesc->host_name) ||
+                NULL == procdesc->executable_name ||
+                0 != strcmp("./hello", procdesc->executable_name)) {
+                if (0 == num_bad++) {
+                    check(0, "MPIR_proctable entry of rank %d does not match", rank);
+                }
+            }
+        }
+    }
+    check(0 == num_bad, "%d MPIR_proctable entries do not match", num_bad);
+}
+
+/**
+ * @name   check_abort
+ * @brief  Check the first failure is reported once the tool has the process
+ *         table, even if the rank aborted before, naming the rank, its exit
+ *         code and its node.
+ */
+void check_abort(void)
+{
+    char hostname[MOCK_PMIX_MAX_HOSTNAME], expected[2 * MOCK_PMIX_MAX_HOSTNAME];
+
+    check(1 == num_spawned, "MPIR_DEBUG_ABORTING reported after %d MPIR_DEBUG_SPAWNED",
+          num_spawned);
+    if (1 < num_aborting || NULL == scenario->fail_rank) {
+        return;
+    }
+    mock_pmix_hostname(atoi(scenario->fail_rank), atoi(scenario->num_ranks), hostname,
+                       sizeof(hostname));
+    snprintf(expected, sizeof(expected), "Rank %s of job 0 aborted with code 134 on %s",
+             scenario->fail_rank, hostname);
+    if (NULL == MPIR_debug_abort_string || 0 != strcmp(expected, MPIR_debug_abort_string)) {
+        printf("%s: MPIR_debug_abort_string is '%s'\n", scenario->name,
+               (NULL == MPIR_debug_abort_string) ? "(null)" : MPIR_debug_abort_string);
+        check(0, "Expected the failure of rank %d", atoi(scenario->fail_rank));
+    }
+}
+
+/**
+ * @name   num_jobs
+ * @brief  Get the number of jobs of the running scenario.
+ * @return The number of jobs
+ */
+int num_jobs(void)
+{
+    return (0 < scenario->num_jobs) ? scenario->num_jobs : 1;
+}
+
+/**
+ * @name   temp_path
+ * @brief  Name a temporary file of this process.
+ * @param  path: Set to the name
+ * @param  size: Size of path
+ * @param  suffix: What the file holds
+ */
+void temp_path(char *path, size_t size, const char *suffix)
+{
+    const char *dir;
+
+    dir = getenv("TMPDIR");
+    snprintf(path, size, "%s/mock_test.%d.%s", (NULL == dir) ? "/tmp" : dir,
+             (int)getpid(), suffix);
+}
+
+/**
+ * @name   capture_start
+ * @brief  Send stdout and stderr to temporary files, so the output the
+ *         session writes can be checked.
+ */
+void capture_start(void)
+{
+    char path[PATH_MAX];
+    int fd, i;
+
+    fflush(stdout);
+    fflush(stderr);
+    saved_stdout = dup(STDOUT_FILENO);
+    saved_stderr = dup(STDERR_FILENO);
+    for (i = 0; i < 2; i++) {
+        temp_path(path, sizeof(path), (0 == i) ? "stdout" : "stderr");
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (0 > fd) {
+            perror(path);
+            _exit(1);
+        }
+        dup2(fd, (0 == i) ? STDOUT_FILENO : STDERR_FILENO);
+        close(fd);
+    }
+}
+
+/**
+ * @name   capture_stop
+ * @brief  Restore stdout and stderr, and read what was written to them
+ *         into captured_stdout and captured_stderr.
+ */
+void capture_stop(void)
+{
+    char path[PATH_MAX];
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stdout);
+    close(saved_stderr);
+
+    temp_path(path, sizeof(path), "stdout");
+    captured_stdout = read_file(path);
+    unlink(path);
+    temp_path(path, sizeof(path), "stderr");
+    captured_stderr = read_file(path);
+    unlink(path);
+    check(NULL != captured_stdout && NULL != captured_stderr,
+          "Unable to read the captured output %d", 0);
+}
+
+/**
+ * @name   check_stdin
+ * @brief  Check the stdin the mock got for each rank of the first job.
+ * @param  targeted: '1' for each rank that should get stdin, '0' otherwise
+ * @param  size: Bytes each targeted rank should get
+ */
+void check_stdin(const char *targeted, long size)
+{
+    long bytes;
+    int rank, closed;
+
+    for (rank = 0; '\0' != targeted[rank]; rank++) {
+        bytes = mock_pmix_stdin_bytes(0, rank, &closed);
+        if ('1' == targeted[rank]) {
+            check(size == bytes, "Rank %d did not get all of stdin", rank);
+            check(closed, "Rank %d was not told stdin ended", rank);
+        }
+        else {
+            check(0 == bytes && !closed, "Rank %d got stdin", rank);
+        }
+    }
+}
+
+/**
+ * @name   sum_counts
+ * @brief  Add up the counts of a JSON list of objects written on one line.
+ * @param  list: The line
+ * @return The sum of the "count" members up to the end of the list
+ */
+unsigned long sum_counts(const char *list)
+{
+    const char *end, *count;
+    unsigned long sum = 0;
+
+    end = strchr(list, ']');
+    for (count = strstr(list, "\"count\": "); NULL != count && NULL != end && count < end;
+         count = strstr(count + 1, "\"count\": ")) {
+        sum += strtoul(count + 9, NULL, 10);
+    }
+    return sum;
+}
+
+/**
+ * @name   read_hold_stats
+ * @brief  Read a distribution of the hold report.
+ * @param  json: The report
+ * @param  name: Member of the distribution
+ * @param  stats: Set to the ranks, minimum, 50th, 90th and 99th percentiles
+ *         and maximum
+ * @return 0 if found, 1 otherwise
+ */
+int read_hold_stats(const char *json, const char *name, double stats[6])
+{
+    char member[64];
+    const char *found;
+
+    snprintf(member, sizeof(member), "\"%s\": {", name);
+    found = strstr(json, member);
+    if (NULL == found ||
+        6 != sscanf(found + strlen(member), "\"ranks\": %lf, \"min\": %lf, \"p50\": %lf, "
+                    "\"p90\": %lf, \"p99\": %lf, \"max\": %lf}", &stats[0], &stats[1],
+                    &stats[2], &stats[3], &stats[4], &stats[5])) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @name   count_timings
+ * @brief  Count the timings of a phase.
+ * @param  timings: The timings
+ * @param  num_timings: Number of timings
+ * @param  phase: Name of the phase
+ * @param  job: Index of the job, -1 for a phase of the session
+ * @return The number of timings of the phase
+ */
+int count_timings(const MPIR_Shim_timing_t *timings, int num_timings, const char *phase,
+                  int job)
+{
+    int i, count = 0;
+
+    for (i = 0; i < num_timings; i++) {
+        if (0 == strcmp(phase, timings[i].phase) && job == timings[i].job_index) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @name   read_file
+ * @brief  Read a whole file as a string.
+ * @param  path: The file
+ * @return The contents, to be freed, NULL if it cannot be read
+ */
+char *read_file(const char *path)
+{
+    FILE *file;
+    char *text;
+
+    file = fopen(path, "r");
+    if (NULL == file) {
+        return NULL;
+    }
+    text = read_stream(file);
+    fclose(file);
+    return text;
+}
+
+/**
+ * @name   run_tool
+ * @brief  Run one of the programs built with the shim, such as mpirtrace,
+ *         and read its output.
+ * @param  command: The program and its arguments
+ * @return The output, to be freed, NULL if the program failed
+ */
+char *run_tool(const char *command)
+{
+    char line[PATH_MAX + 64];
+    FILE *pipe;
+    char *text;
+
+    snprintf(line, sizeof(line), "%s/%s", MOCK_TEST_TOOLDIR, command);
+    pipe = popen(line, "r");
+    if (NULL == pipe) {
+        return NULL;
+    }
+    text = read_stream(pipe);
+    if (0 != pclose(pipe)) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @name   read_stream
+ * @brief  Read a stream to its end as a string.
+ * @param  stream: The stream
+ * @return The contents, to be freed, NULL if out of memory
+ */
+char *read_stream(FILE *stream)
+{
+    char *text = NULL, *new_text;
+    size_t size = 0, capacity = 0, n;
+
+    do {
+        if (capacity - size < 4096) {
+            capacity = (0 == capacity) ? 65536 : 2 * capacity;
+            new_text = realloc(text, capacity + 1);
+            if (NULL == new_text) {
+                free(text);
+                return NULL;
+            }
+            text = new_text;
+        }
+        n = fread(text + size, 1, capacity - size, stream);
+        size += n;
+    } while (0 < n);
+    text[size] = '\0';
+    return text;
+}
+
+/**
+ * @name   next_line
+ * @brief  Step to the next line of a text.
+ * @param  line: The current line
+ * @return The next line, NULL at the end of the text
+ */
+const char *next_line(const char *line)
+{
+    line = strchr(line, '\n');
+    return (NULL == line || '\0' == line[1]) ? NULL : line + 1;
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2026      agent.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * @file  mpirshim_bench.c
+ * @brief Benchmark the launch path of the shim, from MPIR_Shim_common to
+ *        MPIR_Breakpoint through pmix_proc_table_to_mpir, and its teardown,
+ *        against the mock PMIx server of mock_pmix.c, for synthetic jobs
+ *        of increasing size. Run by "make bench".
+ *
+ * Each case runs one session in a child process, so that its peak resident
+ * set size is its own, with the mock answering without delay. The results
+ * are written as CSV and as JSON, one row per run, to be compared across
+ * releases.
+ *
+ *   mpirshim_bench --ranks 1000,1000000 --nodes 10,1000 --csv bench.csv
+ */
+#include "mpirshim.h"
+#include "mpirshim_test.h"
+#include "mock_pmix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <argp.h>
+
+/* Use argp to parse the command line
+ *   https://www.gnu.org/software/libc/manual/html_node/Argp.html
+ */
+static error_t bench_parse_opt(int key, char *arg, struct argp_state *state);
+
+static char args_doc[] = "";
+static char args_extra_doc[] =
+    "MPIR Shim launch benchmark\n"
+    "\n"
+    "Every combination of the listed ranks, nodes, path lengths and host\n"
+    "name lengths is run. A node count of 0 places 32 ranks per node. The\n"
+    "results are printed as CSV unless --csv or --json is given.\n"
+    "\n"
+    "OPTIONS:";
+static struct argp_option args_options[] =
+    {
+        {"ranks",       'r', "LIST", 0, "Ranks of the jobs (Default: 1,10,100,1000,10000,100000,1000000)"},
+        {"nodes",       'n', "LIST", 0, "Nodes of the jobs (Default: 0)"},
+        {"path-length", 'p', "LIST", 0, "Length of the executable path (Default: 32)"},
+        {"host-length", 'H', "LIST", 0, "Length of the host names (Default: 8)"},
+        {"repeat",      'R', "N",    0, "Runs of each combination (Default: 1)"},
+        {"csv",         'c', "FILE", 0, "Write the results as CSV to FILE"},
+        {"json",        'j', "FILE", 0, "Write the results as JSON to FILE"},
+        {0}
+    };
+static struct argp argp = { args_options, bench_parse_opt, args_doc, args_extra_doc};
+
+// Ranks placed on each node when the node count is 0
+#define BENCH_RANKS_PER_NODE 32
+#define BENCH_MAX_VALUES 32
+// Longest executable path
+#define BENCH_MAX_LENGTH 4096
+
+extern int MPIR_debug_state;
+
+typedef struct bench_list_t {
+    int values[BENCH_MAX_VALUES];
+    int num_values;
+} bench_list_t;
+
+typedef struct bench_result_t {
+    int num_ranks;
+    int num_nodes;
+    int path_length;
+    int host_length;
+    int run;
+    int status;                 // Return code of the session, -1 if it died
+    double breakpoint_ms;       // From MPIR_Shim_common to MPIR_Breakpoint
+    double proctable_query_ms;
+    double proctable_build_ms;
+    double teardown_ms;         // From the release to the return of MPIR_Shim_common
+    long peak_rss_kb;
+    long allocations;           // Made by the shim during the session
+} bench_result_t;
+
+static bench_list_t rank_list = {{1, 10, 100, 1000, 10000, 100000, 1000000}, 7};
+static bench_list_t node_list = {{0}, 1};
+static bench_list_t path_list = {{32}, 1};
+static bench_list_t host_list = {{8}, 1};
+static int num_repeats = 1;
+static const char *csv_file = NULL;
+static const char *json_file = NULL;
+
+/*
+ * Allocations are counted by wrapping the allocation calls of the shim and
+ * the mock at link time (-Wl,--wrap), so those made inside libpmix and libc
+ * are not counted.
+ */
+static long num_allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *string);
+char *__real_strndup(const char *string, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+char *__wrap_strdup(const char *string);
+char *__wrap_strndup(const char *string, size_t size);
+
+// State of the session running in this process
+static double session_start_ms = 0;
+static double breakpoint_ms = 0;
+static double release_ms = 0;
+
+static int parse_list(const char *arg, bench_list_t *list);
+static double bench_now(void);
+static int run_case(bench_result_t *result);
+static void run_session(bench_result_t *result);
+static void write_csv(FILE *file, const bench_result_t *results, int num_results);
+static void write_json(FILE *file, const bench_result_t *results, int num_results);
+
+void MPIR_Breakpoint_hook(void)
+{
+    if (1 == MPIR_debug_state && 0 == breakpoint_ms) {
+        breakpoint_ms = bench_now() - session_start_ms;
+        release_ms = bench_now();
+        if (0 != MPIR_Shim_release_application()) {
+            fprintf(stderr, "MPIR_Shim_release_application failed\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_result_t *results;
+    FILE *file;
+    int r, n, p, h, run, num_results = 0, rc = 0;
+
+    argp_parse(&argp, argc, argv, 0, 0, NULL);
+
+    results = calloc((size_t)rank_list.num_values * node_list.num_values *
+                     path_list.num_values * host_list.num_values * num_repeats,
+                     sizeof(bench_result_t));
+    if (NULL == results) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    for (r = 0; r < rank_list.num_values; r++) {
+        for (n = 0; n < node_list.num_values; n++) {
+            for (p = 0; p < path_list.num_values; p++) {
+                for (h = 0; h < host_list.num_values; h++) {
+                    for (run = 0; run < num_repeats; run++) {
+                        bench_result_t *result = &results[num_results++];
+
+                        result->num_ranks = rank_list.values[r];
+                        result->num_nodes = node_list.values[n];
+                        if (0 == result->num_nodes) {
+                            result->num_nodes = (result->num_ranks + BENCH_RANKS_PER_NODE - 1) /
+                                                BENCH_RANKS_PER_NODE;
+                        }
+                        result->path_length = path_list.values[p];
+                        result->host_length = host_list.values[h];
+                        result->run = run;
+                        if (0 != run_case(result)) {
+                            rc = 1;
+                        }
+                        fprintf(stderr, "%d ranks on %d nodes: breakpoint %.3f ms, "
+                                "teardown %.3f ms, peak RSS %ld kB, status %d\n",
+                                result->num_ranks, result->num_nodes,
+                                result->breakpoint_ms, result->teardown_ms,
+                                result->peak_rss_kb, result->status);
+                    }
+                }
+            }
+        }
+    }
+
+    if (NULL == csv_file && NULL == json_file) {
+        write_csv(stdout, results, num_results);
+    }
+    if (NULL != csv_file) {
+        file = fopen(csv_file, "w");
+        if (NULL == file) {
+            perror(csv_file);
+            return 1;
+        }
+        write_csv(file, results, num_results);
+        fclose(file);
+    }
+    if (NULL != json_file) {
+        file = fopen(json_file, "w");
+        if (NULL == file) {
+            perror(json_file);
+            return 1;
+        }
+        write_json(file, results, num_results);
+        fclose(file);
+    }
+    free(results);
+    return rc;
+}
+
+/**
+ * @name  bench_parse_opt
+ * @brief argp command line option parser
+ * @param key: Single character version of the command line options
+ * @param arg: Pointer to the argument provided to this option, if any.
+ * @param state: The argp state object
+ * @return 0 if successful, non-zero otherwise
+ */
+static error_t bench_parse_opt(int key, char *arg, struct argp_state *state)
+{
+    char *endp = NULL;
+
+    switch (key) {
+        case 'r':
+            if (0 != parse_list(arg, &rank_list) || 0 == rank_list.values[0]) {
+                argp_error(state, "Invalid list of ranks '%s'.", arg);
+            }
+            break;
+        case 'n':
+            if (0 != parse_list(arg, &node_list)) {
+                argp_error(state, "Invalid list of nodes '%s'.", arg);
+            }
+            break;
+        case 'p':
+            if (0 != parse_list(arg, &path_list)) {
+                argp_error(state, "Invalid list of path lengths '%s'.", arg);
+            }
+            break;
+        case 'H':
+            if (0 != parse_list(arg, &host_list)) {
+                argp_error(state, "Invalid list of host name lengths '%s'.", arg);
+            }
+            break;
+        case 'R':
+            num_repeats = strtol(arg, &endp, 10);
+            if ('\0' != *endp || 1 > num_repeats) {
+                argp_error(state, "Invalid number of runs '%s'.", arg);
+            }
+            break;
+        case 'c':
+            csv_file = arg;
+            break;
+        case 'j':
+            json_file = arg;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/**
+ * @name   parse_list
+ * @brief  Parse a comma separated list of numbers.
+ * @param  arg: The list
+ * @param  list: Set to the numbers
+ * @return 0 if successful, 1 if a number is invalid or there are too many
+ */
+int parse_list(const char *arg, bench_list_t *list)
+{
+    char *endp;
+    long value;
+
+    list->num_values = 0;
+    do {
+        value = strtol(arg, &endp, 10);
+        if (endp == arg || (',' != *endp && '\0' != *endp) || 0 > value ||
+            1000000000 < value || BENCH_MAX_VALUES == list->num_values) {
+            return 1;
+        }
+        list->values[list->num_values++] = (int)value;
+        arg = endp + 1;
+    } while (',' == *endp);
+    return 0;
+}
+
+/**
+ * @name   bench_now
+ * @brief  Read the clock the benchmark is timed with.
+ * @return Milliseconds
+ */
+double bench_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * @name   run_case
+ * @brief  Run one session in a child process and collect its results.
+ * @param  result: The case, set to its results
+ * @return 0 if successful, 1 if the session failed
+ */
+int run_case(bench_result_t *result)
+{
+    int fds[2], status;
+    pid_t pid;
+
+    if (0 != pipe(fds)) {
+        perror("pipe");
+        return 1;
+    }
+    fflush(NULL);
+    pid = fork();
+    if (0 > pid) {
+        perror("fork");
+        return 1;
+    }
+    if (0 == pid) {
+        close(fds[0]);
+        run_session(result);
+        if (sizeof(*result) != write(fds[1], result, sizeof(*result))) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if (sizeof(*result) != read(fds[0], result, sizeof(*result))) {
+        result->status = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    return (0 == result->status) ? 0 : 1;
+}
+
+/**
+ * @name   run_session
+ * @brief  Launch a job through the shim against the mock, in this process.
+ * @param  result: The case, set to its results
+ */
+void run_session(bench_result_t *result)
+{
+    const MPIR_Shim_timing_t *timings;
+    char path[BENCH_MAX_LENGTH], prefix[MOCK_PMIX_MAX_HOSTNAME], ranks[16], nodes[16];
+    char *launcher[] = {"prterun", "-n", ranks, path, NULL};
+    struct rusage usage;
+    long allocations;
+    int num_timings, length, i;
+
+    /*
+     * An executable path of the requested length, with a directory every 16
+     * characters, and node names of the requested length with their 4 digit
+     * number.
+     */
+    length = result->path_length;
+    length = (8 > length) ? 8 : ((BENCH_MAX_LENGTH - 1 < length) ? BENCH_MAX_LENGTH - 1 : length);
+    for (i = 0; i < length - 6; i++) {
+        path[i] = (0 == i % 16) ? '/' : 'd';
+    }
+    strcpy(&path[length - 6], "/a.out");
+    length = result->host_length - 4;
+    length = (1 > length) ? 1 : ((MOCK_PMIX_MAX_HOSTNAME - 16 < length) ?
+                                 MOCK_PMIX_MAX_HOSTNAME - 16 : length);
+    memset(prefix, 'n', length);
+    prefix[length] = '\0';
+
+    snprintf(ranks, sizeof(ranks), "%d", result->num_ranks);
+    snprintf(nodes, sizeof(nodes), "%d", result->num_nodes);
+    setenv("MOCK_PMIX_NODES", nodes, 1);
+    setenv("MOCK_PMIX_HOST_PREFIX", prefix, 1);
+    setenv("MOCK_PMIX_LAUNCH_MS", "0", 1);
+    setenv("MOCK_PMIX_READY_MS", "0", 1);
+    setenv("MOCK_PMIX_EXIT_MS", "0", 1);
+
+    allocations = __atomic_load_n(&num_allocations, __ATOMIC_RELAXED);
+    session_start_ms = bench_now();
+    result->status = MPIR_Shim_common(MPIR_SHIM_PROXY_MODE, 0, 0, 4, launcher, NULL);
+    result->teardown_ms = bench_now() - release_ms;
+    result->breakpoint_ms = breakpoint_ms;
+    if (0 == breakpoint_ms) {
+        result->status = -1;
+    }
+    result->allocations = __atomic_load_n(&num_allocations, __ATOMIC_RELAXED) -
+                          allocations - mock_pmix_num_allocations();
+
+    if (0 == MPIR_Shim_get_timings(&timings, &num_timings)) {
+        for (i = 0; i < num_timings; i++) {
+            if (0 == strcmp(timings[i].phase, "proctable_query")) {
+                result->proctable_query_ms += timings[i].elapsed_ms;
+            }
+            else if (0 == strcmp(timings[i].phase, "proctable_build")) {
+                result->proctable_build_ms += timings[i].elapsed_ms;
+            }
+        }
+    }
+    getrusage(RUSAGE_SELF, &usage);
+    result->peak_rss_kb = usage.ru_maxrss;
+}
+
+/**
+ * @name   write_csv
+ * @brief  Write the results as CSV, with a header line.
+ * @param  file: File to write to
+ * @param  results: The results
+ * @param  num_results: Number of results
+ */
+void write_csv(FILE *file, const bench_result_t *results, int num_results)
+{
+    int i;
+
+    fprintf(file, "ranks,nodes,path_length,host_length,run,status,breakpoint_ms,"
+            "proctable_query_ms,proctable_build_ms,teardown_ms,peak_rss_kb,allocations\n");
+    for (i = 0; i < num_results; i++) {
+        fprintf(file, "%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%ld,%ld\n",
+                results[i].num_ranks, results[i].num_nodes, results[i].path_length,
+                results[i].host_length, results[i].run, results[i].status,
+                results[i].breakpoint_ms, results[i].proctable_query_ms,
+                results[i].proctable_build_ms, results[i].teardown_ms,
+                results[i].peak_rss_kb, results[i].allocations);
+    }
+}
+
+/**
+ * @name   write_json
+ * @brief  Write the results as JSON.
+ * @param  file: File to write to
+ * @param  results: The results
+ * @param  num_results: Number of results
+ */
+void write_json(FILE *file, const bench_result_t *results, int num_results)
+{
+    int i;
+
+    fprintf(file, "{\n  \"version\": 1,\n  \"pmix_version\": \"%s\",\n  \"results\": [",
+            PMIx_Get_version());
+    for (i = 0; i < num_results; i++) {
+        fprintf(file, "%s\n    {\"ranks\": %d, \"nodes\": %d, \"path_length\": %d, "
+                "\"host_length\": %d, \"run\": %d, \"status\": %d, "
+                "\"breakpoint_ms\": %.3f, \"proctable_query_ms\": %.3f, "
+                "\"proctable_build_ms\": %.3f, \"teardown_ms\": %.3f, "
+                "\"peak_rss_kb\": %ld, \"allocations\": %ld}",
+                (0 == i) ? "" : ",", results[i].num_ranks, results[i].num_nodes,
+                results[i].path_length, results[i].host_length, results[i].run,
+                results[i].status, results[i].breakpoint_ms,
+                results[i].proctable_query_ms, results[i].proctable_build_ms,
+                results[i].teardown_ms, results[i].peak_rss_kb, results[i].allocations);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+/*
+ * Counting wrappers of the allocation calls
+ */
+void *__wrap_malloc(size_t size)
+{
+    __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *string)
+{
+    __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+    return __real_strdup(string);
+}
+
+char *__wrap_strndup(const char *string, size_t size)
+{
+    __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+    return __real_strndup(string, size);
+}